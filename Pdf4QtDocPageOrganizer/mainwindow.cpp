@@ -38,6 +38,7 @@
 #include <QPixmapCache>
 #include <QScreen>
 #include <QGuiApplication>
+#include <QScrollBar>
 
 namespace pdfdocpage
 {
@@ -175,6 +176,8 @@ MainWindow::MainWindow(QWidget* parent) :
 
     connect(&m_mapper, QOverload<int>::of(&QSignalMapper::mapped), this, &MainWindow::onMappedActionTriggered);
     connect(ui->documentItemsView->selectionModel(), &QItemSelectionModel::selectionChanged, this, &MainWindow::updateActions);
+    connect(m_delegate, &PageItemDelegate::pageImageRendered, ui->documentItemsView->viewport(), QOverload<>::of(&QWidget::update));
+    connect(ui->documentItemsView->verticalScrollBar(), &QScrollBar::valueChanged, this, &MainWindow::onViewScrolled);
 
     QList<QAction*> actions = findChildren<QAction*>();
     for (QAction* action : actions)
@@ -239,6 +242,14 @@ void MainWindow::onMappedActionTriggered(int actionId)
     performOperation(static_cast<Operation>(actionId));
 }
 
+void MainWindow::onViewScrolled()
+{
+    // Page images of items, which are no longer visible, are not needed. Visible
+    // items are repainted, so they request their page images again.
+    m_delegate->cancelPendingRequests();
+    ui->documentItemsView->viewport()->update();
+}
+
 void MainWindow::updateActions()
 {
     QList<QAction*> actions = findChildren<QAction*>();
@@ -102,6 +102,7 @@ private slots:
     void on_actionAddDocument_triggered();
     void onMappedActionTriggered(int actionId);
     void updateActions();
+    void onViewScrolled();
 
 private:
     void loadSettings();
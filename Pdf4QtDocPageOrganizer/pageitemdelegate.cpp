@@ -25,19 +25,225 @@
 
 #include <QPainter>
 #include <QPixmapCache>
+#include <QtConcurrent/QtConcurrent>
 
 namespace pdfdocpage
 {
 
-PageItemDelegate::PageItemDelegate(PageItemModel* model, QObject* parent) :
+PageImageRenderer::DocumentRenderData::DocumentRenderData(const pdf::PDFDocument& sourceDocument) :
+    document(sourceDocument),
+    fontCache(pdf::DEFAULT_FONT_CACHE_LIMIT, pdf::DEFAULT_REALIZED_FONT_CACHE_LIMIT),
+    cmsManager(nullptr),
+    optionalContentActivity(&document, pdf::OCUsage::View, nullptr)
+{
+    fontCache.setDocument(pdf::PDFModifiedDocument(&document, &optionalContentActivity));
+    cmsManager.setDocument(&document);
+    cms = cmsManager.getCurrentCMS();
+}
+
+PageImageRenderer::PageImageRenderer(PageItemModel* model, QObject* parent) :
     BaseClass(parent),
     m_model(model),
-    m_rasterizer(nullptr)
+    m_rasterizerPool(nullptr),
+    m_maxRenderTasks(pdf::PDFRasterizerPool::getDefaultRasterizerCount())
 {
-    m_rasterizer = new pdf::PDFRasterizer(this);
+    // Rasterizer pool is used only as an object pool, rasterizers
+    // must be created in the main GUI thread, but can be used in other threads.
     QSurfaceFormat format;
     format.setSamples(16);
-    m_rasterizer->reset(true, format);
+    m_rasterizerPool = new pdf::PDFRasterizerPool(nullptr, nullptr, nullptr, nullptr, pdf::PDFRenderer::getDefaultFeatures(), m_meshQualitySettings, m_maxRenderTasks, true, format, this);
+
+    connect(m_model, &PageItemModel::modelReset, this, &PageImageRenderer::onModelReset);
+}
+
+PageImageRenderer::~PageImageRenderer()
+{
+    m_pendingRequests.clear();
+    m_pendingRequestKeys.clear();
+
+    for (const auto& taskItem : m_renderTasks)
+    {
+        disconnect(taskItem.second.taskWatcher, &QFutureWatcher<QImage>::finished, this, &PageImageRenderer::onPageImageRendered);
+        taskItem.second.taskWatcher->waitForFinished();
+    }
+    m_renderTasks.clear();
+}
+
+void PageImageRenderer::requestPageImage(const QString& key, int documentIndex, pdf::PDFInteger pageIndex, pdf::PageRotation pageRotation, QSize imageSize)
+{
+    if (m_renderTasks.count(key))
+    {
+        // Image is being rendered
+        return;
+    }
+
+    RenderRequest request;
+
+    auto it = m_pendingRequestKeys.find(key);
+    if (it != m_pendingRequestKeys.end())
+    {
+        // Request is already pending, raise its priority
+        auto requestIt = m_pendingRequests.find(it->second);
+        Q_ASSERT(requestIt != m_pendingRequests.end());
+        request = qMove(requestIt->second);
+        m_pendingRequests.erase(requestIt);
+    }
+    else
+    {
+        request.key = key;
+        request.renderData = getDocumentRenderData(documentIndex);
+        request.pageIndex = pageIndex;
+        request.pageRotation = pageRotation;
+        request.imageSize = imageSize;
+
+        if (!request.renderData)
+        {
+            return;
+        }
+    }
+
+    const quint64 priority = ++m_requestCounter;
+    m_pendingRequestKeys[key] = priority;
+    m_pendingRequests[priority] = qMove(request);
+
+    startRenderTasks();
+}
+
+void PageImageRenderer::cancelPendingRequests()
+{
+    m_pendingRequests.clear();
+    m_pendingRequestKeys.clear();
+}
+
+void PageImageRenderer::startRenderTasks()
+{
+    while (int(m_renderTasks.size()) < m_maxRenderTasks && !m_pendingRequests.empty())
+    {
+        // Take request with highest priority (last requested)
+        auto it = std::prev(m_pendingRequests.end());
+        RenderRequest request = qMove(it->second);
+        m_pendingRequests.erase(it);
+        m_pendingRequestKeys.erase(request.key);
+
+        DocumentRenderData* renderData = request.renderData.data();
+        pdf::PDFRasterizerPool* rasterizerPool = m_rasterizerPool;
+        const pdf::PDFMeshQualitySettings& meshQualitySettings = m_meshQualitySettings;
+        const pdf::PDFInteger pageIndex = request.pageIndex;
+        const pdf::PageRotation pageRotation = request.pageRotation;
+        const QSize imageSize = request.imageSize;
+
+        auto renderPage = [renderData, rasterizerPool, &meshQualitySettings, pageIndex, pageRotation, imageSize]() -> QImage
+        {
+            QImage pageImage;
+
+            const pdf::PDFDocument* document = &renderData->document;
+            if (pageIndex >= 0 && pageIndex < pdf::PDFInteger(document->getCatalog()->getPageCount()))
+            {
+                const pdf::PDFPage* page = document->getCatalog()->getPage(pageIndex);
+                Q_ASSERT(page);
+
+                pdf::PDFPrecompiledPage compiledPage;
+                pdf::PDFRenderer renderer(document, &renderData->fontCache, renderData->cms.data(), &renderData->optionalContentActivity, pdf::PDFRenderer::getDefaultFeatures(), meshQualitySettings);
+                renderer.compile(&compiledPage, pageIndex);
+
+                pdf::PDFRasterizer* rasterizer = rasterizerPool->acquire();
+                pageImage = rasterizer->render(pageIndex, page, &compiledPage, imageSize, pdf::PDFRenderer::getDefaultFeatures(), nullptr, pageRotation);
+                rasterizerPool->release(rasterizer);
+            }
+
+            // We store empty image, if page can't be rendered, so it is not requested again
+            if (pageImage.isNull())
+            {
+                pageImage = QImage(imageSize, QImage::Format_ARGB32_Premultiplied);
+                pageImage.fill(Qt::transparent);
+            }
+
+            return pageImage;
+        };
+
+        // Render data are held by the task (not by the rendering function),
+        // so they are always released in the main thread
+        RenderTask& task = m_renderTasks[request.key];
+        task.renderData = request.renderData;
+        task.generation = m_generation;
+        task.taskFuture = QtConcurrent::run(renderPage);
+        task.taskWatcher = new QFutureWatcher<QImage>(this);
+        connect(task.taskWatcher, &QFutureWatcher<QImage>::finished, this, &PageImageRenderer::onPageImageRendered);
+        task.taskWatcher->setFuture(task.taskFuture);
+    }
+}
+
+void PageImageRenderer::onPageImageRendered()
+{
+    bool isImageRendered = false;
+
+    for (auto it = m_renderTasks.begin(); it != m_renderTasks.end();)
+    {
+        RenderTask& task = it->second;
+        if (task.taskWatcher->isFinished())
+        {
+            // Images of the documents, which were removed, are not stored
+            if (task.generation == m_generation)
+            {
+                QImage pageImage = task.taskWatcher->result();
+                QPixmap pixmap = QPixmap::fromImage(qMove(pageImage));
+                QPixmapCache::insert(it->first, pixmap);
+                isImageRendered = true;
+            }
+
+            task.taskWatcher->deleteLater();
+            it = m_renderTasks.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    startRenderTasks();
+
+    if (isImageRendered)
+    {
+        emit pageImageRendered();
+    }
+}
+
+void PageImageRenderer::onModelReset()
+{
+    // Documents can be removed, or document indices can be reused,
+    // so we must discard all rendering data.
+    ++m_generation;
+    cancelPendingRequests();
+    m_documentRenderData.clear();
+}
+
+PageImageRenderer::DocumentRenderDataPointer PageImageRenderer::getDocumentRenderData(int documentIndex)
+{
+    auto it = m_documentRenderData.find(documentIndex);
+    if (it != m_documentRenderData.end())
+    {
+        return it->second;
+    }
+
+    const auto& documents = m_model->getDocuments();
+    auto documentIt = documents.find(documentIndex);
+    if (documentIt == documents.cend())
+    {
+        return DocumentRenderDataPointer();
+    }
+
+    DocumentRenderDataPointer renderData(new DocumentRenderData(documentIt->second.document));
+    m_documentRenderData[documentIndex] = renderData;
+    return renderData;
+}
+
+PageItemDelegate::PageItemDelegate(PageItemModel* model, QObject* parent) :
+    BaseClass(parent),
+    m_model(model),
+    m_pageImageRenderer(nullptr)
+{
+    m_pageImageRenderer = new PageImageRenderer(model, this);
+    connect(m_pageImageRenderer, &PageImageRenderer::pageImageRendered, this, &PageItemDelegate::pageImageRendered);
 }
 
 PageItemDelegate::~PageItemDelegate()
@@ -125,6 +331,11 @@ QSize PageItemDelegate::sizeHint(const QStyleOptionViewItem& option, const QMode
     return QSize(width, height);
 }
 
+void PageItemDelegate::cancelPendingRequests()
+{
+    m_pageImageRenderer->cancelPendingRequests();
+}
+
 QSize PageItemDelegate::getPageImageSize() const
 {
     return m_pageImageSize;
@@ -160,45 +371,20 @@ QPixmap PageItemDelegate::getPageImagePixmap(const PageGroupItem* item, QRect re
 
     if (!QPixmapCache::find(key, &pixmap))
     {
+        if (groupItem.pageType == PT_DocumentPage)
+        {
+            // Page is rendered asynchronously, page image is inserted
+            // into the pixmap cache, when it is rendered. Until then, empty page is painted.
+            m_pageImageRenderer->requestPageImage(key, groupItem.documentIndex, groupItem.pageIndex - 1, groupItem.pageAdditionalRotation, rect.size());
+            return pixmap;
+        }
+
         // We must draw the pixmap
         pixmap = QPixmap(rect.width(), rect.height());
         pixmap.fill(Qt::transparent);
 
         switch (groupItem.pageType)
         {
-            case pdfdocpage::PT_DocumentPage:
-            {
-                const auto& documents = m_model->getDocuments();
-                auto it = documents.find(groupItem.documentIndex);
-                if (it != documents.cend())
-                {
-                    const pdf::PDFDocument& document = it->second.document;
-                    const pdf::PDFInteger pageIndex = groupItem.pageIndex - 1;
-                    if (pageIndex >= 0 && pageIndex < pdf::PDFInteger(document.getCatalog()->getPageCount()))
-                    {
-                        const pdf::PDFPage* page = document.getCatalog()->getPage(pageIndex);
-                        Q_ASSERT(page);
-
-                        pdf::PDFPrecompiledPage compiledPage;
-                        pdf::PDFFontCache fontCache(pdf::DEFAULT_FONT_CACHE_LIMIT, pdf::DEFAULT_REALIZED_FONT_CACHE_LIMIT);
-                        pdf::PDFCMSManager cmsManager(nullptr);
-                        pdf::PDFOptionalContentActivity optionalContentActivity(&document, pdf::OCUsage::View, nullptr);
-
-                        fontCache.setDocument(pdf::PDFModifiedDocument(const_cast<pdf::PDFDocument*>(&document), &optionalContentActivity));
-                        cmsManager.setDocument(&document);
-
-                        pdf::PDFCMSPointer cms = cmsManager.getCurrentCMS();
-                        pdf::PDFRenderer renderer(&document, &fontCache, cms.data(), &optionalContentActivity, pdf::PDFRenderer::getDefaultFeatures(), pdf::PDFMeshQualitySettings());
-                        renderer.compile(&compiledPage, pageIndex);
-
-                        QSize imageSize = rect.size();
-                        QImage pageImage = m_rasterizer->render(pageIndex, page, &compiledPage, imageSize, pdf::PDFRenderer::getDefaultFeatures(), nullptr, groupItem.pageAdditionalRotation);
-                        pixmap = QPixmap::fromImage(qMove(pageImage));
-                    }
-                }
-                break;
-            }
-
             case pdfdocpage::PT_Image:
             {
                 const auto& images = m_model->getImages();
@@ -224,6 +410,7 @@ QPixmap PageItemDelegate::getPageImagePixmap(const PageGroupItem* item, QRect re
                 break;
             }
 
+            case pdfdocpage::PT_DocumentPage:
             case pdfdocpage::PT_Empty:
                 Q_ASSERT(false);
                 break;
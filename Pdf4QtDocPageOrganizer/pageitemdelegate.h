@@ -20,7 +20,10 @@
 
 #include "pdfrenderer.h"
 #include "pdfcms.h"
+#include "pdffont.h"
+#include "pdfoptionalcontent.h"
 
+#include <QFutureWatcher>
 #include <QAbstractItemDelegate>
 
 namespace pdfdocpage
@@ -29,6 +32,91 @@ namespace pdfdocpage
 class PageItemModel;
 struct PageGroupItem;
 
+/// Renders page images (thumbnails) asynchronously in background threads.
+/// Font cache and color management system are shared for all pages of the
+/// same document. Requests are processed in the reverse order, so recently
+/// painted (visible) items are rendered first. Pending requests can be
+/// cancelled (for example, when view is scrolled). Rendered images are
+/// stored in the pixmap cache.
+class PageImageRenderer : public QObject
+{
+    Q_OBJECT
+
+private:
+    using BaseClass = QObject;
+
+public:
+    explicit PageImageRenderer(PageItemModel* model, QObject* parent);
+    virtual ~PageImageRenderer() override;
+
+    /// Requests page image rendering. If request with the same key is already
+    /// pending, then its priority is raised. When image is rendered, it is
+    /// inserted into the pixmap cache under the given key.
+    /// \param key Pixmap cache key
+    /// \param documentIndex Document index
+    /// \param pageIndex Page index (zero-based)
+    /// \param pageRotation Additional page rotation
+    /// \param imageSize Image size
+    void requestPageImage(const QString& key, int documentIndex, pdf::PDFInteger pageIndex, pdf::PageRotation pageRotation, QSize imageSize);
+
+    /// Cancels all pending requests, which are not being rendered
+    void cancelPendingRequests();
+
+signals:
+    void pageImageRendered();
+
+private:
+    /// Rendering data shared by all pages of the document. Document
+    /// is copied, so it can be used in the rendering threads, even
+    /// if the model is changed in the meantime.
+    struct DocumentRenderData
+    {
+        explicit DocumentRenderData(const pdf::PDFDocument& sourceDocument);
+
+        pdf::PDFDocument document;
+        pdf::PDFFontCache fontCache;
+        pdf::PDFCMSManager cmsManager;
+        pdf::PDFCMSPointer cms;
+        pdf::PDFOptionalContentActivity optionalContentActivity;
+    };
+
+    using DocumentRenderDataPointer = QSharedPointer<DocumentRenderData>;
+
+    struct RenderRequest
+    {
+        QString key;
+        DocumentRenderDataPointer renderData;
+        pdf::PDFInteger pageIndex = -1;
+        pdf::PageRotation pageRotation = pdf::PageRotation::None;
+        QSize imageSize;
+    };
+
+    struct RenderTask
+    {
+        DocumentRenderDataPointer renderData;
+        quint64 generation = 0;
+        QFuture<QImage> taskFuture;
+        QFutureWatcher<QImage>* taskWatcher = nullptr;
+    };
+
+    void startRenderTasks();
+    void onPageImageRendered();
+    void onModelReset();
+
+    DocumentRenderDataPointer getDocumentRenderData(int documentIndex);
+
+    PageItemModel* m_model;
+    pdf::PDFMeshQualitySettings m_meshQualitySettings;
+    pdf::PDFRasterizerPool* m_rasterizerPool;
+    int m_maxRenderTasks;
+    quint64 m_requestCounter = 0;
+    quint64 m_generation = 0;
+    std::map<quint64, RenderRequest> m_pendingRequests;
+    std::map<QString, quint64> m_pendingRequestKeys;
+    std::map<QString, RenderTask> m_renderTasks;
+    std::map<int, DocumentRenderDataPointer> m_documentRenderData;
+};
+
 class PageItemDelegate : public QAbstractItemDelegate
 {
     Q_OBJECT
@@ -46,6 +134,14 @@ public:
     QSize getPageImageSize() const;
     void setPageImageSize(QSize pageImageSize);
 
+    /// Cancels pending page image requests (for example, when view
+    /// is scrolled). Visible items will request their images again,
+    /// when they are painted.
+    void cancelPendingRequests();
+
+signals:
+    void pageImageRendered();
+
 private:
     static constexpr int getVerticalSpacing() { return 5; }
     static constexpr int getHorizontalSpacing() { return 5; }
@@ -54,7 +150,7 @@ private:
 
     PageItemModel* m_model;
     QSize m_pageImageSize;
-    pdf::PDFRasterizer* m_rasterizer;
+    PageImageRenderer* m_pageImageRenderer;
 };
 
 }   // namespace pdfdocpage
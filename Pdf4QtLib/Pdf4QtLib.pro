@@ -86,6 +86,7 @@ SOURCES += \
     sources/pdfsignaturehandler.cpp \
     sources/pdfsnapper.cpp \
     sources/pdfstructuretree.cpp \
+    sources/pdftextindex.cpp \
     sources/pdftextlayout.cpp \
     sources/pdftransparencyrenderer.cpp \
     sources/pdfutils.cpp \
@@ -108,7 +109,8 @@ SOURCES += \
     sources/pdffunction.cpp \
     sources/pdfnametounicode.cpp \
     sources/pdffont.cpp \
-    sources/pdfimage.cpp
+    sources/pdfimage.cpp \
+    sources/pdfimagebandwriter.cpp
 
 HEADERS += \
     sources/pdfaction.h \
@@ -162,6 +164,7 @@ HEADERS += \
     sources/pdfsignaturehandler_impl.h \
     sources/pdfsnapper.h \
     sources/pdfstructuretree.h \
+    sources/pdftextindex.h \
     sources/pdftextlayout.h \
     sources/pdftransparencyrenderer.h \
     sources/pdfwidgettool.h \
@@ -188,7 +191,8 @@ HEADERS += \
     sources/pdfnametounicode.h \
     sources/pdffont.h \
     sources/pdfexception.h \
-    sources/pdfimage.h
+    sources/pdfimage.h \
+    sources/pdfimagebandwriter.h
 
 FORMS += \
     sources/pdfrenderingerrorswidget.ui \
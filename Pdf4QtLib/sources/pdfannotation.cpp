@@ -26,6 +26,7 @@
 #include "pdfparser.h"
 #include "pdfdrawwidget.h"
 #include "pdfform.h"
+#include "pdfoptionalcontent.h"
 #include "pdfpainterutils.h"
 #include "pdfdocumentbuilder.h"
 #include "pdfobjecteditorwidget.h"
@@ -1195,7 +1196,11 @@ PDFAnnotationManager::PDFAnnotationManager(PDFFontCache* fontCache,
     m_features(features),
     m_target(target)
 {
-
+    if (m_cmsManager)
+    {
+        // Colors are converted in compiled appearances, so we must compile them again
+        connect(m_cmsManager, &PDFCMSManager::colorManagementSystemChanged, this, &PDFAnnotationManager::clearAppearanceCache);
+    }
 }
 
 PDFAnnotationManager::~PDFAnnotationManager()
@@ -1395,7 +1400,8 @@ void PDFAnnotationManager::drawAnnotation(const PageAnnotation& annotation,
 {
     try
     {
-        PDFObject appearanceStreamObject = m_document->getObject(getAppearanceStream(annotation));
+        PDFObject appearanceStream = getAppearanceStream(annotation);
+        PDFObject appearanceStreamObject = m_document->getObject(appearanceStream);
         if (!appearanceStreamObject.isStream() || isEditorDrawEnabled)
         {
             // Object is not valid appearance stream. We will try to draw default
@@ -1407,7 +1413,8 @@ void PDFAnnotationManager::drawAnnotation(const PageAnnotation& annotation,
         }
         else
         {
-            drawAnnotationUsingAppearanceStream(annotation, appearanceStreamObject, pagePointToDevicePointMatrix, page, cms, painter);
+            PDFObjectReference appearanceStreamReference = appearanceStream.isReference() ? appearanceStream.getReference() : PDFObjectReference();
+            drawAnnotationUsingAppearanceStream(annotation, appearanceStreamReference, appearanceStreamObject, pagePointToDevicePointMatrix, page, cms, painter);
         }
     }
     catch (const PDFException& exception)
@@ -1493,6 +1500,7 @@ void PDFAnnotationManager::drawAnnotationDirect(const PageAnnotation& annotation
 }
 
 void PDFAnnotationManager::drawAnnotationUsingAppearanceStream(const PageAnnotation& annotation,
+                                                               PDFObjectReference appearanceStreamReference,
                                                                const PDFObject& appearanceStreamObject,
                                                                const QMatrix& pagePointToDevicePointMatrix,
                                                                const PDFPage* page,
@@ -1507,10 +1515,6 @@ void PDFAnnotationManager::drawAnnotationUsingAppearanceStream(const PageAnnotat
     QRectF annotationRectangle = annotation.annotation->getRectangle();
     QRectF formBoundingBox = loader.readRectangle(formDictionary->get("BBox"), QRectF());
     QMatrix formMatrix = loader.readMatrixFromDictionary(formDictionary, "Matrix", QMatrix());
-    QByteArray content = m_document->getDecodedStream(formStream);
-    PDFObject resources = m_document->getObject(formDictionary->get("Resources"));
-    PDFObject transparencyGroup = m_document->getObject(formDictionary->get("Group"));
-    const PDFInteger formStructuralParentKey = loader.readIntegerFromDictionary(formDictionary, "StructParent", page->getStructureParentKey());
 
     if (formBoundingBox.isEmpty() || annotationRectangle.isEmpty())
     {
@@ -1546,8 +1550,46 @@ void PDFAnnotationManager::drawAnnotationUsingAppearanceStream(const PageAnnotat
 
     bool isContentVisible = false;
 
-    // Draw annotation
+    if (appearanceStreamReference.isValid())
     {
+        // Compiled appearance is in form space, so we draw it using
+        // matrix AA (maps form space to page space) and user space to device space matrix.
+        PDFObjectReference oc = annotation.annotation->getOptionalContent();
+        isContentVisible = !oc.isValid();
+        if (!isContentVisible)
+        {
+            PDFPainter pdfPainter(painter, features, userSpaceToDeviceSpace, page, m_document, m_fontCache, cms, m_optionalActivity, m_meshQualitySettings);
+            isContentVisible = !pdfPainter.isContentSuppressedByOC(oc);
+        }
+
+        if (isContentVisible)
+        {
+            std::shared_ptr<const PDFPrecompiledPage> compiledAppearance = getCompiledAppearance(appearanceStreamReference, formStream, page, cms);
+
+            PDFPainterStateGuard guard(painter);
+            if (features.testFlag(PDFRenderer::ClipToCropBox))
+            {
+                QRectF cropBox = page->getCropBox();
+                if (cropBox.isValid())
+                {
+                    QPainterPath path;
+                    path.addPolygon(userSpaceToDeviceSpace.map(cropBox));
+                    painter->setClipPath(path, Qt::IntersectClip);
+                }
+            }
+
+            features.setFlag(PDFRenderer::ClipToCropBox, false);
+            compiledAppearance->draw(painter, QRectF(), AA * userSpaceToDeviceSpace, features, 1.0);
+        }
+    }
+    else
+    {
+        QByteArray content = m_document->getDecodedStream(formStream);
+        PDFObject resources = m_document->getObject(formDictionary->get("Resources"));
+        PDFObject transparencyGroup = m_document->getObject(formDictionary->get("Group"));
+        const PDFInteger formStructuralParentKey = loader.readIntegerFromDictionary(formDictionary, "StructParent", page->getStructureParentKey());
+
+        // Draw annotation
         PDFPainterStateGuard guard(painter);
         PDFPainter pdfPainter(painter, features, userSpaceToDeviceSpace, page, m_document, m_fontCache, cms, m_optionalActivity, m_meshQualitySettings);
         pdfPainter.initializeProcessor();
@@ -1578,13 +1620,75 @@ void PDFAnnotationManager::setDocument(const PDFModifiedDocument& document)
     if (m_document != document)
     {
         m_document = document;
-        m_optionalActivity = document.getOptionalContentActivity();
+        setOptionalActivity(document.getOptionalContentActivity());
 
         if (document.hasReset() || document.hasFlag(PDFModifiedDocument::Annotation))
         {
             m_pageAnnotations.clear();
         }
+
+        // Appearance streams can be regenerated (for example, when form field value changes)
+        if (document.hasReset() || document.hasFlag(PDFModifiedDocument::Annotation) || document.hasFlag(PDFModifiedDocument::FormField))
+        {
+            clearAppearanceCache();
+        }
+    }
+}
+
+std::shared_ptr<const PDFPrecompiledPage> PDFAnnotationManager::getCompiledAppearance(PDFObjectReference appearanceStreamReference,
+                                                                                      const PDFStream* formStream,
+                                                                                      const PDFPage* page,
+                                                                                      const PDFCMS* cms) const
+{
+    {
+        QReadLocker lock(&m_appearanceCacheLock);
+        auto it = m_appearanceCache.find(appearanceStreamReference);
+        if (it != m_appearanceCache.cend())
+        {
+            return it->second;
+        }
     }
+
+    PDFDocumentDataLoaderDecorator loader(m_document);
+    const PDFDictionary* formDictionary = formStream->getDictionary();
+
+    QRectF formBoundingBox = loader.readRectangle(formDictionary->get("BBox"), QRectF());
+    QByteArray content = m_document->getDecodedStream(formStream);
+    PDFObject resources = m_document->getObject(formDictionary->get("Resources"));
+    PDFObject transparencyGroup = m_document->getObject(formDictionary->get("Group"));
+    const PDFInteger formStructuralParentKey = loader.readIntegerFromDictionary(formDictionary, "StructParent", page->getStructureParentKey());
+
+    std::shared_ptr<PDFPrecompiledPage> compiledAppearance = std::make_shared<PDFPrecompiledPage>();
+    PDFPrecompiledPageGenerator generator(compiledAppearance.get(), m_features, page, m_document, m_fontCache, cms, m_optionalActivity, m_meshQualitySettings);
+    generator.initializeProcessor();
+    generator.processForm(QMatrix(), formBoundingBox, resources, transparencyGroup, content, formStructuralParentKey);
+    compiledAppearance->optimize();
+    compiledAppearance->finalize(0, QList<PDFRenderError>());
+
+    QWriteLocker lock(&m_appearanceCacheLock);
+    auto it = m_appearanceCache.find(appearanceStreamReference);
+    if (it != m_appearanceCache.cend())
+    {
+        // Another thread has compiled the appearance in the meantime
+        return it->second;
+    }
+
+    if (m_appearanceCacheMemoryConsumption + compiledAppearance->getMemoryConsumptionEstimate() > APPEARANCE_CACHE_MEMORY_BUDGET)
+    {
+        m_appearanceCache.clear();
+        m_appearanceCacheMemoryConsumption = 0;
+    }
+
+    m_appearanceCacheMemoryConsumption += compiledAppearance->getMemoryConsumptionEstimate();
+    m_appearanceCache[appearanceStreamReference] = compiledAppearance;
+    return compiledAppearance;
+}
+
+void PDFAnnotationManager::clearAppearanceCache()
+{
+    QWriteLocker lock(&m_appearanceCacheLock);
+    m_appearanceCache.clear();
+    m_appearanceCacheMemoryConsumption = 0;
 }
 
 PDFObject PDFAnnotationManager::getAppearanceStream(const PageAnnotation& pageAnnotation) const
@@ -1663,7 +1767,11 @@ PDFRenderer::Features PDFAnnotationManager::getFeatures() const
 
 void PDFAnnotationManager::setFeatures(PDFRenderer::Features features)
 {
-    m_features = features;
+    if (m_features != features)
+    {
+        m_features = features;
+        clearAppearanceCache();
+    }
 }
 
 PDFMeshQualitySettings PDFAnnotationManager::getMeshQualitySettings() const
@@ -1674,6 +1782,7 @@ PDFMeshQualitySettings PDFAnnotationManager::getMeshQualitySettings() const
 void PDFAnnotationManager::setMeshQualitySettings(const PDFMeshQualitySettings& meshQualitySettings)
 {
     m_meshQualitySettings = meshQualitySettings;
+    clearAppearanceCache();
 }
 
 PDFFontCache* PDFAnnotationManager::getFontCache() const
@@ -1684,6 +1793,7 @@ PDFFontCache* PDFAnnotationManager::getFontCache() const
 void PDFAnnotationManager::setFontCache(PDFFontCache* fontCache)
 {
     m_fontCache = fontCache;
+    clearAppearanceCache();
 }
 
 const PDFOptionalContentActivity* PDFAnnotationManager::getOptionalActivity() const
@@ -1693,7 +1803,17 @@ const PDFOptionalContentActivity* PDFAnnotationManager::getOptionalActivity() co
 
 void PDFAnnotationManager::setOptionalActivity(const PDFOptionalContentActivity* optionalActivity)
 {
-    m_optionalActivity = optionalActivity;
+    if (m_optionalActivity != optionalActivity)
+    {
+        m_optionalActivity = optionalActivity;
+        clearAppearanceCache();
+    }
+
+    if (m_optionalActivity)
+    {
+        // Optional content in appearance streams is evaluated, when appearance is compiled
+        connect(m_optionalActivity, &PDFOptionalContentActivity::optionalContentGroupStateChanged, this, &PDFAnnotationManager::clearAppearanceCache, Qt::UniqueConnection);
+    }
 }
 
 PDFAnnotationManager::Target PDFAnnotationManager::getTarget() const
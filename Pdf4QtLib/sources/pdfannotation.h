@@ -32,8 +32,10 @@
 
 #include <QCursor>
 #include <QPainterPath>
+#include <QReadWriteLock>
 
 #include <array>
+#include <memory>
 
 class QKeyEvent;
 class QMouseEvent;
@@ -1594,20 +1596,42 @@ protected:
                               bool isEditorDrawEnabled,
                               QPainter* painter) const;
 
-    /// Draws annotation using annotation's appearance stream.
+    /// Draws annotation using annotation's appearance stream. If appearance
+    /// stream is an indirect object, then it is compiled only once and
+    /// compiled appearance is used for subsequent drawing.
     /// \param pageAnnotation Page annotation
+    /// \param appearanceStreamReference Reference to appearance stream (can be invalid)
     /// \param appearanceStreamObject Object with appearance stream
     /// \param pagePointToDevicePointMatrix Page point to device point matrix
     /// \param page Page
     /// \param cms Color management system
     /// \param painter Painter
     void drawAnnotationUsingAppearanceStream(const PageAnnotation& annotation,
+                                             PDFObjectReference appearanceStreamReference,
                                              const PDFObject& appearanceStreamObject,
                                              const QMatrix& pagePointToDevicePointMatrix,
                                              const PDFPage* page,
                                              const PDFCMS* cms,
                                              QPainter* painter) const;
 
+    /// Returns compiled appearance stream. Appearance stream is compiled in the form
+    /// space (i.e. without form matrix), so it can be drawn for any annotation
+    /// using this appearance stream. Compiled appearances are cached.
+    /// \param appearanceStreamReference Reference to appearance stream
+    /// \param formStream Appearance stream
+    /// \param page Page
+    /// \param cms Color management system
+    std::shared_ptr<const PDFPrecompiledPage> getCompiledAppearance(PDFObjectReference appearanceStreamReference,
+                                                                    const PDFStream* formStream,
+                                                                    const PDFPage* page,
+                                                                    const PDFCMS* cms) const;
+
+    /// Clears cache of compiled appearance streams
+    void clearAppearanceCache();
+
+    /// Memory budget for compiled appearance streams. If it is exceeded, cache is cleared.
+    static constexpr qint64 APPEARANCE_CACHE_MEMORY_BUDGET = 64 * 1024 * 1024;
+
     const PDFDocument* m_document;
 
     PDFFontCache* m_fontCache;
@@ -1620,6 +1644,10 @@ protected:
     mutable QMutex m_mutex;
     mutable std::map<PDFInteger, PageAnnotations> m_pageAnnotations;
     Target m_target = Target::View;
+
+    mutable QReadWriteLock m_appearanceCacheLock;
+    mutable std::map<PDFObjectReference, std::shared_ptr<const PDFPrecompiledPage>> m_appearanceCache;
+    mutable qint64 m_appearanceCacheMemoryConsumption = 0;
 };
 
 /// Annotation manager for GUI rendering, it also manages annotations widgets
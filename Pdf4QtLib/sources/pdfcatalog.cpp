@@ -58,28 +58,261 @@ static constexpr const char* PDF_VIEWER_PREFERENCES_PICK_TRAY_BY_PDF_SIZE = "Pic
 static constexpr const char* PDF_VIEWER_PREFERENCES_NUMBER_OF_COPIES = "NumCopies";
 static constexpr const char* PDF_VIEWER_PREFERENCES_PRINT_PAGE_RANGE = "PrintPageRange";
 
+const PDFPage* PDFCatalog::getPage(size_t index) const
+{
+    std::atomic<const PDFPage*>& pagePointer = m_pageTree->pagePointers.at(index);
+    if (const PDFPage* page = pagePointer.load(std::memory_order_acquire))
+    {
+        return page;
+    }
+
+    QMutexLocker lock(&m_pageTree->mutex);
+    if (const PDFPage* page = pagePointer.load(std::memory_order_acquire))
+    {
+        return page;
+    }
+
+    if (!m_pageTree->isAllPagesLoaded)
+    {
+        Q_ASSERT(m_storage);
+
+        try
+        {
+            if (std::optional<PDFPage> page = PDFPage::parsePage(m_storage, m_pageTree->root, index))
+            {
+                return m_pageTree->storePage(index, qMove(*page));
+            }
+        }
+        catch (const PDFException&)
+        {
+            // Page tree is damaged, we will parse it as a whole
+        }
+
+        // Page can't be found using /Count entries of page tree nodes
+        // (some intermediate node has wrong /Count entry), so we parse whole page tree.
+        loadAllPages();
+    }
+
+    return pagePointer.load(std::memory_order_acquire);
+}
+
+void PDFCatalog::loadAllPages() const
+{
+    std::vector<PDFPage> pages;
+
+    try
+    {
+        pages = PDFPage::parse(m_storage, m_pageTree->root);
+    }
+    catch (const PDFException&)
+    {
+        // Pages, which can't be parsed, are left empty
+    }
+
+    // Page count was determined from the page tree, so it must be kept. If some
+    // page is missing, empty page is used instead.
+    for (size_t i = 0, pageCount = m_pageTree->pagePointers.size(); i < pageCount; ++i)
+    {
+        m_pageTree->storePage(i, i < pages.size() ? qMove(pages[i]) : PDFPage());
+    }
+
+    m_pageTree->isAllPagesLoaded = true;
+}
+
+void PDFCatalog::PageTreeData::initialize(size_t pageCount)
+{
+    pagePointers = std::vector<std::atomic<const PDFPage*>>(pageCount);
+    pages.clear();
+    pages.reserve(pageCount);
+}
+
+const PDFPage* PDFCatalog::PageTreeData::storePage(size_t index, PDFPage page)
+{
+    std::atomic<const PDFPage*>& pagePointer = pagePointers.at(index);
+    if (const PDFPage* storedPage = pagePointer.load(std::memory_order_acquire))
+    {
+        return storedPage;
+    }
+
+    pages.emplace_back(std::make_unique<PDFPage>(qMove(page)));
+    pagePointer.store(pages.back().get(), std::memory_order_release);
+    return pages.back().get();
+}
+
 size_t PDFCatalog::getPageIndexFromPageReference(PDFObjectReference reference) const
 {
-    auto it = std::find_if(m_pages.cbegin(), m_pages.cend(), [reference](const PDFPage& page) { return page.getPageReference() == reference; });
-    if (it != m_pages.cend())
+    QMutexLocker lock(&m_pageTree->mutex);
+
+    if (!m_pageTree->isPageReferenceMapBuilt)
+    {
+        const size_t pageCount = m_pageTree->pagePointers.size();
+        std::vector<PDFObjectReference> references;
+
+        if (!m_pageTree->isAllPagesLoaded)
+        {
+            // Only page tree nodes are traversed, pages are not parsed
+            try
+            {
+                references = PDFPage::parsePageReferences(m_storage, m_pageTree->root);
+            }
+            catch (const PDFException&)
+            {
+                references.clear();
+            }
+
+            if (references.size() != pageCount)
+            {
+                loadAllPages();
+            }
+        }
+
+        if (m_pageTree->isAllPagesLoaded)
+        {
+            references.clear();
+            references.reserve(pageCount);
+            for (size_t i = 0; i < pageCount; ++i)
+            {
+                references.push_back(m_pageTree->pagePointers[i].load(std::memory_order_acquire)->getPageReference());
+            }
+        }
+
+        m_pageTree->pageReferenceToIndex.reserve(pageCount);
+        for (size_t i = 0; i < references.size(); ++i)
+        {
+            if (references[i].isValid())
+            {
+                m_pageTree->pageReferenceToIndex.emplace(references[i], i);
+            }
+        }
+        m_pageTree->isPageReferenceMapBuilt = true;
+    }
+
+    auto it = m_pageTree->pageReferenceToIndex.find(reference);
+    if (it != m_pageTree->pageReferenceToIndex.cend())
     {
-        return std::distance(m_pages.cbegin(), it);
+        return it->second;
     }
 
     return INVALID_PAGE_INDEX;
 }
 
+QSharedPointer<PDFOutlineItem> PDFCatalog::getOutlineRootPtr() const
+{
+    QMutexLocker lock(&m_lazyData->mutex);
+
+    if (!m_lazyData->isOutlineLoaded)
+    {
+        m_lazyData->isOutlineLoaded = true;
+
+        try
+        {
+            m_lazyData->outlineRoot = PDFOutlineItem::parse(m_storage, m_outlineObject);
+        }
+        catch (const PDFException&)
+        {
+            // Outline is damaged, document is displayed without outline
+            m_lazyData->outlineRoot.reset();
+        }
+    }
+
+    return m_lazyData->outlineRoot;
+}
+
+const std::vector<PDFPageLabel>& PDFCatalog::getPageLabels() const
+{
+    QMutexLocker lock(&m_lazyData->mutex);
+
+    if (!m_lazyData->pageLabels.has_value())
+    {
+        try
+        {
+            m_lazyData->pageLabels = PDFNumberTreeLoader<PDFPageLabel>::parse(m_storage, m_pageLabelsObject);
+        }
+        catch (const PDFException&)
+        {
+            // Page labels are damaged, pages are displayed without labels
+            m_lazyData->pageLabels = std::vector<PDFPageLabel>();
+        }
+    }
+
+    return *m_lazyData->pageLabels;
+}
+
+const std::map<QByteArray, PDFDestination>& PDFCatalog::getNamedDestinations() const
+{
+    QMutexLocker lock(&m_lazyData->mutex);
+
+    if (!m_lazyData->isAllNamedDestinationsLoaded)
+    {
+        m_lazyData->isAllNamedDestinationsLoaded = true;
+
+        std::map<QByteArray, PDFDestination> namedDestinations = PDFNameTreeLoader<PDFDestination>::parse(m_storage, m_namedDestinationsTree, &PDFCatalog::parseNamedDestination);
+
+        // Destinations in "Dests" dictionary have precedence
+        if (const PDFDictionary* destsDictionary = m_storage->getDictionaryFromObject(m_destinationsDictionary))
+        {
+            const size_t count = destsDictionary->getCount();
+            for (size_t i = 0; i < count; ++i)
+            {
+                namedDestinations[destsDictionary->getKey(i).getString()] = PDFDestination::parse(m_storage, destsDictionary->getValue(i));
+            }
+        }
+
+        // Already found destinations can be referenced by pointer, so we must keep them
+        m_lazyData->namedDestinations.merge(namedDestinations);
+    }
+
+    return m_lazyData->namedDestinations;
+}
+
 const PDFDestination* PDFCatalog::getNamedDestination(const QByteArray& key) const
 {
-    auto it = m_namedDestinations.find(key);
-    if (it != m_namedDestinations.cend())
+    QMutexLocker lock(&m_lazyData->mutex);
+
+    auto it = m_lazyData->namedDestinations.find(key);
+    if (it != m_lazyData->namedDestinations.cend())
     {
         return &it->second;
     }
 
+    if (m_lazyData->isAllNamedDestinationsLoaded)
+    {
+        return nullptr;
+    }
+
+    std::optional<PDFDestination> destination;
+    if (const PDFDictionary* destsDictionary = m_storage->getDictionaryFromObject(m_destinationsDictionary))
+    {
+        if (destsDictionary->hasKey(key))
+        {
+            destination = PDFDestination::parse(m_storage, destsDictionary->get(key));
+        }
+    }
+
+    if (!destination)
+    {
+        destination = PDFNameTreeLoader<PDFDestination>::find(m_storage, m_namedDestinationsTree, key, &PDFCatalog::parseNamedDestination);
+    }
+
+    if (destination)
+    {
+        return &m_lazyData->namedDestinations.emplace(key, qMove(*destination)).first->second;
+    }
+
     return nullptr;
 }
 
+PDFDestination PDFCatalog::parseNamedDestination(const PDFObjectStorage* storage, PDFObject object)
+{
+    object = storage->getObject(object);
+    if (object.isDictionary())
+    {
+        object = object.getDictionary()->get("D");
+    }
+
+    return PDFDestination::parse(storage, qMove(object));
+}
+
 PDFActionPtr PDFCatalog::getNamedJavaScriptAction(const QByteArray& key) const
 {
     auto it = m_namedJavaScriptActions.find(key);
@@ -180,19 +413,35 @@ PDFCatalog PDFCatalog::parse(const PDFObject& catalog, const PDFDocument* docume
 
     PDFCatalog catalogObject;
     catalogObject.m_viewerPreferences = PDFViewerPreferences::parse(catalog, document);
-    catalogObject.m_pages = PDFPage::parse(&document->getStorage(), catalogDictionary->get("Pages"));
-    catalogObject.m_pageLabels = PDFNumberTreeLoader<PDFPageLabel>::parse(&document->getStorage(), catalogDictionary->get("PageLabels"));
+    catalogObject.m_storage = &document->getStorage();
 
-    if (catalogDictionary->hasKey("OCProperties"))
+    // Pages are parsed on demand, if page count can be determined from the root of the
+    // page tree. Otherwise whole page tree is parsed (and errors are reported immediately).
+    PageTreeData* pageTree = catalogObject.m_pageTree.data();
+    pageTree->root = catalogDictionary->get("Pages");
+    if (std::optional<size_t> pageCount = PDFPage::parsePageCount(catalogObject.m_storage, pageTree->root))
     {
-        catalogObject.m_optionalContentProperties = PDFOptionalContentProperties::create(document, catalogDictionary->get("OCProperties"));
+        pageTree->initialize(*pageCount);
     }
+    else
+    {
+        std::vector<PDFPage> pages = PDFPage::parse(catalogObject.m_storage, pageTree->root);
+        pageTree->initialize(pages.size());
+        for (size_t i = 0; i < pages.size(); ++i)
+        {
+            pageTree->storePage(i, qMove(pages[i]));
+        }
+        pageTree->isAllPagesLoaded = true;
+    }
+    catalogObject.m_pageLabelsObject = catalogDictionary->get("PageLabels");
 
-    if (catalogDictionary->hasKey("Outlines"))
+    if (catalogDictionary->hasKey("OCProperties"))
     {
-        catalogObject.m_outlineRoot = PDFOutlineItem::parse(&document->getStorage(), catalogDictionary->get("Outlines"));
+        catalogObject.m_optionalContentProperties = PDFOptionalContentProperties::create(document, catalogDictionary->get("OCProperties"));
     }
 
+    catalogObject.m_outlineObject = catalogDictionary->get("Outlines");
+
     if (catalogDictionary->hasKey("OpenAction"))
     {
         PDFObject openAction = document->getObject(catalogDictionary->get("OpenAction"));
@@ -248,23 +497,12 @@ PDFCatalog PDFCatalog::parse(const PDFObject& catalog, const PDFDocument* docume
 
     if (const PDFDictionary* namesDictionary = document->getDictionaryFromObject(catalogDictionary->get("Names")))
     {
-        auto parseDestination = [](const PDFObjectStorage* storage, PDFObject object)
-        {
-            object = storage->getObject(object);
-            if (object.isDictionary())
-            {
-                object = object.getDictionary()->get("D");
-            }
-
-            return PDFDestination::parse(storage, qMove(object));
-        };
-
         auto getObject = [](const PDFObjectStorage*, PDFObject object)
         {
             return object;
         };
 
-        catalogObject.m_namedDestinations = PDFNameTreeLoader<PDFDestination>::parse(&document->getStorage(), namesDictionary->get("Dests"), parseDestination);
+        catalogObject.m_namedDestinationsTree = namesDictionary->get("Dests");
         catalogObject.m_namedAppearanceStreams = PDFNameTreeLoader<PDFObject>::parse(&document->getStorage(), namesDictionary->get("AP"), getObject);
         catalogObject.m_namedJavaScriptActions = PDFNameTreeLoader<PDFActionPtr>::parse(&document->getStorage(), namesDictionary->get("JavaScript"), &PDFAction::parse);
         catalogObject.m_namedPages = PDFNameTreeLoader<PDFObject>::parse(&document->getStorage(), namesDictionary->get("Pages"), getObject);
@@ -276,15 +514,8 @@ PDFCatalog PDFCatalog::parse(const PDFObject& catalog, const PDFDocument* docume
         catalogObject.m_namedRenditions = PDFNameTreeLoader<PDFObject>::parse(&document->getStorage(), namesDictionary->get("Renditions"), getObject);
     }
 
-    // Examine "Dests" dictionary
-    if (const PDFDictionary* destsDictionary = document->getDictionaryFromObject(catalogDictionary->get("Dests")))
-    {
-        const size_t count = destsDictionary->getCount();
-        for (size_t i = 0; i < count; ++i)
-        {
-            catalogObject.m_namedDestinations[destsDictionary->getKey(i).getString()] = PDFDestination::parse(&document->getStorage(), destsDictionary->getValue(i));
-        }
-    }
+    // Named destinations are loaded on demand
+    catalogObject.m_destinationsDictionary = catalogDictionary->get("Dests");
 
     // Examine "URI" dictionary
     if (const PDFDictionary* URIDictionary = document->getDictionaryFromObject(catalogDictionary->get("URI")))
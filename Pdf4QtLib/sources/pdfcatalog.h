@@ -28,7 +28,10 @@
 
 #include <array>
 #include <vector>
+#include <atomic>
+#include <memory>
 #include <utility>
+#include <unordered_map>
 
 namespace pdf
 {
@@ -591,10 +594,13 @@ public:
     const PDFViewerPreferences* getViewerPreferences() const { return &m_viewerPreferences; }
 
     /// Returns the page count
-    size_t getPageCount() const { return m_pages.size(); }
+    size_t getPageCount() const { return m_pageTree->pagePointers.size(); }
 
-    /// Returns the page
-    const PDFPage* getPage(size_t index) const { return &m_pages.at(index); }
+    /// Returns the page. Pages are parsed on first access, returned
+    /// pointer is valid during the whole lifetime of the catalog. This
+    /// function is thread safe.
+    /// \param index Page index
+    const PDFPage* getPage(size_t index) const;
 
     /// Returns page index. If page is not found, then INVALID_PAGE_INDEX is returned.
     size_t getPageIndexFromPageReference(PDFObjectReference reference) const;
@@ -602,8 +608,12 @@ public:
     /// Returns optional content properties
     const PDFOptionalContentProperties* getOptionalContentProperties() const { return &m_optionalContentProperties; }
 
-    /// Returns root pointer for outline items
-    QSharedPointer<PDFOutlineItem> getOutlineRootPtr() const { return m_outlineRoot; }
+    /// Returns root pointer for outline items. Outline is loaded
+    /// on first access.
+    QSharedPointer<PDFOutlineItem> getOutlineRootPtr() const;
+
+    /// Returns page labels. Page labels are loaded on first access.
+    const std::vector<PDFPageLabel>& getPageLabels() const;
 
     /// Returns action, which should be performed
     const PDFAction* getOpenAction() const { return m_openAction.data(); }
@@ -634,7 +644,10 @@ public:
     bool isXFANeedsRendering() const { return m_xfaNeedsRendering; }
     const PDFObject& getAssociatedFiles() const { return m_associatedFiles; }
     const PDFObject& getDocumentPartRoot() const { return m_documentPartRoot; }
-    const std::map<QByteArray, PDFDestination>& getNamedDestinations() const { return m_namedDestinations; }
+
+    /// Returns all named destinations. Named destinations are loaded on first
+    /// access, prefer \p getNamedDestination, if only some destinations are needed.
+    const std::map<QByteArray, PDFDestination>& getNamedDestinations() const;
 
     /// Is document marked to have structure tree conforming to tagged document convention?
     bool isLogicalStructureMarked() const { return m_markInfoFlags.testFlag(MarkInfo_Marked); }
@@ -646,7 +659,8 @@ public:
     bool isLogicalStructureSuspects() const { return m_markInfoFlags.testFlag(MarkInfo_Suspects); }
 
     /// Returns destination using the key. If destination with the key is not found,
-    /// then nullptr is returned.
+    /// then nullptr is returned. Name tree is not loaded, only the destination
+    /// is found and parsed.
     /// \param key Destination key
     /// \returns Pointer to the destination, or nullptr
     const PDFDestination* getNamedDestination(const QByteArray& key) const;
@@ -719,12 +733,60 @@ private:
     };
     Q_DECLARE_FLAGS(MarkInfoFlags, MarkInfoFlag)
 
+    /// Parts of the catalog, which are loaded on first access. They are shared
+    /// between copies of the catalog (copies of the same document).
+    struct LazyData
+    {
+        QMutex mutex;
+        bool isOutlineLoaded = false;
+        bool isAllNamedDestinationsLoaded = false;
+        QSharedPointer<PDFOutlineItem> outlineRoot;
+        std::optional<std::vector<PDFPageLabel>> pageLabels;
+        std::map<QByteArray, PDFDestination> namedDestinations;
+    };
+
+    /// Pages of the document. If page tree is consistent (page count of the root
+    /// matches page counts of its kids), then only page count is determined when
+    /// catalog is parsed, and pages are parsed on first access (page tree is navigated
+    /// using /Count entries). Otherwise, whole page tree is parsed immediately.
+    /// Parsed pages are shared between copies of the catalog.
+    struct PageTreeData
+    {
+        QMutex mutex;
+        PDFObject root;
+        std::vector<std::atomic<const PDFPage*>> pagePointers;
+        std::vector<std::unique_ptr<PDFPage>> pages;
+        bool isAllPagesLoaded = false;
+        bool isPageReferenceMapBuilt = false;
+        std::unordered_map<PDFObjectReference, size_t, PDFObjectReferenceHash> pageReferenceToIndex;
+
+        /// Initializes page pointers for given page count
+        void initialize(size_t pageCount);
+
+        /// Stores parsed page to the page index (if page is not already stored)
+        const PDFPage* storePage(size_t index, PDFPage page);
+    };
+
+    /// Parses all pages of the page tree (used, when page tree is damaged
+    /// and page can't be found using /Count entries). Mutex must be locked.
+    void loadAllPages() const;
+
+    /// Parses named destination object
+    static PDFDestination parseNamedDestination(const PDFObjectStorage* storage, PDFObject object);
+
+    /// Sets storage owning the catalog (it is called by the document,
+    /// when document is copied)
+    void setStorage(const PDFObjectStorage* storage) { m_storage = storage; }
+
+    friend class PDFDocument;
+
     QByteArray m_version;
     PDFViewerPreferences m_viewerPreferences;
-    std::vector<PDFPage> m_pages;
-    std::vector<PDFPageLabel> m_pageLabels;
+    const PDFObjectStorage* m_storage = nullptr;
+    QSharedPointer<PageTreeData> m_pageTree = QSharedPointer<PageTreeData>::create();
+    PDFObject m_pageLabelsObject;
     PDFOptionalContentProperties m_optionalContentProperties;
-    QSharedPointer<PDFOutlineItem> m_outlineRoot;
+    PDFObject m_outlineObject;
     PDFActionPtr m_openAction;
     std::array<PDFActionPtr, LastDocumentAction> m_documentActions;
     PageLayout m_pageLayout = PageLayout::SinglePage;
@@ -749,8 +811,11 @@ private:
     PDFObject m_associatedFiles;
     PDFObject m_documentPartRoot;
 
+    PDFObject m_namedDestinationsTree;
+    PDFObject m_destinationsDictionary;
+    QSharedPointer<LazyData> m_lazyData = QSharedPointer<LazyData>::create();
+
     // Maps from Names dictionary
-    std::map<QByteArray, PDFDestination> m_namedDestinations;
     std::map<QByteArray, PDFObject> m_namedAppearanceStreams;
     std::map<QByteArray, PDFActionPtr> m_namedJavaScriptActions;
     std::map<QByteArray, PDFObject> m_namedPages;
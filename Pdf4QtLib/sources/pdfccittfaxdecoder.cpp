@@ -283,6 +283,103 @@ static constexpr PDFCCITTCode CCITT_BLACK_CODES[] = {
     { 2560,    0b000000011111,     000000011111_bitlength }
 };
 
+/// Lookup table for decoding of the CCITT codes. Table is indexed by the next \p LOOKUP_BITS
+/// bits of the stream, so code is decoded by single table lookup instead of reading
+/// the stream bit by bit and searching for the code.
+struct PDFCCITTCodeLookupTable
+{
+    /// Black make-up codes are one bit longer than MAX_CODE_BIT_LENGTH
+    static constexpr uint8_t LOOKUP_BITS = MAX_CODE_BIT_LENGTH + 1;
+
+    struct Entry
+    {
+        uint16_t value = 0;
+        uint8_t bits = 0; ///< Code length in bits, zero, if code is invalid
+    };
+
+    /// Creates lookup table from codes. Code value is obtained by \p getValue
+    /// functor, codes with bit length greater than \p lookupBits are ignored.
+    template<typename Code, typename GetValue>
+    explicit PDFCCITTCodeLookupTable(const Code* codes, size_t codeCount, uint8_t lookupBits, GetValue getValue) :
+        lookupBits(lookupBits)
+    {
+        entries.resize(static_cast<size_t>(1) << lookupBits);
+
+        // Codes are prefix codes, but we fill shorter codes first to be sure,
+        // that shortest matching code is always returned.
+        for (uint8_t bits = 1; bits <= lookupBits; ++bits)
+        {
+            for (size_t i = 0; i < codeCount; ++i)
+            {
+                const Code& code = codes[i];
+                if (code.bits != bits)
+                {
+                    continue;
+                }
+
+                const uint8_t freeBits = lookupBits - bits;
+                const size_t first = static_cast<size_t>(code.code) << freeBits;
+                const size_t last = first + (static_cast<size_t>(1) << freeBits);
+                for (size_t index = first; index < last; ++index)
+                {
+                    if (!entries[index].bits)
+                    {
+                        entries[index].value = getValue(code);
+                        entries[index].bits = bits;
+                    }
+                }
+            }
+        }
+    }
+
+    uint8_t lookupBits;
+    std::vector<Entry> entries;
+};
+
+static const PDFCCITTCodeLookupTable& getWhiteCodeLookupTable()
+{
+    static const PDFCCITTCodeLookupTable table(CCITT_WHITE_CODES, std::size(CCITT_WHITE_CODES), PDFCCITTCodeLookupTable::LOOKUP_BITS, [](const PDFCCITTCode& code) { return code.length; });
+    return table;
+}
+
+static const PDFCCITTCodeLookupTable& getBlackCodeLookupTable()
+{
+    static const PDFCCITTCodeLookupTable table(CCITT_BLACK_CODES, std::size(CCITT_BLACK_CODES), PDFCCITTCodeLookupTable::LOOKUP_BITS, [](const PDFCCITTCode& code) { return code.length; });
+    return table;
+}
+
+static const PDFCCITTCodeLookupTable& get2DModeLookupTable()
+{
+    static const PDFCCITTCodeLookupTable table(CCITT_2D_CODE_MODES, std::size(CCITT_2D_CODE_MODES), MAX_2D_MODE_BIT_LENGTH, [](const PDFCCITT2DModeInfo& info) { return static_cast<uint16_t>(info.mode); });
+    return table;
+}
+
+/// Sets pixels in the range [start, end) of the packed row to zero (black
+/// pixels). Whole bytes in the middle of the range are filled at once.
+static void fillBlackRun(uint8_t* row, int start, int end)
+{
+    Q_ASSERT(start < end);
+
+    const int startByte = start / 8;
+    const int endByte = end / 8;
+    const uint8_t startMask = 0xFF >> (start % 8);
+    const uint8_t endMask = static_cast<uint8_t>(~(0xFF >> (end % 8)));
+
+    if (startByte == endByte)
+    {
+        row[startByte] &= ~(startMask & endMask);
+        return;
+    }
+
+    row[startByte] &= ~startMask;
+    std::fill(row + startByte + 1, row + endByte, 0x00);
+
+    if (endMask)
+    {
+        row[endByte] &= ~endMask;
+    }
+}
+
 PDFCCITTFaxDecoder::PDFCCITTFaxDecoder(const QByteArray* stream, const PDFCCITTFaxDecoderParameters& parameters) :
     m_reader(stream, 1),
     m_parameters(parameters)
@@ -292,10 +389,17 @@ PDFCCITTFaxDecoder::PDFCCITTFaxDecoder(const QByteArray* stream, const PDFCCITTF
 
 PDFImageData PDFCCITTFaxDecoder::decode()
 {
-    PDFBitWriter writer(1);
     std::vector<int> codingLine;
     std::vector<int> referenceLine;
 
+    // Output data are written directly as packed rows, white pixel is 1
+    const int stride = (m_parameters.columns + 7) / 8;
+    QByteArray imageData;
+    if (m_parameters.rows > 0)
+    {
+        imageData.reserve(m_parameters.rows * stride);
+    }
+
     int row = 0;
     const size_t lineSize = m_parameters.columns + 2;
     codingLine.resize(lineSize, m_parameters.columns);
@@ -452,20 +556,31 @@ PDFImageData PDFCCITTFaxDecoder::decode()
             }
         }
 
-        // Write the line to the output buffer
+        // Write the line to the output buffer. Row is filled with white pixels,
+        // then black runs are filled (runs of white and black pixels alternate).
+        imageData.resize((row + 1) * stride);
+        uint8_t* rowData = reinterpret_cast<uint8_t*>(imageData.data()) + row * stride;
+        std::fill(rowData, rowData + stride, 0xFF);
+
+        int runStart = 0;
         isCurrentPixelBlack = false;
-        int index = 0;
-        for (int i = 0; i < m_parameters.columns; ++i)
+        for (int index = 0; runStart < m_parameters.columns && index < static_cast<int>(codingLine.size()); ++index)
         {
-            if (i == codingLine[index])
+            const int runEnd = qMin(codingLine[index], static_cast<int>(m_parameters.columns));
+            if (isCurrentPixelBlack && runStart < runEnd)
             {
-                isCurrentPixelBlack = !isCurrentPixelBlack;
-                ++index;
+                fillBlackRun(rowData, runStart, runEnd);
             }
 
-            writer.write(isCurrentPixelBlack ? 0 : 1);
+            runStart = qMax(runStart, runEnd);
+            isCurrentPixelBlack = !isCurrentPixelBlack;
+        }
+
+        // Clear padding bits at the end of the row
+        if (m_parameters.columns < stride * 8)
+        {
+            fillBlackRun(rowData, m_parameters.columns, stride * 8);
         }
-        writer.finishLine();
 
         ++row;
 
@@ -555,7 +670,7 @@ PDFImageData PDFCCITTFaxDecoder::decode()
         decode = { m_parameters.decode[0], m_parameters.decode[1] };
     }
 
-    return PDFImageData(1, 1, m_parameters.columns, row, (m_parameters.columns + 7) / 8, m_parameters.maskingType, writer.takeByteArray(), { }, qMove(decode), { });
+    return PDFImageData(1, 1, m_parameters.columns, row, stride, m_parameters.maskingType, qMove(imageData), { }, qMove(decode), { });
 }
 
 void PDFCCITTFaxDecoder::skipFill()
@@ -639,32 +754,21 @@ uint32_t PDFCCITTFaxDecoder::getRunLength(bool white)
 
 uint32_t PDFCCITTFaxDecoder::getWhiteCode()
 {
-    return getCode(CCITT_WHITE_CODES, std::size(CCITT_WHITE_CODES));
+    return getCode(getWhiteCodeLookupTable());
 }
 
 uint32_t PDFCCITTFaxDecoder::getBlackCode()
 {
-    return getCode(CCITT_BLACK_CODES, std::size(CCITT_BLACK_CODES));
+    return getCode(getBlackCodeLookupTable());
 }
 
-uint32_t PDFCCITTFaxDecoder::getCode(const PDFCCITTCode* codes, size_t codeCount)
+uint32_t PDFCCITTFaxDecoder::getCode(const PDFCCITTCodeLookupTable& table)
 {
-    uint32_t code = 0;
-    uint8_t bits = 0;
-
-    while (bits <= MAX_CODE_BIT_LENGTH)
+    const PDFCCITTCodeLookupTable::Entry& entry = table.entries[m_reader.look(table.lookupBits)];
+    if (entry.bits)
     {
-        code = (code << 1) + m_reader.read(1);
-        ++bits;
-
-        for (size_t i = 0; i < codeCount; ++i)
-        {
-            const PDFCCITTCode& currentCode = codes[i];
-            if (currentCode.bits == bits && currentCode.code == code)
-            {
-                return currentCode.length;
-            }
-        }
+        m_reader.read(entry.bits);
+        return entry.value;
     }
 
     throw PDFException(PDFTranslationContext::tr("Invalid CCITT run length code word."));
@@ -673,21 +777,12 @@ uint32_t PDFCCITTFaxDecoder::getCode(const PDFCCITTCode* codes, size_t codeCount
 
 CCITT_2D_Code_Mode PDFCCITTFaxDecoder::get2DMode()
 {
-    uint32_t code = 0;
-    uint8_t bits = 0;
-
-    while (bits <= MAX_2D_MODE_BIT_LENGTH)
+    const PDFCCITTCodeLookupTable& table = get2DModeLookupTable();
+    const PDFCCITTCodeLookupTable::Entry& entry = table.entries[m_reader.look(table.lookupBits)];
+    if (entry.bits)
     {
-        code = (code << 1) + m_reader.read(1);
-        ++bits;
-
-        for (const PDFCCITT2DModeInfo& info : CCITT_2D_CODE_MODES)
-        {
-            if (info.bits == bits && info.code == code)
-            {
-                return info.mode;
-            }
-        }
+        m_reader.read(entry.bits);
+        return static_cast<CCITT_2D_Code_Mode>(entry.value);
     }
 
     throw PDFException(PDFTranslationContext::tr("Invalid CCITT 2D mode."));
@@ -24,7 +24,7 @@
 namespace pdf
 {
 
-struct PDFCCITTCode;
+struct PDFCCITTCodeLookupTable;
 
 struct PDFCCITTFaxDecoderParameters
 {
@@ -86,7 +86,7 @@ enum CCITT_2D_Code_Mode
     Invalid
 };
 
-class PDFCCITTFaxDecoder
+class PDF4QTLIBSHARED_EXPORT PDFCCITTFaxDecoder
 {
 public:
     explicit PDFCCITTFaxDecoder(const QByteArray* stream, const PDFCCITTFaxDecoderParameters& parameters);
@@ -122,7 +122,10 @@ private:
     uint32_t getWhiteCode();
     uint32_t getBlackCode();
 
-    uint32_t getCode(const PDFCCITTCode* codes, size_t codeCount);
+    /// Decodes code from the stream using the lookup table. If code is invalid,
+    /// then exception is thrown.
+    /// \param table Lookup table
+    uint32_t getCode(const PDFCCITTCodeLookupTable& table);
 
     PDFBitReader m_reader;
     PDFCCITTFaxDecoderParameters m_parameters;
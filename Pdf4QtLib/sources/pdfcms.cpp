@@ -39,6 +39,7 @@
 #endif
 #endif
 
+#include <tuple>
 #include <unordered_map>
 
 namespace pdf
@@ -63,6 +64,7 @@ public:
     virtual bool fillRGBBufferFromXYZ(const PDFColor3& whitePoint, const std::vector<float>& colors, RenderingIntent intent, unsigned char* outputBuffer, PDFRenderErrorReporter* reporter) const override;
     virtual bool fillRGBBufferFromICC(const std::vector<float>& colors, RenderingIntent renderingIntent, unsigned char* outputBuffer, const QByteArray& iccID, const QByteArray& iccData, PDFRenderErrorReporter* reporter) const override;
     virtual bool transformColorSpace(const ColorSpaceTransformParams& params) const override;
+    virtual bool fillRGBBufferFromSamples(ColorSpaceType colorSpaceType, const unsigned char* samples, size_t sampleCount, uint8_t bitsPerComponent, RenderingIntent intent, unsigned char* outputBuffer, const QByteArray& iccID, const QByteArray& iccData, PDFRenderErrorReporter* reporter) const override;
 
 private:
     void init();
@@ -86,6 +88,32 @@ private:
         ProfileCount
     };
 
+    /// Format of the input data of the transform
+    enum SampleFormat
+    {
+        FloatSamples,   ///< Float values (CMYK is in range [0, 100])
+        UInt8Samples,   ///< 8-bit unsigned integer samples
+        UInt16Samples,  ///< 16-bit unsigned big-endian integer samples
+        SampleFormatCount
+    };
+
+    /// Key of the memoized solid color
+    struct SolidColorKey
+    {
+        ColorSpaceType colorSpaceType = Invalid;
+        RenderingIntent intent = RenderingIntent::Unknown;
+        std::array<PDFColorComponent, 4> color = { };
+        QByteArray iccID;
+
+        bool operator<(const SolidColorKey& other) const
+        {
+            return std::tie(colorSpaceType, intent, color, iccID) < std::tie(other.colorSpaceType, other.intent, other.color, other.iccID);
+        }
+    };
+
+    /// Maximal number of memoized solid colors. When limit is reached, cache is cleared.
+    static constexpr size_t SOLID_COLOR_CACHE_LIMIT = 4096;
+
     /// Returns true, if we are doing soft-proofing
     bool isSoftProofing() const;
 
@@ -102,14 +130,33 @@ private:
     /// \param profile Color profile
     /// \param intent Rendering intent
     /// \param isRGB888Buffer If true, 8-bit RGB output buffer is used, otherwise FLOAT RGB output buffer is used
-    cmsHTRANSFORM getTransform(Profile profile, RenderingIntent intent, bool isRGB888Buffer) const;
+    /// \param sampleFormat Format of input data
+    cmsHTRANSFORM getTransform(Profile profile, RenderingIntent intent, bool isRGB888Buffer, SampleFormat sampleFormat = FloatSamples) const;
 
     /// Gets transform for ICC profile from cache. If transform doesn't exist, then it is created.
     /// \param iccData Data of icc profile
     /// \param iccID Icc profile id
     /// \param renderingIntent Rendering intent
     /// \param isRGB888Buffer If true, 8-bit RGB output buffer is used, otherwise FLOAT RGB output buffer is used
-    cmsHTRANSFORM getTransformFromICCProfile(const QByteArray& iccData, const QByteArray& iccID, RenderingIntent renderingIntent, bool isRGB888Buffer) const;
+    /// \param sampleFormat Format of input data
+    cmsHTRANSFORM getTransformFromICCProfile(const QByteArray& iccData, const QByteArray& iccID, RenderingIntent renderingIntent, bool isRGB888Buffer, SampleFormat sampleFormat = FloatSamples) const;
+
+    /// Returns memoized solid color, or invalid color, if color is not memoized
+    /// \param key Solid color key
+    QColor getSolidColorFromCache(const SolidColorKey& key) const;
+
+    /// Memoizes valid solid color
+    /// \param key Solid color key
+    /// \param color Transformed color
+    void storeSolidColorToCache(const SolidColorKey& key, const QColor& color) const;
+
+    /// Creates solid color key. If color can't be memoized, then key with
+    /// invalid color space type is returned.
+    /// \param colorSpaceType Color space type
+    /// \param intent Effective rendering intent
+    /// \param color Input color
+    /// \param iccID Icc profile id (only for ICC color space)
+    static SolidColorKey createSolidColorKey(ColorSpaceType colorSpaceType, RenderingIntent intent, const PDFColor& color, const QByteArray& iccID);
 
     /// Returns transformation flags according to the current settings
     cmsUInt32Number getTransformationFlags() const;
@@ -122,7 +169,8 @@ private:
     /// \param profile Color profile
     /// \param intent Rendering intent
     /// \param isRGB888Buffer If true, 8-bit RGB output buffer is used, otherwise FLOAT RGB output buffer is used
-    static constexpr int getCacheKey(Profile profile, RenderingIntent intent, bool isRGB888Buffer) { return ((int(intent) * ProfileCount + profile) << 1) + (isRGB888Buffer ? 1 : 0); }
+    /// \param sampleFormat Format of input data
+    static constexpr int getCacheKey(Profile profile, RenderingIntent intent, bool isRGB888Buffer, SampleFormat sampleFormat) { return (((int(intent) * ProfileCount + profile) * SampleFormatCount + sampleFormat) << 1) + (isRGB888Buffer ? 1 : 0); }
 
     /// Returns little CMS rendering intent
     /// \param intent Rendering intent
@@ -130,7 +178,8 @@ private:
 
     /// Returns little CMS data format for profile
     /// \param profile Color profile handle
-    static cmsUInt32Number getProfileDataFormat(cmsHPROFILE profile);
+    /// \param sampleFormat Format of input data
+    static cmsUInt32Number getProfileDataFormat(cmsHPROFILE profile, SampleFormat sampleFormat);
 
     /// Returns color from output color. Clamps invalid rgb output values to range [0.0, 1.0].
     /// \param color01 Rgb color (range 0-1 is assumed).
@@ -154,6 +203,9 @@ private:
 
     mutable QReadWriteLock m_transformColorSpaceCacheLock;
     mutable std::map<QByteArray, cmsHTRANSFORM> m_transformColorSpaceCache;
+
+    mutable QReadWriteLock m_solidColorCacheLock;
+    mutable std::map<SolidColorKey, QColor> m_solidColorCache;
 };
 
 bool PDFLittleCMS::fillRGBBufferFromDeviceGray(const std::vector<float>& colors,
@@ -490,7 +542,15 @@ QColor PDFLittleCMS::getPaperColor() const
 
 QColor PDFLittleCMS::getColorFromDeviceGray(const PDFColor& color, RenderingIntent intent, PDFRenderErrorReporter* reporter) const
 {
-    cmsHTRANSFORM transform = getTransform(Gray, getEffectiveRenderingIntent(intent), false);
+    const RenderingIntent effectiveRenderingIntent = getEffectiveRenderingIntent(intent);
+    const SolidColorKey solidColorKey = createSolidColorKey(DeviceGray, effectiveRenderingIntent, color, QByteArray());
+    QColor cachedColor = getSolidColorFromCache(solidColorKey);
+    if (cachedColor.isValid())
+    {
+        return cachedColor;
+    }
+
+    cmsHTRANSFORM transform = getTransform(Gray, effectiveRenderingIntent, false);
 
     if (!transform)
     {
@@ -505,7 +565,9 @@ QColor PDFLittleCMS::getColorFromDeviceGray(const PDFColor& color, RenderingInte
         const float grayColor = color[0];
         std::array<float, 3> rgbOutputColor = { };
         cmsDoTransform(transform, &grayColor, rgbOutputColor.data(), 1);
-        return getColorFromOutputColor(rgbOutputColor);
+        QColor result = getColorFromOutputColor(rgbOutputColor);
+        storeSolidColorToCache(solidColorKey, result);
+        return result;
     }
     else
     {
@@ -517,7 +579,15 @@ QColor PDFLittleCMS::getColorFromDeviceGray(const PDFColor& color, RenderingInte
 
 QColor PDFLittleCMS::getColorFromDeviceRGB(const PDFColor& color, RenderingIntent intent, PDFRenderErrorReporter* reporter) const
 {
-    cmsHTRANSFORM transform = getTransform(RGB, getEffectiveRenderingIntent(intent), false);
+    const RenderingIntent effectiveRenderingIntent = getEffectiveRenderingIntent(intent);
+    const SolidColorKey solidColorKey = createSolidColorKey(DeviceRGB, effectiveRenderingIntent, color, QByteArray());
+    QColor cachedColor = getSolidColorFromCache(solidColorKey);
+    if (cachedColor.isValid())
+    {
+        return cachedColor;
+    }
+
+    cmsHTRANSFORM transform = getTransform(RGB, effectiveRenderingIntent, false);
 
     if (!transform)
     {
@@ -532,7 +602,9 @@ QColor PDFLittleCMS::getColorFromDeviceRGB(const PDFColor& color, RenderingInten
         std::array<float, 3> rgbInputColor = { color[0], color[1], color[2] };
         std::array<float, 3> rgbOutputColor = { };
         cmsDoTransform(transform, rgbInputColor.data(), rgbOutputColor.data(), 1);
-        return getColorFromOutputColor(rgbOutputColor);
+        QColor result = getColorFromOutputColor(rgbOutputColor);
+        storeSolidColorToCache(solidColorKey, result);
+        return result;
     }
     else
     {
@@ -544,7 +616,15 @@ QColor PDFLittleCMS::getColorFromDeviceRGB(const PDFColor& color, RenderingInten
 
 QColor PDFLittleCMS::getColorFromDeviceCMYK(const PDFColor& color, RenderingIntent intent, PDFRenderErrorReporter* reporter) const
 {
-    cmsHTRANSFORM transform = getTransform(CMYK, getEffectiveRenderingIntent(intent), false);
+    const RenderingIntent effectiveRenderingIntent = getEffectiveRenderingIntent(intent);
+    const SolidColorKey solidColorKey = createSolidColorKey(DeviceCMYK, effectiveRenderingIntent, color, QByteArray());
+    QColor cachedColor = getSolidColorFromCache(solidColorKey);
+    if (cachedColor.isValid())
+    {
+        return cachedColor;
+    }
+
+    cmsHTRANSFORM transform = getTransform(CMYK, effectiveRenderingIntent, false);
 
     if (!transform)
     {
@@ -559,7 +639,9 @@ QColor PDFLittleCMS::getColorFromDeviceCMYK(const PDFColor& color, RenderingInte
         std::array<float, 4> cmykInputColor = { color[0] * 100.0f, color[1] * 100.0f, color[2] * 100.0f, color[3] * 100.0f };
         std::array<float, 3> rgbOutputColor = { };
         cmsDoTransform(transform, cmykInputColor.data(), rgbOutputColor.data(), 1);
-        return getColorFromOutputColor(rgbOutputColor);
+        QColor result = getColorFromOutputColor(rgbOutputColor);
+        storeSolidColorToCache(solidColorKey, result);
+        return result;
     }
     else
     {
@@ -597,10 +679,12 @@ QColor PDFLittleCMS::getColorFromXYZ(const PDFColor3& whitePoint, const PDFColor
     return QColor();
 }
 
-cmsHTRANSFORM PDFLittleCMS::getTransformFromICCProfile(const QByteArray& iccData, const QByteArray& iccID, RenderingIntent renderingIntent, bool isRGB888Buffer) const
+cmsHTRANSFORM PDFLittleCMS::getTransformFromICCProfile(const QByteArray& iccData, const QByteArray& iccID, RenderingIntent renderingIntent, bool isRGB888Buffer, SampleFormat sampleFormat) const
 {
+    static constexpr std::array<const char*, SampleFormatCount> sampleFormatSuffixes = { "", "_U8", "_U16" };
+
     RenderingIntent effectiveRenderingIntent = getEffectiveRenderingIntent(renderingIntent);
-    const auto key = std::make_pair(iccID + (isRGB888Buffer ? "RGB_888" : "FLT"), effectiveRenderingIntent);
+    const auto key = std::make_pair(iccID + (isRGB888Buffer ? "RGB_888" : "FLT") + sampleFormatSuffixes[sampleFormat], effectiveRenderingIntent);
     QReadLocker lock(&m_customIccProfileCacheLock);
     auto it = m_customIccProfileCache.find(key);
     if (it == m_customIccProfileCache.cend())
@@ -617,7 +701,7 @@ cmsHTRANSFORM PDFLittleCMS::getTransformFromICCProfile(const QByteArray& iccData
             cmsHPROFILE profile = cmsOpenProfileFromMem(iccData.data(), iccData.size());
             if (profile)
             {
-                if (const cmsUInt32Number inputDataFormat = getProfileDataFormat(profile))
+                if (const cmsUInt32Number inputDataFormat = getProfileDataFormat(profile, sampleFormat))
                 {
                     cmsUInt32Number lcmsIntent = getLittleCMSRenderingIntent(effectiveRenderingIntent);
 
@@ -656,6 +740,13 @@ cmsHTRANSFORM PDFLittleCMS::getTransformFromICCProfile(const QByteArray& iccData
 
 QColor PDFLittleCMS::getColorFromICC(const PDFColor& color, RenderingIntent renderingIntent, const QByteArray& iccID, const QByteArray& iccData, PDFRenderErrorReporter* reporter) const
 {
+    const SolidColorKey solidColorKey = createSolidColorKey(ICC, getEffectiveRenderingIntent(renderingIntent), color, iccID);
+    QColor cachedColor = getSolidColorFromCache(solidColorKey);
+    if (cachedColor.isValid())
+    {
+        return cachedColor;
+    }
+
     cmsHTRANSFORM transform = getTransformFromICCProfile(iccData, iccID, renderingIntent, false);
 
     if (!transform)
@@ -678,7 +769,9 @@ QColor PDFLittleCMS::getColorFromICC(const PDFColor& color, RenderingIntent rend
 
         std::array<float, 3> rgbOutputColor = { };
         cmsDoTransform(transform, inputBuffer.data(), rgbOutputColor.data(), 1);
-        return getColorFromOutputColor(rgbOutputColor);
+        QColor result = getColorFromOutputColor(rgbOutputColor);
+        storeSolidColorToCache(solidColorKey, result);
+        return result;
     }
     else
     {
@@ -951,9 +1044,9 @@ cmsHPROFILE PDFLittleCMS::createProfile(const QString& id, const PDFColorProfile
     return cmsHPROFILE();
 }
 
-cmsHTRANSFORM PDFLittleCMS::getTransform(Profile profile, RenderingIntent intent, bool isRGB888Buffer) const
+cmsHTRANSFORM PDFLittleCMS::getTransform(Profile profile, RenderingIntent intent, bool isRGB888Buffer, SampleFormat sampleFormat) const
 {
-    const int key = getCacheKey(profile, intent, isRGB888Buffer);
+    const int key = getCacheKey(profile, intent, isRGB888Buffer, sampleFormat);
 
     QReadLocker lock(&m_transformationCacheLock);
     auto it = m_transformationCache.find(key);
@@ -971,7 +1064,9 @@ cmsHTRANSFORM PDFLittleCMS::getTransform(Profile profile, RenderingIntent intent
             cmsHPROFILE input = m_profiles[profile];
             cmsHPROFILE output = m_profiles[Output];
 
-            if (input && output)
+            const cmsUInt32Number inputDataFormat = input ? getProfileDataFormat(input, sampleFormat) : 0;
+
+            if (input && output && inputDataFormat)
             {
                 if (isSoftProofing())
                 {
@@ -982,12 +1077,12 @@ cmsHTRANSFORM PDFLittleCMS::getTransform(Profile profile, RenderingIntent intent
                         proofingIntent = intent;
                     }
 
-                    transform = cmsCreateProofingTransform(input, getProfileDataFormat(input), output, isRGB888Buffer ? TYPE_RGB_8 : TYPE_RGB_FLT, proofingProfile,
+                    transform = cmsCreateProofingTransform(input, inputDataFormat, output, isRGB888Buffer ? TYPE_RGB_8 : TYPE_RGB_FLT, proofingProfile,
                                                            getLittleCMSRenderingIntent(intent), getLittleCMSRenderingIntent(proofingIntent), getTransformationFlags());
                 }
                 else
                 {
-                    transform = cmsCreateTransform(input, getProfileDataFormat(input), output, isRGB888Buffer ? TYPE_RGB_8 : TYPE_RGB_FLT, getLittleCMSRenderingIntent(intent), getTransformationFlags());
+                    transform = cmsCreateTransform(input, inputDataFormat, output, isRGB888Buffer ? TYPE_RGB_8 : TYPE_RGB_FLT, getLittleCMSRenderingIntent(intent), getTransformationFlags());
                 }
             }
 
@@ -1078,22 +1173,55 @@ cmsUInt32Number PDFLittleCMS::getLittleCMSRenderingIntent(RenderingIntent intent
     return INTENT_PERCEPTUAL;
 }
 
-cmsUInt32Number PDFLittleCMS::getProfileDataFormat(cmsHPROFILE profile)
+cmsUInt32Number PDFLittleCMS::getProfileDataFormat(cmsHPROFILE profile, SampleFormat sampleFormat)
 {
+    auto selectFormat = [sampleFormat](cmsUInt32Number floatFormat, cmsUInt32Number uint8Format, cmsUInt32Number uint16Format) -> cmsUInt32Number
+    {
+        switch (sampleFormat)
+        {
+            case FloatSamples:
+                return floatFormat;
+
+            case UInt8Samples:
+                return uint8Format;
+
+            case UInt16Samples:
+                return uint16Format;
+
+            default:
+                Q_ASSERT(false);
+                break;
+        }
+
+        return 0;
+    };
+
+    // 16-bit samples in PDF are big-endian, so on little-endian
+    // machines we must use swapped endianness formats.
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    constexpr cmsUInt32Number grayFormat16 = TYPE_GRAY_16_SE;
+    constexpr cmsUInt32Number rgbFormat16 = TYPE_RGB_16_SE;
+    constexpr cmsUInt32Number cmykFormat16 = TYPE_CMYK_16_SE;
+#else
+    constexpr cmsUInt32Number grayFormat16 = TYPE_GRAY_16;
+    constexpr cmsUInt32Number rgbFormat16 = TYPE_RGB_16;
+    constexpr cmsUInt32Number cmykFormat16 = TYPE_CMYK_16;
+#endif
+
     cmsColorSpaceSignature signature = cmsGetColorSpace(profile);
     switch (signature)
     {
         case cmsSigGrayData:
-            return TYPE_GRAY_FLT;
+            return selectFormat(TYPE_GRAY_FLT, TYPE_GRAY_8, grayFormat16);
 
         case cmsSigRgbData:
-            return TYPE_RGB_FLT;
+            return selectFormat(TYPE_RGB_FLT, TYPE_RGB_8, rgbFormat16);
 
         case cmsSigCmykData:
-            return TYPE_CMYK_FLT;
+            return selectFormat(TYPE_CMYK_FLT, TYPE_CMYK_8, cmykFormat16);
 
         case cmsSigXYZData:
-            return TYPE_XYZ_FLT;
+            return selectFormat(TYPE_XYZ_FLT, 0, 0);
 
         default:
             break;
@@ -1102,6 +1230,126 @@ cmsUInt32Number PDFLittleCMS::getProfileDataFormat(cmsHPROFILE profile)
     return 0;
 }
 
+QColor PDFLittleCMS::getSolidColorFromCache(const SolidColorKey& key) const
+{
+    if (key.colorSpaceType == Invalid)
+    {
+        return QColor();
+    }
+
+    QReadLocker lock(&m_solidColorCacheLock);
+    auto it = m_solidColorCache.find(key);
+    if (it != m_solidColorCache.cend())
+    {
+        return it->second;
+    }
+
+    return QColor();
+}
+
+void PDFLittleCMS::storeSolidColorToCache(const SolidColorKey& key, const QColor& color) const
+{
+    if (key.colorSpaceType == Invalid || !color.isValid())
+    {
+        return;
+    }
+
+    QWriteLocker lock(&m_solidColorCacheLock);
+    if (m_solidColorCache.size() >= SOLID_COLOR_CACHE_LIMIT)
+    {
+        m_solidColorCache.clear();
+    }
+    m_solidColorCache[key] = color;
+}
+
+PDFLittleCMS::SolidColorKey PDFLittleCMS::createSolidColorKey(ColorSpaceType colorSpaceType, RenderingIntent intent, const PDFColor& color, const QByteArray& iccID)
+{
+    SolidColorKey key;
+
+    if (color.size() <= key.color.size())
+    {
+        key.colorSpaceType = colorSpaceType;
+        key.intent = intent;
+        key.iccID = iccID;
+        for (size_t i = 0; i < color.size(); ++i)
+        {
+            key.color[i] = color[i];
+        }
+    }
+
+    return key;
+}
+
+bool PDFLittleCMS::fillRGBBufferFromSamples(ColorSpaceType colorSpaceType,
+                                            const unsigned char* samples,
+                                            size_t sampleCount,
+                                            uint8_t bitsPerComponent,
+                                            RenderingIntent intent,
+                                            unsigned char* outputBuffer,
+                                            const QByteArray& iccID,
+                                            const QByteArray& iccData,
+                                            PDFRenderErrorReporter* reporter) const
+{
+    Q_UNUSED(reporter);
+
+    SampleFormat sampleFormat = FloatSamples;
+    switch (bitsPerComponent)
+    {
+        case 8:
+            sampleFormat = UInt8Samples;
+            break;
+
+        case 16:
+            sampleFormat = UInt16Samples;
+            break;
+
+        default:
+            return false;
+    }
+
+    const RenderingIntent effectiveRenderingIntent = getEffectiveRenderingIntent(intent);
+    cmsHTRANSFORM transform = cmsHTRANSFORM();
+
+    switch (colorSpaceType)
+    {
+        case DeviceGray:
+            transform = getTransform(Gray, effectiveRenderingIntent, true, sampleFormat);
+            break;
+
+        case DeviceRGB:
+            transform = getTransform(RGB, effectiveRenderingIntent, true, sampleFormat);
+            break;
+
+        case DeviceCMYK:
+            transform = getTransform(CMYK, effectiveRenderingIntent, true, sampleFormat);
+            break;
+
+        case ICC:
+            transform = getTransformFromICCProfile(iccData, iccID, intent, true, sampleFormat);
+            break;
+
+        default:
+            return false;
+    }
+
+    // If transform can't be created, caller will use float buffer
+    // conversion, which reports an error, if it also fails.
+    if (!transform)
+    {
+        return false;
+    }
+
+    const cmsUInt32Number channels = T_CHANNELS(cmsGetTransformInputFormat(transform));
+    if (channels == 0 || sampleCount % channels != 0)
+    {
+        return false;
+    }
+
+    Q_ASSERT(cmsGetTransformOutputFormat(transform) == TYPE_RGB_8);
+    cmsDoTransform(transform, samples, outputBuffer, static_cast<cmsUInt32Number>(sampleCount / channels));
+    return true;
+}
+
 QColor PDFLittleCMS::getColorFromOutputColor(std::array<float, 3> color01)
 {
     QColor color(QColor::Rgb);
@@ -1203,7 +1451,7 @@ cmsHTRANSFORM PDFLittleCMS::getTransformBetweenColorSpaces(const PDFCMS::ColorSp
 
             if (inputProfile && outputProfile)
             {
-                transform = cmsCreateTransform(inputProfile, getProfileDataFormat(inputProfile), outputProfile, getProfileDataFormat(outputProfile), getLittleCMSRenderingIntent(params.intent), getTransformationFlags());
+                transform = cmsCreateTransform(inputProfile, getProfileDataFormat(inputProfile, FloatSamples), outputProfile, getProfileDataFormat(outputProfile, FloatSamples), getLittleCMSRenderingIntent(params.intent), getTransformationFlags());
             }
 
             if (params.sourceType == ColorSpaceType::ICC)
@@ -1380,6 +1628,20 @@ bool PDFCMSGeneric::transformColorSpace(const PDFCMS::ColorSpaceTransformParams&
     return false;
 }
 
+bool PDFCMSGeneric::fillRGBBufferFromSamples(ColorSpaceType colorSpaceType, const unsigned char* samples, size_t sampleCount, uint8_t bitsPerComponent, RenderingIntent intent, unsigned char* outputBuffer, const QByteArray& iccID, const QByteArray& iccData, PDFRenderErrorReporter* reporter) const
+{
+    Q_UNUSED(colorSpaceType);
+    Q_UNUSED(samples);
+    Q_UNUSED(sampleCount);
+    Q_UNUSED(bitsPerComponent);
+    Q_UNUSED(intent);
+    Q_UNUSED(outputBuffer);
+    Q_UNUSED(iccID);
+    Q_UNUSED(iccData);
+    Q_UNUSED(reporter);
+    return false;
+}
+
 PDFCMSManager::PDFCMSManager(QObject* parent) :
     BaseClass(parent),
     m_document(nullptr),
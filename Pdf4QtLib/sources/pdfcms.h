@@ -244,13 +244,38 @@ public:
     /// it just transforms two float buffers from input color space to output color space.
     virtual bool transformColorSpace(const ColorSpaceTransformParams& params) const = 0;
 
+    /// Fills RGB buffer directly from raw interleaved image samples with 8 or 16 bits
+    /// per component (16-bit samples are big-endian, as they are stored in PDF). Samples
+    /// are assumed to have default decode array, so they map linearly to range [0, 1].
+    /// Avoids conversion of samples to float buffer. If error occurs, or color space
+    /// or sample format is not supported, then false is returned. Caller then should
+    /// handle this - try to convert color as accurate as possible.
+    /// \param colorSpaceType Source color space (DeviceGray, DeviceRGB, DeviceCMYK or ICC)
+    /// \param samples Raw sample data
+    /// \param sampleCount Number of samples (pixel count multiplied by color channel count)
+    /// \param bitsPerComponent Bits per component (8 or 16)
+    /// \param intent Rendering intent
+    /// \param outputBuffer Output buffer in format RGB_888 (8-bit RGB values)
+    /// \param iccID Unique ICC profile identifier (only for ICC color space)
+    /// \param iccData Color profile data (only for ICC color space)
+    /// \param reporter Render error reporter (used, when color transform fails)
+    virtual bool fillRGBBufferFromSamples(ColorSpaceType colorSpaceType,
+                                          const unsigned char* samples,
+                                          size_t sampleCount,
+                                          uint8_t bitsPerComponent,
+                                          RenderingIntent intent,
+                                          unsigned char* outputBuffer,
+                                          const QByteArray& iccID,
+                                          const QByteArray& iccData,
+                                          PDFRenderErrorReporter* reporter) const = 0;
+
     /// Get D50 white point for XYZ color space
     static PDFColor3 getDefaultXYZWhitepoint();
 };
 
 using PDFCMSPointer = QSharedPointer<PDFCMS>;
 
-class PDFCMSGeneric : public PDFCMS
+class PDF4QTLIBSHARED_EXPORT PDFCMSGeneric : public PDFCMS
 {
 public:
     explicit inline PDFCMSGeneric() = default;
@@ -268,6 +293,7 @@ public:
     virtual bool fillRGBBufferFromXYZ(const PDFColor3& whitePoint, const std::vector<float>& colors, RenderingIntent intent, unsigned char* outputBuffer, PDFRenderErrorReporter* reporter) const override;
     virtual bool fillRGBBufferFromICC(const std::vector<float>& colors, RenderingIntent renderingIntent, unsigned char* outputBuffer, const QByteArray& iccID, const QByteArray& iccData, PDFRenderErrorReporter* reporter) const override;
     virtual bool transformColorSpace(const ColorSpaceTransformParams& params) const override;
+    virtual bool fillRGBBufferFromSamples(ColorSpaceType colorSpaceType, const unsigned char* samples, size_t sampleCount, uint8_t bitsPerComponent, RenderingIntent intent, unsigned char* outputBuffer, const QByteArray& iccID, const QByteArray& iccData, PDFRenderErrorReporter* reporter) const override;
 };
 
 struct PDFColorProfileIdentifier
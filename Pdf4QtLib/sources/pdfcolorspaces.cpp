@@ -107,6 +107,11 @@ void PDFDeviceGrayColorSpace::fillRGBBuffer(const std::vector<float>& colors, un
     }
 }
 
+bool PDFDeviceGrayColorSpace::fillRGBBufferFromSamples(const unsigned char* samples, size_t sampleCount, uint8_t bitsPerComponent, unsigned char* outputBuffer, RenderingIntent intent, const PDFCMS* cms, PDFRenderErrorReporter* reporter) const
+{
+    return cms->fillRGBBufferFromSamples(PDFCMS::DeviceGray, samples, sampleCount, bitsPerComponent, intent, outputBuffer, QByteArray(), QByteArray(), reporter);
+}
+
 PDFColor PDFDeviceRGBColorSpace::getDefaultColorOriginal() const
 {
     return PDFColor(0.0f, 0.0f, 0.0f);
@@ -146,6 +151,11 @@ void PDFDeviceRGBColorSpace::fillRGBBuffer(const std::vector<float>& colors, uns
     }
 }
 
+bool PDFDeviceRGBColorSpace::fillRGBBufferFromSamples(const unsigned char* samples, size_t sampleCount, uint8_t bitsPerComponent, unsigned char* outputBuffer, RenderingIntent intent, const PDFCMS* cms, PDFRenderErrorReporter* reporter) const
+{
+    return cms->fillRGBBufferFromSamples(PDFCMS::DeviceRGB, samples, sampleCount, bitsPerComponent, intent, outputBuffer, QByteArray(), QByteArray(), reporter);
+}
+
 PDFColor PDFDeviceCMYKColorSpace::getDefaultColorOriginal() const
 {
     return PDFColor(0.0f, 0.0f, 0.0f, 1.0f);
@@ -186,6 +196,11 @@ void PDFDeviceCMYKColorSpace::fillRGBBuffer(const std::vector<float>& colors, un
     }
 }
 
+bool PDFDeviceCMYKColorSpace::fillRGBBufferFromSamples(const unsigned char* samples, size_t sampleCount, uint8_t bitsPerComponent, unsigned char* outputBuffer, RenderingIntent intent, const PDFCMS* cms, PDFRenderErrorReporter* reporter) const
+{
+    return cms->fillRGBBufferFromSamples(PDFCMS::DeviceCMYK, samples, sampleCount, bitsPerComponent, intent, outputBuffer, QByteArray(), QByteArray(), reporter);
+}
+
 bool PDFAbstractColorSpace::equals(const PDFAbstractColorSpace* other) const
 {
     return getColorSpace() == other->getColorSpace();
@@ -213,185 +228,187 @@ QColor PDFAbstractColorSpace::getDefaultColor(const PDFCMS* cms, RenderingIntent
     return getColor(getDefaultColorOriginal(), cms, intent, reporter, true);
 }
 
-QImage PDFAbstractColorSpace::getImage(const PDFImageData& imageData,
-                                       const PDFImageData& softMask,
-                                       const PDFCMS* cms,
-                                       RenderingIntent intent,
-                                       PDFRenderErrorReporter* reporter) const
+void PDFAbstractColorSpace::fillImageBand(const PDFImageData& imageData,
+                                          const PDFImageData& softMask,
+                                          QImage& image,
+                                          unsigned int firstScanLine,
+                                          const PDFCMS* cms,
+                                          RenderingIntent intent,
+                                          PDFRenderErrorReporter* reporter) const
 {
-    if (imageData.isValid())
+    unsigned int componentCount = imageData.getComponents();
+    if (componentCount != getColorComponentCount())
     {
-        switch (imageData.getMaskingType())
+        throw PDFException(PDFTranslationContext::tr("Invalid colors for color space. Color space has %1 colors. Provided color count is %4.").arg(getColorComponentCount()).arg(componentCount));
+    }
+
+    const std::vector<PDFReal>& decode = imageData.getDecode();
+    if (!decode.empty() && decode.size() != componentCount * 2)
+    {
+        throw PDFException(PDFTranslationContext::tr("Invalid size of the decode array. Expected %1, actual %2.").arg(componentCount * 2).arg(decode.size()));
+    }
+
+    const unsigned int imageWidth = imageData.getWidth();
+    const unsigned int imageHeight = imageData.getHeight();
+    const bool hasSoftMask = softMask.isValid();
+
+    const std::vector<PDFReal>& matte = softMask.getMatte();
+    bool hasMatte = hasSoftMask && !matte.empty();
+    if (hasSoftMask)
+    {
+        checkAlphaMask(softMask);
+
+        if (hasMatte && matte.size() != componentCount)
         {
-            case PDFImageData::MaskingType::None:
-            {
-                QImage image(imageData.getWidth(), imageData.getHeight(), QImage::Format_RGB888);
-                image.fill(QColor(Qt::white));
+            reporter->reportRenderErrorOnce(RenderErrorType::Warning, PDFTranslationContext::tr("Invalid matte color."));
+            hasMatte = false;
+        }
+    }
 
-                unsigned int componentCount = imageData.getComponents();
-                if (componentCount != getColorComponentCount())
-                {
-                    throw PDFException(PDFTranslationContext::tr("Invalid colors for color space. Color space has %1 colors. Provided color count is %4.").arg(getColorComponentCount()).arg(componentCount));
-                }
+    Q_ASSERT(image.format() == (hasSoftMask ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB888));
+    Q_ASSERT(image.width() == int(imageWidth) && image.height() >= int(firstScanLine + imageHeight));
+    Q_ASSERT(!hasSoftMask || (softMask.getWidth() == imageWidth && softMask.getHeight() == imageHeight));
 
-                const std::vector<PDFReal>& decode = imageData.getDecode();
-                if (!decode.empty() && decode.size() != componentCount * 2)
-                {
-                    throw PDFException(PDFTranslationContext::tr("Invalid size of the decode array. Expected %1, actual %2.").arg(componentCount * 2).arg(decode.size()));
-                }
+    // Colors premultiplied with matte color must be un-premultiplied
+    // in float precision, so raw sample conversion can't be used.
+    const bool isRawSampleConversion = !hasMatte && isRawSampleConversionPossible(imageData);
 
-                const unsigned int imageWidth = imageData.getWidth();
-                const unsigned int imageHeight = imageData.getHeight();
+    QMutex exceptionMutex;
+    std::optional<PDFException> exception;
 
-                QMutex exceptionMutex;
-                std::optional<PDFException> exception;
+    auto transformPixelLine = [&](unsigned int i)
+    {
+        try
+        {
+            unsigned char* outputLine = image.scanLine(firstScanLine + i);
+
+            // If image has soft mask, colors are converted to the temporary buffer
+            // and then premultiplied by alpha values to the output line.
+            std::vector<unsigned char> alphaBuffer;
+            std::vector<unsigned char> colorBuffer;
+            unsigned char* colorLine = outputLine;
+            if (hasSoftMask)
+            {
+                alphaBuffer.resize(imageWidth, 0);
+                fillAlphaMaskLine(softMask, i, alphaBuffer.data());
+                colorBuffer.resize(imageWidth * 3, 0);
+                colorLine = colorBuffer.data();
+            }
 
-                auto transformPixelLine = [&](unsigned int i)
+            const unsigned char* samples = isRawSampleConversion ? reinterpret_cast<const unsigned char*>(imageData.getData().constData()) + size_t(i) * imageData.getStride() : nullptr;
+            if (!isRawSampleConversion || !fillRGBBufferFromSamples(samples, size_t(imageWidth) * componentCount, static_cast<uint8_t>(imageData.getBitsPerComponent()), colorLine, intent, cms, reporter))
+            {
+                PDFBitReader reader(&imageData.getData(), imageData.getBitsPerComponent());
+                reader.seek(i * imageData.getStride());
+
+                const double max = reader.max();
+                const double coefficient = 1.0 / max;
+
+                std::vector<float> inputColors(imageWidth * componentCount, 0.0f);
+                auto itInputColor = inputColors.begin();
+                for (unsigned int j = 0; j < imageData.getWidth(); ++j)
                 {
-                    try
+                    for (unsigned int k = 0; k < componentCount; ++k)
                     {
-                        PDFBitReader reader(&imageData.getData(), imageData.getBitsPerComponent());
-                        reader.seek(i * imageData.getStride());
+                        PDFReal value = reader.read();
 
-                        const double max = reader.max();
-                        const double coefficient = 1.0 / max;
-                        unsigned char* outputLine = image.scanLine(i);
-
-                        std::vector<float> inputColors(imageWidth * componentCount, 0.0f);
-                        auto itInputColor = inputColors.begin();
-                        for (unsigned int j = 0; j < imageData.getWidth(); ++j)
+                        // Interpolate value, if it is not empty
+                        if (!decode.empty())
                         {
-                            for (unsigned int k = 0; k < componentCount; ++k)
-                            {
-                                PDFReal value = reader.read();
-
-                                // Interpolate value, if it is not empty
-                                if (!decode.empty())
-                                {
-                                    *itInputColor++ = interpolate(value, 0.0, max, decode[2 * k], decode[2 * k + 1]);
-                                }
-                                else
-                                {
-                                    *itInputColor++ = value * coefficient;
-                                }
-                            }
+                            *itInputColor++ = interpolate(value, 0.0, max, decode[2 * k], decode[2 * k + 1]);
                         }
-
-                        fillRGBBuffer(inputColors, outputLine, intent, cms, reporter);
-                    }
-                    catch (PDFException lineException)
-                    {
-                        QMutexLocker lock(&exceptionMutex);
-                        if (!exception)
+                        else
                         {
-                            exception = lineException;
+                            *itInputColor++ = value * coefficient;
                         }
                     }
-                };
-
-                auto range = PDFIntegerRange<unsigned int>(0, imageHeight);
-                PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Content, range.begin(), range.end(), transformPixelLine);
+                }
 
-                if (exception)
+                if (hasMatte)
                 {
-                    throw *exception;
+                    // Colors were premultiplied with matte color as c' = m + alpha * (c - m),
+                    // so we must compute original color as c = m + (c' - m) / alpha.
+                    itInputColor = inputColors.begin();
+                    for (unsigned int j = 0; j < imageWidth; ++j)
+                    {
+                        const PDFReal alpha = alphaBuffer[j] / 255.0;
+                        for (unsigned int k = 0; k < componentCount; ++k)
+                        {
+                            if (!qFuzzyIsNull(alpha))
+                            {
+                                *itInputColor = matte[k] + (*itInputColor - matte[k]) / alpha;
+                            }
+                            ++itInputColor;
+                        }
+                    }
                 }
 
-                return image;
+                fillRGBBuffer(inputColors, colorLine, intent, cms, reporter);
             }
 
-            case PDFImageData::MaskingType::SoftMask:
+            if (hasSoftMask)
             {
-                const bool hasMatte = !softMask.getMatte().empty();
-                QImage image(imageData.getWidth(), imageData.getHeight(), hasMatte ? QImage::Format_RGBA8888_Premultiplied : QImage::Format_RGBA8888);
-                image.fill(QColor(Qt::white));
-
-                unsigned int componentCount = imageData.getComponents();
-                if (componentCount != getColorComponentCount())
+                QRgb* outputPixel = reinterpret_cast<QRgb*>(outputLine);
+                const unsigned char* transformedLine = colorBuffer.data();
+                for (unsigned int j = 0; j < imageWidth; ++j)
                 {
-                    throw PDFException(PDFTranslationContext::tr("Invalid colors for color space. Color space has %1 colors. Provided color count is %4.").arg(getColorComponentCount()).arg(componentCount));
+                    *outputPixel++ = qPremultiply(qRgba(transformedLine[0], transformedLine[1], transformedLine[2], alphaBuffer[j]));
+                    transformedLine += 3;
                 }
+            }
+        }
+        catch (PDFException lineException)
+        {
+            QMutexLocker lock(&exceptionMutex);
+            if (!exception)
+            {
+                exception = lineException;
+            }
+        }
+    };
 
-                const std::vector<PDFReal>& decode = imageData.getDecode();
-                if (!decode.empty() && decode.size() != componentCount * 2)
-                {
-                    throw PDFException(PDFTranslationContext::tr("Invalid size of the decode array. Expected %1, actual %2.").arg(componentCount * 2).arg(decode.size()));
-                }
+    auto range = PDFIntegerRange<unsigned int>(0, imageHeight);
+    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Content, range.begin(), range.end(), transformPixelLine);
 
-                const unsigned int imageWidth = imageData.getWidth();
-                const unsigned int imageHeight = imageData.getHeight();
+    if (exception)
+    {
+        throw *exception;
+    }
+}
 
-                QImage alphaMask = createAlphaMask(softMask);
-                if (alphaMask.size() != image.size())
-                {
-                    // Scale the alpha mask, if it is masked
-                    alphaMask = alphaMask.scaled(image.size());
-                }
+QImage PDFAbstractColorSpace::getImage(const PDFImageData& imageData,
+                                       const PDFImageData& softMask,
+                                       const PDFCMS* cms,
+                                       RenderingIntent intent,
+                                       PDFRenderErrorReporter* reporter) const
+{
+    if (imageData.isValid())
+    {
+        switch (imageData.getMaskingType())
+        {
+            case PDFImageData::MaskingType::None:
+            {
+                QImage image(imageData.getWidth(), imageData.getHeight(), QImage::Format_RGB888);
+                image.fill(QColor(Qt::white));
+                fillImageBand(imageData, PDFImageData(), image, 0, cms, intent, reporter);
+                return image;
+            }
 
-                QMutex exceptionMutex;
-                std::optional<PDFException> exception;
+            case PDFImageData::MaskingType::SoftMask:
+            {
+                QImage image(imageData.getWidth(), imageData.getHeight(), QImage::Format_ARGB32_Premultiplied);
+                image.fill(Qt::transparent);
 
-                auto transformPixelLine = [&](unsigned int i)
+                // If soft mask has the same size as the image, then alpha values are decoded
+                // line by line together with the image, otherwise whole soft mask is decoded
+                // and scaled to the image size.
+                if (softMask.getWidth() != imageData.getWidth() || softMask.getHeight() != imageData.getHeight())
                 {
-                    try
-                    {
-                        PDFBitReader reader(&imageData.getData(), imageData.getBitsPerComponent());
-                        reader.seek(i * imageData.getStride());
-
-                        const double max = reader.max();
-                        const double coefficient = 1.0 / max;
-                        unsigned char* outputLine = image.scanLine(i);
-                        unsigned char* alphaLine = alphaMask.scanLine(i);
-
-                        std::vector<float> inputColors(imageWidth * componentCount, 0.0f);
-                        std::vector<unsigned char> outputColors(imageWidth * 3, 0);
-
-                        auto itInputColor = inputColors.begin();
-                        for (unsigned int j = 0; j < imageData.getWidth(); ++j)
-                        {
-                            for (unsigned int k = 0; k < componentCount; ++k)
-                            {
-                                PDFReal value = reader.read();
-
-                                // Interpolate value, if it is not empty
-                                if (!decode.empty())
-                                {
-                                    *itInputColor++ = interpolate(value, 0.0, max, decode[2 * k], decode[2 * k + 1]);
-                                }
-                                else
-                                {
-                                    *itInputColor++ = value * coefficient;
-                                }
-                            }
-                        }
-
-                        fillRGBBuffer(inputColors, outputColors.data(), intent, cms, reporter);
-
-                        const unsigned char* transformedLine = outputColors.data();
-                        for (unsigned int i = 0; i < imageWidth; ++i)
-                        {
-                            *outputLine++ = *transformedLine++;
-                            *outputLine++ = *transformedLine++;
-                            *outputLine++ = *transformedLine++;
-                            *outputLine++ = *alphaLine++;
-                        }
-                    }
-                    catch (PDFException lineException)
-                    {
-                        QMutexLocker lock(&exceptionMutex);
-                        if (!exception)
-                        {
-                            exception = lineException;
-                        }
-                    }
-                };
-
-                auto range = PDFIntegerRange<unsigned int>(0, imageHeight);
-                PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Content, range.begin(), range.end(), transformPixelLine);
-
-                if (exception)
+                    fillImageBand(imageData, createScaledSoftMask(softMask, image.size()), image, 0, cms, intent, reporter);
+                }
+                else
                 {
-                    throw *exception;
+                    fillImageBand(imageData, softMask, image, 0, cms, intent, reporter);
                 }
 
                 return image;
@@ -399,8 +416,8 @@ QImage PDFAbstractColorSpace::getImage(const PDFImageData& imageData,
 
             case PDFImageData::MaskingType::ColorKeyMasking:
             {
-                QImage image(imageData.getWidth(), imageData.getHeight(), QImage::Format_RGBA8888);
-                image.fill(QColor(Qt::transparent));
+                QImage image(imageData.getWidth(), imageData.getHeight(), QImage::Format_ARGB32_Premultiplied);
+                image.fill(Qt::transparent);
 
                 unsigned int componentCount = imageData.getComponents();
                 if (componentCount != getColorComponentCount())
@@ -431,7 +448,7 @@ QImage PDFAbstractColorSpace::getImage(const PDFImageData& imageData,
                 for (unsigned int i = 0, rowCount = imageData.getHeight(); i < rowCount; ++i)
                 {
                     reader.seek(i * imageData.getStride());
-                    unsigned char* outputLine = image.scanLine(i);
+                    QRgb* outputLine = reinterpret_cast<QRgb*>(image.scanLine(i));
 
                     for (unsigned int j = 0; j < imageData.getWidth(); ++j)
                     {
@@ -460,13 +477,16 @@ QImage PDFAbstractColorSpace::getImage(const PDFImageData& imageData,
                             }
                         }
 
-                        QColor transformedColor = getColor(color, cms, intent, reporter, true);
-                        QRgb rgb = transformedColor.rgb();
-
-                        *outputLine++ = qRed(rgb);
-                        *outputLine++ = qGreen(rgb);
-                        *outputLine++ = qBlue(rgb);
-                        *outputLine++ = (maskedColors == componentCount) ? 0x00 : 0xFF;
+                        if (maskedColors == componentCount)
+                        {
+                            // Fully transparent pixel in premultiplied format
+                            *outputLine++ = 0;
+                        }
+                        else
+                        {
+                            QColor transformedColor = getColor(color, cms, intent, reporter, true);
+                            *outputLine++ = transformedColor.rgb();
+                        }
                     }
                 }
 
@@ -511,6 +531,51 @@ void PDFAbstractColorSpace::fillRGBBuffer(const std::vector<float>& colors,
     }
 }
 
+bool PDFAbstractColorSpace::fillRGBBufferFromSamples(const unsigned char* samples,
+                                                     size_t sampleCount,
+                                                     uint8_t bitsPerComponent,
+                                                     unsigned char* outputBuffer,
+                                                     RenderingIntent intent,
+                                                     const PDFCMS* cms,
+                                                     PDFRenderErrorReporter* reporter) const
+{
+    Q_UNUSED(samples);
+    Q_UNUSED(sampleCount);
+    Q_UNUSED(bitsPerComponent);
+    Q_UNUSED(outputBuffer);
+    Q_UNUSED(intent);
+    Q_UNUSED(cms);
+    Q_UNUSED(reporter);
+
+    // Generic color space can't convert raw samples directly
+    return false;
+}
+
+bool PDFAbstractColorSpace::isRawSampleConversionPossible(const PDFImageData& imageData)
+{
+    const unsigned int bitsPerComponent = imageData.getBitsPerComponent();
+    if (bitsPerComponent != 8 && bitsPerComponent != 16)
+    {
+        return false;
+    }
+
+    const std::vector<PDFReal>& decode = imageData.getDecode();
+    for (size_t i = 0; i + 1 < decode.size(); i += 2)
+    {
+        if (decode[i] != 0.0 || decode[i + 1] != 1.0)
+        {
+            return false;
+        }
+    }
+
+    // Check, that all rows are present in the image data, otherwise
+    // we must use bit reader, which handles incomplete data.
+    const size_t rowSize = (size_t(imageData.getWidth()) * imageData.getComponents() * bitsPerComponent) / 8;
+    const size_t stride = imageData.getStride();
+    const size_t height = imageData.getHeight();
+    return height == 0 || (rowSize <= stride && (height - 1) * stride + rowSize <= size_t(imageData.getData().size()));
+}
+
 QColor PDFAbstractColorSpace::getCheckedColor(const PDFColor& color, const PDFCMS* cms, RenderingIntent intent, PDFRenderErrorReporter* reporter) const
 {
     if (getColorComponentCount() != color.size())
@@ -522,6 +587,28 @@ QColor PDFAbstractColorSpace::getCheckedColor(const PDFColor& color, const PDFCM
 }
 
 QImage PDFAbstractColorSpace::createAlphaMask(const PDFImageData& softMask)
+{
+    checkAlphaMask(softMask);
+
+    QImage image(softMask.getWidth(), softMask.getHeight(), QImage::Format_Alpha8);
+
+    for (unsigned int i = 0, rowCount = softMask.getHeight(); i < rowCount; ++i)
+    {
+        fillAlphaMaskLine(softMask, i, image.scanLine(i));
+    }
+
+    return image;
+}
+
+PDFImageData PDFAbstractColorSpace::createScaledSoftMask(const PDFImageData& softMask, QSize size)
+{
+    QImage alphaMask = createAlphaMask(softMask).scaled(size);
+    QByteArray data(reinterpret_cast<const char*>(alphaMask.constBits()), int(alphaMask.sizeInBytes()));
+    std::vector<PDFReal> matte = softMask.getMatte();
+    return PDFImageData(1, 8, alphaMask.width(), alphaMask.height(), alphaMask.bytesPerLine(), PDFImageData::MaskingType::None, qMove(data), { }, { }, qMove(matte));
+}
+
+void PDFAbstractColorSpace::checkAlphaMask(const PDFImageData& softMask)
 {
     if (softMask.getMaskingType() != PDFImageData::MaskingType::None)
     {
@@ -533,8 +620,6 @@ QImage PDFAbstractColorSpace::createAlphaMask(const PDFImageData& softMask)
         throw PDFException(PDFTranslationContext::tr("Invalid size of soft mask."));
     }
 
-    QImage image(softMask.getWidth(), softMask.getHeight(), QImage::Format_Alpha8);
-
     unsigned int componentCount = softMask.getComponents();
     if (componentCount != 1)
     {
@@ -546,42 +631,45 @@ QImage PDFAbstractColorSpace::createAlphaMask(const PDFImageData& softMask)
     {
         throw PDFException(PDFTranslationContext::tr("Invalid size of the decode array. Expected %1, actual %2.").arg(componentCount * 2).arg(decode.size()));
     }
+}
 
-    PDFBitReader reader(&softMask.getData(), softMask.getBitsPerComponent());
+void PDFAbstractColorSpace::fillAlphaMaskLine(const PDFImageData& softMask, unsigned int line, unsigned char* outputLine)
+{
+    const std::vector<PDFReal>& decode = softMask.getDecode();
 
-    PDFColor color;
-    color.resize(componentCount);
+    // 8-bit alpha values without decode array are copied directly
+    const size_t rowOffset = size_t(line) * softMask.getStride();
+    if (softMask.getBitsPerComponent() == 8 && decode.empty() && rowOffset + softMask.getWidth() <= size_t(softMask.getData().size()))
+    {
+        std::copy_n(softMask.getData().constData() + rowOffset, softMask.getWidth(), outputLine);
+        return;
+    }
+
+    PDFBitReader reader(&softMask.getData(), softMask.getBitsPerComponent());
+    reader.seek(line * softMask.getStride());
 
     const double max = reader.max();
     const double coefficient = 1.0 / max;
-    for (unsigned int i = 0, rowCount = softMask.getHeight(); i < rowCount; ++i)
+    for (unsigned int j = 0; j < softMask.getWidth(); ++j)
     {
-        reader.seek(i * softMask.getStride());
-        unsigned char* outputLine = image.scanLine(i);
-
-        for (unsigned int j = 0; j < softMask.getWidth(); ++j)
-        {
-            PDFReal alpha = 0.0;
+        PDFReal alpha = 0.0;
 
-            PDFReal value = reader.read();
+        PDFReal value = reader.read();
 
-            // Interpolate value, if it is not empty
-            if (!decode.empty())
-            {
-                alpha = interpolate(value, 0.0, max, decode[0], decode[1]);
-            }
-            else
-            {
-                alpha = value * coefficient;
-            }
-
-            alpha = qBound(0.0, alpha, 1.0);
-            uint8_t alphaCoded = alpha * 255;
-            *outputLine++ = alphaCoded;
+        // Interpolate value, if it is not empty
+        if (!decode.empty())
+        {
+            alpha = interpolate(value, 0.0, max, decode[0], decode[1]);
+        }
+        else
+        {
+            alpha = value * coefficient;
         }
-    }
 
-    return image;
+        alpha = qBound(0.0, alpha, 1.0);
+        uint8_t alphaCoded = alpha * 255;
+        *outputLine++ = alphaCoded;
+    }
 }
 
 PDFColorSpacePointer PDFAbstractColorSpace::createColorSpace(const PDFDictionary* colorSpaceDictionary,
@@ -1681,6 +1769,21 @@ void PDFICCBasedColorSpace::fillRGBBuffer(const std::vector<float>& colors, unsi
     }
 }
 
+bool PDFICCBasedColorSpace::fillRGBBufferFromSamples(const unsigned char* samples, size_t sampleCount, uint8_t bitsPerComponent, unsigned char* outputBuffer, RenderingIntent intent, const PDFCMS* cms, PDFRenderErrorReporter* reporter) const
+{
+    // Samples with default decode array are in range [0, 1], so they can
+    // be passed directly only, if they are not clipped by the range.
+    for (size_t i = 0, colorComponentCount = getColorComponentCount(); i < colorComponentCount; ++i)
+    {
+        if (m_range[2 * i] > 0.0 || m_range[2 * i + 1] < 1.0)
+        {
+            return false;
+        }
+    }
+
+    return cms->fillRGBBufferFromSamples(PDFCMS::ICC, samples, sampleCount, bitsPerComponent, intent, outputBuffer, m_iccProfileDataChecksum, m_iccProfileData, reporter);
+}
+
 bool PDFICCBasedColorSpace::equals(const PDFAbstractColorSpace* other) const
 {
     if (!PDFAbstractColorSpace::equals(other))
@@ -1867,104 +1970,80 @@ size_t PDFIndexedColorSpace::getColorComponentCount() const
     return 1;
 }
 
-QImage PDFIndexedColorSpace::getImage(const PDFImageData& imageData,
-                                      const PDFImageData& softMask,
-                                      const PDFCMS* cms,
-                                      RenderingIntent intent,
-                                      PDFRenderErrorReporter* reporter) const
+void PDFIndexedColorSpace::fillImageBand(const PDFImageData& imageData,
+                                         const PDFImageData& softMask,
+                                         QImage& image,
+                                         unsigned int firstScanLine,
+                                         const PDFCMS* cms,
+                                         RenderingIntent intent,
+                                         PDFRenderErrorReporter* reporter) const
 {
-    if (imageData.isValid())
-    {
-        switch (imageData.getMaskingType())
-        {
-            case PDFImageData::MaskingType::None:
-            {
-                QImage image(imageData.getWidth(), imageData.getHeight(), QImage::Format_RGB888);
-                image.fill(QColor(Qt::white));
-
-                unsigned int componentCount = imageData.getComponents();
-                PDFBitReader reader(&imageData.getData(), imageData.getBitsPerComponent());
+    unsigned int componentCount = imageData.getComponents();
+    PDFBitReader reader(&imageData.getData(), imageData.getBitsPerComponent());
 
-                if (componentCount != getColorComponentCount())
-                {
-                    throw PDFException(PDFTranslationContext::tr("Invalid colors for indexed color space. Color space has %1 colors. Provided color count is %4.").arg(getColorComponentCount()).arg(componentCount));
-                }
+    if (componentCount != getColorComponentCount())
+    {
+        throw PDFException(PDFTranslationContext::tr("Invalid colors for indexed color space. Color space has %1 colors. Provided color count is %4.").arg(getColorComponentCount()).arg(componentCount));
+    }
 
-                Q_ASSERT(componentCount == 1);
+    const bool hasSoftMask = softMask.isValid();
+    if (hasSoftMask)
+    {
+        checkAlphaMask(softMask);
+    }
 
-                PDFColor color;
-                color.resize(1);
+    Q_ASSERT(componentCount == 1);
+    Q_ASSERT(image.format() == (hasSoftMask ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB888));
+    Q_ASSERT(!hasSoftMask || (softMask.getWidth() == imageData.getWidth() && softMask.getHeight() == imageData.getHeight()));
 
-                for (unsigned int i = 0, rowCount = imageData.getHeight(); i < rowCount; ++i)
-                {
-                    reader.seek(i * imageData.getStride());
-                    unsigned char* outputLine = image.scanLine(i);
+    const std::vector<unsigned char> palette = createRGBPalette(cms, intent, reporter);
 
-                    for (unsigned int j = 0; j < imageData.getWidth(); ++j)
-                    {
-                        PDFBitReader::Value index = reader.read();
-                        color[0] = index;
-
-                        QColor transformedColor = getColor(color, cms, intent, reporter, false);
-                        QRgb rgb = transformedColor.rgb();
+    // Matte color is ignored for indexed images, because indexed color
+    // can't be un-premultiplied.
+    std::vector<unsigned char> alphaBuffer(hasSoftMask ? imageData.getWidth() : 0, 0);
+    for (unsigned int i = 0, rowCount = imageData.getHeight(); i < rowCount; ++i)
+    {
+        reader.seek(i * imageData.getStride());
 
-                        *outputLine++ = qRed(rgb);
-                        *outputLine++ = qGreen(rgb);
-                        *outputLine++ = qBlue(rgb);
-                    }
-                }
+        if (hasSoftMask)
+        {
+            fillAlphaMaskLine(softMask, i, alphaBuffer.data());
 
-                return image;
+            QRgb* outputLine = reinterpret_cast<QRgb*>(image.scanLine(firstScanLine + i));
+            for (unsigned int j = 0; j < imageData.getWidth(); ++j)
+            {
+                const unsigned char* rgb = palette.data() + 3 * qMin<PDFBitReader::Value>(reader.read(), m_maxValue);
+                *outputLine++ = qPremultiply(qRgba(rgb[0], rgb[1], rgb[2], alphaBuffer[j]));
             }
-
-            case PDFImageData::MaskingType::SoftMask:
+        }
+        else
+        {
+            unsigned char* outputLine = image.scanLine(firstScanLine + i);
+            for (unsigned int j = 0; j < imageData.getWidth(); ++j)
             {
-                const bool hasMatte = !softMask.getMatte().empty();
-                QImage image(imageData.getWidth(), imageData.getHeight(), hasMatte ? QImage::Format_RGBA8888_Premultiplied : QImage::Format_RGBA8888);
-
-                unsigned int componentCount = imageData.getComponents();
-                PDFBitReader reader(&imageData.getData(), imageData.getBitsPerComponent());
-
-                if (componentCount != getColorComponentCount())
-                {
-                    throw PDFException(PDFTranslationContext::tr("Invalid colors for indexed color space. Color space has %1 colors. Provided color count is %4.").arg(getColorComponentCount()).arg(componentCount));
-                }
-
-                Q_ASSERT(componentCount == 1);
-
-                PDFColor color;
-                color.resize(1);
-
-                QImage alphaMask = createAlphaMask(softMask);
-                if (alphaMask.size() != image.size())
-                {
-                    // Scale the alpha mask, if it is masked
-                    alphaMask = alphaMask.scaled(image.size());
-                }
-
-                for (unsigned int i = 0, rowCount = imageData.getHeight(); i < rowCount; ++i)
-                {
-                    reader.seek(i * imageData.getStride());
-                    unsigned char* outputLine = image.scanLine(i);
-                    unsigned char* alphaLine = alphaMask.scanLine(i);
+                const unsigned char* rgb = palette.data() + 3 * qMin<PDFBitReader::Value>(reader.read(), m_maxValue);
 
-                    for (unsigned int j = 0; j < imageData.getWidth(); ++j)
-                    {
-                        PDFBitReader::Value index = reader.read();
-                        color[0] = index;
-
-                        QColor transformedColor = getColor(color, cms, intent, reporter, false);
-                        QRgb rgb = transformedColor.rgb();
-
-                        *outputLine++ = qRed(rgb);
-                        *outputLine++ = qGreen(rgb);
-                        *outputLine++ = qBlue(rgb);
-                        *outputLine++ = *alphaLine++;
-                    }
-                }
-
-                return image;
+                *outputLine++ = rgb[0];
+                *outputLine++ = rgb[1];
+                *outputLine++ = rgb[2];
             }
+        }
+    }
+}
+
+QImage PDFIndexedColorSpace::getImage(const PDFImageData& imageData,
+                                      const PDFImageData& softMask,
+                                      const PDFCMS* cms,
+                                      RenderingIntent intent,
+                                      PDFRenderErrorReporter* reporter) const
+{
+    if (imageData.isValid())
+    {
+        switch (imageData.getMaskingType())
+        {
+            case PDFImageData::MaskingType::None:
+            case PDFImageData::MaskingType::SoftMask:
+                return PDFAbstractColorSpace::getImage(imageData, softMask, cms, intent, reporter);
 
             default:
                 throw PDFRendererException(RenderErrorType::NotImplemented, PDFTranslationContext::tr("Image masking not implemented!"));
@@ -2024,6 +2103,25 @@ PDFColorSpacePointer PDFIndexedColorSpace::getBaseColorSpace() const
     return m_baseColorSpace;
 }
 
+std::vector<unsigned char> PDFIndexedColorSpace::createRGBPalette(const PDFCMS* cms, RenderingIntent intent, PDFRenderErrorReporter* reporter) const
+{
+    const size_t colorCount = static_cast<size_t>(m_maxValue - MIN_VALUE + 1);
+    const size_t colorComponentCount = m_baseColorSpace->getColorComponentCount();
+
+    // We must point into the array (checked, when color space is created)
+    Q_ASSERT(colorCount * colorComponentCount <= size_t(m_colors.size()));
+
+    std::vector<float> baseColors(colorCount * colorComponentCount, 0.0f);
+    for (size_t i = 0; i < baseColors.size(); ++i)
+    {
+        baseColors[i] = static_cast<unsigned char>(m_colors[int(i)]) / 255.0f;
+    }
+
+    std::vector<unsigned char> palette(colorCount * 3, 0);
+    m_baseColorSpace->fillRGBBuffer(baseColors, palette.data(), intent, cms, reporter);
+    return palette;
+}
+
 std::vector<PDFColorComponent> PDFIndexedColorSpace::transformColorsToBaseColorSpace(const PDFColorBuffer buffer) const
 {
     const std::size_t colorComponentCount = m_baseColorSpace->getColorComponentCount();
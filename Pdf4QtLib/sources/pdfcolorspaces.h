@@ -371,6 +371,29 @@ public:
                             RenderingIntent intent,
                             PDFRenderErrorReporter* reporter) const;
 
+    /// Transforms band of image rows to the scanlines of the target image. Image data
+    /// contain only rows of the band (masking type is ignored), row \p i of the band
+    /// is written to the scanline \p firstScanLine + \p i. It is used, when image
+    /// is decoded band by band, so decoded data of the whole image are not needed.
+    /// If soft mask is valid, it contains alpha values of the same rows (it must have
+    /// the same size as image data) and target image must have premultiplied ARGB32
+    /// format. Colors are un-premultiplied by matte color of the soft mask, if it is set.
+    /// \param imageData Image data of the band
+    /// \param softMask Soft mask of the band (can be invalid, if image has no soft mask)
+    /// \param image Target image (8-bit RGB format, or premultiplied ARGB32 format, if soft mask
+    ///        is valid, with the same width as image data)
+    /// \param firstScanLine Scanline of the target image, to which first row of the band is written
+    /// \param cms Color management system
+    /// \param intent Rendering intent
+    /// \param reporter Error reporter
+    virtual void fillImageBand(const PDFImageData& imageData,
+                               const PDFImageData& softMask,
+                               QImage& image,
+                               unsigned int firstScanLine,
+                               const PDFCMS* cms,
+                               RenderingIntent intent,
+                               PDFRenderErrorReporter* reporter) const;
+
     /// Fills RGB buffer using colors from \p colors. Colors are transformed
     /// by this color space (or color management system is used). Buffer
     /// must be big enough to contain all 8-bit RGB data.
@@ -385,6 +408,25 @@ public:
                                const PDFCMS* cms,
                                PDFRenderErrorReporter* reporter) const;
 
+    /// Fills RGB buffer directly from raw interleaved image samples with 8 or 16
+    /// bits per component (16-bit samples are big-endian). Samples must have default
+    /// decode array. Returns false, if this color space can't convert samples directly,
+    /// caller then must convert samples to float colors and use \p fillRGBBuffer.
+    /// \param samples Raw samples
+    /// \param sampleCount Number of samples (pixel count multiplied by color component count)
+    /// \param bitsPerComponent Bits per component (8 or 16)
+    /// \param outputBuffer 8-bit RGB output buffer
+    /// \param intent Rendering intent
+    /// \param cms Color management system
+    /// \param reporter Render error reporter
+    virtual bool fillRGBBufferFromSamples(const unsigned char* samples,
+                                          size_t sampleCount,
+                                          uint8_t bitsPerComponent,
+                                          unsigned char* outputBuffer,
+                                          RenderingIntent intent,
+                                          const PDFCMS* cms,
+                                          PDFRenderErrorReporter* reporter) const;
+
     /// If this class is pattern space, returns this, otherwise returns nullptr.
     virtual const PDFPatternColorSpace* asPatternColorSpace() const { return nullptr; }
 
@@ -400,6 +442,23 @@ public:
     /// \param softMask Soft mask
     static QImage createAlphaMask(const PDFImageData& softMask);
 
+    /// Creates 8-bit soft mask of the given size from soft image data (soft mask is
+    /// scaled). Matte color is preserved. Exception is thrown, if something fails.
+    /// \param softMask Soft mask
+    /// \param size Size of the resulting soft mask
+    static PDFImageData createScaledSoftMask(const PDFImageData& softMask, QSize size);
+
+    /// Checks, if soft image data can be used as alpha mask. Exception is thrown, if not.
+    /// \param softMask Soft mask
+    static void checkAlphaMask(const PDFImageData& softMask);
+
+    /// Decodes one line of the alpha mask to 8-bit alpha values. Soft mask must
+    /// be checked by \p checkAlphaMask before this function is called.
+    /// \param softMask Soft mask
+    /// \param line Line index
+    /// \param outputLine Output buffer, must be big enough to contain whole line
+    static void fillAlphaMaskLine(const PDFImageData& softMask, unsigned int line, unsigned char* outputLine);
+
     /// Parses the desired color space. If desired color space is not found, then exception is thrown.
     /// If everything is OK, then shared pointer to the new color space is returned.
     /// \param colorSpaceDictionary Dictionary containing color spaces of the page
@@ -456,6 +515,11 @@ protected:
     /// Clips the color component to range [0, 1]
     static constexpr PDFColorComponent clip01(PDFColorComponent component) { return qBound<PDFColorComponent>(0.0, component, 1.0); }
 
+    /// Returns true, if image samples can be converted directly using \p fillRGBBufferFromSamples,
+    /// i.e. image has 8 or 16 bits per component and default decode array.
+    /// \param imageData Image data
+    static bool isRawSampleConversionPossible(const PDFImageData& imageData);
+
     /// Clips the color to range [0 1] in all components
     static constexpr PDFColor3 clip01(const PDFColor3& color)
     {
@@ -563,6 +627,7 @@ public:
     virtual QColor getColor(const PDFColor& color, const PDFCMS* cms, RenderingIntent intent, PDFRenderErrorReporter* reporter, bool isRange01) const override;
     virtual size_t getColorComponentCount() const override;
     virtual void fillRGBBuffer(const std::vector<float>& colors,unsigned char* outputBuffer, RenderingIntent intent, const PDFCMS* cms, PDFRenderErrorReporter* reporter) const override;
+    virtual bool fillRGBBufferFromSamples(const unsigned char* samples, size_t sampleCount, uint8_t bitsPerComponent, unsigned char* outputBuffer, RenderingIntent intent, const PDFCMS* cms, PDFRenderErrorReporter* reporter) const override;
 };
 
 class PDFDeviceRGBColorSpace : public PDFAbstractColorSpace
@@ -576,6 +641,7 @@ public:
     virtual QColor getColor(const PDFColor& color, const PDFCMS* cms, RenderingIntent intent, PDFRenderErrorReporter* reporter, bool isRange01) const override;
     virtual size_t getColorComponentCount() const override;
     virtual void fillRGBBuffer(const std::vector<float>& colors,unsigned char* outputBuffer, RenderingIntent intent, const PDFCMS* cms, PDFRenderErrorReporter* reporter) const override;
+    virtual bool fillRGBBufferFromSamples(const unsigned char* samples, size_t sampleCount, uint8_t bitsPerComponent, unsigned char* outputBuffer, RenderingIntent intent, const PDFCMS* cms, PDFRenderErrorReporter* reporter) const override;
 };
 
 class PDFDeviceCMYKColorSpace : public PDFAbstractColorSpace
@@ -589,6 +655,7 @@ public:
     virtual QColor getColor(const PDFColor& color, const PDFCMS* cms, RenderingIntent intent, PDFRenderErrorReporter* reporter, bool isRange01) const override;
     virtual size_t getColorComponentCount() const override;
     virtual void fillRGBBuffer(const std::vector<float>& colors,unsigned char* outputBuffer, RenderingIntent intent, const PDFCMS* cms, PDFRenderErrorReporter* reporter) const override;
+    virtual bool fillRGBBufferFromSamples(const unsigned char* samples, size_t sampleCount, uint8_t bitsPerComponent, unsigned char* outputBuffer, RenderingIntent intent, const PDFCMS* cms, PDFRenderErrorReporter* reporter) const override;
 };
 
 class PDFXYZColorSpace : public PDFAbstractColorSpace
@@ -711,6 +778,7 @@ public:
     virtual QColor getColor(const PDFColor& color, const PDFCMS* cms, RenderingIntent intent, PDFRenderErrorReporter* reporter, bool isRange01) const override;
     virtual size_t getColorComponentCount() const override;
     virtual void fillRGBBuffer(const std::vector<float>& colors, unsigned char* outputBuffer, RenderingIntent intent, const PDFCMS* cms, PDFRenderErrorReporter* reporter) const override;
+    virtual bool fillRGBBufferFromSamples(const unsigned char* samples, size_t sampleCount, uint8_t bitsPerComponent, unsigned char* outputBuffer, RenderingIntent intent, const PDFCMS* cms, PDFRenderErrorReporter* reporter) const override;
     virtual bool equals(const PDFAbstractColorSpace* other) const override;
 
     PDFObjectReference getMetadata() const { return m_metadata; }
@@ -756,6 +824,13 @@ public:
                             const PDFCMS* cms,
                             RenderingIntent intent,
                             PDFRenderErrorReporter* reporter) const override;
+    virtual void fillImageBand(const PDFImageData& imageData,
+                               const PDFImageData& softMask,
+                               QImage& image,
+                               unsigned int firstScanLine,
+                               const PDFCMS* cms,
+                               RenderingIntent intent,
+                               PDFRenderErrorReporter* reporter) const override;
 
     /// Creates indexed color space from provided values.
     /// \param colorSpaceDictionary Color space dictionary
@@ -776,6 +851,13 @@ public:
     const QByteArray& getColors() const;
 
 private:
+    /// Converts all colors of the color table to the 8-bit RGB palette
+    /// (3 bytes per color), using single transformation of the base color space.
+    /// \param cms Color management system
+    /// \param intent Rendering intent
+    /// \param reporter Render error reporter
+    std::vector<unsigned char> createRGBPalette(const PDFCMS* cms, RenderingIntent intent, PDFRenderErrorReporter* reporter) const;
+
     static constexpr const int MIN_VALUE = 0;
     static constexpr const int MAX_VALUE = 255;
 
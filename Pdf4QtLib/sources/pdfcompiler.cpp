@@ -18,11 +18,14 @@
 #include "pdfcompiler.h"
 #include "pdfcms.h"
 #include "pdfdrawspacecontroller.h"
+#include "pdfdrawwidget.h"
 #include "pdfprogress.h"
 #include "pdfexecutionpolicy.h"
+#include "pdftextindex.h"
 
 #include <QtConcurrent/QtConcurrent>
 
+#include <numeric>
 #include <execution>
 
 namespace pdf
@@ -225,6 +228,12 @@ bool PDFTextLayoutGenerator::isContentKindSuppressed(ContentKind kind) const
     return false;
 }
 
+bool PDFTextLayoutGenerator::isTextMetricsOnly() const
+{
+    // Text layout needs only character boxes, glyph outlines are used only if explicitly requested
+    return !m_features.testFlag(PDFRenderer::ExactTextOutlines);
+}
+
 void PDFTextLayoutGenerator::performOutputCharacter(const PDFTextCharacterInfo& info)
 {
     if (!isContentSuppressed() && !info.character.isSpace())
@@ -237,6 +246,7 @@ PDFAsynchronousTextLayoutCompiler::PDFAsynchronousTextLayoutCompiler(PDFDrawWidg
     BaseClass(proxy),
     m_proxy(proxy),
     m_isRunning(false),
+    m_isCancelled(false),
     m_cache(std::bind(&PDFAsynchronousTextLayoutCompiler::createTextLayout, this, std::placeholders::_1))
 {
     connect(&m_textLayoutCompileFutureWatcher, &QFutureWatcher<PDFTextLayoutStorage>::finished, this, &PDFAsynchronousTextLayoutCompiler::onTextLayoutCreated);
@@ -273,16 +283,25 @@ void PDFAsynchronousTextLayoutCompiler::stop(bool clearCache)
 
         case State::Active:
         {
-            // Stop the engine
+            // Stop the engine. If cache is being cleared, then text layout
+            // being created will not be used, so we can cancel its creation.
             m_state = State::Stopping;
+            m_isCancelled = clearCache;
             m_textLayoutCompileFutureWatcher.waitForFinished();
 
             if (clearCache)
             {
+                if (m_isRunning)
+                {
+                    // Result of cancelled text layout creation is ignored
+                    finishTextLayoutCreation();
+                }
+
                 m_textLayouts = std::nullopt;
                 m_cache.clear();
             }
 
+            m_isCancelled = false;
             m_state = State::Inactive;
             break;
         }
@@ -310,6 +329,11 @@ PDFTextLayout PDFAsynchronousTextLayoutCompiler::createTextLayout(PDFInteger pag
     {
         result = getTextLayout(pageIndex);
     }
+    else if (QByteArray data = getCompiledPageData(pageIndex); !data.isEmpty())
+    {
+        // Page was already processed by running text layout creation
+        result = PDFFlatTextLayout(qMove(data)).createTextLayout();
+    }
     else
     {
         if (m_state != State::Active || !m_proxy->getDocument())
@@ -367,6 +391,25 @@ PDFTextLayoutGetter PDFAsynchronousTextLayoutCompiler::getTextLayoutLazy(PDFInte
     return PDFTextLayoutGetter(&m_cache, pageIndex);
 }
 
+bool PDFAsynchronousTextLayoutCompiler::isHoveringOverTextBlock(PDFInteger pageIndex, const QPointF& point)
+{
+    if (m_state == State::Active && m_textLayouts)
+    {
+        return m_textLayouts->isHoveringOverTextBlock(pageIndex, point);
+    }
+
+    if (m_state == State::Active)
+    {
+        QByteArray data = getCompiledPageData(pageIndex);
+        if (!data.isEmpty())
+        {
+            return PDFFlatTextLayout(qMove(data)).isHoveringOverTextBlock(point);
+        }
+    }
+
+    return m_cache.getTextLayout(pageIndex).isHoveringOverTextBlock(point);
+}
+
 PDFTextSelection PDFAsynchronousTextLayoutCompiler::getTextSelectionAll(QColor color) const
 {
     PDFTextSelection result;
@@ -379,19 +422,17 @@ PDFTextSelection PDFAsynchronousTextLayoutCompiler::getTextSelectionAll(QColor c
         PDFIntegerRange<size_t> pageRange(0, textLayouts.getCount());
         auto selectPageText = [&mutex, &textLayouts, &result, color](PDFInteger pageIndex)
         {
-            PDFTextLayout textLayout = textLayouts.getTextLayout(pageIndex);
+            PDFFlatTextLayout textLayout = textLayouts.getFlatTextLayout(pageIndex);
             PDFTextSelectionItems items;
 
-            const PDFTextBlocks& blocks = textLayout.getTextBlocks();
-            for (size_t blockId = 0, blockCount = blocks.size(); blockId < blockCount; ++blockId)
+            for (size_t blockId = 0, blockCount = textLayout.getBlockCount(); blockId < blockCount; ++blockId)
             {
-                const PDFTextBlock& block = blocks[blockId];
-                const PDFTextLines& lines = block.getLines();
+                const PDFFlatTextLayout::Block block = textLayout.getBlock(blockId);
 
-                if (!lines.empty())
+                if (block.lineCount > 0)
                 {
-                    const PDFTextLine& lastLine = lines.back();
-                    Q_ASSERT(!lastLine.getCharacters().empty());
+                    const PDFFlatTextLayout::Line lastLine = textLayout.getLine(block.firstLine + block.lineCount - 1);
+                    Q_ASSERT(lastLine.characterCount > 0);
 
                     PDFCharacterPointer ptrStart;
                     ptrStart.pageIndex = pageIndex;
@@ -402,8 +443,8 @@ PDFTextSelection PDFAsynchronousTextLayoutCompiler::getTextSelectionAll(QColor c
                     PDFCharacterPointer ptrEnd;
                     ptrEnd.pageIndex = pageIndex;
                     ptrEnd.blockIndex = blockId;
-                    ptrEnd.lineIndex = lines.size() - 1;
-                    ptrEnd.characterIndex = lastLine.getCharacters().size() - 1;
+                    ptrEnd.lineIndex = block.lineCount - 1;
+                    ptrEnd.characterIndex = lastLine.characterCount - 1;
 
                     items.emplace_back(ptrStart, ptrEnd);
                 }
@@ -452,17 +493,28 @@ void PDFAsynchronousTextLayoutCompiler::makeTextLayout()
     m_proxy->getProgress()->start(catalog->getPageCount(), qMove(info));
 
     PDFCMSPointer cms = m_proxy->getCMSManager()->getCurrentCMS();
+    std::vector<PDFInteger> pageIndices = getPageIndicesByPriority(catalog->getPageCount());
 
-    auto createTextLayout = [this, cms, catalog]() -> PDFTextLayoutStorage
+    {
+        QMutexLocker lock(&m_compiledPagesMutex);
+        m_compiledPages.assign(catalog->getPageCount(), QByteArray());
+    }
+
+    auto createTextLayout = [this, cms, catalog, pageIndices]() -> PDFTextLayoutStorage
     {
         PDFTextLayoutStorage result(catalog->getPageCount());
-        QMutex mutex;
-        auto generateTextLayout = [this, &result, &mutex, cms, catalog](PDFInteger pageIndex)
+        auto generateTextLayout = [this, &result, cms, catalog](PDFInteger pageIndex)
         {
+            if (m_isCancelled)
+            {
+                // Text layout creation was cancelled, skip remaining pages
+                return;
+            }
+
             if (!catalog->getPage(pageIndex))
             {
                 // Invalid page index
-                result.setTextLayout(pageIndex, PDFTextLayout(), &mutex);
+                result.setTextLayout(pageIndex, PDFTextLayout());
                 return;
             }
 
@@ -471,12 +523,35 @@ void PDFAsynchronousTextLayoutCompiler::makeTextLayout()
 
             PDFTextLayoutGenerator generator(m_proxy->getFeatures(), page, m_proxy->getDocument(), m_proxy->getFontCache(), cms.data(), m_proxy->getOptionalContentActivity(), QMatrix(), m_proxy->getMeshQualitySettings());
             generator.processContents();
-            result.setTextLayout(pageIndex, generator.createTextLayout(), &mutex);
+            result.setTextLayout(pageIndex, generator.createTextLayout());
+
+            // Publish the page, so it can be used before whole document is processed
+            QByteArray data = result.getFlatTextLayout(pageIndex).getData();
+            {
+                QMutexLocker lock(&m_compiledPagesMutex);
+                m_compiledPages[pageIndex] = qMove(data);
+            }
+
             m_proxy->getProgress()->step();
         };
 
-        auto pageRange = PDFIntegerRange<PDFInteger>(0, catalog->getPageCount());
-        PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, pageRange.begin(), pageRange.end(), generateTextLayout);
+        // Page tasks are started in the thread pool in the given order,
+        // so visible pages are processed first.
+        PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, pageIndices.cbegin(), pageIndices.cend(), generateTextLayout);
+
+        if (m_isCancelled)
+        {
+            return result;
+        }
+
+        // Build text index, so text search doesn't have to process all pages. Index
+        // is kept in memory only. Text layouts of all pages are created anyway and
+        // index is built from them in a single pass, so loading a stored index
+        // (as PdfTool search does) would save only this pass.
+        result.setTextIndex(std::make_shared<const PDFTextIndex>(PDFTextIndex::create(result)));
+
+        // Keep layouts uncompressed (so they can be read in place), unless they are too large
+        result.compress(TEXT_LAYOUT_MEMORY_BUDGET);
         return result;
     };
 
@@ -487,13 +562,75 @@ void PDFAsynchronousTextLayoutCompiler::makeTextLayout()
 
 void PDFAsynchronousTextLayoutCompiler::onTextLayoutCreated()
 {
-    m_proxy->getFontCache()->setCacheShrinkEnabled(this, true);
-    m_proxy->getProgress()->finish();
-    m_cache.clear();
+    if (!m_isRunning || !m_textLayoutCompileFuture.isFinished())
+    {
+        // Text layout creation was cancelled (signal can be from the cancelled run)
+        return;
+    }
 
     m_textLayouts = m_textLayoutCompileFuture.result();
-    m_isRunning = false;
+    finishTextLayoutCreation();
+    m_cache.clear();
+
     emit textLayoutChanged();
 }
 
+std::vector<PDFInteger> PDFAsynchronousTextLayoutCompiler::getPageIndicesByPriority(PDFInteger pageCount) const
+{
+    std::vector<PDFInteger> visiblePages;
+    if (m_proxy->getWidget())
+    {
+        visiblePages = m_proxy->getPagesIntersectingRect(m_proxy->getWidget()->rect());
+    }
+
+    std::vector<PDFInteger> pageIndices(pageCount, 0);
+    std::iota(pageIndices.begin(), pageIndices.end(), 0);
+
+    if (!visiblePages.empty())
+    {
+        // Distance of the page to the nearest visible page (visible pages have zero distance)
+        auto getDistance = [&visiblePages](PDFInteger pageIndex)
+        {
+            auto it = std::lower_bound(visiblePages.cbegin(), visiblePages.cend(), pageIndex);
+
+            PDFInteger distance = std::numeric_limits<PDFInteger>::max();
+            if (it != visiblePages.cend())
+            {
+                distance = *it - pageIndex;
+            }
+            if (it != visiblePages.cbegin())
+            {
+                distance = qMin(distance, pageIndex - *std::prev(it));
+            }
+            return distance;
+        };
+
+        std::stable_sort(pageIndices.begin(), pageIndices.end(), [&getDistance](PDFInteger l, PDFInteger r) { return getDistance(l) < getDistance(r); });
+    }
+
+    return pageIndices;
+}
+
+QByteArray PDFAsynchronousTextLayoutCompiler::getCompiledPageData(PDFInteger pageIndex) const
+{
+    QMutexLocker lock(&m_compiledPagesMutex);
+
+    if (pageIndex >= 0 && pageIndex < PDFInteger(m_compiledPages.size()))
+    {
+        return m_compiledPages[pageIndex];
+    }
+
+    return QByteArray();
+}
+
+void PDFAsynchronousTextLayoutCompiler::finishTextLayoutCreation()
+{
+    m_proxy->getFontCache()->setCacheShrinkEnabled(this, true);
+    m_proxy->getProgress()->finish();
+    m_isRunning = false;
+
+    QMutexLocker lock(&m_compiledPagesMutex);
+    m_compiledPages.clear();
+}
+
 }   // namespace pdf
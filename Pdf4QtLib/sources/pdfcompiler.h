@@ -23,9 +23,12 @@
 #include "pdftextlayout.h"
 
 #include <QCache>
+#include <QMutex>
 #include <QFuture>
 #include <QFutureWatcher>
 
+#include <atomic>
+
 namespace pdf
 {
 class PDFDrawWidgetProxy;
@@ -115,7 +118,8 @@ public:
     /// clears the cache if parameter \p clearCache. Call this function
     /// only if engine is active. Clear cache should be set to false,
     /// only if "soft" document update appears (no text on page is being
-    /// changed).
+    /// changed). If text layout is being created, and cache is cleared,
+    /// then text layout creation is cancelled.
     /// \param clearCache Clear cache
     void stop(bool clearCache);
 
@@ -145,12 +149,22 @@ public:
     /// \param pageIndex Page index
     PDFTextLayoutGetter getTextLayoutLazy(PDFInteger pageIndex);
 
+    /// Returns true, if given point is pointing to some text block on the page.
+    /// If text layout for the document is ready, it is read in place, without
+    /// creating the text layout of the page.
+    /// \param pageIndex Page index
+    /// \param point Point (in page coordinates)
+    bool isHoveringOverTextBlock(PDFInteger pageIndex, const QPointF& point);
+
     /// Select all texts on all pages using \p color color.
     /// \param color Color to be used for text selection
     PDFTextSelection getTextSelectionAll(QColor color) const;
 
     /// Create text layout for the document. Function is asynchronous,
-    /// it returns immediately. After text layout is created, signal
+    /// it returns immediately. Pages are processed in order of priority
+    /// (visible pages first, then their neighbours, then the rest of the document),
+    /// and text layout of each page can be used as soon as it is finished.
+    /// After text layout of whole document is created, signal
     /// \p textLayoutChanged is emitted.
     void makeTextLayout();
 
@@ -166,10 +180,34 @@ signals:
 private:
     void onTextLayoutCreated();
 
+    /// Returns page indices in order, in which text layouts should be created,
+    /// i.e. visible pages first, then pages near visible pages, then the others.
+    /// \param pageCount Page count
+    std::vector<PDFInteger> getPageIndicesByPriority(PDFInteger pageCount) const;
+
+    /// Returns flat text layout of the page, which was already created by running
+    /// text layout creation. If page is not yet processed, empty array is returned.
+    /// \param pageIndex Page index
+    QByteArray getCompiledPageData(PDFInteger pageIndex) const;
+
+    /// Finishes text layout creation (both when it is finished, or cancelled)
+    void finishTextLayoutCreation();
+
+    /// Memory budget for text layouts, if text layouts need more memory,
+    /// then some of them are compressed.
+    static constexpr qint64 TEXT_LAYOUT_MEMORY_BUDGET = 256 * 1024 * 1024;
+
     PDFDrawWidgetProxy* m_proxy;
     State m_state = State::Inactive;
     bool m_isRunning;
+    std::atomic_bool m_isCancelled;
     std::optional<PDFTextLayoutStorage> m_textLayouts;
+
+    /// Flat text layouts of pages, which were already created by running
+    /// text layout creation, protected by the mutex below.
+    std::vector<QByteArray> m_compiledPages;
+    mutable QMutex m_compiledPagesMutex;
+
     QFuture<PDFTextLayoutStorage> m_textLayoutCompileFuture;
     QFutureWatcher<PDFTextLayoutStorage> m_textLayoutCompileFutureWatcher;
     PDFTextLayoutCache m_cache;
@@ -200,6 +238,7 @@ public:
 protected:
     virtual bool isContentSuppressedByOC(PDFObjectReference ocgOrOcmd) override;
     virtual bool isContentKindSuppressed(ContentKind kind) const override;
+    virtual bool isTextMetricsOnly() const override;
     virtual void performOutputCharacter(const PDFTextCharacterInfo& info) override;
 
 private:
@@ -37,6 +37,40 @@ PDFDocument::~PDFDocument()
 
 }
 
+PDFDocument::PDFDocument(const PDFDocument& other) :
+    m_pdfObjectStorage(other.m_pdfObjectStorage),
+    m_info(other.m_info),
+    m_catalog(other.m_catalog)
+{
+    m_catalog.setStorage(&m_pdfObjectStorage);
+}
+
+PDFDocument::PDFDocument(PDFDocument&& other) :
+    m_pdfObjectStorage(qMove(other.m_pdfObjectStorage)),
+    m_info(qMove(other.m_info)),
+    m_catalog(qMove(other.m_catalog))
+{
+    m_catalog.setStorage(&m_pdfObjectStorage);
+}
+
+PDFDocument& PDFDocument::operator=(const PDFDocument& other)
+{
+    m_pdfObjectStorage = other.m_pdfObjectStorage;
+    m_info = other.m_info;
+    m_catalog = other.m_catalog;
+    m_catalog.setStorage(&m_pdfObjectStorage);
+    return *this;
+}
+
+PDFDocument& PDFDocument::operator=(PDFDocument&& other)
+{
+    m_pdfObjectStorage = qMove(other.m_pdfObjectStorage);
+    m_info = qMove(other.m_info);
+    m_catalog = qMove(other.m_catalog);
+    m_catalog.setStorage(&m_pdfObjectStorage);
+    return *this;
+}
+
 bool PDFDocument::operator==(const PDFDocument& other) const
 {
     // Document is considered equal, if storage is equal
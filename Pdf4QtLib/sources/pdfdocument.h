@@ -410,6 +410,13 @@ public:
     explicit PDFDocument() = default;
     ~PDFDocument();
 
+    // Catalog refers to the object storage of the document (pages are parsed
+    // on demand), so it must be rebound, when document is copied or moved.
+    PDFDocument(const PDFDocument& other);
+    PDFDocument(PDFDocument&& other);
+    PDFDocument& operator=(const PDFDocument& other);
+    PDFDocument& operator=(PDFDocument&& other);
+
     bool operator==(const PDFDocument& other) const;
     bool operator!=(const PDFDocument& other) const { return !(*this == other); }
 
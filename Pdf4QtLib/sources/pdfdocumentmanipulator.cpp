@@ -17,11 +17,65 @@
 
 #include "pdfdocumentmanipulator.h"
 #include "pdfdocumentbuilder.h"
+#include "pdfdocumentwriter.h"
+#include "pdfobjectutils.h"
 #include "pdfoptimizer.h"
 
+#include <QCryptographicHash>
+
 namespace pdf
 {
 
+/// Returns page tree root of the document builder
+static PDFObjectReference getPageTreeRoot(const PDFDocumentBuilder& documentBuilder)
+{
+    if (const PDFDictionary* catalogDictionary = documentBuilder.getDictionaryFromObject(documentBuilder.getObjectByReference(documentBuilder.getCatalogReference())))
+    {
+        PDFDocumentDataLoaderDecorator loader(documentBuilder.getStorage());
+        return loader.readReferenceFromDictionary(catalogDictionary, "Pages");
+    }
+
+    return PDFObjectReference();
+}
+
+/// Collects references of the document skeleton objects, reachable from the root objects.
+/// Streams (content streams, images, fonts, appearance streams...) are not part
+/// of the skeleton. Page dictionaries are, but objects referenced from them are not traversed.
+/// \param rootReferences Root objects
+/// \param pageReferences Page dictionaries
+/// \param storage Storage
+static std::set<PDFObjectReference> getSkeletonReferences(const std::vector<PDFObjectReference>& rootReferences,
+                                                          const std::set<PDFObjectReference>& pageReferences,
+                                                          const PDFObjectStorage& storage)
+{
+    std::set<PDFObjectReference> references;
+    std::vector<PDFObjectReference> workList = rootReferences;
+
+    while (!workList.empty())
+    {
+        const PDFObjectReference reference = workList.back();
+        workList.pop_back();
+
+        const PDFObject& object = storage.getObject(reference);
+        if (object.isStream() || references.count(reference))
+        {
+            continue;
+        }
+
+        references.insert(reference);
+
+        if (pageReferences.count(reference))
+        {
+            continue;
+        }
+
+        std::set<PDFObjectReference> directReferences = PDFObjectUtils::getDirectReferences(object);
+        workList.insert(workList.end(), directReferences.cbegin(), directReferences.cend());
+    }
+
+    return references;
+}
+
 PDFOperationResult PDFDocumentManipulator::assemble(const AssembledPages& pages)
 {
     if (pages.empty())
@@ -32,6 +86,13 @@ PDFOperationResult PDFDocumentManipulator::assemble(const AssembledPages& pages)
     m_flags = None;
     m_mergedObjects = { };
     m_assembledDocument = PDFDocument();
+    m_documentInfos.clear();
+    m_copiedObjects.clear();
+
+    for (const auto& documentItem : m_documents)
+    {
+        addDocumentInfo(documentItem.first, documentItem.second);
+    }
 
     try
     {
@@ -99,6 +160,78 @@ PDFOperationResult PDFDocumentManipulator::assemble(const AssembledPages& pages)
     return true;
 }
 
+PDFOperationResult PDFDocumentManipulator::assemble(const AssembledPages& pages, const DocumentLoader& loader, QIODevice* device)
+{
+    if (pages.empty())
+    {
+        return tr("Empty page list.");
+    }
+
+    if (!device->isWritable())
+    {
+        return tr("Device is not writable.");
+    }
+
+    m_flags = None;
+    m_mergedObjects = { };
+    m_assembledDocument = PDFDocument();
+    m_outlines.clear();
+    m_documentInfos.clear();
+    m_copiedObjects.clear();
+
+    try
+    {
+        // Document builder always creates document of version 1.7,
+        // so we can write the header before any document is loaded.
+        PDFDocumentStreamWriter writer(device);
+        writer.writeHeader(PDFVersion(1, 7));
+
+        pdf::PDFDocumentBuilder documentBuilder;
+        initializeMergedObjects(documentBuilder);
+
+        ProcessedPages processedPages = streamObjectsAndCopyPages(documentBuilder, writer, pages, loader);
+        createSpecialPages(documentBuilder, processedPages);
+
+        std::vector<PDFObjectReference> adjustedPages;
+        std::transform(processedPages.cbegin(), processedPages.cend(), std::back_inserter(adjustedPages), [](const auto& page) { return page.targetPageReference; });
+        documentBuilder.setPages(adjustedPages);
+
+        // Pages are already flattened (they have inheritable attributes), we just
+        // set the parent. We can't flatten page tree again, because inheritable
+        // attributes can be in objects, which were already written.
+        PDFObjectFactory parentFactory;
+        parentFactory.beginDictionary();
+        parentFactory.beginDictionaryItem("Parent");
+        parentFactory << getPageTreeRoot(documentBuilder);
+        parentFactory.endDictionaryItem();
+        parentFactory.endDictionary();
+        PDFObject parentObject = parentFactory.takeObject();
+
+        for (const PDFObjectReference& pageReference : adjustedPages)
+        {
+            documentBuilder.mergeTo(pageReference, parentObject);
+        }
+
+        // Merged objects can contain duplicit references (document is not optimized,
+        // so we must remove them here).
+        for (MergedObjectType mergedObjectType : { MOT_OCProperties, MOT_Form })
+        {
+            const PDFObjectReference reference = m_mergedObjects[mergedObjectType];
+            documentBuilder.setObject(reference, PDFObjectManipulator::removeDuplicitReferencesInArrays(documentBuilder.getObjectByReference(reference)));
+        }
+
+        finalizeMergedObjects(documentBuilder);
+        addOutlineAndDocumentParts(documentBuilder, pages, adjustedPages);
+
+        PDFDocument skeletonDocument = documentBuilder.build();
+        return writer.finish(&skeletonDocument);
+    }
+    catch (const PDFException& exception)
+    {
+        return exception.getMessage();
+    }
+}
+
 PDFDocumentManipulator::AssembledPages PDFDocumentManipulator::createAllDocumentPages(int documentIndex, const PDFDocument* document)
 {
     AssembledPages assembledPages;
@@ -178,6 +311,12 @@ PDFDocumentManipulator::ProcessedPages PDFDocumentManipulator::processPages(PDFD
         processedPages = collectObjectsAndCopyPages(documentBuilder, pages);
     }
 
+    createSpecialPages(documentBuilder, processedPages);
+    return processedPages;
+}
+
+void PDFDocumentManipulator::createSpecialPages(PDFDocumentBuilder& documentBuilder, ProcessedPages& processedPages)
+{
     // Now, create "special" pages, such as image pages or blank pages, and rotate
     // final pages (we must check, that page object exists).
     for (ProcessedPage& processedPage : processedPages)
@@ -225,8 +364,6 @@ PDFDocumentManipulator::ProcessedPages PDFDocumentManipulator::processPages(PDFD
 
         documentBuilder.setPageRotation(processedPage.targetPageReference, processedPage.assembledPage.pageRotation);
     }
-
-    return processedPages;
 }
 
 PDFDocumentManipulator::ProcessedPages PDFDocumentManipulator::collectObjectsAndCopyPages(PDFDocumentBuilder& documentBuilder, const AssembledPages& pages)
@@ -346,7 +483,15 @@ PDFDocumentManipulator::ProcessedPages PDFDocumentManipulator::collectObjectsAnd
             objectsToMerge.insert(objectsToMerge.end(), { acroFormReference, namesReference, ocPropertiesReference, outlineReference });
 
             // Now, we are ready to merge objects into target document builder
-            std::vector<pdf::PDFObjectReference> references = pdf::PDFDocumentBuilder::createReferencesFromObjects(documentBuilder.copyFrom(pdf::PDFDocumentBuilder::createObjectsFromReferences(objectsToMerge), *temporaryBuilder.getStorage(), true));
+            const PDFObjectStorage& storage = *temporaryBuilder.getStorage();
+            std::set<PDFObjectReference> objectReferences = PDFObjectUtils::getReferences(pdf::PDFDocumentBuilder::createObjectsFromReferences(objectsToMerge), storage);
+            std::set<PDFObjectReference> excludedReferences(objectsToMerge.cbegin(), objectsToMerge.cend());
+            auto storeObject = [&documentBuilder](PDFObjectReference, PDFObjectReference targetReference, PDFObject object) { documentBuilder.setObject(targetReference, qMove(object)); };
+            std::map<PDFObjectReference, PDFObjectReference> referenceMapping = copyObjects(documentBuilder, objectReferences, excludedReferences, storage, storeObject);
+
+            std::vector<pdf::PDFObjectReference> references;
+            references.reserve(objectsToMerge.size());
+            std::transform(objectsToMerge.cbegin(), objectsToMerge.cend(), std::back_inserter(references), [&referenceMapping](const PDFObjectReference& reference) { return referenceMapping.at(reference); });
 
             outlineReference = references.back();
             references.pop_back();
@@ -403,6 +548,349 @@ PDFDocumentManipulator::ProcessedPages PDFDocumentManipulator::collectObjectsAnd
     return processedPages;
 }
 
+PDFDocumentManipulator::ProcessedPages PDFDocumentManipulator::streamObjectsAndCopyPages(PDFDocumentBuilder& documentBuilder,
+                                                                                        PDFDocumentStreamWriter& writer,
+                                                                                        const AssembledPages& pages,
+                                                                                        const DocumentLoader& loader)
+{
+    ProcessedPages processedPages;
+    processedPages.reserve(pages.size());
+
+    std::map<PDFInteger, std::set<PDFInteger>> documentPages;
+    std::map<std::pair<PDFInteger, PDFInteger>, PDFObjectReference> copiedPages;
+
+    for (const AssembledPage& assembledPage : pages)
+    {
+        ProcessedPage processedPage;
+        processedPage.assembledPage = assembledPage;
+        processedPages.push_back(processedPage);
+
+        if (assembledPage.isDocumentPage())
+        {
+            documentPages[assembledPage.documentIndex].insert(assembledPage.pageIndex);
+        }
+    }
+
+    auto createNullEntryObject = [](const char* key)
+    {
+        PDFObjectFactory factory;
+        factory.beginDictionary();
+        factory.beginDictionaryItem(key);
+        factory << nullptr;
+        factory.endDictionaryItem();
+        factory.endDictionary();
+        return factory.takeObject();
+    };
+
+    const PDFObject removeParentObject = createNullEntryObject("Parent");
+    const PDFObject removeAnnotationsObject = createNullEntryObject("Annots");
+
+    for (const auto& documentItem : documentPages)
+    {
+        const PDFInteger documentIndex = documentItem.first;
+        const std::set<PDFInteger>& pageIndices = documentItem.second;
+
+        // Loaded document is released at the end of this iteration,
+        // so only one source document is held in the memory.
+        PDFDocument loadedDocument;
+        const PDFDocument* document = nullptr;
+
+        if (loader)
+        {
+            loadedDocument = loader(documentIndex);
+            document = &loadedDocument;
+        }
+        else if (m_documents.count(documentIndex))
+        {
+            document = m_documents.at(documentIndex);
+        }
+        else
+        {
+            throw PDFException(tr("Invalid document."));
+        }
+
+        addDocumentInfo(documentIndex, document);
+
+        pdf::PDFDocumentBuilder temporaryBuilder(document);
+        temporaryBuilder.flattenPageTree();
+
+        std::vector<pdf::PDFObjectReference> currentPages = temporaryBuilder.getPages();
+        std::vector<pdf::PDFObjectReference> selectedPages;
+        selectedPages.reserve(pageIndices.size());
+
+        for (PDFInteger pageIndex : pageIndices)
+        {
+            if (pageIndex < 0 || pageIndex >= PDFInteger(currentPages.size()))
+            {
+                throw PDFException(tr("Missing page (%1) in a document.").arg(pageIndex));
+            }
+
+            selectedPages.push_back(currentPages[pageIndex]);
+        }
+
+        pdf::PDFObjectReference acroFormReference;
+        pdf::PDFObjectReference namesReference;
+        pdf::PDFObjectReference ocPropertiesReference;
+        pdf::PDFObjectReference outlineReference;
+        pdf::PDFObjectReference pageTreeRootReference = getPageTreeRoot(temporaryBuilder);
+
+        pdf::PDFObject formObject = document->getCatalog()->getFormObject();
+        if (formObject.isReference())
+        {
+            acroFormReference = formObject.getReference();
+        }
+        else
+        {
+            acroFormReference = temporaryBuilder.addObject(formObject);
+        }
+
+        if (const pdf::PDFDictionary* catalogDictionary = temporaryBuilder.getDictionaryFromObject(temporaryBuilder.getObjectByReference(temporaryBuilder.getCatalogReference())))
+        {
+            pdf::PDFObject namesObject = catalogDictionary->get("Names");
+            if (namesObject.isReference())
+            {
+                namesReference = namesObject.getReference();
+            }
+
+            pdf::PDFObject ocPropertiesObject = catalogDictionary->get("OCProperties");
+            if (ocPropertiesObject.isReference())
+            {
+                ocPropertiesReference = ocPropertiesObject.getReference();
+            }
+
+            // Outline is used only, when whole document is assembled and outlines are joined
+            pdf::PDFObject outlineObject = catalogDictionary->get("Outlines");
+            if (outlineObject.isReference() && m_outlineMode == OutlineMode::Join && selectedPages.size() == currentPages.size())
+            {
+                outlineReference = outlineObject.getReference();
+            }
+        }
+
+        if (!namesReference.isValid())
+        {
+            namesReference = temporaryBuilder.addObject(pdf::PDFObject());
+        }
+
+        if (!ocPropertiesReference.isValid())
+        {
+            ocPropertiesReference = temporaryBuilder.addObject(pdf::PDFObject());
+        }
+
+        if (!outlineReference.isValid())
+        {
+            outlineReference = temporaryBuilder.addObject(pdf::PDFObject());
+        }
+
+        // Remove pages, which are not assembled, and the page tree, so objects
+        // referenced only by them are not written to the output device.
+        std::set<PDFObjectReference> selectedPagesSet(selectedPages.cbegin(), selectedPages.cend());
+        for (const PDFObjectReference& pageReference : currentPages)
+        {
+            if (selectedPagesSet.count(pageReference))
+            {
+                temporaryBuilder.mergeTo(pageReference, removeParentObject);
+            }
+            else
+            {
+                temporaryBuilder.setObject(pageReference, PDFObject());
+            }
+        }
+
+        if (pageTreeRootReference.isValid())
+        {
+            temporaryBuilder.setObject(pageTreeRootReference, PDFObject());
+        }
+
+        std::vector<PDFObjectReference> rootReferences = selectedPages;
+        rootReferences.insert(rootReferences.end(), { acroFormReference, namesReference, ocPropertiesReference, outlineReference });
+
+        const PDFObjectStorage& storage = *temporaryBuilder.getStorage();
+        std::set<PDFObjectReference> references = PDFObjectUtils::getReferences(pdf::PDFDocumentBuilder::createObjectsFromReferences(rootReferences), storage);
+        std::set<PDFObjectReference> skeletonReferences = getSkeletonReferences(rootReferences, selectedPagesSet, storage);
+
+        // Skeleton objects are stored in the document builder, other objects
+        // are written immediately and are never held in the document builder.
+        // Skeleton objects are never shared with already written objects,
+        // because we must be able to read them.
+        auto storeObject = [&documentBuilder, &writer, &skeletonReferences](PDFObjectReference sourceReference, PDFObjectReference targetReference, PDFObject object)
+        {
+            if (skeletonReferences.count(sourceReference))
+            {
+                documentBuilder.setObject(targetReference, qMove(object));
+            }
+            else if (!object.isNull())
+            {
+                writer.writeObject(targetReference, object);
+            }
+        };
+        std::map<PDFObjectReference, PDFObjectReference> referenceMapping = copyObjects(documentBuilder, references, skeletonReferences, storage, storeObject);
+
+        documentBuilder.appendTo(m_mergedObjects[MOT_OCProperties], documentBuilder.getObjectByReference(referenceMapping.at(ocPropertiesReference)));
+        documentBuilder.appendTo(m_mergedObjects[MOT_Form], documentBuilder.getObjectByReference(referenceMapping.at(acroFormReference)));
+        documentBuilder.mergeNames(m_mergedObjects[MOT_Names], referenceMapping.at(namesReference));
+        m_outlines[documentIndex] = referenceMapping.at(outlineReference);
+
+        auto pageIndexIt = pageIndices.cbegin();
+        for (const PDFObjectReference& pageReference : selectedPages)
+        {
+            copiedPages[std::make_pair(documentIndex, *pageIndexIt++)] = referenceMapping.at(pageReference);
+        }
+    }
+
+    std::set<PDFObjectReference> usedReferences;
+    for (ProcessedPage& processedPage : processedPages)
+    {
+        if (processedPage.assembledPage.isDocumentPage())
+        {
+            auto key = std::make_pair(processedPage.assembledPage.documentIndex, processedPage.assembledPage.pageIndex);
+            Q_ASSERT(copiedPages.count(key));
+
+            PDFObjectReference pageReference = copiedPages.at(key);
+            if (!usedReferences.count(pageReference))
+            {
+                processedPage.targetPageReference = pageReference;
+                usedReferences.insert(pageReference);
+            }
+            else
+            {
+                // Page is being cloned. Page objects are already written, so cloned page
+                // shares them with the original page. Annotations can't be shared
+                // between pages, so they are removed from the cloned page.
+                PDFObjectReference clonedPageReference = documentBuilder.addObject(documentBuilder.getObjectByReference(pageReference));
+                documentBuilder.mergeTo(clonedPageReference, removeAnnotationsObject);
+                processedPage.targetPageReference = clonedPageReference;
+                usedReferences.insert(clonedPageReference);
+            }
+        }
+    }
+
+    return processedPages;
+}
+
+std::map<PDFObjectReference, PDFObjectReference> PDFDocumentManipulator::copyObjects(PDFDocumentBuilder& documentBuilder,
+                                                                                   const std::set<PDFObjectReference>& references,
+                                                                                   const std::set<PDFObjectReference>& excludedReferences,
+                                                                                   const PDFObjectStorage& storage,
+                                                                                   const CopyObjectCallback& callback)
+{
+    std::map<PDFObjectReference, PDFObjectReference> referenceMapping;
+
+    // Count, how many not yet copied objects each object references,
+    // and which objects are referencing given object.
+    std::map<PDFObjectReference, size_t> unresolvedCounts;
+    std::map<PDFObjectReference, std::vector<PDFObjectReference>> referencingObjects;
+    std::vector<PDFObjectReference> workList;
+
+    for (const PDFObjectReference& reference : references)
+    {
+        size_t unresolvedCount = 0;
+        for (const PDFObjectReference& directReference : PDFObjectUtils::getDirectReferences(storage.getObject(reference)))
+        {
+            if (references.count(directReference))
+            {
+                referencingObjects[directReference].push_back(reference);
+                ++unresolvedCount;
+            }
+        }
+
+        unresolvedCounts[reference] = unresolvedCount;
+        if (unresolvedCount == 0)
+        {
+            workList.push_back(reference);
+        }
+    }
+
+    auto isShareable = [&excludedReferences, &storage](const PDFObjectReference& reference, const PDFObject& object)
+    {
+        if (object.isNull() || excludedReferences.count(reference))
+        {
+            return false;
+        }
+
+        // We do not share special objects, such as pages
+        if (const PDFDictionary* dictionary = storage.getDictionaryFromObject(object))
+        {
+            PDFObject nameObject = storage.getObject(dictionary->get("Type"));
+            if (nameObject.isName() && nameObject.getString() == "Page")
+            {
+                return false;
+            }
+        }
+
+        return true;
+    };
+
+    // Objects are copied in order, where all referenced objects
+    // are already copied, so references in the object are already mapped to the
+    // target document and content of the object can be compared with objects
+    // copied from other documents.
+    while (!workList.empty())
+    {
+        const PDFObjectReference sourceReference = workList.back();
+        workList.pop_back();
+
+        PDFObject object = PDFObjectUtils::replaceReferences(storage.getObject(sourceReference), referenceMapping);
+
+        if (isShareable(sourceReference, object))
+        {
+            QByteArray hash = QCryptographicHash::hash(PDFDocumentWriter::getSerializedObject(object), QCryptographicHash::Sha256);
+            auto it = m_copiedObjects.find(hash);
+
+            // If copied object is still in the document builder, compare it, otherwise
+            // it was already written, and we must rely on the hash.
+            const PDFObject* copiedObject = (it != m_copiedObjects.end()) ? &documentBuilder.getObjectByReference(it->second) : nullptr;
+            if (copiedObject && (copiedObject->isNull() || *copiedObject == object))
+            {
+                referenceMapping[sourceReference] = it->second;
+            }
+            else
+            {
+                const PDFObjectReference targetReference = documentBuilder.addObject(PDFObject::createNull());
+                referenceMapping[sourceReference] = targetReference;
+                m_copiedObjects[hash] = targetReference;
+                callback(sourceReference, targetReference, qMove(object));
+            }
+        }
+        else
+        {
+            const PDFObjectReference targetReference = documentBuilder.addObject(PDFObject::createNull());
+            referenceMapping[sourceReference] = targetReference;
+            callback(sourceReference, targetReference, qMove(object));
+        }
+
+        auto itReferencing = referencingObjects.find(sourceReference);
+        if (itReferencing != referencingObjects.end())
+        {
+            for (const PDFObjectReference& referencingObject : itReferencing->second)
+            {
+                if (--unresolvedCounts[referencingObject] == 0)
+                {
+                    workList.push_back(referencingObject);
+                }
+            }
+        }
+    }
+
+    // Objects in reference cycles (for example, annotation and its popup) are
+    // copied without sharing. We must allocate references for all of them first.
+    std::vector<PDFObjectReference> remainingReferences;
+    for (const PDFObjectReference& reference : references)
+    {
+        if (!referenceMapping.count(reference))
+        {
+            referenceMapping[reference] = documentBuilder.addObject(PDFObject::createNull());
+            remainingReferences.push_back(reference);
+        }
+    }
+
+    for (const PDFObjectReference& sourceReference : remainingReferences)
+    {
+        callback(sourceReference, referenceMapping.at(sourceReference), PDFObjectUtils::replaceReferences(storage.getObject(sourceReference), referenceMapping));
+    }
+
+    return referenceMapping;
+}
+
 void PDFDocumentManipulator::classify(const AssembledPages& pages)
 {
     m_flags = None;
@@ -428,6 +916,14 @@ void PDFDocumentManipulator::classify(const AssembledPages& pages)
     }
 }
 
+void PDFDocumentManipulator::addDocumentInfo(PDFInteger documentIndex, const PDFDocument* document)
+{
+    DocumentInfo info;
+    info.title = document->getInfo()->title;
+    info.pageCount = document->getCatalog()->getPageCount();
+    m_documentInfos[documentIndex] = qMove(info);
+}
+
 void PDFDocumentManipulator::initializeMergedObjects(PDFDocumentBuilder& documentBuilder)
 {
     m_mergedObjects[MOT_OCProperties] = documentBuilder.addObject(PDFObject());
@@ -512,16 +1008,16 @@ void PDFDocumentManipulator::addOutlineAndDocumentParts(PDFDocumentBuilder& docu
         DocumentPartInfo& info = documentParts.back();
 
         QString documentTitle;
-        if (documentIndex != -1 && m_documents.count(documentIndex))
+        if (documentIndex != -1 && m_documentInfos.count(documentIndex))
         {
-            const PDFDocument* document = m_documents.at(documentIndex);
-            documentTitle = document->getInfo()->title;
+            const DocumentInfo& documentInfo = m_documentInfos.at(documentIndex);
+            documentTitle = documentInfo.title;
             if (documentTitle.isEmpty())
             {
                 documentTitle = tr("Document %1").arg(documentIndex);
             }
 
-            if (pageNumbers.getTotalLength() < PDFInteger(document->getCatalog()->getPageCount()))
+            if (pageNumbers.getTotalLength() < PDFInteger(documentInfo.pageCount))
             {
                 documentTitle = tr("%1, p. %2").arg(documentTitle, pageNumbers.toText(true));
             }
@@ -22,9 +22,13 @@
 #include "pdfutils.h"
 
 #include <QImage>
+#include <QIODevice>
+
+#include <functional>
 
 namespace pdf
 {
+class PDFDocumentStreamWriter;
 
 /// Document page assembler/manipulator. Can assemble document(s) pages
 /// to a new document, where pages are inserted/removed/moved, or joined
@@ -79,6 +83,26 @@ public:
     /// \returns True or error message
     PDFOperationResult assemble(const AssembledPages& pages);
 
+    /// Function, which loads source document with given index. Used in streamed
+    /// assembling, where source documents are loaded one by one and released
+    /// immediately after their objects are written. If document can't be loaded,
+    /// then function should throw PDFException.
+    using DocumentLoader = std::function<PDFDocument(PDFInteger)>;
+
+    /// Assembles pages into a new document, which is written directly to the
+    /// output device. Source documents are processed one at a time, their objects
+    /// are written immediately (with renumbered references) and only the document
+    /// skeleton (page dictionaries, page tree, outlines and merged form, names and
+    /// optional content properties) is held in memory until the end. So memory
+    /// consumption depends on the largest source document, not on the sum of them.
+    /// Assembled document is not optimized and is not accessible by the getters.
+    /// If \p loader is empty, then documents added by \p addDocument are used.
+    /// \param pages Pages
+    /// \param loader Document loader (can be empty)
+    /// \param device Output device (must be opened for writing)
+    /// \returns True or error message
+    PDFOperationResult assemble(const AssembledPages& pages, const DocumentLoader& loader, QIODevice* device);
+
     /// Returns reference to an assembled document. This function should
     /// be called only, if method \p assemble returns true, otherwise
     /// undefined document can be returned.
@@ -110,6 +134,12 @@ private:
 
     using ProcessedPages = std::vector<ProcessedPage>;
 
+    struct DocumentInfo
+    {
+        QString title;
+        size_t pageCount = 0;
+    };
+
     enum AssembleFlag
     {
         None            = 0x0000,
@@ -138,7 +168,49 @@ private:
     /// \returns Processed pages
     ProcessedPages collectObjectsAndCopyPages(PDFDocumentBuilder& documentBuilder, const AssembledPages& pages);
 
+    /// Copies objects of the document pages into the target document builder and
+    /// writes them to the stream writer. Documents are processed one at a time,
+    /// only the document skeleton is stored in the document builder.
+    /// \param documentBuilder Document builder
+    /// \param writer Stream writer
+    /// \param pages Pages to be copied
+    /// \param loader Document loader (can be empty)
+    /// \returns Processed pages
+    ProcessedPages streamObjectsAndCopyPages(PDFDocumentBuilder& documentBuilder,
+                                             PDFDocumentStreamWriter& writer,
+                                             const AssembledPages& pages,
+                                             const DocumentLoader& loader);
+
+    /// Callback, which stores copied object. Parameters are source reference,
+    /// target reference and object with references mapped to the target document.
+    using CopyObjectCallback = std::function<void(PDFObjectReference, PDFObjectReference, PDFObject)>;
+
+    /// Copies objects from the source storage to the target document builder
+    /// and returns reference mapping. Objects, which are identical to objects
+    /// already copied during the assembling (for example, the same font embedded
+    /// in multiple source documents), are not copied again, their references
+    /// are mapped to the already copied objects. Objects are identified by hash
+    /// of their content with references mapped to the target document, so
+    /// referenced objects are processed before objects referencing them.
+    /// Objects in reference cycles, pages and excluded objects are always copied.
+    /// \param documentBuilder Target document builder (references are allocated in it)
+    /// \param references References of objects to be copied
+    /// \param excludedReferences References of objects, which are always copied
+    /// \param storage Source storage
+    /// \param callback Callback, which stores copied objects
+    std::map<PDFObjectReference, PDFObjectReference> copyObjects(PDFDocumentBuilder& documentBuilder,
+                                                                 const std::set<PDFObjectReference>& references,
+                                                                 const std::set<PDFObjectReference>& excludedReferences,
+                                                                 const PDFObjectStorage& storage,
+                                                                 const CopyObjectCallback& callback);
+
+    /// Creates blank pages and image pages and sets rotation of all processed pages.
+    /// \param documentBuilder Document builder
+    /// \param processedPages Processed pages
+    void createSpecialPages(PDFDocumentBuilder& documentBuilder, ProcessedPages& processedPages);
+
     void classify(const AssembledPages& pages);
+    void addDocumentInfo(PDFInteger documentIndex, const PDFDocument* document);
     void initializeMergedObjects(PDFDocumentBuilder& documentBuilder);
     void finalizeMergedObjects(PDFDocumentBuilder& documentBuilder);
     void finalizeDocument(PDFDocument* document);
@@ -153,6 +225,8 @@ private:
     PDFDocument m_assembledDocument;
     OutlineMode m_outlineMode = OutlineMode::DocumentParts;
     std::map<PDFInteger, PDFObjectReference> m_outlines;
+    std::map<PDFInteger, DocumentInfo> m_documentInfos;
+    std::map<QByteArray, PDFObjectReference> m_copiedObjects;
 };
 
 }   // namespace pdf
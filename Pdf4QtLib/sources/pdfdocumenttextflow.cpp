@@ -203,6 +203,7 @@ public:
 protected:
     virtual bool isContentSuppressedByOC(PDFObjectReference ocgOrOcmd) override;
     virtual bool isContentKindSuppressed(ContentKind kind) const override;
+    virtual bool isTextMetricsOnly() const override;
     virtual void performOutputCharacter(const PDFTextCharacterInfo& info) override;
     virtual void performMarkedContentBegin(const QByteArray& tag, const PDFObject& properties) override;
     virtual void performMarkedContentEnd() override;
@@ -389,6 +390,12 @@ bool PDFStructureTreeTextContentProcessor::isContentKindSuppressed(ContentKind k
     return false;
 }
 
+bool PDFStructureTreeTextContentProcessor::isTextMetricsOnly() const
+{
+    // Glyph outlines are needed only for bounding boxes of the text
+    return !m_extractorOptions.testFlag(PDFStructureTreeTextExtractor::BoundingBoxes);
+}
+
 void PDFStructureTreeTextContentProcessor::performOutputCharacter(const PDFTextCharacterInfo& info)
 {
     if (!isContentSuppressed())
@@ -695,7 +702,10 @@ PDFDocumentTextFlow PDFDocumentTextFlowFactory::create(const PDFDocument* docume
                 const PDFPage* page = catalog->getPage(pageIndex);
                 Q_ASSERT(page);
 
-                PDFTextLayoutGenerator generator(PDFRenderer::IgnoreOptionalContent, page, document, &fontCache, &cms, &oca, QMatrix(), mqs);
+                PDFRenderer::Features features = PDFRenderer::IgnoreOptionalContent;
+                features.setFlag(PDFRenderer::ExactTextOutlines, m_exactTextOutlines);
+
+                PDFTextLayoutGenerator generator(features, page, document, &fontCache, &cms, &oca, QMatrix(), mqs);
                 QList<PDFRenderError> errors = generator.processContents();
                 PDFTextLayout textLayout = generator.createTextLayout();
                 PDFTextFlows textFlows = PDFTextFlow::createTextFlows(textLayout, PDFTextFlow::FlowFlags(PDFTextFlow::SeparateBlocks) | PDFTextFlow::RemoveSoftHyphen, pageIndex);
@@ -797,6 +807,11 @@ void PDFDocumentTextFlowFactory::setCalculateBoundingBoxes(bool calculateBoundin
     m_calculateBoundingBoxes = calculateBoundingBoxes;
 }
 
+void PDFDocumentTextFlowFactory::setExactTextOutlines(bool exactTextOutlines)
+{
+    m_exactTextOutlines = exactTextOutlines;
+}
+
 void PDFDocumentTextFlowEditor::setTextFlow(PDFDocumentTextFlow textFlow)
 {
     m_originalTextFlow = std::move(textFlow);
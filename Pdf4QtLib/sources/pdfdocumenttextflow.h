@@ -142,9 +142,15 @@ public:
     /// \param calculateBoundingBoxes Perform bounding box calculation?
     void setCalculateBoundingBoxes(bool calculateBoundingBoxes);
 
+    /// Sets if exact glyph outlines should be used in layout algorithm. By default,
+    /// character boxes are created from font metrics, which is much faster.
+    /// \param exactTextOutlines Use exact glyph outlines?
+    void setExactTextOutlines(bool exactTextOutlines);
+
 private:
     QList<PDFRenderError> m_errors;
     bool m_calculateBoundingBoxes = false;
+    bool m_exactTextOutlines = false;
 };
 
 /// Editor which can edit document text flow, modify user text,
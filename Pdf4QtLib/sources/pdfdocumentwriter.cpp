@@ -245,14 +245,7 @@ PDFOperationResult PDFDocumentWriter::write(QIODevice* device, const PDFDocument
     }
 
     // Write header
-    PDFVersion version = document->getInfo()->version;
-    device->write(QString("%PDF-%1.%2").arg(version.major).arg(version.minor).toLatin1());
-    writeCRLF(device);
-    device->write("% PDF producer: ");
-    device->write(PDF_LIBRARY_NAME);
-    writeCRLF(device);
-    writeCRLF(device);
-    writeCRLF(device);
+    writeHeader(device, document->getInfo()->version);
 
     PDFObjectReference encryptObjectReference;
     PDFObject encryptObject = document->getTrailerDictionary()->get("Encrypt");
@@ -298,6 +291,27 @@ PDFOperationResult PDFDocumentWriter::write(QIODevice* device, const PDFDocument
         }
     }
 
+    writeCrossReferenceTableAndTrailer(device, document, offsets);
+    return true;
+}
+
+void PDFDocumentWriter::writeHeader(QIODevice* device, PDFVersion version)
+{
+    device->write(QString("%PDF-%1.%2").arg(version.major).arg(version.minor).toLatin1());
+    writeCRLF(device);
+    device->write("% PDF producer: ");
+    device->write(PDF_LIBRARY_NAME);
+    writeCRLF(device);
+    writeCRLF(device);
+    writeCRLF(device);
+}
+
+void PDFDocumentWriter::writeCrossReferenceTableAndTrailer(QIODevice* device, const PDFDocument* document, const std::vector<PDFInteger>& offsets)
+{
+    const PDFObjectStorage::PDFObjects& objects = document->getStorage().getObjects();
+    const size_t objectCount = objects.size();
+    Q_ASSERT(offsets.size() == objectCount);
+
     // Write cross-reference table
     PDFInteger xrefOffset = device->pos();
     device->write("xref");
@@ -328,7 +342,7 @@ PDFOperationResult PDFDocumentWriter::write(QIODevice* device, const PDFDocument
         device->write(" ");
         device->write(generationString.toLatin1());
         device->write(" ");
-        device->write(entry.object.isNull() ? "f" : "n");
+        device->write(offsets[i] == -1 ? "f" : "n");
         writeCRLF(device);
     }
 
@@ -359,8 +373,6 @@ PDFOperationResult PDFDocumentWriter::write(QIODevice* device, const PDFDocument
 
     // Write footer
     device->write("%%EOF");
-
-    return true;
 }
 
 void PDFDocumentWriter::writeCRLF(QIODevice* device)
@@ -381,6 +393,77 @@ void PDFDocumentWriter::writeObjectFooter(QIODevice* device)
     writeCRLF(device);
 }
 
+PDFDocumentStreamWriter::PDFDocumentStreamWriter(QIODevice* device) :
+    m_device(device)
+{
+
+}
+
+void PDFDocumentStreamWriter::writeHeader(PDFVersion version)
+{
+    PDFDocumentWriter::writeHeader(m_device, version);
+}
+
+void PDFDocumentStreamWriter::writeObject(PDFObjectReference reference, const PDFObject& object)
+{
+    Q_ASSERT(reference.isValid());
+
+    const size_t objectNumber = reference.objectNumber;
+    if (objectNumber >= m_offsets.size())
+    {
+        m_offsets.resize(objectNumber + 1, -1);
+    }
+
+    m_offsets[objectNumber] = m_device->pos();
+
+    PDFWriteObjectVisitor visitor(m_device);
+    PDFDocumentWriter::writeObjectHeader(m_device, reference);
+    object.accept(&visitor);
+    PDFDocumentWriter::writeObjectFooter(m_device);
+}
+
+bool PDFDocumentStreamWriter::isWritten(PDFObjectReference reference) const
+{
+    return reference.objectNumber >= 0 && size_t(reference.objectNumber) < m_offsets.size() && m_offsets[reference.objectNumber] != -1;
+}
+
+PDFOperationResult PDFDocumentStreamWriter::finish(const PDFDocument* document)
+{
+    if (!m_device->isWritable())
+    {
+        return PDFDocumentWriter::tr("Device is not writable.");
+    }
+
+    const PDFObjectStorage& storage = document->getStorage();
+    if (storage.getSecurityHandler()->getMode() != EncryptionMode::None)
+    {
+        return PDFDocumentWriter::tr("Writing of encrypted documents is not supported.");
+    }
+
+    const PDFObjectStorage::PDFObjects& objects = storage.getObjects();
+    const size_t objectCount = objects.size();
+    if (m_offsets.size() > objectCount)
+    {
+        return PDFDocumentWriter::tr("Document doesn't contain all written objects.");
+    }
+    m_offsets.resize(objectCount, -1);
+
+    // Write remaining objects, which were not streamed yet
+    for (size_t i = 0; i < objectCount; ++i)
+    {
+        const PDFObjectStorage::Entry& entry = objects[i];
+        if (entry.object.isNull() || m_offsets[i] != -1)
+        {
+            continue;
+        }
+
+        writeObject(PDFObjectReference(i, entry.generation), entry.object);
+    }
+
+    PDFDocumentWriter::writeCrossReferenceTableAndTrailer(m_device, document, m_offsets);
+    return true;
+}
+
 class PDFSizeCounterIODevice : public QIODevice
 {
 public:
@@ -73,14 +73,54 @@ public:
     static QByteArray getSerializedObject(const PDFObject& object);
 
 private:
+    friend class PDFDocumentStreamWriter;
+
     static void writeCRLF(QIODevice* device);
+    static void writeHeader(QIODevice* device, PDFVersion version);
     static void writeObjectHeader(QIODevice* device, PDFObjectReference reference);
     static void writeObjectFooter(QIODevice* device);
+    static void writeCrossReferenceTableAndTrailer(QIODevice* device, const PDFDocument* document, const std::vector<PDFInteger>& offsets);
 
     /// Progress indicator
     PDFProgress* m_progress;
 };
 
+/// Writes document to the output device object by object, so objects
+/// can be released from memory immediately after they are written. Objects
+/// are written in the order of \p writeObject calls. Finally, \p finish
+/// must be called with the document containing remaining objects (objects
+/// not written yet), together with the trailer dictionary. Object numbers
+/// of the written objects must be reserved in this document (they can be null,
+/// because they are already stored in the output device). Encrypted documents
+/// are not supported.
+class PDF4QTLIBSHARED_EXPORT PDFDocumentStreamWriter
+{
+public:
+    explicit PDFDocumentStreamWriter(QIODevice* device);
+
+    /// Writes document header. Must be called before any object is written.
+    /// \param version Document version
+    void writeHeader(PDFVersion version);
+
+    /// Writes object to the output device
+    /// \param reference Object reference
+    /// \param object Object
+    void writeObject(PDFObjectReference reference, const PDFObject& object);
+
+    /// Returns true, if object with given reference was already written
+    /// \param reference Object reference
+    bool isWritten(PDFObjectReference reference) const;
+
+    /// Writes remaining (not yet written) objects of the document, cross
+    /// reference table and trailer dictionary of the document.
+    /// \param document Document
+    PDFOperationResult finish(const PDFDocument* document);
+
+private:
+    QIODevice* m_device;
+    std::vector<PDFInteger> m_offsets;
+};
+
 }   // namespace pdf
 
 #endif // PDFDOCUMENTWRITER_H
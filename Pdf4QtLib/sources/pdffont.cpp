@@ -425,7 +425,8 @@ public:
     /// produces glyphs for the font.
     /// \param byteArray Array of bytes to be interpreted
     /// \param textSequence Text sequence to be filled
-    virtual void fillTextSequence(const QByteArray& byteArray, TextSequence& textSequence, PDFRenderErrorReporter* reporter) = 0;
+    /// \param mode Mode, determining, how glyphs are created
+    virtual void fillTextSequence(const QByteArray& byteArray, TextSequence& textSequence, PDFRenderErrorReporter* reporter, TextSequenceMode mode) = 0;
 
     /// Returns true, if font has horizontal writing system
     virtual bool isHorizontalWritingSystem() const = 0;
@@ -449,7 +450,7 @@ public:
 
     PDFReal getPixelSize() const { return m_pixelSize; }
 
-    virtual void fillTextSequence(const QByteArray& byteArray, TextSequence& textSequence, PDFRenderErrorReporter* reporter) override;
+    virtual void fillTextSequence(const QByteArray& byteArray, TextSequence& textSequence, PDFRenderErrorReporter* reporter, TextSequenceMode mode) override;
     virtual bool isHorizontalWritingSystem() const override;
     virtual CharacterInfos getCharacterInfos() const override;
 
@@ -468,7 +469,7 @@ public:
     explicit PDFRealizedFontImpl();
     virtual ~PDFRealizedFontImpl();
 
-    virtual void fillTextSequence(const QByteArray& byteArray, TextSequence& textSequence, PDFRenderErrorReporter* reporter) override;
+    virtual void fillTextSequence(const QByteArray& byteArray, TextSequence& textSequence, PDFRenderErrorReporter* reporter, TextSequenceMode mode) override;
     virtual bool isHorizontalWritingSystem() const override { return !m_isVertical; }
     virtual void dumpFontToTreeItem(QTreeWidgetItem* item) const override;
     virtual QString getPostScriptName() const override { return m_postScriptName; }
@@ -497,6 +498,11 @@ private:
     /// Get glyph for glyph index
     const Glyph& getGlyph(unsigned int glyphIndex);
 
+    /// Get glyph box created from font metrics. If font metrics are not available,
+    /// or font has vertical writing system, nullptr is returned.
+    /// \param glyphWidth Glyph width in 1/1000 of text space units
+    const Glyph* getMetricsGlyph(PDFReal glyphWidth);
+
     /// Function checks, if error occured, and if yes, then exception is thrown
     static void checkFreeTypeError(FT_Error error);
 
@@ -506,6 +512,10 @@ private:
     /// Glyph cache, must be protected by the mutex above
     std::unordered_map<unsigned int, Glyph> m_glyphCache;
 
+    /// Glyph boxes created from font metrics (key is glyph width),
+    /// must be protected by the mutex above
+    std::unordered_map<PDFReal, Glyph> m_metricsGlyphCache;
+
     /// For embedded fonts, this byte array contains embedded font data
     QByteArray m_embeddedFontData;
 
@@ -560,8 +570,10 @@ PDFRealizedFontImpl::~PDFRealizedFontImpl()
     }
 }
 
-void PDFRealizedFontImpl::fillTextSequence(const QByteArray& byteArray, TextSequence& textSequence, PDFRenderErrorReporter* reporter)
+void PDFRealizedFontImpl::fillTextSequence(const QByteArray& byteArray, TextSequence& textSequence, PDFRenderErrorReporter* reporter, TextSequenceMode mode)
 {
+    const bool useMetrics = mode == TextSequenceMode::Metrics;
+
     switch (m_parentFont->getFontType())
     {
         case FontType::Type1:
@@ -590,7 +602,12 @@ void PDFRealizedFontImpl::fillTextSequence(const QByteArray& byteArray, TextSequ
 
                 const PDFReal glyphWidth = font->getGlyphAdvance(static_cast<uint8_t>(byteArray[i]));
 
-                if (glyphIndex)
+                const Glyph* metricsGlyph = (useMetrics && glyphIndex) ? getMetricsGlyph(glyphWidth) : nullptr;
+                if (metricsGlyph)
+                {
+                    textSequence.items.emplace_back(&metricsGlyph->glyph, (*encoding)[static_cast<uint8_t>(byteArray[i])], metricsGlyph->advance);
+                }
+                else if (glyphIndex)
                 {
                     const Glyph& glyph = getGlyph(glyphIndex);
                     textSequence.items.emplace_back(&glyph.glyph, (*encoding)[static_cast<uint8_t>(byteArray[i])], glyph.advance);
@@ -624,7 +641,13 @@ void PDFRealizedFontImpl::fillTextSequence(const QByteArray& byteArray, TextSequ
                 const GID glyphIndex = CIDtoGIDmapper->map(cid);
                 const PDFReal glyphWidth = font->getGlyphAdvance(cid);
 
-                if (glyphIndex)
+                const Glyph* metricsGlyph = (useMetrics && glyphIndex) ? getMetricsGlyph(glyphWidth) : nullptr;
+                if (metricsGlyph)
+                {
+                    QChar character = toUnicode->getToUnicode(cid);
+                    textSequence.items.emplace_back(&metricsGlyph->glyph, character, metricsGlyph->advance);
+                }
+                else if (glyphIndex)
                 {
                     QChar character = toUnicode->getToUnicode(cid);
                     const Glyph& glyph = getGlyph(glyphIndex);
@@ -934,6 +957,57 @@ const PDFRealizedFontImpl::Glyph& PDFRealizedFontImpl::getGlyph(unsigned int gly
     return dummy;
 }
 
+const PDFRealizedFontImpl::Glyph* PDFRealizedFontImpl::getMetricsGlyph(PDFReal glyphWidth)
+{
+    if (glyphWidth <= 0.0 || m_isVertical)
+    {
+        // Zero width means, that width is not defined in the font
+        // dictionary (for example, standard 14 fonts), and vertical fonts use
+        // different metrics. In both cases, we must use glyph outlines.
+        return nullptr;
+    }
+
+    {
+        QReadLocker readLock(&m_readWriteLock);
+
+        auto it = m_metricsGlyphCache.find(glyphWidth);
+        if (it != m_metricsGlyphCache.cend())
+        {
+            return &it->second;
+        }
+    }
+
+    // Determine vertical extent of the glyph box. Font bounding box is used,
+    // if ascent and descent are not defined in the font descriptor.
+    const FontDescriptor* descriptor = m_parentFont->getFontDescriptor();
+    PDFReal ascent = descriptor->ascent;
+    PDFReal descent = descriptor->descent;
+    if (qFuzzyIsNull(ascent - descent) && descriptor->boundingBox.isValid())
+    {
+        ascent = descriptor->boundingBox.bottom();
+        descent = descriptor->boundingBox.top();
+    }
+
+    if (ascent <= descent)
+    {
+        return nullptr;
+    }
+
+    const PDFReal scale = m_pixelSize * FONT_WIDTH_MULTIPLIER;
+
+    Glyph glyph;
+    glyph.glyph.addRect(QRectF(0.0, descent * scale, glyphWidth * scale, (ascent - descent) * scale));
+    glyph.advance = glyphWidth * scale;
+
+    QWriteLocker writeLock(&m_readWriteLock);
+    auto it = m_metricsGlyphCache.find(glyphWidth);
+    if (it == m_metricsGlyphCache.cend())
+    {
+        it = m_metricsGlyphCache.insert(std::make_pair(glyphWidth, qMove(glyph))).first;
+    }
+    return &it->second;
+}
+
 void PDFRealizedFontImpl::checkFreeTypeError(FT_Error error)
 {
     if (error)
@@ -953,9 +1027,9 @@ PDFRealizedFont::~PDFRealizedFont()
     delete m_impl;
 }
 
-void PDFRealizedFont::fillTextSequence(const QByteArray& byteArray, TextSequence& textSequence, PDFRenderErrorReporter* reporter)
+void PDFRealizedFont::fillTextSequence(const QByteArray& byteArray, TextSequence& textSequence, PDFRenderErrorReporter* reporter, TextSequenceMode mode)
 {
-    m_impl->fillTextSequence(byteArray, textSequence, reporter);
+    m_impl->fillTextSequence(byteArray, textSequence, reporter, mode);
 }
 
 bool PDFRealizedFont::isHorizontalWritingSystem() const
@@ -2418,8 +2492,10 @@ const QByteArray* PDFType3Font::getContentStream(int characterIndex) const
     return nullptr;
 }
 
-void PDFRealizedType3FontImpl::fillTextSequence(const QByteArray& byteArray, TextSequence& textSequence, PDFRenderErrorReporter* reporter)
+void PDFRealizedType3FontImpl::fillTextSequence(const QByteArray& byteArray, TextSequence& textSequence, PDFRenderErrorReporter* reporter, TextSequenceMode mode)
 {
+    Q_UNUSED(mode);
+
     Q_ASSERT(dynamic_cast<const PDFType3Font*>(m_parentFont.get()));
     const PDFType3Font* parentFont = static_cast<const PDFType3Font*>(m_parentFont.get());
 
@@ -80,6 +80,14 @@ struct TextSequence
     std::vector<TextSequenceItem> items;
 };
 
+/// Determines, how glyphs are created when filling the text sequence
+enum class TextSequenceMode
+{
+    GlyphOutlines,  ///< Glyph outlines are loaded from the font program (slow, but exact)
+    Metrics         ///< Glyphs are boxes created from font metrics (glyph widths, ascent/descent or font bounding box),
+                    ///< glyph outlines are used only if metrics are not available
+};
+
 constexpr bool isTextRenderingModeFilled(TextRenderingMode mode)
 {
     switch (mode)
@@ -234,11 +242,13 @@ public:
     ~PDFRealizedFont();
 
     /// Fills the text sequence by interpreting byte array according font data and
-    /// produces glyphs for the font.
+    /// produces glyphs for the font. In metrics mode, glyphs are just boxes
+    /// computed from the font metrics, so they can't be used for painting.
     /// \param byteArray Array of bytes to be interpreted
     /// \param textSequence Text sequence to be filled
     /// \param reporter Error reporter
-    void fillTextSequence(const QByteArray& byteArray, TextSequence& textSequence, PDFRenderErrorReporter* reporter);
+    /// \param mode Mode, determining, how glyphs are created
+    void fillTextSequence(const QByteArray& byteArray, TextSequence& textSequence, PDFRenderErrorReporter* reporter, TextSequenceMode mode = TextSequenceMode::GlyphOutlines);
 
     /// Return true, if we have horizontal writing system
     bool isHorizontalWritingSystem() const;
@@ -24,6 +24,7 @@
 #include <limits>
 #include <tuple>
 #include <array>
+#include <functional>
 
 #if defined(PDF4QTLIB_LIBRARY)
 #  define PDF4QTLIBSHARED_EXPORT Q_DECL_EXPORT
@@ -115,6 +116,16 @@ struct PDFObjectReference
     constexpr bool isValid() const { return objectNumber > 0; }
 };
 
+/// Hash function for object reference, so it can be used as a key
+/// in unordered containers.
+struct PDFObjectReferenceHash
+{
+    size_t operator()(const PDFObjectReference& reference) const
+    {
+        return std::hash<PDFInteger>()(reference.objectNumber) ^ (std::hash<PDFInteger>()(reference.generation) << 1);
+    }
+};
+
 /// Represents version identification
 struct PDFVersion
 {
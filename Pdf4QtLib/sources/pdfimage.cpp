@@ -22,10 +22,14 @@
 #include "pdfutils.h"
 #include "pdfjbig2decoder.h"
 #include "pdfccittfaxdecoder.h"
+#include "pdfstreamfilters.h"
 
 #include <openjpeg.h>
 #include <jpeglib.h>
 
+#include <memory>
+#include <functional>
+
 namespace pdf
 {
 
@@ -47,6 +51,452 @@ struct PDFJPEGDCTSource
     int startByte = 0;
 };
 
+/// Maximal size of the band of decoded image rows (in bytes), when image is decoded band by band
+static constexpr unsigned int IMAGE_BAND_SIZE = 1024 * 1024;
+
+/// Collects decoded image rows (and rows of the soft mask, if image has
+/// soft mask) to bands and converts each complete band to the scanlines
+/// of the target image using the color space.
+class PDFImageBandConverter
+{
+public:
+    explicit PDFImageBandConverter(const PDFAbstractColorSpace* colorSpace,
+                                   std::vector<PDFReal> decode,
+                                   RenderingIntent intent,
+                                   const PDFCMS* cms,
+                                   PDFRenderErrorReporter* reporter) :
+        m_colorSpace(colorSpace),
+        m_decode(qMove(decode)),
+        m_intent(intent),
+        m_cms(cms),
+        m_reporter(reporter)
+    {
+
+    }
+
+    /// Sets soft mask of the image. Soft mask must have the same size
+    /// as the image. Must be called before \p begin.
+    void setSoftMask(unsigned int bitsPerComponent, unsigned int stride, std::vector<PDFReal> decode, std::vector<PDFReal> matte)
+    {
+        m_hasSoftMask = true;
+        m_softMaskBitsPerComponent = bitsPerComponent;
+        m_softMaskStride = stride;
+        m_softMaskDecode = qMove(decode);
+        m_softMaskMatte = qMove(matte);
+    }
+
+    /// Creates target image and band buffer
+    void begin(unsigned int components, unsigned int bitsPerComponent, unsigned int width, unsigned int height, unsigned int stride)
+    {
+        m_components = components;
+        m_bitsPerComponent = bitsPerComponent;
+        m_width = width;
+        m_stride = stride;
+        m_bandRowCount = qMax(IMAGE_BAND_SIZE / qMax(qMax(stride, m_softMaskStride), 1u), 1u);
+        m_bandRowCount = qMin(m_bandRowCount, height);
+
+        if (m_hasSoftMask)
+        {
+            m_image = QImage(width, height, QImage::Format_ARGB32_Premultiplied);
+            m_image.fill(Qt::transparent);
+            m_softMaskBand = QByteArray(int(m_bandRowCount * m_softMaskStride), 0);
+        }
+        else
+        {
+            m_image = QImage(width, height, QImage::Format_RGB888);
+            m_image.fill(QColor(Qt::white));
+        }
+        m_band = QByteArray(int(m_bandRowCount * stride), 0);
+    }
+
+    /// Returns buffer for the next row (it has stride bytes)
+    unsigned char* getNextRow()
+    {
+        if (m_rowCount == m_bandRowCount)
+        {
+            flush();
+        }
+
+        return reinterpret_cast<unsigned char*>(m_band.data()) + size_t(m_rowCount++) * m_stride;
+    }
+
+    /// Returns buffer for the soft mask row, which corresponds to the row
+    /// returned by last call of \p getNextRow (it has soft mask stride bytes)
+    unsigned char* getSoftMaskRow()
+    {
+        Q_ASSERT(m_hasSoftMask && m_rowCount > 0);
+        return reinterpret_cast<unsigned char*>(m_softMaskBand.data()) + size_t(m_rowCount - 1) * m_softMaskStride;
+    }
+
+    /// Converts remaining rows and returns the image
+    QImage finish()
+    {
+        flush();
+        return qMove(m_image);
+    }
+
+private:
+    void flush()
+    {
+        if (m_rowCount > 0 && m_firstScanLine + m_rowCount <= unsigned(m_image.height()))
+        {
+            // Band data are shared, so they are not copied
+            PDFImageData bandData(m_components, m_bitsPerComponent, m_width, m_rowCount, m_stride, PDFImageData::MaskingType::None, m_band, { }, std::vector<PDFReal>(m_decode), { });
+            PDFImageData softMaskBandData;
+            if (m_hasSoftMask)
+            {
+                softMaskBandData = PDFImageData(1, m_softMaskBitsPerComponent, m_width, m_rowCount, m_softMaskStride, PDFImageData::MaskingType::None, m_softMaskBand, { }, std::vector<PDFReal>(m_softMaskDecode), std::vector<PDFReal>(m_softMaskMatte));
+            }
+            m_colorSpace->fillImageBand(bandData, softMaskBandData, m_image, m_firstScanLine, m_cms, m_intent, m_reporter);
+        }
+
+        m_firstScanLine += m_rowCount;
+        m_rowCount = 0;
+    }
+
+    const PDFAbstractColorSpace* m_colorSpace;
+    std::vector<PDFReal> m_decode;
+    RenderingIntent m_intent;
+    const PDFCMS* m_cms;
+    PDFRenderErrorReporter* m_reporter;
+
+    unsigned int m_components = 0;
+    unsigned int m_bitsPerComponent = 0;
+    unsigned int m_width = 0;
+    unsigned int m_stride = 0;
+    unsigned int m_bandRowCount = 0;
+    unsigned int m_rowCount = 0;
+    unsigned int m_firstScanLine = 0;
+    QImage m_image;
+    QByteArray m_band;
+
+    bool m_hasSoftMask = false;
+    unsigned int m_softMaskBitsPerComponent = 0;
+    unsigned int m_softMaskStride = 0;
+    std::vector<PDFReal> m_softMaskDecode;
+    std::vector<PDFReal> m_softMaskMatte;
+    QByteArray m_softMaskBand;
+};
+
+/// Reads rows of the image stream data, which are either not compressed,
+/// or compressed by FlateDecode filter (without predictor, or with PNG predictor).
+/// Missing rows at the end of the data are filled with zeros.
+class PDFImageRowReader
+{
+public:
+    /// Filter of the image stream
+    enum class Filter
+    {
+        Unsupported,    ///< Stream can't be decoded row by row
+        None,           ///< Data are not compressed
+        Flate,          ///< FlateDecode filter
+        DCT             ///< DCTDecode filter (rows are decoded by JPEG decoder)
+    };
+
+    /// Determines filter of the image stream. Only streams without filter, or with single
+    /// filter, can be decoded row by row.
+    /// \param document Document
+    /// \param dictionary Image stream dictionary
+    /// \param filterParameters Filter parameters (output)
+    static Filter getFilter(const PDFDocument* document, const PDFDictionary* dictionary, PDFObject& filterParameters)
+    {
+        if (dictionary->hasKey(PDF_STREAM_DICT_FILE_FILTER))
+        {
+            return Filter::Unsupported;
+        }
+
+        QByteArray filterName;
+        filterParameters = document->getObject(dictionary->get(PDF_STREAM_DICT_DECODE_PARMS));
+        const PDFObject& filters = document->getObject(dictionary->get(PDF_STREAM_DICT_FILTER));
+        if (filters.isName())
+        {
+            filterName = filters.getString();
+        }
+        else if (filters.isArray() && filters.getArray()->getCount() == 1)
+        {
+            const PDFObject& filterObject = document->getObject(filters.getArray()->getItem(0));
+            if (!filterObject.isName())
+            {
+                return Filter::Unsupported;
+            }
+            filterName = filterObject.getString();
+        }
+        else if (!filters.isNull())
+        {
+            return Filter::Unsupported;
+        }
+
+        if (filterParameters.isArray())
+        {
+            const PDFArray* filterParametersArray = filterParameters.getArray();
+            filterParameters = filterParametersArray->getCount() > 0 ? document->getObject(filterParametersArray->getItem(0)) : PDFObject();
+        }
+
+        if (filterName.isEmpty())
+        {
+            return Filter::None;
+        }
+        if (filterName == "FlateDecode" || filterName == "Fl")
+        {
+            return Filter::Flate;
+        }
+        if (filterName == "DCTDecode" || filterName == "DCT")
+        {
+            return Filter::DCT;
+        }
+
+        return Filter::Unsupported;
+    }
+
+    /// Creates row reader of the stream data. If data can't be read row by row
+    /// (filter is not supported, or predictor is applied to the whole stream),
+    /// then nullptr is returned.
+    /// \param document Document
+    /// \param content Stream data (must exist during the lifetime of the reader)
+    /// \param filter Filter of the stream
+    /// \param filterParameters Filter parameters
+    /// \param stride Row size in bytes
+    static std::unique_ptr<PDFImageRowReader> create(const PDFDocument* document, const QByteArray* content, Filter filter, const PDFObject& filterParameters, unsigned int stride)
+    {
+        switch (filter)
+        {
+            case Filter::None:
+                return std::unique_ptr<PDFImageRowReader>(new PDFImageRowReader(content, stride, nullptr));
+
+            case Filter::Flate:
+            {
+                PDFStreamPredictor predictor = PDFStreamPredictor::createPredictor([document](const PDFObject& object) -> const PDFObject& { return document->getObject(object); }, filterParameters);
+                if (!predictor.isNoPredictor() && !(predictor.isPNGPredictor() && predictor.getStride() == int(stride)))
+                {
+                    // TIFF predictor, or predictor with different row size, is applied to the whole stream
+                    return nullptr;
+                }
+
+                return std::unique_ptr<PDFImageRowReader>(new PDFImageRowReader(content, stride, std::make_unique<PDFFlateRowDecoder>(content, predictor, int(stride))));
+            }
+
+            default:
+                break;
+        }
+
+        return nullptr;
+    }
+
+    /// Reads next row of the data
+    /// \param row Buffer for the row (it has stride bytes)
+    void readRow(unsigned char* row)
+    {
+        if (m_decoder)
+        {
+            m_decoder->readRow(row);
+            return;
+        }
+
+        const int offset = int(qMin<size_t>(size_t(m_row++) * m_stride, size_t(m_content->size())));
+        const int bytesCopied = qMin(int(m_stride), m_content->size() - offset);
+        std::memcpy(row, m_content->constData() + offset, bytesCopied);
+        std::memset(row + bytesCopied, 0, m_stride - bytesCopied);
+    }
+
+private:
+    explicit PDFImageRowReader(const QByteArray* content, unsigned int stride, std::unique_ptr<PDFFlateRowDecoder> decoder) :
+        m_content(content),
+        m_stride(stride),
+        m_decoder(qMove(decoder))
+    {
+
+    }
+
+    const QByteArray* m_content;
+    unsigned int m_stride;
+    unsigned int m_row = 0;
+    std::unique_ptr<PDFFlateRowDecoder> m_decoder;
+};
+
+/// Reads rendering intent from the image dictionary
+/// \param loader Data loader
+/// \param dictionary Image dictionary
+/// \param renderingIntent Default rendering intent
+static RenderingIntent readImageRenderingIntent(const PDFDocumentDataLoaderDecorator& loader, const PDFDictionary* dictionary, RenderingIntent renderingIntent)
+{
+    if (dictionary->hasKey("Intent"))
+    {
+        QByteArray renderingIntentName = loader.readNameFromDictionary(dictionary, "Intent");
+        if (renderingIntentName == "Perceptual")
+        {
+            return RenderingIntent::Perceptual;
+        }
+        else if (renderingIntentName == "AbsoluteColorimetric")
+        {
+            return RenderingIntent::AbsoluteColorimetric;
+        }
+        else if (renderingIntentName == "RelativeColorimetric")
+        {
+            return RenderingIntent::RelativeColorimetric;
+        }
+        else if (renderingIntentName == "Saturation")
+        {
+            return RenderingIntent::Saturation;
+        }
+    }
+
+    return renderingIntent;
+}
+
+/// Decodes JPEG (DCT) image row by row. Returns false, if image header
+/// can't be read, or decoding was stopped. If error occurs, exception is thrown.
+/// \param content JPEG data
+/// \param colorTransform Color transform from the image dictionary (-1, if not present)
+/// \param errorReporter Error reporter
+/// \param startCallback Called, when decompression starts (with width, height and component count),
+///        if it returns false, decoding is stopped and false is returned
+/// \param rowCallback Called for each decoded row (8 bits per component)
+static bool decodeDCTImage(const QByteArray& content,
+                           int colorTransform,
+                           PDFRenderErrorReporter* errorReporter,
+                           const std::function<bool(unsigned int, unsigned int, unsigned int)>& startCallback,
+                           const std::function<void(const unsigned char*)>& rowCallback)
+{
+    jpeg_decompress_struct codec;
+    jpeg_error_mgr errorManager;
+    std::memset(&codec, 0, sizeof(jpeg_decompress_struct));
+    std::memset(&errorManager, 0, sizeof(errorManager));
+
+    PDFJPEGDCTSource source;
+    source.buffer = &content;
+    std::memset(&source.sourceManager, 0, sizeof(jpeg_source_mgr));
+
+    // Fix issue, that image doesn't start with FFD8 (start of image marker). If this
+    // occurs, try to find sequence FFD8, and if we can find it, then advance the buffer.
+    source.startByte = qMax(content.indexOf("\xFF\xD8"), 0);
+    if (source.startByte > 0)
+    {
+        errorReporter->reportRenderError(RenderErrorType::Warning, PDFTranslationContext::tr("Malformed data while reading JPEG stream. %1 bytes skipped.").arg(source.startByte));
+    }
+
+    auto errorMethod = [](j_common_ptr ptr)
+    {
+        char buffer[JMSG_LENGTH_MAX] = { };
+        (ptr->err->format_message)(ptr, buffer);
+
+        jpeg_destroy(ptr);
+        throw PDFException(PDFTranslationContext::tr("Error reading JPEG (DCT) image: %1.").arg(QString::fromLatin1(buffer)));
+    };
+
+    auto fillInputBufferMethod = [](j_decompress_ptr decompress) -> boolean
+    {
+        PDFJPEGDCTSource* source = reinterpret_cast<PDFJPEGDCTSource*>(decompress->src);
+
+        if (!source->sourceManager.next_input_byte)
+        {
+            const QByteArray* buffer = source->buffer;
+            source->sourceManager.next_input_byte = reinterpret_cast<const JOCTET*>(buffer->constData());
+            source->sourceManager.bytes_in_buffer = buffer->size();
+            source->sourceManager.next_input_byte += source->startByte;
+            source->sourceManager.bytes_in_buffer -= source->startByte;
+            return TRUE;
+        }
+
+        return FALSE;
+    };
+
+    auto skipInputDataMethod = [](j_decompress_ptr decompress, long num_bytes)
+    {
+        PDFJPEGDCTSource* source = reinterpret_cast<PDFJPEGDCTSource*>(decompress->src);
+
+        const size_t skippedBytes = qMin(source->sourceManager.bytes_in_buffer, static_cast<size_t>(num_bytes));
+        source->sourceManager.next_input_byte += skippedBytes;
+        source->sourceManager.bytes_in_buffer -= skippedBytes;
+    };
+
+    source.sourceManager.bytes_in_buffer = 0;
+    source.sourceManager.next_input_byte = nullptr;
+    source.sourceManager.init_source = [](j_decompress_ptr) { };
+    source.sourceManager.fill_input_buffer = fillInputBufferMethod;
+    source.sourceManager.skip_input_data = skipInputDataMethod;
+    source.sourceManager.resync_to_restart = jpeg_resync_to_restart;
+    source.sourceManager.term_source = [](j_decompress_ptr) { };
+
+    jpeg_std_error(&errorManager);
+    errorManager.error_exit = errorMethod;
+    codec.err = &errorManager;
+
+    jpeg_create_decompress(&codec);
+    codec.src = reinterpret_cast<jpeg_source_mgr*>(&source);
+
+    if (jpeg_read_header(&codec, TRUE) == JPEG_HEADER_OK)
+    {
+        // Determine color transform
+        if (colorTransform == -1 && codec.saw_Adobe_marker)
+        {
+            colorTransform = codec.Adobe_transform;
+        }
+
+        // Set the input transform
+        if (colorTransform > -1)
+        {
+            switch (codec.num_components)
+            {
+                case 3:
+                {
+                    codec.jpeg_color_space = colorTransform ? JCS_YCbCr : JCS_RGB;
+                    break;
+                }
+
+                case 4:
+                {
+                    codec.jpeg_color_space = colorTransform ? JCS_YCCK : JCS_CMYK;
+                    break;
+                }
+
+                default:
+                    break;
+            }
+        }
+
+        jpeg_start_decompress(&codec);
+
+        try
+        {
+            const JDIMENSION rowStride = codec.output_width * codec.output_components;
+            JSAMPARRAY samples = codec.mem->alloc_sarray(reinterpret_cast<j_common_ptr>(&codec), JPOOL_IMAGE, rowStride, 1);
+
+            if (!startCallback(codec.output_width, codec.output_height, codec.output_components))
+            {
+                jpeg_destroy_decompress(&codec);
+                return false;
+            }
+
+            while (codec.output_scanline < codec.output_height)
+            {
+                if (jpeg_read_scanlines(&codec, samples, 1) != 1)
+                {
+                    break;
+                }
+
+                rowCallback(samples[0]);
+            }
+
+            if (codec.output_scanline == codec.output_height)
+            {
+                jpeg_finish_decompress(&codec);
+            }
+        }
+        catch (...)
+        {
+            // Decompressor can be already destroyed in error handler, destroying it twice is safe
+            jpeg_destroy_decompress(&codec);
+            throw;
+        }
+
+        jpeg_destroy_decompress(&codec);
+        return true;
+    }
+
+    jpeg_destroy_decompress(&codec);
+    return false;
+}
+
 PDFImage PDFImage::createImage(const PDFDocument* document,
                                const PDFStream* stream,
                                PDFColorSpacePointer colorSpace,
@@ -96,26 +546,7 @@ PDFImage PDFImage::createImage(const PDFDocument* document,
     }
 
     // Set rendering intent
-    if (dictionary->hasKey("Intent"))
-    {
-        QByteArray renderingIntentName = loader.readNameFromDictionary(dictionary, "Intent");
-        if (renderingIntentName == "Perceptual")
-        {
-            image.m_renderingIntent = RenderingIntent::Perceptual;
-        }
-        else if (renderingIntentName == "AbsoluteColorimetric")
-        {
-            image.m_renderingIntent = RenderingIntent::AbsoluteColorimetric;
-        }
-        else if (renderingIntentName == "RelativeColorimetric")
-        {
-            image.m_renderingIntent = RenderingIntent::RelativeColorimetric;
-        }
-        else if (renderingIntentName == "Saturation")
-        {
-            image.m_renderingIntent = RenderingIntent::Saturation;
-        }
-    }
+    image.m_renderingIntent = readImageRenderingIntent(loader, dictionary, image.m_renderingIntent);
 
     // Fill Mask
     if (dictionary->hasKey("Mask"))
@@ -240,129 +671,35 @@ PDFImage PDFImage::createImage(const PDFDocument* document,
     {
         int colorTransform = loader.readIntegerFromDictionary(dictionary, "ColorTransform", -1);
 
-        jpeg_decompress_struct codec;
-        jpeg_error_mgr errorManager;
-        std::memset(&codec, 0, sizeof(jpeg_decompress_struct));
-        std::memset(&errorManager, 0, sizeof(errorManager));
+        unsigned int width = 0;
+        unsigned int height = 0;
+        unsigned int components = 0;
+        unsigned int rowStride = 0;
+        QByteArray buffer;
+        char* rowData = nullptr;
 
-        PDFJPEGDCTSource source;
-        source.buffer = &content;
-        std::memset(&source.sourceManager, 0, sizeof(jpeg_source_mgr));
-
-        // Fix issue, that image doesn't start with FFD8 (start of image marker). If this
-        // occurs, try to find sequence FFD8, and if we can find it, then advance the buffer.
-        source.startByte = qMax(content.indexOf("\xFF\xD8"), 0);
-        if (source.startByte > 0)
+        auto startDecoding = [&](unsigned int imageWidth, unsigned int imageHeight, unsigned int imageComponents)
         {
-            errorReporter->reportRenderError(RenderErrorType::Warning, PDFTranslationContext::tr("Malformed data while reading JPEG stream. %1 bytes skipped.").arg(source.startByte));
-        }
-
-        auto errorMethod = [](j_common_ptr ptr)
-        {
-            char buffer[JMSG_LENGTH_MAX] = { };
-            (ptr->err->format_message)(ptr, buffer);
-
-            jpeg_destroy(ptr);
-            throw PDFException(PDFTranslationContext::tr("Error reading JPEG (DCT) image: %1.").arg(QString::fromLatin1(buffer)));
+            width = imageWidth;
+            height = imageHeight;
+            components = imageComponents;
+            rowStride = width * components;
+            buffer = QByteArray(int(rowStride * height), 0);
+            rowData = buffer.data();
+            return true;
         };
 
-        auto fillInputBufferMethod = [](j_decompress_ptr decompress) -> boolean
+        auto decodeRow = [&](const unsigned char* row)
         {
-            PDFJPEGDCTSource* source = reinterpret_cast<PDFJPEGDCTSource*>(decompress->src);
-
-            if (!source->sourceManager.next_input_byte)
-            {
-                const QByteArray* buffer = source->buffer;
-                source->sourceManager.next_input_byte = reinterpret_cast<const JOCTET*>(buffer->constData());
-                source->sourceManager.bytes_in_buffer = buffer->size();
-                source->sourceManager.next_input_byte += source->startByte;
-                source->sourceManager.bytes_in_buffer -= source->startByte;
-                return TRUE;
-            }
-
-            return FALSE;
+            std::memcpy(rowData, row, rowStride);
+            rowData += rowStride;
         };
 
-        auto skipInputDataMethod = [](j_decompress_ptr decompress, long num_bytes)
+        if (decodeDCTImage(content, colorTransform, errorReporter, startDecoding, decodeRow))
         {
-            PDFJPEGDCTSource* source = reinterpret_cast<PDFJPEGDCTSource*>(decompress->src);
-
-            const size_t skippedBytes = qMin(source->sourceManager.bytes_in_buffer, static_cast<size_t>(num_bytes));
-            source->sourceManager.next_input_byte += skippedBytes;
-            source->sourceManager.bytes_in_buffer -= skippedBytes;
-        };
-
-        source.sourceManager.bytes_in_buffer = 0;
-        source.sourceManager.next_input_byte = nullptr;
-        source.sourceManager.init_source = [](j_decompress_ptr) { };
-        source.sourceManager.fill_input_buffer = fillInputBufferMethod;
-        source.sourceManager.skip_input_data = skipInputDataMethod;
-        source.sourceManager.resync_to_restart = jpeg_resync_to_restart;
-        source.sourceManager.term_source = [](j_decompress_ptr) { };
-
-        jpeg_std_error(&errorManager);
-        errorManager.error_exit = errorMethod;
-        codec.err = &errorManager;
-
-        jpeg_create_decompress(&codec);
-        codec.src = reinterpret_cast<jpeg_source_mgr*>(&source);
-
-        if (jpeg_read_header(&codec, TRUE) == JPEG_HEADER_OK)
-        {
-            // Determine color transform
-            if (colorTransform == -1 && codec.saw_Adobe_marker)
-            {
-                colorTransform = codec.Adobe_transform;
-            }
-
-            // Set the input transform
-            if (colorTransform > -1)
-            {
-                switch (codec.num_components)
-                {
-                    case 3:
-                    {
-                        codec.jpeg_color_space = colorTransform ? JCS_YCbCr : JCS_RGB;
-                        break;
-                    }
-
-                    case 4:
-                    {
-                        codec.jpeg_color_space = colorTransform ? JCS_YCCK : JCS_CMYK;
-                        break;
-                    }
-
-                    default:
-                        break;
-                }
-            }
-
-            jpeg_start_decompress(&codec);
-
-            const JDIMENSION rowStride = codec.output_width * codec.output_components;
-            JSAMPARRAY samples = codec.mem->alloc_sarray(reinterpret_cast<j_common_ptr>(&codec), JPOOL_IMAGE, rowStride, 1);
-            JDIMENSION scanLineCount = codec.output_height;
-
-            const unsigned int width = codec.output_width;
-            const unsigned int height = codec.output_height;
-            const unsigned int components = codec.output_components;
-            const unsigned int bitsPerComponent =  8;
-            QByteArray buffer(rowStride * height, 0);
-            JSAMPROW rowData = reinterpret_cast<JSAMPROW>(buffer.data());
-
-            while (scanLineCount)
-            {
-                JDIMENSION readCount = jpeg_read_scanlines(&codec, samples, 1);
-                std::memcpy(rowData, samples[0], rowStride);
-                scanLineCount -= readCount;
-                rowData += rowStride;
-            }
-
-            jpeg_finish_decompress(&codec);
+            const unsigned int bitsPerComponent = 8;
             image.m_imageData = PDFImageData(components, bitsPerComponent, width, height, rowStride, maskingType, qMove(buffer), qMove(mask), qMove(decode), qMove(matte));
         }
-
-        jpeg_destroy_decompress(&codec);
     }
     else if (imageFilterName == "JPXDecode")
     {
@@ -670,13 +1007,12 @@ PDFImage PDFImage::createImage(const PDFDocument* document,
         parameters.damagedRowsBeforeError = loader.readIntegerFromDictionary(filterParamsDictionary, "DamagedRowsBeforeError", 0);
         parameters.decode = !decode.empty() ? qMove(decode) : std::vector<PDFReal>({ 0.0, 1.0 });
 
-        QByteArray imageDataBuffer = document->getDecodedStream(stream);
-        PDFCCITTFaxDecoder decoder(&imageDataBuffer, parameters);
+        PDFCCITTFaxDecoder decoder(&content, parameters);
         image.m_imageData = decoder.decode();
     }
     else if (imageFilterName == "JBIG2Decode")
     {
-        QByteArray data = document->getDecodedStream(stream);
+        QByteArray data = qMove(content);
         QByteArray globalData;
         if (filterParamsDictionary)
         {
@@ -712,8 +1048,8 @@ PDFImage PDFImage::createImage(const PDFDocument* document,
         // Calculate stride
         const unsigned int stride = (components * bitsPerComponent * width + 7) / 8;
 
-        QByteArray imageDataBuffer = document->getDecodedStream(stream);
-        image.m_imageData = PDFImageData(components, bitsPerComponent, width, height, stride, maskingType, qMove(imageDataBuffer), qMove(mask), qMove(decode), qMove(matte));
+        // Image data were already decoded at the beginning, so we reuse them
+        image.m_imageData = PDFImageData(components, bitsPerComponent, width, height, stride, maskingType, qMove(content), qMove(mask), qMove(decode), qMove(matte));
     }
     else if (imageMask)
     {
@@ -737,13 +1073,167 @@ PDFImage PDFImage::createImage(const PDFDocument* document,
         // Calculate stride
         const unsigned int stride = (width + 7) / 8;
 
-        QByteArray imageDataBuffer = document->getDecodedStream(stream);
-        image.m_imageData = PDFImageData(1, bitsPerComponent, width, height, stride, maskingType, qMove(imageDataBuffer), qMove(mask), qMove(decode), qMove(matte));
+        image.m_imageData = PDFImageData(1, bitsPerComponent, width, height, stride, maskingType, qMove(content), qMove(mask), qMove(decode), qMove(matte));
     }
 
     return image;
 }
 
+QImage PDFImage::createImageByBands(const PDFDocument* document,
+                                    const PDFStream* stream,
+                                    PDFColorSpacePointer colorSpace,
+                                    RenderingIntent renderingIntent,
+                                    const PDFCMS* cms,
+                                    PDFRenderErrorReporter* errorReporter)
+{
+    const PDFDictionary* dictionary = stream->getDictionary();
+    PDFDocumentDataLoaderDecorator loader(document);
+
+    // Image masks and images masked by stencil mask or color key mask are decoded as a whole
+    if (!colorSpace || colorSpace->asPatternColorSpace() ||
+        loader.readBooleanFromDictionary(dictionary, "ImageMask", false) ||
+        dictionary->hasKey("Mask") ||
+        dictionary->hasKey("Matte"))
+    {
+        return QImage();
+    }
+
+    PDFObject filterParameters;
+    const PDFImageRowReader::Filter filter = PDFImageRowReader::getFilter(document, dictionary, filterParameters);
+    if (filter == PDFImageRowReader::Filter::Unsupported)
+    {
+        return QImage();
+    }
+
+    const QByteArray* content = stream->getContent();
+    if (content->isEmpty())
+    {
+        throw PDFException(PDFTranslationContext::tr("Image has not data."));
+    }
+
+    renderingIntent = readImageRenderingIntent(loader, dictionary, renderingIntent);
+    PDFImageBandConverter converter(colorSpace.data(), loader.readNumberArrayFromDictionary(dictionary, "Decode"), renderingIntent, cms, errorReporter);
+
+    // Soft mask is decoded together with the image, if it has the same size as the image
+    // and its data can be read row by row. Otherwise, image is decoded as a whole.
+    std::unique_ptr<PDFImageRowReader> softMaskReader;
+    unsigned int softMaskWidth = 0;
+    unsigned int softMaskHeight = 0;
+    if (dictionary->hasKey("SMask"))
+    {
+        const PDFObject& softMaskObject = document->getObject(dictionary->get("SMask"));
+        if (!softMaskObject.isStream())
+        {
+            return QImage();
+        }
+
+        const PDFStream* softMaskStream = softMaskObject.getStream();
+        const PDFDictionary* softMaskDictionary = softMaskStream->getDictionary();
+        if (loader.readBooleanFromDictionary(softMaskDictionary, "ImageMask", false) ||
+            softMaskDictionary->hasKey("Mask") ||
+            softMaskDictionary->hasKey("SMask") ||
+            softMaskStream->getContent()->isEmpty())
+        {
+            return QImage();
+        }
+
+        const unsigned int softMaskBitsPerComponent = static_cast<unsigned int>(loader.readIntegerFromDictionary(softMaskDictionary, "BitsPerComponent", 8));
+        softMaskWidth = static_cast<unsigned int>(loader.readIntegerFromDictionary(softMaskDictionary, "Width", 0));
+        softMaskHeight = static_cast<unsigned int>(loader.readIntegerFromDictionary(softMaskDictionary, "Height", 0));
+        if (softMaskBitsPerComponent < 1 || softMaskBitsPerComponent > 32 || softMaskWidth == 0 || softMaskHeight == 0)
+        {
+            return QImage();
+        }
+
+        PDFObject softMaskFilterParameters;
+        const PDFImageRowReader::Filter softMaskFilter = PDFImageRowReader::getFilter(document, softMaskDictionary, softMaskFilterParameters);
+        const unsigned int softMaskStride = (softMaskBitsPerComponent * softMaskWidth + 7) / 8;
+        softMaskReader = PDFImageRowReader::create(document, softMaskStream->getContent(), softMaskFilter, softMaskFilterParameters, softMaskStride);
+        if (!softMaskReader)
+        {
+            return QImage();
+        }
+
+        converter.setSoftMask(softMaskBitsPerComponent, softMaskStride, loader.readNumberArrayFromDictionary(softMaskDictionary, "Decode"), loader.readNumberArrayFromDictionary(softMaskDictionary, "Matte"));
+    }
+
+    if (filter == PDFImageRowReader::Filter::DCT)
+    {
+        const int colorTransform = loader.readIntegerFromDictionary(dictionary, "ColorTransform", -1);
+        unsigned int rowStride = 0;
+
+        auto startDecoding = [&](unsigned int width, unsigned int height, unsigned int components)
+        {
+            if (softMaskReader && (width != softMaskWidth || height != softMaskHeight))
+            {
+                // Soft mask must be scaled to the image size
+                return false;
+            }
+
+            rowStride = width * components;
+            converter.begin(components, 8, width, height, rowStride);
+            return true;
+        };
+
+        auto decodeRow = [&](const unsigned char* row)
+        {
+            std::memcpy(converter.getNextRow(), row, rowStride);
+
+            if (softMaskReader)
+            {
+                softMaskReader->readRow(converter.getSoftMaskRow());
+            }
+        };
+
+        if (!decodeDCTImage(*content, colorTransform, errorReporter, startDecoding, decodeRow))
+        {
+            return QImage();
+        }
+
+        return converter.finish();
+    }
+
+    const unsigned int components = static_cast<unsigned int>(colorSpace->getColorComponentCount());
+    const unsigned int bitsPerComponent = static_cast<unsigned int>(loader.readIntegerFromDictionary(dictionary, "BitsPerComponent", 8));
+    const unsigned int width = static_cast<unsigned int>(loader.readIntegerFromDictionary(dictionary, "Width", 0));
+    const unsigned int height = static_cast<unsigned int>(loader.readIntegerFromDictionary(dictionary, "Height", 0));
+
+    if (bitsPerComponent < 1 || bitsPerComponent > 32)
+    {
+        throw PDFRendererException(RenderErrorType::Error, PDFTranslationContext::tr("Invalid number of bits per component (%1).").arg(bitsPerComponent));
+    }
+
+    if (width == 0 || height == 0)
+    {
+        throw PDFRendererException(RenderErrorType::Error, PDFTranslationContext::tr("Invalid size of image (%1x%2)").arg(width).arg(height));
+    }
+
+    if (softMaskReader && (width != softMaskWidth || height != softMaskHeight))
+    {
+        // Soft mask must be scaled to the image size
+        return QImage();
+    }
+
+    const unsigned int stride = (components * bitsPerComponent * width + 7) / 8;
+    std::unique_ptr<PDFImageRowReader> reader = PDFImageRowReader::create(document, content, filter, filterParameters, stride);
+    if (!reader)
+    {
+        return QImage();
+    }
+
+    converter.begin(components, bitsPerComponent, width, height, stride);
+    for (unsigned int i = 0; i < height; ++i)
+    {
+        reader->readRow(converter.getNextRow());
+
+        if (softMaskReader)
+        {
+            softMaskReader->readRow(converter.getSoftMaskRow());
+        }
+    }
+    return converter.finish();
+}
+
 QImage PDFImage::getImage(const PDFCMS* cms, PDFRenderErrorReporter* reporter) const
 {
     const bool isImageMask = m_imageData.getMaskingType() == PDFImageData::MaskingType::ImageMask;
@@ -72,6 +72,29 @@ public:
                                 RenderingIntent renderingIntent,
                                 PDFRenderErrorReporter* errorReporter);
 
+    /// Creates image directly from the image stream. Image stream is decoded
+    /// band by band and each band is converted to the scanlines of the resulting
+    /// image, so decoded data of the whole image are never held in memory. Only
+    /// images not compressed, or compressed by single FlateDecode (without predictor
+    /// or with PNG predictor) or DCTDecode filter, are supported. Image can have soft
+    /// mask of the same size, which is not compressed, or compressed by FlateDecode,
+    /// soft mask is then decoded together with the image. Images with other masks
+    /// are not supported.
+    /// If image can't be decoded this way, null image is returned and image must
+    /// be created using \p createImage. If error occurs, exception is thrown.
+    /// \param document Document
+    /// \param stream Stream with image
+    /// \param colorSpace Color space of the image
+    /// \param renderingIntent Default rendering intent of the image
+    /// \param cms Color management system
+    /// \param errorReporter Error reporter for reporting errors (or warnings)
+    static QImage createImageByBands(const PDFDocument* document,
+                                     const PDFStream* stream,
+                                     PDFColorSpacePointer colorSpace,
+                                     RenderingIntent renderingIntent,
+                                     const PDFCMS* cms,
+                                     PDFRenderErrorReporter* errorReporter);
+
     /// Returns image transformed from image data and color space
     QImage getImage(const PDFCMS* cms, PDFRenderErrorReporter* reporter) const;
 
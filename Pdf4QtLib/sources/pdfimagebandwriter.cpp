@@ -0,0 +1,481 @@
+//    Copyright (C) 2021 Jakub Melka
+//
+//    This file is part of PDF4QT.
+//
+//    PDF4QT is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    with the written consent of the copyright owner, any later version.
+//
+//    PDF4QT is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public License
+//    along with PDF4QT.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "pdfimagebandwriter.h"
+
+#include <zlib.h>
+
+#include <array>
+#include <algorithm>
+
+namespace pdf
+{
+
+/// Writes PNG image (8-bit RGB, non-interlaced). Rows are filtered
+/// using Sub filter and compressed using single deflate stream, which
+/// is split into IDAT chunks.
+class PDFPNGBandWriter : public PDFImageBandWriter
+{
+public:
+    explicit PDFPNGBandWriter(const QString& fileName, int compression, int quality);
+    virtual ~PDFPNGBandWriter() override;
+
+protected:
+    virtual bool writeHeader() override;
+    virtual bool writeRow(const QRgb* row) override;
+    virtual bool writeTrailer() override;
+
+private:
+    static constexpr int IDAT_CHUNK_SIZE = 256 * 1024;
+
+    /// Compresses data and appends compressed data to the pending IDAT data
+    bool compress(const QByteArray& data, int flush);
+
+    /// Writes PNG chunk (length, type, data and CRC)
+    bool writeChunk(const char* type, const QByteArray& data);
+
+    static void appendUInt32(QByteArray& data, quint32 value);
+
+    /// Returns zlib compression level from image writer settings, in the same
+    /// way as Qt's PNG image handler does (compression has priority over quality).
+    static int getCompressionLevel(int compression, int quality);
+
+    int m_compression;
+    bool m_isStreamInitialized = false;
+    z_stream m_stream = { };
+    std::array<Bytef, 16384> m_outputBuffer = { };
+    QByteArray m_rowData;
+    QByteArray m_compressedData;
+};
+
+/// Writes binary PBM (P4), PGM (P5) or PPM (P6) image
+class PDFPNMBandWriter : public PDFImageBandWriter
+{
+public:
+    enum class Type
+    {
+        PBM,
+        PGM,
+        PPM
+    };
+
+    explicit PDFPNMBandWriter(const QString& fileName, Type type);
+
+protected:
+    virtual bool writeHeader() override;
+    virtual bool writeRow(const QRgb* row) override;
+    virtual bool writeTrailer() override { return true; }
+
+private:
+    Type m_type;
+    QByteArray m_rowData;
+};
+
+PDFImageBandWriter::PDFImageBandWriter(const QString& fileName) :
+    m_fileName(fileName)
+{
+
+}
+
+PDFImageBandWriter::~PDFImageBandWriter()
+{
+
+}
+
+std::unique_ptr<PDFImageBandWriter> PDFImageBandWriter::create(const QString& fileName, const QByteArray& format, int compression, int quality)
+{
+    const QByteArray lowerCaseFormat = format.toLower();
+
+    if (lowerCaseFormat == "png")
+    {
+        return std::make_unique<PDFPNGBandWriter>(fileName, compression, quality);
+    }
+    if (lowerCaseFormat == "pbm")
+    {
+        return std::make_unique<PDFPNMBandWriter>(fileName, PDFPNMBandWriter::Type::PBM);
+    }
+    if (lowerCaseFormat == "pgm")
+    {
+        return std::make_unique<PDFPNMBandWriter>(fileName, PDFPNMBandWriter::Type::PGM);
+    }
+    if (lowerCaseFormat == "ppm")
+    {
+        return std::make_unique<PDFPNMBandWriter>(fileName, PDFPNMBandWriter::Type::PPM);
+    }
+
+    return nullptr;
+}
+
+bool PDFImageBandWriter::isFormatSupported(const QByteArray& format)
+{
+    const QByteArray lowerCaseFormat = format.toLower();
+    return lowerCaseFormat == "png" || lowerCaseFormat == "pbm" || lowerCaseFormat == "pgm" || lowerCaseFormat == "ppm";
+}
+
+bool PDFImageBandWriter::begin(QSize imageSize)
+{
+    if (imageSize.isEmpty())
+    {
+        return setError(PDFTranslationContext::tr("Invalid image size %1 x %2.").arg(imageSize.width()).arg(imageSize.height()));
+    }
+
+    m_imageSize = imageSize;
+    m_rowsWritten = 0;
+
+    m_file.setFileName(m_fileName);
+    if (!m_file.open(QFile::WriteOnly | QFile::Truncate))
+    {
+        return setError(m_file.errorString());
+    }
+
+    return writeHeader();
+}
+
+bool PDFImageBandWriter::writeBand(const QImage& band)
+{
+    if (!m_file.isOpen() || !m_errorString.isEmpty())
+    {
+        return false;
+    }
+
+    if (band.width() != m_imageSize.width() || m_rowsWritten + band.height() > m_imageSize.height())
+    {
+        return setError(PDFTranslationContext::tr("Image band of size %1 x %2 doesn't fit into the image.").arg(band.width()).arg(band.height()));
+    }
+
+    // Rendered bands have format Format_ARGB32_Premultiplied, but they
+    // are opaque, so color values are the same as in Format_ARGB32.
+    QImage convertedBand;
+    const QImage* bandImage = &band;
+    switch (band.format())
+    {
+        case QImage::Format_RGB32:
+        case QImage::Format_ARGB32:
+        case QImage::Format_ARGB32_Premultiplied:
+            break;
+
+        default:
+            convertedBand = band.convertToFormat(QImage::Format_ARGB32);
+            bandImage = &convertedBand;
+            break;
+    }
+
+    for (int y = 0; y < bandImage->height(); ++y)
+    {
+        if (!writeRow(reinterpret_cast<const QRgb*>(bandImage->constScanLine(y))))
+        {
+            return false;
+        }
+        ++m_rowsWritten;
+    }
+
+    return true;
+}
+
+bool PDFImageBandWriter::finish()
+{
+    if (!m_file.isOpen())
+    {
+        return false;
+    }
+
+    bool result = m_errorString.isEmpty();
+    if (result && m_rowsWritten != m_imageSize.height())
+    {
+        result = setError(PDFTranslationContext::tr("Image is incomplete, %1 of %2 rows were written.").arg(m_rowsWritten).arg(m_imageSize.height()));
+    }
+
+    result = result && writeTrailer();
+    m_file.close();
+    return result;
+}
+
+bool PDFImageBandWriter::writeData(const QByteArray& data)
+{
+    if (m_file.write(data) != data.size())
+    {
+        return setError(m_file.errorString());
+    }
+
+    return true;
+}
+
+bool PDFImageBandWriter::setError(const QString& errorString)
+{
+    if (m_errorString.isEmpty())
+    {
+        m_errorString = errorString;
+    }
+
+    return false;
+}
+
+PDFPNGBandWriter::PDFPNGBandWriter(const QString& fileName, int compression, int quality) :
+    PDFImageBandWriter(fileName),
+    m_compression(getCompressionLevel(compression, quality))
+{
+
+}
+
+PDFPNGBandWriter::~PDFPNGBandWriter()
+{
+    if (m_isStreamInitialized)
+    {
+        deflateEnd(&m_stream);
+    }
+}
+
+bool PDFPNGBandWriter::writeHeader()
+{
+    static constexpr const char PNG_SIGNATURE[] = "\x89PNG\r\n\x1A\n";
+
+    if (!writeData(QByteArray(PNG_SIGNATURE, 8)))
+    {
+        return false;
+    }
+
+    QByteArray header;
+    appendUInt32(header, quint32(m_imageSize.width()));
+    appendUInt32(header, quint32(m_imageSize.height()));
+    header.append(char(8));     // Bit depth
+    header.append(char(2));     // Color type - RGB
+    header.append(char(0));     // Compression method - deflate
+    header.append(char(0));     // Filter method - adaptive filtering
+    header.append(char(0));     // Interlace method - no interlace
+
+    if (!writeChunk("IHDR", header))
+    {
+        return false;
+    }
+
+    if (deflateInit(&m_stream, m_compression) != Z_OK)
+    {
+        return setError(PDFTranslationContext::tr("Failed to initialize flate compression stream."));
+    }
+    m_isStreamInitialized = true;
+
+    m_rowData.resize(1 + 3 * m_imageSize.width());
+    return true;
+}
+
+bool PDFPNGBandWriter::writeRow(const QRgb* row)
+{
+    // Sub filter - each byte is stored as difference from the corresponding
+    // byte of the previous pixel, which usually compresses well for rendered pages.
+    uchar* data = reinterpret_cast<uchar*>(m_rowData.data());
+    *data++ = 1;
+
+    uchar previous[3] = { 0, 0, 0 };
+    for (int x = 0, width = m_imageSize.width(); x < width; ++x)
+    {
+        const uchar current[3] = { uchar(qRed(row[x])), uchar(qGreen(row[x])), uchar(qBlue(row[x])) };
+        for (int i = 0; i < 3; ++i)
+        {
+            *data++ = uchar(current[i] - previous[i]);
+            previous[i] = current[i];
+        }
+    }
+
+    if (!compress(m_rowData, Z_NO_FLUSH))
+    {
+        return false;
+    }
+
+    if (m_compressedData.size() >= IDAT_CHUNK_SIZE)
+    {
+        if (!writeChunk("IDAT", m_compressedData))
+        {
+            return false;
+        }
+        m_compressedData.clear();
+    }
+
+    return true;
+}
+
+bool PDFPNGBandWriter::writeTrailer()
+{
+    if (!compress(QByteArray(), Z_FINISH))
+    {
+        return false;
+    }
+
+    if (!m_compressedData.isEmpty() && !writeChunk("IDAT", m_compressedData))
+    {
+        return false;
+    }
+    m_compressedData.clear();
+
+    return writeChunk("IEND", QByteArray());
+}
+
+bool PDFPNGBandWriter::compress(const QByteArray& data, int flush)
+{
+    Q_ASSERT(m_isStreamInitialized);
+
+    m_stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.constData()));
+    m_stream.avail_in = uInt(data.size());
+
+    int error = Z_OK;
+    do
+    {
+        m_stream.next_out = m_outputBuffer.data();
+        m_stream.avail_out = uInt(m_outputBuffer.size());
+
+        error = deflate(&m_stream, flush);
+        if (error == Z_STREAM_ERROR)
+        {
+            return setError(PDFTranslationContext::tr("Flate compression failed (zlib code: %1).").arg(error));
+        }
+
+        const int bytesWritten = int(m_outputBuffer.size() - m_stream.avail_out);
+        m_compressedData.append(reinterpret_cast<const char*>(m_outputBuffer.data()), bytesWritten);
+    } while (flush == Z_FINISH ? error != Z_STREAM_END : m_stream.avail_out == 0);
+
+    return true;
+}
+
+bool PDFPNGBandWriter::writeChunk(const char* type, const QByteArray& data)
+{
+    QByteArray chunk;
+    chunk.reserve(data.size() + 12);
+    appendUInt32(chunk, quint32(data.size()));
+    chunk.append(type, 4);
+    chunk.append(data);
+
+    // CRC is computed from chunk type and chunk data
+    uLong crc = crc32(0L, Z_NULL, 0);
+    crc = crc32(crc, reinterpret_cast<const Bytef*>(chunk.constData() + 4), uInt(chunk.size() - 4));
+    appendUInt32(chunk, quint32(crc));
+
+    return writeData(chunk);
+}
+
+int PDFPNGBandWriter::getCompressionLevel(int compression, int quality)
+{
+    if (compression >= 0)
+    {
+        compression = qMin(compression, 100);
+    }
+    else if (quality >= 0)
+    {
+        compression = 100 - qMin(quality, 100);
+    }
+
+    if (compression >= 0)
+    {
+        // Map [0, 100] to zlib compression level [0, 9]
+        return (compression * 9) / 91;
+    }
+
+    return Z_DEFAULT_COMPRESSION;
+}
+
+void PDFPNGBandWriter::appendUInt32(QByteArray& data, quint32 value)
+{
+    data.append(char((value >> 24) & 0xFF));
+    data.append(char((value >> 16) & 0xFF));
+    data.append(char((value >> 8) & 0xFF));
+    data.append(char(value & 0xFF));
+}
+
+PDFPNMBandWriter::PDFPNMBandWriter(const QString& fileName, Type type) :
+    PDFImageBandWriter(fileName),
+    m_type(type)
+{
+
+}
+
+bool PDFPNMBandWriter::writeHeader()
+{
+    QByteArray header;
+    switch (m_type)
+    {
+        case Type::PBM:
+            header = QString("P4\n%1 %2\n").arg(m_imageSize.width()).arg(m_imageSize.height()).toLatin1();
+            m_rowData.resize((m_imageSize.width() + 7) / 8);
+            break;
+
+        case Type::PGM:
+            header = QString("P5\n%1 %2\n255\n").arg(m_imageSize.width()).arg(m_imageSize.height()).toLatin1();
+            m_rowData.resize(m_imageSize.width());
+            break;
+
+        case Type::PPM:
+            header = QString("P6\n%1 %2\n255\n").arg(m_imageSize.width()).arg(m_imageSize.height()).toLatin1();
+            m_rowData.resize(3 * m_imageSize.width());
+            break;
+
+        default:
+            Q_ASSERT(false);
+            break;
+    }
+
+    return writeData(header);
+}
+
+bool PDFPNMBandWriter::writeRow(const QRgb* row)
+{
+    uchar* data = reinterpret_cast<uchar*>(m_rowData.data());
+    const int width = m_imageSize.width();
+
+    switch (m_type)
+    {
+        case Type::PBM:
+        {
+            // Threshold is used instead of dithering, because dithering
+            // error can't be propagated across band boundaries.
+            std::fill(m_rowData.begin(), m_rowData.end(), 0);
+            for (int x = 0; x < width; ++x)
+            {
+                if (qGray(row[x]) < 128)
+                {
+                    data[x / 8] |= uchar(0x80 >> (x % 8));
+                }
+            }
+            break;
+        }
+
+        case Type::PGM:
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                data[x] = uchar(qGray(row[x]));
+            }
+            break;
+        }
+
+        case Type::PPM:
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                *data++ = uchar(qRed(row[x]));
+                *data++ = uchar(qGreen(row[x]));
+                *data++ = uchar(qBlue(row[x]));
+            }
+            break;
+        }
+
+        default:
+            Q_ASSERT(false);
+            break;
+    }
+
+    return writeData(m_rowData);
+}
+
+}   // namespace pdf
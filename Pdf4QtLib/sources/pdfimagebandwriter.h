@@ -0,0 +1,101 @@
+//    Copyright (C) 2021 Jakub Melka
+//
+//    This file is part of PDF4QT.
+//
+//    PDF4QT is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    with the written consent of the copyright owner, any later version.
+//
+//    PDF4QT is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public License
+//    along with PDF4QT.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef PDFIMAGEBANDWRITER_H
+#define PDFIMAGEBANDWRITER_H
+
+#include "pdfglobal.h"
+
+#include <QFile>
+#include <QImage>
+
+#include <memory>
+
+namespace pdf
+{
+
+/// Writes image to the file band by band (horizontal strips, from top to bottom),
+/// so whole image doesn't need to be held in memory. Only formats, which can be
+/// encoded scanline by scanline, are supported (PNG, PBM, PGM, PPM). Image is
+/// supposed to be opaque (alpha channel is not written). Usage: call \p begin
+/// with image size, then \p writeBand for each band, and then \p finish.
+class PDF4QTLIBSHARED_EXPORT PDFImageBandWriter
+{
+public:
+    explicit PDFImageBandWriter(const QString& fileName);
+    virtual ~PDFImageBandWriter();
+
+    /// Creates band writer for given format. If format can't be written
+    /// band by band, then nullptr is returned.
+    /// \param fileName File name
+    /// \param format Image format (for example, "png")
+    /// \param compression Compression (0-100, as in QImageWriter), negative value means not set
+    /// \param quality Quality (0-100, as in QImageWriter), negative value means not set
+    static std::unique_ptr<PDFImageBandWriter> create(const QString& fileName, const QByteArray& format, int compression, int quality);
+
+    /// Returns true, if image of given format can be written band by band
+    /// \param format Image format
+    static bool isFormatSupported(const QByteArray& format);
+
+    /// Opens the file and writes image header. Returns false, if error occurs.
+    /// \param imageSize Size of the whole image
+    bool begin(QSize imageSize);
+
+    /// Writes band of the image. Band must have the same width as the image,
+    /// and bands must be written from top to bottom. Returns false, if error occurs.
+    /// \param band Band image
+    bool writeBand(const QImage& band);
+
+    /// Finishes writing of the image and closes the file. Returns false,
+    /// if error occurs, or not all image rows were written.
+    bool finish();
+
+    /// Returns file name
+    const QString& getFileName() const { return m_fileName; }
+
+    /// Returns error string (if error occured)
+    const QString& getErrorString() const { return m_errorString; }
+
+protected:
+    /// Writes image header
+    virtual bool writeHeader() = 0;
+
+    /// Writes one image row. Row has ARGB32 format and has image width.
+    /// \param row Row data
+    virtual bool writeRow(const QRgb* row) = 0;
+
+    /// Writes image trailer (after all rows are written)
+    virtual bool writeTrailer() = 0;
+
+    /// Writes data to the file, returns false, if error occurs
+    /// \param data Data
+    bool writeData(const QByteArray& data);
+
+    /// Sets error string, returns false
+    /// \param errorString Error string
+    bool setError(const QString& errorString);
+
+    QFile m_file;
+    QString m_fileName;
+    QString m_errorString;
+    QSize m_imageSize;
+    int m_rowsWritten = 0;
+};
+
+}   // namespace pdf
+
+#endif // PDFIMAGEBANDWRITER_H
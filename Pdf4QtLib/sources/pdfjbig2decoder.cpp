@@ -435,6 +435,58 @@ struct PDFJBIG2SymbolDictionaryDecodingParameters
     std::vector<int32_t> SDNEWSYMWIDTHS;
 };
 
+/// Sliding window over single row of the bitmap. It is used to compute contexts
+/// of the arithmetic decoder incrementally, so each pixel of the row is read only once
+/// (instead of reading all template pixels for each decoded pixel). Window contains
+/// last \p bitCount pixels of the row, the rightmost pixel is in the lowest bit.
+/// Pixels outside of the bitmap are zero.
+class PDFJBIG2BitmapRowWindow
+{
+public:
+    /// Creates window over the row \p y of the bitmap. After first call of \p advance,
+    /// window will contain pixels [x + lead - bitCount + 1, x + lead].
+    /// \param bitmap Bitmap
+    /// \param y Row index (can be outside of the bitmap)
+    /// \param x Position of the first pixel
+    /// \param lead How many pixels is window ahead of the current pixel
+    /// \param bitCount Window size in bits
+    explicit inline PDFJBIG2BitmapRowWindow(const PDFJBIG2Bitmap* bitmap, int y, int x, int lead, int bitCount) :
+        m_row((y >= 0 && y < bitmap->getHeight()) ? bitmap->getRow(y) : nullptr),
+        m_width(bitmap->getWidth()),
+        m_position(x + lead - bitCount + 1),
+        m_window(0),
+        m_mask((1 << bitCount) - 1)
+    {
+        for (int i = 1; i < bitCount; ++i)
+        {
+            advance();
+        }
+    }
+
+    /// Moves window by one pixel to the right
+    inline void advance()
+    {
+        uint32_t bit = 0;
+        if (m_row && m_position >= 0 && m_position < m_width)
+        {
+            bit = (m_row[m_position >> 3] >> (7 - (m_position & 0x07))) & 0x01;
+        }
+
+        m_window = ((m_window << 1) | bit) & m_mask;
+        ++m_position;
+    }
+
+    /// Returns pixels in the window
+    inline uint32_t get() const { return m_window; }
+
+private:
+    const uint8_t* m_row;
+    int m_width;
+    int m_position;
+    uint32_t m_window;
+    uint32_t m_mask;
+};
+
 static constexpr PDFJBIG2HuffmanTableEntry PDFJBIG2StandardHuffmanTable_A[] =
 {
     {     0, 1,  4,   0b0, PDFJBIG2HuffmanTableEntry::Type::Standard},
@@ -1118,21 +1170,27 @@ PDFImageData PDFJBIG2Decoder::decode(PDFImageData::MaskingType maskingType)
 
     if (m_pageBitmap.isValid())
     {
-        PDFBitWriter writer(1);
-
         const int columns = m_pageBitmap.getWidth();
         const int rows = m_pageBitmap.getHeight();
+        const int stride = m_pageBitmap.getStride();
 
+        // Page bitmap has the same layout as image data, we only invert the pixels
+        // (and keep the padding bits at the end of the row zero).
+        const uint8_t lastByteMask = static_cast<uint8_t>(0xFF << (stride * 8 - columns));
+        QByteArray imageData(stride * rows, 0);
+        uint8_t* targetData = reinterpret_cast<uint8_t*>(imageData.data());
         for (int row = 0; row < rows; ++row)
         {
-            for (int column = 0; column < columns; ++column)
+            const uint8_t* sourceRow = m_pageBitmap.getRow(row);
+            uint8_t* targetRow = targetData + row * stride;
+            for (int i = 0; i < stride; ++i)
             {
-                writer.write(!m_pageBitmap.getPixel(column, row));
+                targetRow[i] = ~sourceRow[i];
             }
-            writer.finishLine();
+            targetRow[stride - 1] &= lastByteMask;
         }
 
-        return PDFImageData(1, 1, static_cast<uint32_t>(columns), static_cast<uint32_t>(rows), static_cast<uint32_t>((columns + 7) / 8), maskingType, writer.takeByteArray(), { }, { }, { });
+        return PDFImageData(1, 1, static_cast<uint32_t>(columns), static_cast<uint32_t>(rows), static_cast<uint32_t>(stride), maskingType, qMove(imageData), { }, { }, { });
     }
 
     return PDFImageData();
@@ -2380,7 +2438,8 @@ void PDFJBIG2Decoder::processHalftoneRegion(const PDFJBIG2SegmentHeader& header)
     parameters.arithmeticDecoderState = &genericState;
     parameters.data = qMove(mmrData);
 
-    PDFJBIG2Bitmap GI(HGW, HGH, 0x00);
+    // Grayscale image, one byte per pixel (HBPP is at most 8)
+    std::vector<uint8_t> GI(HGW * HGH, 0x00);
     for (int J = HBPP - 1; J >= 0; --J)
     {
         PDFJBIG2Bitmap PLANE = readBitmap(parameters);
@@ -2412,14 +2471,14 @@ void PDFJBIG2Decoder::processHalftoneRegion(const PDFJBIG2SegmentHeader& header)
             throw PDFException(PDFTranslationContext::tr("JBIG2 invalid halftone grayscale bit plane image."));
         }
 
-        for (int x = 0; x < static_cast<int>(HGW); ++x)
+        for (int y = 0; y < static_cast<int>(HGH); ++y)
         {
-            for (int y = 0; y < static_cast<int>(HGH); ++y)
+            for (int x = 0; x < static_cast<int>(HGW); ++x)
             {
                 // Old bit is in the first position of grayscale image
-                const uint8_t oldPixel = GI.getPixel(x, y);
-                const uint8_t bit = (oldPixel ^ PLANE.getPixel(x, y)) & 0x01;
-                GI.setPixel(x, y, (oldPixel << 1) | bit);
+                uint8_t& pixel = GI[y * HGW + x];
+                const uint8_t bit = (pixel ^ PLANE.getBit(x, y)) & 0x01;
+                pixel = (pixel << 1) | bit;
             }
         }
     }
@@ -2434,7 +2493,7 @@ void PDFJBIG2Decoder::processHalftoneRegion(const PDFJBIG2SegmentHeader& header)
             const int y = (static_cast<int>(HGY) + MG * static_cast<int>(HRX) - NG * static_cast<int>(HRY)) / 256;
 
             /* 6.6.5.1 1) a) ii) */
-            const uint8_t index = GI.getPixel(NG, MG);
+            const uint8_t index = GI[MG * HGW + NG];
             if (Q_UNLIKELY(index >= HNUMPATS))
             {
                 throw PDFException(PDFTranslationContext::tr("JBIG2 halftoning pattern index %1 out of bounds [0, %2]").arg(index).arg(HNUMPATS));
@@ -2864,17 +2923,20 @@ PDFJBIG2Bitmap PDFJBIG2Decoder::readBitmap(PDFJBIG2BitmapDecodingParameters& par
 
         PDFJBIG2Bitmap bitmap(data.getWidth(), data.getHeight(), m_pageDefaultPixelValue);
 
-        // Copy the data
-        PDFBitReader reader(&data.getData(), data.getBitsPerComponent());
+        // Copy the data, decoded data have the same layout as bitmap, but they are inverted
+        Q_ASSERT(data.getBitsPerComponent() == 1);
+        const int stride = qMin(bitmap.getStride(), static_cast<int>(data.getStride()));
+        const uint8_t* sourceData = reinterpret_cast<const uint8_t*>(data.getData().constData());
         for (unsigned int row = 0; row < data.getHeight(); ++row)
         {
-            for (unsigned int column = 0; column < data.getWidth(); ++column)
+            const uint8_t* sourceRow = sourceData + row * data.getStride();
+            uint8_t* targetRow = bitmap.getRow(row);
+            for (int i = 0; i < stride; ++i)
             {
-                bitmap.setPixel(column, row, (reader.read()) ? 0x00 : 0xFF);
+                targetRow[i] = ~sourceRow[i];
             }
-
-            reader.alignToBytes();
         }
+        bitmap.clearPadding();
 
         return bitmap;
     }
@@ -2984,6 +3046,14 @@ PDFJBIG2Bitmap PDFJBIG2Decoder::readBitmap(PDFJBIG2BitmapDecodingParameters& par
         PDFJBIG2ArithmeticDecoder& decoder = *parameters.arithmeticDecoder;
 
         PDFJBIG2Bitmap bitmap(parameters.GBW, parameters.GBH, 0x00);
+        const PDFJBIG2ATPositions& GBAT = parameters.GBAT;
+
+        // Returns bit of the adaptative template pixel
+        auto getATBit = [&bitmap](int x, int y, const PDFJBIG2ATPosition& position) -> uint32_t
+        {
+            return bitmap.getBitSafe(x + position.x, y + position.y);
+        };
+
         for (int y = 0; y < parameters.GBH; ++y)
         {
             // Check TPGDON prediction - if we use same pixels as in previous line
@@ -3000,147 +3070,164 @@ PDFJBIG2Bitmap PDFJBIG2Decoder::readBitmap(PDFJBIG2BitmapDecodingParameters& par
                 }
             }
 
+            // Pixel context is composed from three parts - pixels from current row (already
+            // decoded pixels on the left side of the current pixel), pixels from previous two
+            // rows and adaptative template pixels. Pixels from rows are maintained
+            // in sliding windows, so they are not read for every pixel.
+            int line1Lead = 0;
+            int line1Bits = 0;
+            int line2Lead = 0;
+            int line2Bits = 0;
+            uint32_t line0Mask = 0;
+
+            switch (parameters.GBTEMPLATE)
+            {
+                case 0:
+                {
+                    //  Figure 8. Reused context for coding the SLTP value
+                    //
+                    //          ┌───┬───┬───┬───┬───┐
+                    //          │A15│ 14│ 13│ 12│A11│
+                    //      ┌───┼───┼───┼───┼───┼───┼───┐
+                    //      │A10│ 9 │ 8 │ 7 │ 6 │ 5 │A4 │
+                    //  ┌───┼───┼───┼───┼───┼───┴───┴───┘
+                    //  │ 3 │ 2 │ 1 │ 0 │ X │
+                    //  └───┴───┴───┴───┴───┘
+                    line1Lead = 2;
+                    line1Bits = 5;
+                    line2Lead = 1;
+                    line2Bits = 3;
+                    line0Mask = 0x0F;
+                    break;
+                }
+
+                case 1:
+                {
+                    //  Figure 9. Reused context for coding the SLTP value
+                    //
+                    //          ┌───┬───┬───┬───┐
+                    //          │ 12│ 11│ 10│ 9 │
+                    //      ┌───┼───┼───┼───┼───┼───┐
+                    //      │ 8 │ 7 │ 6 │ 5 │ 4 │A3 │
+                    //  ┌───┼───┼───┼───┼───┴───┴───┘
+                    //  │ 2 │ 1 │ 0 │ x │
+                    //  └───┴───┴───┴───┘
+                    line1Lead = 2;
+                    line1Bits = 5;
+                    line2Lead = 2;
+                    line2Bits = 4;
+                    line0Mask = 0x07;
+                    break;
+                }
+
+                case 2:
+                {
+                    //  Figure 10. Reused context for coding the SLTP value
+                    //
+                    //          ┌───┬───┬───┐
+                    //          │ 9 │ 8 │ 7 │
+                    //      ┌───┼───┼───┼───┼───┐
+                    //      │ 6 │ 5 │ 4 │ 3 │A2 │
+                    //      ├───┼───┼───┼───┴───┘
+                    //      │ 1 │ 0 │ x │
+                    //      └───┴───┴───┘
+                    line1Lead = 1;
+                    line1Bits = 4;
+                    line2Lead = 1;
+                    line2Bits = 3;
+                    line0Mask = 0x03;
+                    break;
+                }
+
+                case 3:
+                {
+                    //  Figure 11. Reused context for coding the SLTP value
+                    //
+                    //          ┌───┬───┬───┬───┬───┬───┐
+                    //          │ 9 │ 8 │ 7 │ 6 │ 5 │A4 │
+                    //      ┌───┼───┼───┼───┼───┼───┴───┘
+                    //      │ 3 │ 2 │ 1 │ 0 │ x │
+                    //      └───┴───┴───┴───┴───┘
+                    line1Lead = 1;
+                    line1Bits = 5;
+                    line0Mask = 0x0F;
+                    break;
+                }
+
+                default:
+                {
+                    Q_ASSERT(false);
+                    break;
+                }
+            }
+
+            PDFJBIG2BitmapRowWindow line1(&bitmap, y - 1, 0, line1Lead, line1Bits);
+            PDFJBIG2BitmapRowWindow line2(&bitmap, y - 2, 0, line2Lead, line2Bits);
+            uint32_t line0 = 0;
+
             for (int x = 0; x < parameters.GBW; ++x)
             {
+                line1.advance();
+                line2.advance();
+
                 // Check, if we have to skip pixel. Pixel should be set to 0, but it is done
                 // in the initialization of the bitmap.
                 if (parameters.SKIP && parameters.SKIP->getPixelSafe(x, y))
                 {
+                    line0 = (line0 << 1) & line0Mask;
                     continue;
                 }
 
-                uint16_t pixelContext = 0;
-                uint16_t pixelContextShift = 0;
-                auto createContextBit = [&](int offsetX, int offsetY)
-                {
-                    uint16_t bit = bitmap.getPixelSafe(offsetX, offsetY) ? 1 : 0;
-                    bit = bit << pixelContextShift;
-                    pixelContext |= bit;
-                    ++pixelContextShift;
-                };
-
-                // Create pixel context based on used template
+                // Create pixel context based on used template (we fill context bits
+                // from the lowest bit, see figures above).
+                uint32_t pixelContext = 0;
                 switch (parameters.GBTEMPLATE)
                 {
                     case 0:
-                    {
-                        //  Figure 8. Reused context for coding the SLTP value
-                        //
-                        //          ┌───┬───┬───┬───┬───┐
-                        //          │A15│ 14│ 13│ 12│A11│
-                        //      ┌───┼───┼───┼───┼───┼───┼───┐
-                        //      │A10│ 9 │ 8 │ 7 │ 6 │ 5 │A4 │
-                        //  ┌───┼───┼───┼───┼───┼───┴───┴───┘
-                        //  │ 3 │ 2 │ 1 │ 0 │ X │
-                        //  └───┴───┴───┴───┴───┘
-
                         // 16-bit context
-                        createContextBit(x - 1, y);
-                        createContextBit(x - 2, y);
-                        createContextBit(x - 3, y);
-                        createContextBit(x - 4, y);
-                        createContextBit(x + parameters.GBAT[0].x, y + parameters.GBAT[0].y);
-                        createContextBit(x + 2, y - 1);
-                        createContextBit(x + 1, y - 1);
-                        createContextBit(x + 0, y - 1);
-                        createContextBit(x - 1, y - 1);
-                        createContextBit(x - 2, y - 1);
-                        createContextBit(x + parameters.GBAT[1].x, y + parameters.GBAT[1].y);
-                        createContextBit(x + parameters.GBAT[2].x, y + parameters.GBAT[2].y);
-                        createContextBit(x + 1, y - 2);
-                        createContextBit(x + 0, y - 2);
-                        createContextBit(x - 1, y - 2);
-                        createContextBit(x + parameters.GBAT[3].x, y + parameters.GBAT[3].y);
+                        pixelContext = line0 |
+                                       (getATBit(x, y, GBAT[0]) << 4) |
+                                       (line1.get() << 5) |
+                                       (getATBit(x, y, GBAT[1]) << 10) |
+                                       (getATBit(x, y, GBAT[2]) << 11) |
+                                       (line2.get() << 12) |
+                                       (getATBit(x, y, GBAT[3]) << 15);
                         break;
-                    }
 
                     case 1:
-                    {
-                        //  Figure 9. Reused context for coding the SLTP value
-                        //
-                        //          ┌───┬───┬───┬───┐
-                        //          │ 12│ 11│ 10│ 9 │
-                        //      ┌───┼───┼───┼───┼───┼───┐
-                        //      │ 8 │ 7 │ 6 │ 5 │ 4 │A3 │
-                        //  ┌───┼───┼───┼───┼───┴───┴───┘
-                        //  │ 2 │ 1 │ 0 │ x │
-                        //  └───┴───┴───┴───┘
-
                         // 13-bit context
-                        createContextBit(x - 1, y);
-                        createContextBit(x - 2, y);
-                        createContextBit(x - 3, y);
-                        createContextBit(x + parameters.GBAT[0].x, y + parameters.GBAT[0].y);
-                        createContextBit(x + 2, y - 1);
-                        createContextBit(x + 1, y - 1);
-                        createContextBit(x + 0, y - 1);
-                        createContextBit(x - 1, y - 1);
-                        createContextBit(x - 2, y - 1);
-                        createContextBit(x + 2, y - 2);
-                        createContextBit(x + 1, y - 2);
-                        createContextBit(x + 0, y - 2);
-                        createContextBit(x - 1, y - 2);
+                        pixelContext = line0 |
+                                       (getATBit(x, y, GBAT[0]) << 3) |
+                                       (line1.get() << 4) |
+                                       (line2.get() << 9);
                         break;
-                    }
 
                     case 2:
-                    {
-                        //  Figure 10. Reused context for coding the SLTP value
-                        //
-                        //          ┌───┬───┬───┐
-                        //          │ 9 │ 8 │ 7 │
-                        //      ┌───┼───┼───┼───┼───┐
-                        //      │ 6 │ 5 │ 4 │ 3 │A2 │
-                        //      ├───┼───┼───┼───┴───┘
-                        //      │ 1 │ 0 │ x │
-                        //      └───┴───┴───┘
-
                         // 10-bit context
-                        createContextBit(x - 1, y);
-                        createContextBit(x - 2, y);
-                        createContextBit(x + parameters.GBAT[0].x, y + parameters.GBAT[0].y);
-                        createContextBit(x + 1, y - 1);
-                        createContextBit(x + 0, y - 1);
-                        createContextBit(x - 1, y - 1);
-                        createContextBit(x - 2, y - 1);
-                        createContextBit(x + 1, y - 2);
-                        createContextBit(x + 0, y - 2);
-                        createContextBit(x - 1, y - 2);
+                        pixelContext = line0 |
+                                       (getATBit(x, y, GBAT[0]) << 2) |
+                                       (line1.get() << 3) |
+                                       (line2.get() << 7);
                         break;
-                    }
 
                     case 3:
-                    {
-                        //  Figure 11. Reused context for coding the SLTP value
-                        //
-                        //          ┌───┬───┬───┬───┬───┬───┐
-                        //          │ 9 │ 8 │ 7 │ 6 │ 5 │A4 │
-                        //      ┌───┼───┼───┼───┼───┼───┴───┘
-                        //      │ 3 │ 2 │ 1 │ 0 │ x │
-                        //      └───┴───┴───┴───┴───┘
-
                         // 10-bit context
-                        createContextBit(x - 1, y);
-                        createContextBit(x - 2, y);
-                        createContextBit(x - 3, y);
-                        createContextBit(x - 4, y);
-                        createContextBit(x + parameters.GBAT[0].x, y + parameters.GBAT[0].y);
-                        createContextBit(x + 1, y - 1);
-                        createContextBit(x + 0, y - 1);
-                        createContextBit(x - 1, y - 1);
-                        createContextBit(x - 2, y - 1);
-                        createContextBit(x - 3, y - 1);
+                        pixelContext = line0 |
+                                       (getATBit(x, y, GBAT[0]) << 4) |
+                                       (line1.get() << 5);
                         break;
-                    }
 
                     default:
-                    {
                         Q_ASSERT(false);
                         break;
-                    }
                 }
 
-                bitmap.setPixel(x, y, (decoder.readBit(pixelContext, parameters.arithmeticDecoderState)) ? 0xFF : 0x00);
+                const uint32_t bit = decoder.readBit(pixelContext, parameters.arithmeticDecoderState);
+                if (bit)
+                {
+                    bitmap.setPixel(x, y, 0xFF);
+                }
+                line0 = ((line0 << 1) | bit) & line0Mask;
             }
         }
 
@@ -3162,78 +3249,7 @@ PDFJBIG2Bitmap PDFJBIG2Decoder::readRefinementBitmap(PDFJBIG2BitmapRefinementDec
     const uint32_t LTPContext = !parameters.GRTEMPLATE ? 0b0000100000000 : 0b0010000000;
 
     PDFJBIG2ArithmeticDecoder& decoder = *parameters.decoder;
-
-    auto createContext = [&](int x, int y) -> uint16_t
-    {
-        uint16_t pixelContext = 0;
-        uint16_t pixelContextShift = 0;
-        auto createContextBit = [&](const PDFJBIG2Bitmap* bitmap, int offsetX, int offsetY)
-        {
-            uint16_t bit = bitmap->getPixelSafe(offsetX, offsetY) ? 1 : 0;
-            bit = bit << pixelContextShift;
-            pixelContext |= bit;
-            ++pixelContextShift;
-        };
-
-        if (!parameters.GRTEMPLATE)
-        {
-            // 13-bit context
-            createContextBit(&GRREG, x - 1, y);
-            createContextBit(&GRREG, x + 1, y - 1);
-            createContextBit(&GRREG, x + 0, y - 1);
-            createContextBit(&GRREG, x + parameters.GRAT[0].x, y + parameters.GRAT[0].y);
-
-            const int refX = x - parameters.GRREFERENCEX;
-            const int refY = y - parameters.GRREFERENCEY;
-
-            createContextBit(parameters.GRREFERENCE, refX + 1, refY + 1);
-            createContextBit(parameters.GRREFERENCE, refX + 0, refY + 1);
-            createContextBit(parameters.GRREFERENCE, refX - 1, refY + 1);
-            createContextBit(parameters.GRREFERENCE, refX + 1, refY + 0);
-            createContextBit(parameters.GRREFERENCE, refX + 0, refY + 0);
-            createContextBit(parameters.GRREFERENCE, refX - 1, refY + 0);
-            createContextBit(parameters.GRREFERENCE, refX + 1, refY - 1);
-            createContextBit(parameters.GRREFERENCE, refX + 0, refY - 1);
-            createContextBit(parameters.GRREFERENCE, refX + parameters.GRAT[1].x, refY + parameters.GRAT[1].y);
-        }
-        else
-        {
-            // 10-bit context
-            createContextBit(&GRREG, x - 1, y);
-            createContextBit(&GRREG, x + 1, y - 1);
-            createContextBit(&GRREG, x + 0, y - 1);
-            createContextBit(&GRREG, x - 1, y - 1);
-
-            const int refX = x - parameters.GRREFERENCEX;
-            const int refY = y - parameters.GRREFERENCEY;
-
-            createContextBit(parameters.GRREFERENCE, refX + 1, refY + 1);
-            createContextBit(parameters.GRREFERENCE, refX + 0, refY + 1);
-            createContextBit(parameters.GRREFERENCE, refX + 1, refY + 0);
-            createContextBit(parameters.GRREFERENCE, refX + 0, refY + 0);
-            createContextBit(parameters.GRREFERENCE, refX - 1, refY + 0);
-            createContextBit(parameters.GRREFERENCE, refX + 0, refY - 1);
-        }
-
-        return pixelContext;
-    };
-
-    auto evaluateTPGRPIX = [&](int x, int y, uint8_t& value) -> bool
-    {
-        const int refX = x - parameters.GRREFERENCEX;
-        const int refY = y - parameters.GRREFERENCEY;
-
-        value = parameters.GRREFERENCE->getPixelSafe(refX, refY);
-
-        return parameters.GRREFERENCE->getPixelSafe(refX - 1, refY - 1) == value &&
-               parameters.GRREFERENCE->getPixelSafe(refX + 0, refY - 1) == value &&
-               parameters.GRREFERENCE->getPixelSafe(refX + 1, refY - 1) == value &&
-               parameters.GRREFERENCE->getPixelSafe(refX - 1, refY + 0) == value &&
-               parameters.GRREFERENCE->getPixelSafe(refX + 1, refY + 0) == value &&
-               parameters.GRREFERENCE->getPixelSafe(refX - 1, refY + 1) == value &&
-               parameters.GRREFERENCE->getPixelSafe(refX + 0, refY + 1) == value &&
-               parameters.GRREFERENCE->getPixelSafe(refX + 1, refY + 1) == value;
-    };
+    const PDFJBIG2Bitmap* GRREFERENCE = parameters.GRREFERENCE;
 
     for (int32_t y = 0; y < static_cast<int32_t>(parameters.GRH); ++y)
     {
@@ -3242,27 +3258,74 @@ PDFJBIG2Bitmap PDFJBIG2Decoder::readRefinementBitmap(PDFJBIG2BitmapRefinementDec
             LTP = LTP ^ decoder.readBit(LTPContext, parameters.arithmeticDecoderState);
         }
 
-        if (!LTP)
+        // We use sliding windows for previous row of the decoded bitmap and for three rows
+        // of the reference bitmap. Each window contains three pixels [x - 1, x + 1] (the pixel
+        // x + 1 is in the lowest bit). Windows of the reference bitmap are also used to evaluate
+        // TPGRPIX, which is true, if all 3x3 reference pixels have the same value.
+        const int refY = y - parameters.GRREFERENCEY;
+        PDFJBIG2BitmapRowWindow previousRow(&GRREG, y - 1, 0, 1, 3);
+        PDFJBIG2BitmapRowWindow referencePreviousRow(GRREFERENCE, refY - 1, -parameters.GRREFERENCEX, 1, 3);
+        PDFJBIG2BitmapRowWindow referenceRow(GRREFERENCE, refY, -parameters.GRREFERENCEX, 1, 3);
+        PDFJBIG2BitmapRowWindow referenceNextRow(GRREFERENCE, refY + 1, -parameters.GRREFERENCEX, 1, 3);
+        uint32_t currentRow = 0;
+
+        for (int32_t x = 0; x < static_cast<int32_t>(parameters.GRW); ++x)
         {
-            for (int32_t x = 0; x < static_cast<int32_t>(parameters.GRW); ++x)
+            previousRow.advance();
+            referencePreviousRow.advance();
+            referenceRow.advance();
+            referenceNextRow.advance();
+
+            const uint32_t referencePrevious = referencePreviousRow.get();
+            const uint32_t reference = referenceRow.get();
+            const uint32_t referenceNext = referenceNextRow.get();
+
+            uint32_t bit = 0;
+            if (LTP && (referencePrevious & reference & referenceNext) == 0x07)
             {
-                GRREG.setPixel(x, y, (decoder.readBit(createContext(x, y), parameters.arithmeticDecoderState)) ? 0xFF : 0x00);
+                // TPGRPIX is true, TPGRVAL is 1
+                bit = 1;
             }
-        }
-        else
-        {
-            for (int32_t x = 0; x < static_cast<int32_t>(parameters.GRW); ++x)
+            else if (LTP && (referencePrevious | reference | referenceNext) == 0x00)
+            {
+                // TPGRPIX is true, TPGRVAL is 0
+                bit = 0;
+            }
+            else
             {
-                uint8_t TPGRVAL = 0;
-                if (evaluateTPGRPIX(x, y, TPGRVAL))
+                // Create pixel context, we fill context bits from the lowest bit
+                uint32_t pixelContext = 0;
+                const int refX = x - parameters.GRREFERENCEX;
+
+                if (!parameters.GRTEMPLATE)
                 {
-                    GRREG.setPixel(x, y, TPGRVAL);
+                    // 13-bit context
+                    pixelContext = (currentRow & 0x01) |
+                                   ((previousRow.get() & 0x03) << 1) |
+                                   (GRREG.getBitSafe(x + parameters.GRAT[0].x, y + parameters.GRAT[0].y) << 3) |
+                                   (referenceNext << 4) |
+                                   (reference << 7) |
+                                   ((referencePrevious & 0x03) << 10) |
+                                   (GRREFERENCE->getBitSafe(refX + parameters.GRAT[1].x, refY + parameters.GRAT[1].y) << 12);
                 }
                 else
                 {
-                    GRREG.setPixel(x, y, (decoder.readBit(createContext(x, y), parameters.arithmeticDecoderState)) ? 0xFF : 0x00);
+                    // 10-bit context
+                    pixelContext = (currentRow & 0x01) |
+                                   (previousRow.get() << 1) |
+                                   ((referenceNext & 0x03) << 4) |
+                                   (reference << 6) |
+                                   (((referencePrevious >> 1) & 0x01) << 9);
                 }
+
+                bit = decoder.readBit(pixelContext, parameters.arithmeticDecoderState);
+            }
+
+            if (bit)
+            {
+                GRREG.setPixel(x, y, 0xFF);
             }
+            currentRow = (currentRow << 1) | bit;
         }
     }
 
@@ -3640,23 +3703,27 @@ int32_t PDFJBIG2Decoder::checkInteger(std::optional<int32_t> value)
 
 PDFJBIG2Bitmap::PDFJBIG2Bitmap() :
     m_width(0),
-    m_height(0)
+    m_height(0),
+    m_stride(0)
 {
 
 }
 
 PDFJBIG2Bitmap::PDFJBIG2Bitmap(int width, int height) :
     m_width(width),
-    m_height(height)
+    m_height(height),
+    m_stride((width + 7) / 8)
 {
-    m_data.resize(width * height, 0);
+    m_data.resize(m_stride * height, 0);
 }
 
 PDFJBIG2Bitmap::PDFJBIG2Bitmap(int width, int height, uint8_t fill) :
     m_width(width),
-    m_height(height)
+    m_height(height),
+    m_stride((width + 7) / 8)
 {
-    m_data.resize(width * height, fill);
+    m_data.resize(m_stride * height, fill ? 0xFF : 0x00);
+    clearPadding();
 }
 
 PDFJBIG2Bitmap::~PDFJBIG2Bitmap()
@@ -3664,18 +3731,68 @@ PDFJBIG2Bitmap::~PDFJBIG2Bitmap()
 
 }
 
+uint8_t PDFJBIG2Bitmap::getByteSafe(int x, int y) const
+{
+    if (x <= -8 || x >= m_width || y < 0 || y >= m_height)
+    {
+        return 0;
+    }
+
+    // Pixels with negative coordinate are taken from virtual byte
+    // before the row start, which is always zero.
+    const uint8_t* row = getRow(y);
+    const int byteIndex = (x >= 0) ? (x >> 3) : -1;
+    const int shift = x - byteIndex * 8;
+
+    uint32_t word = 0;
+    if (byteIndex >= 0)
+    {
+        word = static_cast<uint32_t>(row[byteIndex]) << 8;
+    }
+    if (byteIndex + 1 < m_stride)
+    {
+        word |= row[byteIndex + 1];
+    }
+
+    // Padding bits of the row are zero, but we must not take pixels
+    // from the virtual byte after the row end.
+    uint8_t result = static_cast<uint8_t>((word << shift) >> 8);
+    if (x + 8 > m_width)
+    {
+        result &= static_cast<uint8_t>(0xFF << (x + 8 - m_width));
+    }
+
+    return result;
+}
+
+void PDFJBIG2Bitmap::clearPadding()
+{
+    const int paddingBits = m_stride * 8 - m_width;
+    if (paddingBits > 0)
+    {
+        const uint8_t mask = static_cast<uint8_t>(0xFF << paddingBits);
+        for (int y = 0; y < m_height; ++y)
+        {
+            getRow(y)[m_stride - 1] &= mask;
+        }
+    }
+}
+
 PDFJBIG2Bitmap PDFJBIG2Bitmap::getSubbitmap(int offsetX, int offsetY, int width, int height) const
 {
     PDFJBIG2Bitmap result(width, height, 0x00);
 
+    const int stride = result.getStride();
     for (int y = 0; y < height; ++y)
     {
-        for (int x = 0; x < width; ++x)
+        uint8_t* row = result.getRow(y);
+        for (int i = 0; i < stride; ++i)
         {
-            result.setPixel(x, y, getPixelSafe(x + offsetX, y + offsetY));
+            row[i] = getByteSafe(offsetX + i * 8, offsetY + y);
         }
     }
 
+    result.clearPadding();
     return result;
 }
 
@@ -3690,58 +3807,82 @@ void PDFJBIG2Bitmap::paint(const PDFJBIG2Bitmap& bitmap, int offsetX, int offset
     if (expandY && offsetY + bitmap.getHeight() > m_height)
     {
         m_height = offsetY + bitmap.getHeight();
-        m_data.resize(getPixelCount(), expandPixel);
+        m_data.resize(m_stride * m_height, expandPixel ? 0xFF : 0x00);
+
+        if (expandPixel)
+        {
+            clearPadding();
+        }
     }
 
+    const int targetStartX = qMax(offsetX, 0);
+    const int targetEndX = qMin(offsetX + bitmap.getWidth(), m_width);
+    const int targetStartY = qMax(offsetY, 0);
+    const int targetEndY = qMin(offsetY + bitmap.getHeight(), m_height);
+
     // Check out pathological cases
-    if (offsetX >= m_width || offsetY >= m_height)
+    if (targetStartX >= targetEndX || targetStartY >= targetEndY)
     {
         return;
     }
 
-    const int targetStartX = offsetX;
-    const int targetEndX = qMin(offsetX + bitmap.getWidth(), m_width);
-    const int targetStartY = offsetY;
-    const int targetEndY = qMin(offsetY + bitmap.getHeight(), m_height);
-
-    for (int targetY = targetStartY; targetY < targetEndY; ++targetY)
+    // We combine whole bytes, pixels outside of the paint area are
+    // masked out, so they remain unchanged.
+    auto paintImpl = [&](auto combine)
     {
-        for (int targetX = targetStartX; targetX < targetEndX; ++targetX)
+        const int startByte = targetStartX / 8;
+        const int endByte = (targetEndX - 1) / 8;
+
+        for (int targetY = targetStartY; targetY < targetEndY; ++targetY)
         {
-            const int sourceX = targetX - targetStartX;
-            const int sourceY = targetY - targetStartY;
+            const int sourceY = targetY - offsetY;
+            uint8_t* row = getRow(targetY);
 
-            if (targetX < 0 || targetX >= m_width || targetY < 0 || targetY >= m_height)
+            for (int byteIndex = startByte; byteIndex <= endByte; ++byteIndex)
             {
-                continue;
+                const int byteX = byteIndex * 8;
+
+                uint8_t mask = 0xFF;
+                if (byteX < targetStartX)
+                {
+                    mask &= static_cast<uint8_t>(0xFF >> (targetStartX - byteX));
+                }
+                if (byteX + 8 > targetEndX)
+                {
+                    mask &= static_cast<uint8_t>(0xFF << (byteX + 8 - targetEndX));
+                }
+
+                const uint8_t source = bitmap.getByteSafe(byteX - offsetX, sourceY);
+                const uint8_t target = row[byteIndex];
+                row[byteIndex] = (target & ~mask) | (combine(target, source) & mask);
             }
+        }
+    };
 
-            switch (operation)
-            {
-                case PDFJBIG2BitOperation::Or:
-                    setPixel(targetX, targetY, getPixel(targetX, targetY) | bitmap.getPixel(sourceX, sourceY));
-                    break;
+    switch (operation)
+    {
+        case PDFJBIG2BitOperation::Or:
+            paintImpl([](uint8_t target, uint8_t source) -> uint8_t { return target | source; });
+            break;
 
-                case PDFJBIG2BitOperation::And:
-                    setPixel(targetX, targetY, getPixel(targetX, targetY) & bitmap.getPixel(sourceX, sourceY));
-                    break;
+        case PDFJBIG2BitOperation::And:
+            paintImpl([](uint8_t target, uint8_t source) -> uint8_t { return target & source; });
+            break;
 
-                case PDFJBIG2BitOperation::Xor:
-                    setPixel(targetX, targetY, getPixel(targetX, targetY) ^ bitmap.getPixel(sourceX, sourceY));
-                    break;
+        case PDFJBIG2BitOperation::Xor:
+            paintImpl([](uint8_t target, uint8_t source) -> uint8_t { return target ^ source; });
+            break;
 
-                case PDFJBIG2BitOperation::NotXor:
-                    setPixel(targetX, targetY, getPixel(targetX, targetY) ^ (~bitmap.getPixel(sourceX, sourceY)));
-                    break;
+        case PDFJBIG2BitOperation::NotXor:
+            paintImpl([](uint8_t target, uint8_t source) -> uint8_t { return ~(target ^ source); });
+            break;
 
-                case PDFJBIG2BitOperation::Replace:
-                    setPixel(targetX, targetY, bitmap.getPixel(sourceX, sourceY));
-                    break;
+        case PDFJBIG2BitOperation::Replace:
+            paintImpl([](uint8_t target, uint8_t source) -> uint8_t { Q_UNUSED(target); return source; });
+            break;
 
-                default:
-                    throw PDFException(PDFTranslationContext::tr("JBIG2 - invalid bitmap paint operation."));
-            }
-        }
+        default:
+            throw PDFException(PDFTranslationContext::tr("JBIG2 - invalid bitmap paint operation."));
     }
 }
 
@@ -3752,9 +3893,9 @@ void PDFJBIG2Bitmap::copyRow(int target, int source)
         throw PDFException(PDFTranslationContext::tr("JBIG2 - invalid bitmap copy row operation."));
     }
 
-    auto itSource = std::next(m_data.cbegin(), source * m_width);
-    auto itSourceEnd = std::next(itSource, m_width);
-    auto itTarget = std::next(m_data.begin(), target * m_width);
+    auto itSource = std::next(m_data.cbegin(), source * m_stride);
+    auto itSourceEnd = std::next(itSource, m_stride);
+    auto itTarget = std::next(m_data.begin(), target * m_stride);
     std::copy(itSource, itSourceEnd, itTarget);
 }
 
@@ -323,6 +323,10 @@ private:
     std::vector<PDFJBIG2HuffmanTableEntry> m_entries;
 };
 
+/// Monochrome bitmap used by JBIG2 decoder. Pixels are packed (8 pixels per byte,
+/// most significant bit is the leftmost pixel), each row is padded to whole bytes,
+/// so the layout is the same as 1-bit image data. Unused bits at the end of the row
+/// are always zero. Pixel values are reported as 0x00 / 0xFF.
 class PDF4QTLIBSHARED_EXPORT PDFJBIG2Bitmap : public PDFJBIG2Segment
 {
 public:
@@ -336,9 +340,24 @@ public:
 
     inline int getWidth() const { return m_width; }
     inline int getHeight() const { return m_height; }
+    inline int getStride() const { return m_stride; }
     inline int getPixelCount() const { return m_width * m_height; }
-    inline uint8_t getPixel(int x, int y) const { return m_data[y * m_width + x]; }
-    inline void setPixel(int x, int y, uint8_t value) { m_data[y * m_width + x] = value; }
+    inline uint8_t getPixel(int x, int y) const { return getBit(x, y) ? 0xFF : 0x00; }
+
+    inline void setPixel(int x, int y, uint8_t value)
+    {
+        uint8_t& byte = m_data[y * m_stride + (x >> 3)];
+        const uint8_t mask = 0x80 >> (x & 0x07);
+
+        if (value)
+        {
+            byte |= mask;
+        }
+        else
+        {
+            byte &= ~mask;
+        }
+    }
 
     inline uint8_t getPixelSafe(int x, int y) const
     {
@@ -350,10 +369,40 @@ public:
         return getPixel(x, y);
     }
 
-    inline void fill(uint8_t value) { std::fill(m_data.begin(), m_data.end(), value); }
+    /// Returns pixel as a single bit (0 or 1), pixel coordinates must be valid
+    inline uint32_t getBit(int x, int y) const { return (m_data[y * m_stride + (x >> 3)] >> (7 - (x & 0x07))) & 0x01; }
+
+    /// Returns pixel as a single bit (0 or 1), pixels outside of the bitmap are zero
+    inline uint32_t getBitSafe(int x, int y) const
+    {
+        if (x < 0 || x >= m_width || y < 0 || y >= m_height)
+        {
+            return 0;
+        }
+
+        return getBit(x, y);
+    }
+
+    /// Returns 8 pixels starting at the position (x, y) packed into the byte (pixel x is in
+    /// the highest bit). Pixels outside of the bitmap are zero.
+    /// \param x Horizontal position of the first pixel (need not to be byte aligned)
+    /// \param y Row index
+    uint8_t getByteSafe(int x, int y) const;
+
+    /// Returns pointer to packed row data. Row index must be valid.
+    inline const uint8_t* getRow(int y) const { return m_data.data() + y * m_stride; }
+
+    /// Returns pointer to packed row data. Row index must be valid. If unused bits
+    /// at the end of the row are modified, then \p clearPadding must be called.
+    inline uint8_t* getRow(int y) { return m_data.data() + y * m_stride; }
+
+    inline void fill(uint8_t value) { std::fill(m_data.begin(), m_data.end(), value ? 0xFF : 0x00); clearPadding(); }
     inline void fillZero() { fill(0); }
     inline void fillOne() { fill(0xFF); }
 
+    /// Resets unused bits at the end of each row to zero
+    void clearPadding();
+
     inline bool isValid() const { return getPixelCount() > 0; }
 
     /// Returns subbitmap of this bitmap. If some pixels of subbitmap are outside
@@ -366,6 +415,7 @@ public:
 
     /// Paints another bitmap onto this bitmap. If bitmap is invalid, nothing is done.
     /// If \p expandY is true, height of target bitmap is expanded to fit source draw area.
+    /// Bitmaps are combined byte by byte (8 pixels at once), not pixel by pixel.
     /// \param bitmap Bitmap to be painted on this
     /// \param offsetX Horizontal offset of paint area
     /// \param offsetY Vertical offset of paint area
@@ -383,6 +433,7 @@ public:
 private:
     int m_width;
     int m_height;
+    int m_stride;
     std::vector<uint8_t> m_data;
 };
 
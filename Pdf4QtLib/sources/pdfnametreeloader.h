@@ -20,7 +20,9 @@
 
 #include "pdfdocument.h"
 
+#include <set>
 #include <map>
+#include <optional>
 #include <functional>
 
 namespace pdf
@@ -48,7 +50,164 @@ public:
         return result;
     }
 
+    /// Finds object with given key in the name tree. Tree is not loaded, only nodes,
+    /// which can contain the key (according to their /Limits entry), are visited.
+    /// Kids and names are sorted, so binary search is used. If object is not found,
+    /// then std::nullopt is returned. Object is retrieved by \p loadMethod.
+    /// \param storage Object storage
+    /// \param root Root of the name tree
+    /// \param key Key of the object
+    /// \param loadMethod Parsing method, which retrieves parsed object
+    static std::optional<Type> find(const PDFObjectStorage* storage, const PDFObject& root, const QByteArray& key, const LoadMethod& loadMethod)
+    {
+        std::set<PDFObjectReference> visitedNodes;
+        return findImpl(visitedNodes, storage, root, key, loadMethod);
+    }
+
 private:
+    static std::optional<Type> findImpl(std::set<PDFObjectReference>& visitedNodes,
+                                        const PDFObjectStorage* storage,
+                                        const PDFObject& root,
+                                        const QByteArray& key,
+                                        const LoadMethod& loadMethod)
+    {
+        if (root.isReference())
+        {
+            if (visitedNodes.count(root.getReference()))
+            {
+                // Cycle in the name tree
+                return std::nullopt;
+            }
+
+            visitedNodes.insert(root.getReference());
+        }
+
+        const PDFDictionary* dictionary = storage->getDictionaryFromObject(root);
+        if (!dictionary)
+        {
+            return std::nullopt;
+        }
+
+        const PDFObject& namedItems = storage->getObject(dictionary->get("Names"));
+        if (namedItems.isArray())
+        {
+            const PDFArray* namedItemsArray = namedItems.getArray();
+            const size_t count = namedItemsArray->getCount() / 2;
+
+            auto getName = [storage, namedItemsArray](size_t index) -> QByteArray
+            {
+                const PDFObject& name = storage->getObject(namedItemsArray->getItem(2 * index));
+                return name.isString() ? name.getString() : QByteArray();
+            };
+
+            size_t low = 0;
+            size_t high = count;
+            while (low < high)
+            {
+                const size_t middle = low + (high - low) / 2;
+                if (getName(middle) < key)
+                {
+                    low = middle + 1;
+                }
+                else
+                {
+                    high = middle;
+                }
+            }
+
+            if (low < count && getName(low) == key)
+            {
+                return loadMethod(storage, namedItemsArray->getItem(2 * low + 1));
+            }
+
+            // Some producers do not sort the names, so if binary search
+            // fails, try to find the key sequentially. Objects are not parsed here,
+            // so it is still much faster, than loading the whole tree.
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (getName(i) == key)
+                {
+                    return loadMethod(storage, namedItemsArray->getItem(2 * i + 1));
+                }
+            }
+        }
+
+        const PDFObject& kids = storage->getObject(dictionary->get("Kids"));
+        if (kids.isArray())
+        {
+            const PDFArray* kidsArray = kids.getArray();
+            const size_t count = kidsArray->getCount();
+
+            auto getLimits = [storage, kidsArray](size_t index) -> std::optional<std::pair<QByteArray, QByteArray>>
+            {
+                if (const PDFDictionary* kidDictionary = storage->getDictionaryFromObject(kidsArray->getItem(index)))
+                {
+                    const PDFObject& limits = storage->getObject(kidDictionary->get("Limits"));
+                    if (limits.isArray() && limits.getArray()->getCount() == 2)
+                    {
+                        const PDFObject& lower = storage->getObject(limits.getArray()->getItem(0));
+                        const PDFObject& upper = storage->getObject(limits.getArray()->getItem(1));
+                        if (lower.isString() && upper.isString())
+                        {
+                            return std::make_pair(lower.getString(), upper.getString());
+                        }
+                    }
+                }
+
+                return std::nullopt;
+            };
+
+            // Find first kid, whose upper limit is not less than the key
+            bool limitsValid = true;
+            size_t low = 0;
+            size_t high = count;
+            while (low < high)
+            {
+                const size_t middle = low + (high - low) / 2;
+                std::optional<std::pair<QByteArray, QByteArray>> limits = getLimits(middle);
+                if (!limits)
+                {
+                    limitsValid = false;
+                    break;
+                }
+
+                if (limits->second < key)
+                {
+                    low = middle + 1;
+                }
+                else
+                {
+                    high = middle;
+                }
+            }
+
+            if (limitsValid)
+            {
+                if (low < count)
+                {
+                    std::optional<std::pair<QByteArray, QByteArray>> limits = getLimits(low);
+                    if (limits && limits->first <= key)
+                    {
+                        return findImpl(visitedNodes, storage, kidsArray->getItem(low), key, loadMethod);
+                    }
+                }
+
+                return std::nullopt;
+            }
+
+            // Limits are missing (malformed tree), we must search all kids
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (std::optional<Type> result = findImpl(visitedNodes, storage, kidsArray->getItem(i), key, loadMethod))
+                {
+                    return result;
+                }
+            }
+        }
+
+        return std::nullopt;
+    }
+
     static void parseImpl(MappedObjects& objects, const PDFObjectStorage* storage, const PDFObject& root, const LoadMethod& loadMethod)
     {
         if (const PDFDictionary* dictionary = storage->getDictionaryFromObject(root))
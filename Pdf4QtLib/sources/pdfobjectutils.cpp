@@ -19,6 +19,9 @@
 #include "pdfvisitor.h"
 #include "pdfexecutionpolicy.h"
 #include "pdfdocumentwriter.h"
+#include "pdfutils.h"
+
+#include <memory>
 
 namespace pdf
 {
@@ -270,10 +273,11 @@ QString PDFObjectUtils::getObjectTypeName(PDFObject::Type type)
     return QString();
 }
 
-void PDFObjectClassifier::classify(const PDFDocument* document)
+void PDFObjectClassifier::classify(const PDFDocument* document, bool collectStatistics)
 {
     // Clear old classification, if it exist
     m_classification.clear();
+    m_objectCountByType = { };
     m_allTypesUsed = None;
 
     if (!document)
@@ -292,22 +296,26 @@ void PDFObjectClassifier::classify(const PDFDocument* document)
         m_classification[i].reference = reference;
     }
 
+    // Objects can be shared between pages, so they can be marked
+    // from multiple threads. We mark them using atomic bit operations, so no
+    // locking is needed, and transfer types to the classification at the end.
+    std::unique_ptr<AtomicTypes[]> types(new AtomicTypes[objects.size()]());
+
     // First, iterate trough pages of the document
     const PDFCatalog* catalog = document->getCatalog();
-    const size_t pageCount = catalog->getPageCount();
-    for (size_t i = 0; i < pageCount; ++i)
+    auto processPage = [&](size_t pageIndex)
     {
-        const PDFPage* page = catalog->getPage(i);
+        const PDFPage* page = catalog->getPage(pageIndex);
 
         if (!page)
         {
-            continue;
+            return;
         }
 
         // Handle page itself
         if (hasObject(page->getPageReference()))
         {
-            mark(page->getPageReference(), Page);
+            mark(types.get(), page->getPageReference(), Page);
         }
 
         // Handle annotations
@@ -315,7 +323,7 @@ void PDFObjectClassifier::classify(const PDFDocument* document)
         {
             if (hasObject(reference))
             {
-                mark(reference, Annotation);
+                mark(types.get(), reference, Annotation);
             }
         }
 
@@ -325,19 +333,19 @@ void PDFObjectClassifier::classify(const PDFDocument* document)
 
         const PDFDictionary* dictionary = pageObject.getDictionary();
         const PDFObject& contentsObject = dictionary->get("Contents");
-        if (contentsObject.isReference())
+        if (contentsObject.isReference() && hasObject(contentsObject.getReference()))
         {
-            mark(contentsObject.getReference(), ContentStream);
+            mark(types.get(), contentsObject.getReference(), ContentStream);
         }
 
         // Handle resources
         if (const PDFDictionary* resourcesDictionary = document->getDictionaryFromObject(dictionary->get("Resources")))
         {
-            markDictionary(document, resourcesDictionary->get("ExtGState"), GraphicState);
-            markDictionary(document, resourcesDictionary->get("ColorSpace"), ColorSpace);
-            markDictionary(document, resourcesDictionary->get("Pattern"), Pattern);
-            markDictionary(document, resourcesDictionary->get("Shading"), Shading);
-            markDictionary(document, resourcesDictionary->get("Font"), Font);
+            markDictionary(types.get(), document, resourcesDictionary->get("ExtGState"), GraphicState);
+            markDictionary(types.get(), document, resourcesDictionary->get("ColorSpace"), ColorSpace);
+            markDictionary(types.get(), document, resourcesDictionary->get("Pattern"), Pattern);
+            markDictionary(types.get(), document, resourcesDictionary->get("Shading"), Shading);
+            markDictionary(types.get(), document, resourcesDictionary->get("Font"), Font);
 
             if (const PDFDictionary* xobjectDictionary = document->getDictionaryFromObject(resourcesDictionary->get("XObject")))
             {
@@ -353,34 +361,64 @@ void PDFObjectClassifier::classify(const PDFDocument* document)
 
                             if (subtype == "Image")
                             {
-                                mark(item.getReference(), Image);
+                                mark(types.get(), item.getReference(), Image);
                             }
                             else if (subtype == "Form")
                             {
-                                mark(item.getReference(), Form);
+                                mark(types.get(), item.getReference(), Form);
                             }
                         }
                     }
                 }
             }
         }
-    }
+    };
 
-    for (Classification& classification : m_classification)
+    PDFIntegerRange<size_t> pageRange(0, catalog->getPageCount());
+    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, pageRange.begin(), pageRange.end(), processPage);
+
+    // Then process all objects in one pass. Each object writes only to its
+    // own classification item, statistics collector is thread safe.
+    PDFStatisticsCollector collector;
+    auto processObject = [&](size_t objectIndex)
     {
-        if (const PDFDictionary* dictionary = document->getDictionaryFromObject(document->getObjectByReference(classification.reference)))
+        Classification& classification = m_classification[objectIndex];
+        const PDFObject& object = objects[objectIndex].object;
+
+        if (const PDFDictionary* dictionary = document->getDictionaryFromObject(object))
         {
             QByteArray typeName = loader.readNameFromDictionary(dictionary, "Type");
             if (typeName == "Action")
             {
-                classification.types.setFlag(Action);
+                types[objectIndex].fetch_or(Action, std::memory_order_relaxed);
             }
         }
+
+        classification.isNull = object.isNull();
+        if (collectStatistics)
+        {
+            classification.bytes = PDFDocumentWriter::getObjectSize(document, classification.reference);
+            object.accept(&collector);
+        }
+    };
+
+    PDFIntegerRange<size_t> objectRange(0, objects.size());
+    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Unknown, objectRange.begin(), objectRange.end(), processObject);
+
+    for (size_t i = 0; i < m_classification.size(); ++i)
+    {
+        m_classification[i].types = Types(QFlag(int(types[i].load(std::memory_order_relaxed))));
+        m_allTypesUsed |= m_classification[i].types;
     }
 
-    for (const Classification& classification : m_classification)
+    if (collectStatistics)
     {
-        m_allTypesUsed |= classification.types;
+        storage.getTrailerDictionary().accept(&collector);
+
+        for (PDFObject::Type objectType : PDFObject::getTypes())
+        {
+            m_objectCountByType[size_t(objectType)] = collector.getObjectCount(objectType);
+        }
     }
 }
 
@@ -406,7 +444,7 @@ std::vector<PDFObjectReference> PDFObjectClassifier::getObjectsByType(Type type)
     return result;
 }
 
-PDFObjectClassifier::Statistics PDFObjectClassifier::calculateStatistics(const PDFDocument* document) const
+PDFObjectClassifier::Statistics PDFObjectClassifier::calculateStatistics() const
 {
     Statistics result;
 
@@ -422,13 +460,12 @@ PDFObjectClassifier::Statistics PDFObjectClassifier::calculateStatistics(const P
         }
     }
 
-    auto processEntry = [document, &result](const Classification& entry)
+    // Object sizes were calculated during classification, so we just sum them
+    for (const Classification& entry : m_classification)
     {
-        const PDFObject& object = document->getObjectByReference(entry.reference);
-
-        if (object.isNull())
+        if (entry.isNull)
         {
-            return;
+            continue;
         }
 
         Type type = Type(uint32_t(entry.types));
@@ -439,33 +476,22 @@ PDFObjectClassifier::Statistics PDFObjectClassifier::calculateStatistics(const P
 
         Q_ASSERT(result.statistics.count(type));
 
-        const qint64 objectSize = PDFDocumentWriter::getObjectSize(document, entry.reference);
-
         StatisticsItem& statisticsItem = result.statistics.at(type);
         statisticsItem.count.fetch_add(1);
-        statisticsItem.bytes.fetch_add(objectSize);
-    };
-
-    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Unknown, m_classification.cbegin(), m_classification.cend(), processEntry);
-
-    PDFStatisticsCollector collector;
-    PDFApplyVisitor(*document, &collector);
-
-    for (PDFObject::Type objectType : PDFObject::getTypes())
-    {
-        result.objectCountByType[size_t(objectType)] = collector.getObjectCount(objectType);
+        statisticsItem.bytes.fetch_add(entry.bytes);
     }
 
+    result.objectCountByType = m_objectCountByType;
     return result;
 }
 
-void PDFObjectClassifier::mark(PDFObjectReference reference, Type type)
+void PDFObjectClassifier::mark(AtomicTypes* types, PDFObjectReference reference, Type type) const
 {
     Q_ASSERT(hasObject(reference));
-    m_classification[reference.objectNumber].types.setFlag(type, true);
+    types[reference.objectNumber].fetch_or(type, std::memory_order_relaxed);
 }
 
-void PDFObjectClassifier::markDictionary(const PDFDocument* document, PDFObject object, Type type)
+void PDFObjectClassifier::markDictionary(AtomicTypes* types, const PDFDocument* document, PDFObject object, Type type) const
 {
     if (const PDFDictionary* dictionary = document->getDictionaryFromObject(object))
     {
@@ -475,7 +501,7 @@ void PDFObjectClassifier::markDictionary(const PDFDocument* document, PDFObject
             const PDFObject& item = dictionary->getValue(i);
             if (item.isReference() && hasObject(item.getReference()))
             {
-                mark(item.getReference(), type);
+                mark(types, item.getReference(), type);
             }
         }
     }
@@ -118,9 +118,12 @@ public:
     inline PDFObjectClassifier() = default;
 
     /// Performs object classification on a document. Old classification
-    /// is being cleared.
+    /// is being cleared. Pages and objects are processed in parallel. If \p collectStatistics
+    /// is true, then object sizes and counts of object types are calculated in the same pass
+    /// over the objects, so \p calculateStatistics can be used afterwards.
     /// \param document Document
-    void classify(const PDFDocument* document);
+    /// \param collectStatistics Collect statistics during classification
+    void classify(const PDFDocument* document, bool collectStatistics = false);
 
     enum Type : uint32_t
     {
@@ -172,26 +175,39 @@ public:
         std::map<Type, StatisticsItem> statistics;
     };
 
-    /// Calculate document statistics. Document classification must be
-    /// performed before this function is called, otherwise result is undefined.
-    /// \param document Document
+    /// Calculate document statistics. Document classification with statistics
+    /// collection must be performed before this function is called, otherwise
+    /// result is undefined.
     /// \returns Calculated statistics of each object type
-    Statistics calculateStatistics(const PDFDocument* document) const;
+    Statistics calculateStatistics() const;
 
 private:
     struct Classification
     {
         PDFObjectReference reference;
         Types types = None;
+        bool isNull = true;
+        qint64 bytes = 0;
     };
 
-    /// Marks object with a given type
-    void mark(PDFObjectReference reference, Type type);
+    using AtomicTypes = std::atomic<uint32_t>;
+
+    /// Marks object with a given type. Marking is thread safe, types
+    /// are stored in the array \p types indexed by object number.
+    /// \param types Types of the objects
+    /// \param reference Reference
+    /// \param type Type
+    void mark(AtomicTypes* types, PDFObjectReference reference, Type type) const;
 
-    /// Marks objects in dictionary with a given type
-    void markDictionary(const PDFDocument* document, PDFObject object, Type type);
+    /// Marks objects in dictionary with a given type. Marking is thread safe.
+    /// \param types Types of the objects
+    /// \param document Document
+    /// \param object Dictionary
+    /// \param type Type
+    void markDictionary(AtomicTypes* types, const PDFDocument* document, PDFObject object, Type type) const;
 
     std::vector<Classification> m_classification;
+    std::array<qint64, size_t(PDFObject::Type::LastType)> m_objectCountByType = { };
     Types m_allTypesUsed;
 };
 
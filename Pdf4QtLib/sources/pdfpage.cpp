@@ -137,6 +137,273 @@ QRectF PDFPage::getRotatedCropBox() const
     return getRotatedBox(getCropBox(), getPageRotation());
 }
 
+PDFPage PDFPage::parsePageObject(const PDFObjectStorage* storage,
+                                 PDFObjectReference pageReference,
+                                 const PDFObject& pageObject,
+                                 const PDFPageInheritableAttributes& attributes)
+{
+    Q_ASSERT(pageObject.isDictionary());
+    const PDFDictionary* dictionary = pageObject.getDictionary();
+
+    PDFPage page;
+
+    page.m_pageObject = pageObject;
+    page.m_pageReference = pageReference;
+    page.m_mediaBox = attributes.getMediaBox();
+    page.m_cropBox = attributes.getCropBox();
+    page.m_resources = storage->getObject(attributes.getResources());
+    page.m_pageRotation = attributes.getPageRotation();
+
+    if (!page.m_cropBox.isValid())
+    {
+        page.m_cropBox = page.m_mediaBox;
+    }
+
+    PDFDocumentDataLoaderDecorator loader(storage);
+    page.m_bleedBox = loader.readRectangle(dictionary->get("BleedBox"), page.getCropBox());
+    page.m_trimBox = loader.readRectangle(dictionary->get("TrimBox"), page.getCropBox());
+    page.m_artBox = loader.readRectangle(dictionary->get("ArtBox"), page.getCropBox());
+    page.m_contents = storage->getObject(dictionary->get("Contents"));
+    page.m_annots = loader.readReferenceArrayFromDictionary(dictionary, "Annots");
+    page.m_lastModified = PDFEncoding::convertToDateTime(loader.readStringFromDictionary(dictionary, "LastModified"));
+    page.m_thumbnailReference = loader.readReferenceFromDictionary(dictionary, "Thumb");
+    page.m_beads = loader.readReferenceArrayFromDictionary(dictionary, "B");
+    page.m_duration = loader.readIntegerFromDictionary(dictionary, "Dur", 0);
+    page.m_structParent = loader.readIntegerFromDictionary(dictionary, "StructParents", 0);
+    page.m_webCaptureContentSetId = loader.readStringFromDictionary(dictionary, "ID");
+    page.m_preferredZoom = loader.readNumberFromDictionary(dictionary, "PZ", 0.0);
+
+    constexpr const std::array<std::pair<const char*, PageTabOrder>, 5> tabStops =
+    {
+        std::pair<const char*, PageTabOrder>{ "R", PageTabOrder::Row },
+        std::pair<const char*, PageTabOrder>{ "C", PageTabOrder::Column },
+        std::pair<const char*, PageTabOrder>{ "S", PageTabOrder::Structure },
+        std::pair<const char*, PageTabOrder>{ "A", PageTabOrder::Array },
+        std::pair<const char*, PageTabOrder>{ "W", PageTabOrder::Widget }
+    };
+
+    page.m_pageTabOrder = loader.readEnumByName(dictionary->get("Tabs"), tabStops.cbegin(), tabStops.cend(), PageTabOrder::Invalid);
+    page.m_templateName = loader.readNameFromDictionary(dictionary, "TemplateInstantiated");
+    page.m_userUnit = loader.readNumberFromDictionary(dictionary, "UserUnit", 1.0);
+    page.m_documentPart = loader.readReferenceFromDictionary(dictionary, "DPart");
+
+    return page;
+}
+
+std::optional<size_t> PDFPage::parsePageCount(const PDFObjectStorage* storage, const PDFObject& root)
+{
+    try
+    {
+        const PDFDictionary* dictionary = storage->getDictionaryFromObject(root);
+        if (!dictionary)
+        {
+            return std::nullopt;
+        }
+
+        PDFDocumentDataLoaderDecorator loader(storage);
+        const QByteArray typeString = loader.readNameFromDictionary(dictionary, "Type");
+        if (typeString == "Page")
+        {
+            return 1;
+        }
+
+        const PDFObject& kids = storage->getObject(dictionary->get("Kids"));
+        if (typeString != "Pages" || !kids.isArray())
+        {
+            return std::nullopt;
+        }
+
+        const PDFArray* kidsArray = kids.getArray();
+        size_t kidsPageCount = 0;
+        for (size_t i = 0, count = kidsArray->getCount(); i < count; ++i)
+        {
+            const PDFObject& kid = kidsArray->getItem(i);
+            if (!kid.isReference())
+            {
+                return std::nullopt;
+            }
+
+            kidsPageCount += getPageTreeNodePageCount(storage, kid);
+        }
+
+        const PDFInteger pageCount = loader.readIntegerFromDictionary(dictionary, "Count", -1);
+        if (pageCount < 0 || size_t(pageCount) != kidsPageCount)
+        {
+            return std::nullopt;
+        }
+
+        return kidsPageCount;
+    }
+    catch (const PDFException&)
+    {
+        return std::nullopt;
+    }
+}
+
+std::vector<PDFObjectReference> PDFPage::parsePageReferences(const PDFObjectStorage* storage, const PDFObject& root)
+{
+    std::vector<PDFObjectReference> result;
+    std::set<PDFObjectReference> visited;
+    parsePageReferencesImpl(result, visited, root, storage);
+    return result;
+}
+
+void PDFPage::parsePageReferencesImpl(std::vector<PDFObjectReference>& references,
+                                      std::set<PDFObjectReference>& visitedReferences,
+                                      const PDFObject& node,
+                                      const PDFObjectStorage* storage)
+{
+    const PDFDictionary* dictionary = storage->getDictionaryFromObject(node);
+    if (!dictionary)
+    {
+        throw PDFException(PDFTranslationContext::tr("Expected dictionary in page tree."));
+    }
+
+    PDFDocumentDataLoaderDecorator loader(storage);
+    const QByteArray typeString = loader.readNameFromDictionary(dictionary, "Type");
+    if (typeString == "Page")
+    {
+        references.push_back(node.isReference() ? node.getReference() : PDFObjectReference());
+    }
+    else if (typeString == "Pages")
+    {
+        const PDFObject& kids = storage->getObject(dictionary->get("Kids"));
+        if (!kids.isArray())
+        {
+            throw PDFException(PDFTranslationContext::tr("Expected valid kids in page tree."));
+        }
+
+        const PDFArray* kidsArray = kids.getArray();
+        for (size_t i = 0, count = kidsArray->getCount(); i < count; ++i)
+        {
+            const PDFObject& kid = kidsArray->getItem(i);
+
+            if (!kid.isReference())
+            {
+                throw PDFException(PDFTranslationContext::tr("Expected valid kids in page tree."));
+            }
+
+            if (visitedReferences.count(kid.getReference()))
+            {
+                throw PDFException(PDFTranslationContext::tr("Detected cycles in page tree."));
+            }
+
+            visitedReferences.insert(kid.getReference());
+            parsePageReferencesImpl(references, visitedReferences, kid, storage);
+        }
+    }
+    else
+    {
+        throw PDFException(PDFTranslationContext::tr("Expected valid type item in page tree."));
+    }
+}
+
+size_t PDFPage::getPageTreeNodePageCount(const PDFObjectStorage* storage, const PDFObject& node)
+{
+    if (const PDFDictionary* dictionary = storage->getDictionaryFromObject(node))
+    {
+        PDFDocumentDataLoaderDecorator loader(storage);
+        const QByteArray typeString = loader.readNameFromDictionary(dictionary, "Type");
+
+        if (typeString == "Page")
+        {
+            return 1;
+        }
+
+        if (typeString == "Pages")
+        {
+            return static_cast<size_t>(qMax(loader.readIntegerFromDictionary(dictionary, "Count", 0), PDFInteger(0)));
+        }
+    }
+
+    throw PDFException(PDFTranslationContext::tr("Expected valid type item in page tree."));
+}
+
+std::optional<PDFPage> PDFPage::parsePage(const PDFObjectStorage* storage, const PDFObject& root, size_t pageIndex)
+{
+    std::set<PDFObjectReference> visitedReferences;
+    PDFPageInheritableAttributes attributes;
+    PDFObject node = root;
+
+    while (true)
+    {
+        const PDFObjectReference objectReference = node.isReference() ? node.getReference() : PDFObjectReference();
+        const PDFObject& dereferenced = storage->getObject(node);
+
+        if (!dereferenced.isDictionary())
+        {
+            throw PDFException(PDFTranslationContext::tr("Expected dictionary in page tree."));
+        }
+
+        const PDFDictionary* dictionary = dereferenced.getDictionary();
+        const PDFObject& typeObject = storage->getObject(dictionary->get("Type"));
+        if (!typeObject.isName())
+        {
+            throw PDFException(PDFTranslationContext::tr("Expected valid type item in page tree."));
+        }
+
+        attributes = PDFPageInheritableAttributes::parse(attributes, node, storage);
+
+        QByteArray typeString = typeObject.getString();
+        if (typeString == "Page")
+        {
+            if (pageIndex == 0)
+            {
+                return parsePageObject(storage, objectReference, dereferenced, attributes);
+            }
+
+            return std::nullopt;
+        }
+        else if (typeString != "Pages")
+        {
+            throw PDFException(PDFTranslationContext::tr("Expected valid type item in page tree."));
+        }
+
+        const PDFObject& kids = storage->getObject(dictionary->get("Kids"));
+        if (!kids.isArray())
+        {
+            throw PDFException(PDFTranslationContext::tr("Expected valid kids in page tree."));
+        }
+
+        // Find kid containing the page. Subtrees before the page are skipped
+        // using their page count, so they are not traversed at all.
+        PDFObject nextNode;
+        const PDFArray* kidsArray = kids.getArray();
+        const size_t count = kidsArray->getCount();
+        for (size_t i = 0; i < count; ++i)
+        {
+            const PDFObject& kid = kidsArray->getItem(i);
+
+            if (!kid.isReference())
+            {
+                throw PDFException(PDFTranslationContext::tr("Expected valid kids in page tree."));
+            }
+
+            const size_t kidPageCount = getPageTreeNodePageCount(storage, kid);
+            if (pageIndex < kidPageCount)
+            {
+                nextNode = kid;
+                break;
+            }
+
+            pageIndex -= kidPageCount;
+        }
+
+        if (nextNode.isNull())
+        {
+            return std::nullopt;
+        }
+
+        if (visitedReferences.count(nextNode.getReference()))
+        {
+            throw PDFException(PDFTranslationContext::tr("Detected cycles in page tree."));
+        }
+
+        visitedReferences.insert(nextNode.getReference());
+        node = qMove(nextNode);
+    }
+}
+
 PDFObject PDFPage::getObjectFromPageDictionary(const PDFObjectStorage* storage, const char* key) const
 {
     if (const PDFDictionary* dictionary = storage->getDictionaryFromObject(m_pageObject))
@@ -295,49 +562,7 @@ void PDFPage::parseImpl(std::vector<PDFPage>& pages,
             }
             else if (typeString == "Page")
             {
-                PDFPage page;
-
-                page.m_pageObject = dereferenced;
-                page.m_pageReference = objectReference;
-                page.m_mediaBox = currentInheritableAttributes.getMediaBox();
-                page.m_cropBox = currentInheritableAttributes.getCropBox();
-                page.m_resources = storage->getObject(currentInheritableAttributes.getResources());
-                page.m_pageRotation = currentInheritableAttributes.getPageRotation();
-
-                if (!page.m_cropBox.isValid())
-                {
-                    page.m_cropBox = page.m_mediaBox;
-                }
-
-                PDFDocumentDataLoaderDecorator loader(storage);
-                page.m_bleedBox = loader.readRectangle(dictionary->get("BleedBox"), page.getCropBox());
-                page.m_trimBox = loader.readRectangle(dictionary->get("TrimBox"), page.getCropBox());
-                page.m_artBox = loader.readRectangle(dictionary->get("ArtBox"), page.getCropBox());
-                page.m_contents = storage->getObject(dictionary->get("Contents"));
-                page.m_annots = loader.readReferenceArrayFromDictionary(dictionary, "Annots");
-                page.m_lastModified = PDFEncoding::convertToDateTime(loader.readStringFromDictionary(dictionary, "LastModified"));
-                page.m_thumbnailReference = loader.readReferenceFromDictionary(dictionary, "Thumb");
-                page.m_beads = loader.readReferenceArrayFromDictionary(dictionary, "B");
-                page.m_duration = loader.readIntegerFromDictionary(dictionary, "Dur", 0);
-                page.m_structParent = loader.readIntegerFromDictionary(dictionary, "StructParents", 0);
-                page.m_webCaptureContentSetId = loader.readStringFromDictionary(dictionary, "ID");
-                page.m_preferredZoom = loader.readNumberFromDictionary(dictionary, "PZ", 0.0);
-
-                constexpr const std::array<std::pair<const char*, PageTabOrder>, 5> tabStops =
-                {
-                    std::pair<const char*, PageTabOrder>{ "R", PageTabOrder::Row },
-                    std::pair<const char*, PageTabOrder>{ "C", PageTabOrder::Column },
-                    std::pair<const char*, PageTabOrder>{ "S", PageTabOrder::Structure },
-                    std::pair<const char*, PageTabOrder>{ "A", PageTabOrder::Array },
-                    std::pair<const char*, PageTabOrder>{ "W", PageTabOrder::Widget }
-                };
-
-                page.m_pageTabOrder = loader.readEnumByName(dictionary->get("Tabs"), tabStops.cbegin(), tabStops.cend(), PageTabOrder::Invalid);
-                page.m_templateName = loader.readNameFromDictionary(dictionary, "TemplateInstantiated");
-                page.m_userUnit = loader.readNumberFromDictionary(dictionary, "UserUnit", 1.0);
-                page.m_documentPart = loader.readReferenceFromDictionary(dictionary, "DPart");
-
-                pages.emplace_back(std::move(page));
+                pages.emplace_back(parsePageObject(storage, objectReference, dereferenced, currentInheritableAttributes));
             }
             else
             {
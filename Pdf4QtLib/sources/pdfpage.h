@@ -149,6 +149,32 @@ public:
     /// \param root Root object of page tree
     static std::vector<PDFPage> parse(const PDFObjectStorage* storage, const PDFObject& root);
 
+    /// Returns page count of the page tree. Only root node of the tree and its
+    /// kids are examined (using /Count entries), so tree is not traversed. If page
+    /// count of the root doesn't match page counts of its kids, or root is not valid
+    /// page tree node, then std::nullopt is returned (page tree must be parsed
+    /// as a whole in this case).
+    /// \param storage Storage owning this tree
+    /// \param root Root object of page tree
+    static std::optional<size_t> parsePageCount(const PDFObjectStorage* storage, const PDFObject& root);
+
+    /// Returns references of all pages in the page tree (in page order). Only page
+    /// tree nodes are traversed, pages are not parsed. If error occurs, then
+    /// exception is thrown.
+    /// \param storage Storage owning this tree
+    /// \param root Root object of page tree
+    static std::vector<PDFObjectReference> parsePageReferences(const PDFObjectStorage* storage, const PDFObject& root);
+
+    /// Parses single page of the page tree, without parsing the whole tree.
+    /// Tree is navigated from the root to the page using /Count entries
+    /// of the intermediate nodes, inheritable attributes are resolved on the path.
+    /// If page doesn't exist, then std::nullopt is returned. If error occurs,
+    /// then exception is thrown.
+    /// \param storage Storage owning this tree
+    /// \param root Root object of page tree
+    /// \param pageIndex Index of the page
+    static std::optional<PDFPage> parsePage(const PDFObjectStorage* storage, const PDFObject& root, size_t pageIndex);
+
     inline const QRectF& getMediaBox() const { return m_mediaBox; }
     inline const QRectF& getCropBox() const { return m_cropBox; }
     inline const QRectF& getBleedBox() const { return m_bleedBox; }
@@ -285,6 +311,32 @@ private:
                           const PDFObject& root,
                           const PDFObjectStorage* storage);
 
+    /// Parses page object (leaf node of the page tree)
+    /// \param storage Storage owning this tree
+    /// \param pageReference Reference to the page object
+    /// \param pageObject Page object (dereferenced page dictionary)
+    /// \param attributes Resolved inheritable attributes of the page
+    static PDFPage parsePageObject(const PDFObjectStorage* storage,
+                                   PDFObjectReference pageReference,
+                                   const PDFObject& pageObject,
+                                   const PDFPageInheritableAttributes& attributes);
+
+    /// Returns number of pages in the page tree node. For page, 1 is returned,
+    /// for intermediate node, /Count entry is returned.
+    /// \param storage Storage owning this tree
+    /// \param node Page tree node
+    static size_t getPageTreeNodePageCount(const PDFObjectStorage* storage, const PDFObject& node);
+
+    /// Collects references of pages in the page tree node (implementation)
+    /// \param references Page references
+    /// \param visitedReferences Visited references (to check cycles in page tree and avoid hangup)
+    /// \param node Page tree node
+    /// \param storage Storage owning this tree
+    static void parsePageReferencesImpl(std::vector<PDFObjectReference>& references,
+                                        std::set<PDFObjectReference>& visitedReferences,
+                                        const PDFObject& node,
+                                        const PDFObjectStorage* storage);
+
     /// Returns object from page dictionary. This function requires,
     /// that storage of object is present, for object fetching. Objects
     /// are not stored in this class, because it will have too large
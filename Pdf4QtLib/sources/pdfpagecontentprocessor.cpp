@@ -386,6 +386,11 @@ bool PDFPageContentProcessor::performOriginalImagePainting(const PDFImage& image
     return false;
 }
 
+bool PDFPageContentProcessor::isProcessingOriginalImages() const
+{
+    return false;
+}
+
 void PDFPageContentProcessor::performImagePainting(const QImage& image)
 {
     Q_UNUSED(image);
@@ -481,6 +486,11 @@ bool PDFPageContentProcessor::isContentKindSuppressed(ContentKind kind) const
     return false;
 }
 
+bool PDFPageContentProcessor::isTextMetricsOnly() const
+{
+    return false;
+}
+
 void PDFPageContentProcessor::setGraphicsState(const PDFPageContentProcessorState& state)
 {
     m_graphicState = state;
@@ -2797,7 +2807,7 @@ void PDFPageContentProcessor::operatorTextShowTextString(PDFOperandString text)
 
         // We use simple heuristic to ensure reallocation doesn't occur too often
         textSequence.items.reserve(m_operands.size());
-        realizedFont->fillTextSequence(text.string, textSequence, this);
+        realizedFont->fillTextSequence(text.string, textSequence, this, isTextMetricsOnly() ? TextSequenceMode::Metrics : TextSequenceMode::GlyphOutlines);
         drawText(textSequence);
     }
     else
@@ -2854,7 +2864,7 @@ void PDFPageContentProcessor::operatorTextShowTextIndividualSpacing()
 
                 case PDFLexicalAnalyzer::TokenType::String:
                 {
-                    realizedFont->fillTextSequence(m_operands[i].data.toByteArray(), textSequence, this);
+                    realizedFont->fillTextSequence(m_operands[i].data.toByteArray(), textSequence, this, isTextMetricsOnly() ? TextSequenceMode::Metrics : TextSequenceMode::GlyphOutlines);
                     break;
                 }
 
@@ -2947,6 +2957,18 @@ void PDFPageContentProcessor::paintXObjectImage(const PDFStream* stream)
         }
     }
 
+    // If original image isn't needed, try to decode the image band by band
+    // directly to the target image, so decoded data of the whole image aren't needed.
+    if (!isProcessingOriginalImages())
+    {
+        QImage image = PDFImage::createImageByBands(m_document, stream, colorSpace, m_graphicState.getRenderingIntent(), m_CMS, this);
+        if (!image.isNull())
+        {
+            performImagePainting(image);
+            return;
+        }
+    }
+
     PDFImage pdfImage = PDFImage::createImage(m_document, stream, qMove(colorSpace), false, m_graphicState.getRenderingIntent(), this);
 
     if (!performOriginalImagePainting(pdfImage))
@@ -3151,6 +3173,8 @@ void PDFPageContentProcessor::drawText(const TextSequence& textSequence)
         const bool fill = isTextRenderingModeFilled(textRenderingMode);
         const bool stroke = isTextRenderingModeStroked(textRenderingMode);
         const bool clipped = isTextRenderingModeClipped(textRenderingMode);
+        const bool isTextMetricsOnly = this->isTextMetricsOnly();
+        const bool isTextPainted = !isContentSuppressed() && !isContentKindSuppressed(ContentKind::Text);
 
         // Detect horizontal writing system
         const bool isHorizontalWritingSystem = font->isHorizontalWritingSystem();
@@ -3191,10 +3215,15 @@ void PDFPageContentProcessor::drawText(const TextSequence& textSequence)
                         QMatrix textRenderingMatrix = adjustMatrix * textMatrix;
                         QMatrix toDeviceSpaceTransform = textRenderingMatrix * m_graphicState.getCurrentTransformationMatrix();
 
-                        if (!glyphPath.isEmpty())
+                        // Glyph is only a box in metrics only mode, so it can't be painted or used as clip
+                        if (!glyphPath.isEmpty() && !isTextMetricsOnly)
                         {
-                            QPainterPath transformedGlyph = textRenderingMatrix.map(glyphPath);
-                            processPathPainting(transformedGlyph, stroke, fill, true, transformedGlyph.fillRule());
+                            // Do not transform the glyph, if it is not painted
+                            if (isTextPainted)
+                            {
+                                QPainterPath transformedGlyph = textRenderingMatrix.map(glyphPath);
+                                processPathPainting(transformedGlyph, stroke, fill, true, transformedGlyph.fillRule());
+                            }
 
                             if (clipped)
                             {
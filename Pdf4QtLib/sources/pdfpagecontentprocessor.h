@@ -562,6 +562,11 @@ protected:
     /// \returns true, if image is successfully processed
     virtual bool performOriginalImagePainting(const PDFImage& image);
 
+    /// Returns true, if processor processes original images (in \p performOriginalImagePainting),
+    /// so image data must always be decoded as a whole. Otherwise, images can be decoded
+    /// band by band directly to the QImage.
+    virtual bool isProcessingOriginalImages() const;
+
     /// This function has to be implemented in the client drawing implementation, it should
     /// draw the image.
     /// \param image Image to be painted
@@ -642,6 +647,13 @@ protected:
     /// shading, images, ...)
     virtual bool isContentKindSuppressed(ContentKind kind) const;
 
+    /// Override this function to use font metrics instead of glyph outlines, if only
+    /// positions and boxes of output characters are needed. Text is then neither
+    /// painted nor used for clipping, and output characters have boxes created
+    /// from glyph widths and font ascent/descent as outlines. This is much faster,
+    /// than loading glyph outlines from the font program.
+    virtual bool isTextMetricsOnly() const;
+
     /// Sets current graphic state and updates data
     /// \param state New graphic state
     void setGraphicsState(const PDFPageContentProcessorState& state);
@@ -29,6 +29,9 @@
 #include <QOpenGLPaintDevice>
 #include <QOpenGLFramebufferObject>
 
+#include <map>
+#include <algorithm>
+
 namespace pdf
 {
 
@@ -211,10 +214,126 @@ QImage PDFRasterizer::render(PDFInteger pageIndex,
                              PDFRenderer::Features features,
                              const PDFAnnotationManager* annotationManager,
                              PageRotation extraRotation)
+{
+    QMatrix matrix = PDFRenderer::createPagePointToDevicePointMatrix(page, QRect(QPoint(0, 0), size), extraRotation);
+    return renderImpl(pageIndex, page, compiledPage, size, matrix, features, annotationManager);
+}
+
+QImage PDFRasterizer::renderRegion(PDFInteger pageIndex,
+                                   const PDFPage* page,
+                                   const PDFPrecompiledPage* compiledPage,
+                                   const QRectF& region,
+                                   QSize size,
+                                   PDFRenderer::Features features,
+                                   const PDFAnnotationManager* annotationManager,
+                                   PageRotation extraRotation)
+{
+    if (size.isEmpty() || !region.isValid())
+    {
+        return QImage();
+    }
+
+    // Map the page to the rectangle of its own size (so page rotation is applied)
+    // and then map the rotated region onto the target image.
+    const PageRotation rotation = getPageRotationCombined(page->getPageRotation(), extraRotation);
+    const QRectF rotatedMediaBox = page->getRotatedBox(page->getMediaBox(), rotation);
+    QMatrix pageMatrix = PDFRenderer::createPagePointToDevicePointMatrix(page, QRectF(QPointF(0, 0), rotatedMediaBox.size()), extraRotation);
+    QRectF deviceRegion = pageMatrix.mapRect(region);
+
+    if (deviceRegion.isEmpty())
+    {
+        return QImage();
+    }
+
+    QMatrix regionMatrix;
+    regionMatrix.scale(size.width() / deviceRegion.width(), size.height() / deviceRegion.height());
+    regionMatrix.translate(-deviceRegion.left(), -deviceRegion.top());
+
+    return renderImpl(pageIndex, page, compiledPage, size, pageMatrix * regionMatrix, features, annotationManager);
+}
+
+QImage PDFRasterizer::renderTile(PDFInteger pageIndex,
+                                 const PDFPage* page,
+                                 const PDFPrecompiledPage* compiledPage,
+                                 QSize pageImageSize,
+                                 QRect tileRect,
+                                 PDFRenderer::Features features,
+                                 const PDFAnnotationManager* annotationManager,
+                                 PageRotation extraRotation)
+{
+    tileRect = tileRect.intersected(QRect(QPoint(0, 0), pageImageSize));
+    if (tileRect.isEmpty())
+    {
+        return QImage();
+    }
+
+    // Page matrix is the same as for the whole page image, tile is just shifted to the origin
+    QMatrix matrix = PDFRenderer::createPagePointToDevicePointMatrix(page, QRect(QPoint(0, 0), pageImageSize), extraRotation);
+    matrix = matrix * QMatrix(1.0, 0.0, 0.0, 1.0, -tileRect.left(), -tileRect.top());
+
+    return renderImpl(pageIndex, page, compiledPage, tileRect.size(), matrix, features, annotationManager);
+}
+
+bool PDFRasterizer::renderTiles(PDFInteger pageIndex,
+                                const PDFPage* page,
+                                const PDFPrecompiledPage* compiledPage,
+                                QSize pageImageSize,
+                                QSize tileSize,
+                                PDFRenderer::Features features,
+                                const PDFAnnotationManager* annotationManager,
+                                PageRotation extraRotation,
+                                const ProcessTileMethod& processTile)
+{
+    Q_ASSERT(processTile);
+
+    for (const QRect& tileRect : getTiles(pageImageSize, tileSize))
+    {
+        QImage tile = renderTile(pageIndex, page, compiledPage, pageImageSize, tileRect, features, annotationManager, extraRotation);
+        if (tile.isNull() || !processTile(tileRect, qMove(tile)))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+std::vector<QRect> PDFRasterizer::getTiles(QSize imageSize, QSize tileSize)
+{
+    std::vector<QRect> tiles;
+
+    if (imageSize.isEmpty() || tileSize.isEmpty())
+    {
+        return tiles;
+    }
+
+    const int columns = (imageSize.width() + tileSize.width() - 1) / tileSize.width();
+    const int rows = (imageSize.height() + tileSize.height() - 1) / tileSize.height();
+    tiles.reserve(size_t(columns) * size_t(rows));
+
+    const QRect imageRect(QPoint(0, 0), imageSize);
+    for (int row = 0; row < rows; ++row)
+    {
+        for (int column = 0; column < columns; ++column)
+        {
+            QRect tileRect(QPoint(column * tileSize.width(), row * tileSize.height()), tileSize);
+            tiles.push_back(tileRect.intersected(imageRect));
+        }
+    }
+
+    return tiles;
+}
+
+QImage PDFRasterizer::renderImpl(PDFInteger pageIndex,
+                                 const PDFPage* page,
+                                 const PDFPrecompiledPage* compiledPage,
+                                 QSize size,
+                                 const QMatrix& matrix,
+                                 PDFRenderer::Features features,
+                                 const PDFAnnotationManager* annotationManager)
 {
     QImage image;
 
-    QMatrix matrix = PDFRenderer::createPagePointToDevicePointMatrix(page, QRect(QPoint(0, 0), size), extraRotation);
     if (m_features.testFlag(UseOpenGL) && m_features.testFlag(ValidOpenGL))
     {
         // We have valid OpenGL context, try to select it and possibly create framebuffer object
@@ -400,12 +519,20 @@ void PDFRasterizerPool::render(const std::vector<PDFInteger>& pageIndices,
                                const PDFRasterizerPool::ProcessImageMethod& processImage,
                                PDFProgress* progress)
 {
-    if (pageIndices.empty())
+    render(pageIndices, std::vector<PageImageSizeGetter>{ imageSizeGetter }, processImage, progress);
+}
+
+void PDFRasterizerPool::render(const std::vector<PDFInteger>& pageIndices,
+                               const std::vector<PageImageSizeGetter>& imageSizeGetters,
+                               const PDFRasterizerPool::ProcessImageMethod& processImage,
+                               PDFProgress* progress)
+{
+    if (pageIndices.empty() || imageSizeGetters.empty())
     {
         return;
     }
 
-    Q_ASSERT(imageSizeGetter);
+    Q_ASSERT(std::all_of(imageSizeGetters.cbegin(), imageSizeGetters.cend(), [](const PageImageSizeGetter& getter) { return bool(getter); }));
     Q_ASSERT(processImage);
 
     QElapsedTimer timer;
@@ -413,44 +540,58 @@ void PDFRasterizerPool::render(const std::vector<PDFInteger>& pageIndices,
 
     emit renderError(PDFCatalog::INVALID_PAGE_INDEX, PDFRenderError(RenderErrorType::Information, PDFTranslationContext::tr("Start at %1...").arg(QTime::currentTime().toString(Qt::TextDate))));
 
+    // Each image (page and its size) is rendered as a separate task,
+    // so images of different sizes of the same page are rendered concurrently.
+    // Page is compiled by the first task, which needs it. Tasks of the same page,
+    // which start while the page is being compiled, do not wait for it (they would
+    // block threads of the pool), they leave their images to the compiling task.
+    // When all images of the page are rendered, compiled page is released.
+    struct PageTask
+    {
+        QMutex mutex;
+        bool isCompiling = false;
+        PDFPrecompiledPageCache::PrecompiledPagePointer precompiledPage;
+        std::vector<size_t> deferredImageSizeIndices;
+        size_t remainingImages = 0;
+    };
+
+    std::map<PDFInteger, PageTask> pageTasks;
+    std::vector<std::pair<PDFInteger, size_t>> imageTasks;
+    imageTasks.reserve(pageIndices.size() * imageSizeGetters.size());
+    for (PDFInteger pageIndex : pageIndices)
+    {
+        PageTask& pageTask = pageTasks[pageIndex];
+        for (size_t i = 0; i < imageSizeGetters.size(); ++i)
+        {
+            imageTasks.emplace_back(pageIndex, i);
+            ++pageTask.remainingImages;
+        }
+    }
+
     if (progress)
     {
         ProgressStartupInfo info;
         info.showDialog = true;
         info.text = PDFTranslationContext::tr("Rendering document into images.");
-        progress->start(pageIndices.size(), qMove(info));
+        progress->start(imageTasks.size(), qMove(info));
     }
-    auto processPage = [this, progress, &imageSizeGetter, &processImage](const PDFInteger pageIndex)
-    {
-        const PDFPage* page = m_document->getCatalog()->getPage(pageIndex);
-
-        if (!page)
-        {
-            if (progress)
-            {
-                progress->step();
-            }
-            emit renderError(pageIndex, PDFRenderError(RenderErrorType::Error, PDFTranslationContext::tr("Page %1 not found.").arg(pageIndex)));
-            return;
-        }
 
+    auto renderImage = [this, progress, &imageSizeGetters, &processImage](PDFInteger pageIndex,
+                                                                          const PDFPage* page,
+                                                                          size_t imageSizeIndex,
+                                                                          const PDFPrecompiledPage* precompiledPage,
+                                                                          qint64 pageCompileTime,
+                                                                          qint64 pageCompileWaitTime)
+    {
         QElapsedTimer totalPageTimer;
         totalPageTimer.start();
 
-        QElapsedTimer pageTimer;
-        pageTimer.start();
-
-        // Precompile the page
-        PDFPrecompiledPage precompiledPage;
-        PDFCMSPointer cms = m_cmsManager->getCurrentCMS();
-        PDFRenderer renderer(m_document, m_fontCache, cms.data(), m_optionalContentActivity, m_features, m_meshQualitySettings);
-        renderer.compile(&precompiledPage, pageIndex);
-
-        qint64 pageCompileTime = pageTimer.restart();
-
-        for (const PDFRenderError& error : precompiledPage.getErrors())
+        if (imageSizeIndex == 0)
         {
-            emit renderError(pageIndex, error);
+            for (const PDFRenderError& error : precompiledPage->getErrors())
+            {
+                emit renderError(pageIndex, error);
+            }
         }
 
         // We can const-cast here, because we do not modify the document in annotation manager.
@@ -461,22 +602,70 @@ void PDFRasterizerPool::render(const std::vector<PDFInteger>& pageIndices,
         PDFAnnotationManager annotationManager(m_fontCache, m_cmsManager, m_optionalContentActivity, m_meshQualitySettings, m_features, PDFAnnotationManager::Target::Print, nullptr);
         annotationManager.setDocument(modifiedDocument);
 
+        PDFRenderedPageImage renderedPageImage;
+        renderedPageImage.pageIndex = pageIndex;
+        renderedPageImage.imageSizeIndex = imageSizeIndex;
+        renderedPageImage.pageImageSize = imageSizeGetters[imageSizeIndex](page);
+
+        std::unique_ptr<PDFImageBandWriter> bandWriter;
+        if (m_bandWriterGetter && m_bandHeight > 0)
+        {
+            bandWriter = m_bandWriterGetter(renderedPageImage);
+        }
+
         // Render page to image
-        pageTimer.restart();
+        QElapsedTimer pageTimer;
+        pageTimer.start();
         PDFRasterizer* rasterizer = acquire();
-        qint64 pageWaitTime = pageTimer.restart();
-        QImage image = rasterizer->render(pageIndex, page, &precompiledPage, imageSizeGetter(page), m_features, &annotationManager, PageRotation::None);
-        qint64 pageRenderTime = pageTimer.elapsed();
+        qint64 pageWaitTime = pageTimer.restart() + pageCompileWaitTime;
+        qint64 pageWriteTime = 0;
+        if (bandWriter)
+        {
+            // Bands are written while rasterizer is acquired, so only
+            // one band of the page image exists at a time.
+            QElapsedTimer writeTimer;
+            auto writeBand = [&bandWriter, &writeTimer, &pageWriteTime](const QRect&, QImage band)
+            {
+                writeTimer.start();
+                const bool isWritten = bandWriter->writeBand(band);
+                pageWriteTime += writeTimer.elapsed();
+                return isWritten;
+            };
+
+            const QSize bandSize(renderedPageImage.pageImageSize.width(), m_bandHeight);
+            writeTimer.start();
+            bool isWritten = bandWriter->begin(renderedPageImage.pageImageSize);
+            pageWriteTime += writeTimer.elapsed();
+            isWritten = isWritten && rasterizer->renderTiles(pageIndex, page, precompiledPage, renderedPageImage.pageImageSize, bandSize, m_features, &annotationManager, PageRotation::None, writeBand);
+            writeTimer.start();
+            isWritten = bandWriter->finish() && isWritten;
+            pageWriteTime += writeTimer.elapsed();
+
+            if (!isWritten)
+            {
+                QString errorString = bandWriter->getErrorString();
+                if (errorString.isEmpty())
+                {
+                    errorString = PDFTranslationContext::tr("page image can't be rendered");
+                }
+                emit renderError(pageIndex, PDFRenderError(RenderErrorType::Error, PDFTranslationContext::tr("Cannot write page image to file '%1', because: %2.").arg(bandWriter->getFileName(), errorString)));
+            }
+
+            renderedPageImage.isBandWritten = true;
+        }
+        else
+        {
+            renderedPageImage.pageImage = rasterizer->render(pageIndex, page, precompiledPage, renderedPageImage.pageImageSize, m_features, &annotationManager, PageRotation::None);
+        }
+        qint64 pageRenderTime = pageTimer.elapsed() - pageWriteTime;
         release(rasterizer);
 
         // Now, process the image
-        PDFRenderedPageImage renderedPageImage;
-        renderedPageImage.pageIndex = pageIndex;
-        renderedPageImage.pageImage = qMove(image);
         renderedPageImage.pageCompileTime = pageCompileTime;
         renderedPageImage.pageWaitTime = pageWaitTime;
         renderedPageImage.pageRenderTime = pageRenderTime;
-        renderedPageImage.pageTotalTime = totalPageTimer.elapsed();
+        renderedPageImage.pageWriteTime = pageWriteTime;
+        renderedPageImage.pageTotalTime = totalPageTimer.elapsed() - pageWriteTime + pageCompileTime + pageCompileWaitTime;
         processImage(renderedPageImage);
 
         if (progress)
@@ -484,7 +673,108 @@ void PDFRasterizerPool::render(const std::vector<PDFInteger>& pageIndices,
             progress->step();
         }
     };
-    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, pageIndices.cbegin(), pageIndices.cend(), processPage);
+
+    auto processImageTask = [this, progress, &pageTasks, &renderImage](const std::pair<PDFInteger, size_t>& imageTask)
+    {
+        const PDFInteger pageIndex = imageTask.first;
+        const size_t imageSizeIndex = imageTask.second;
+        const PDFPage* page = m_document->getCatalog()->getPage(pageIndex);
+
+        if (!page)
+        {
+            if (progress)
+            {
+                progress->step();
+            }
+
+            if (imageSizeIndex == 0)
+            {
+                emit renderError(pageIndex, PDFRenderError(RenderErrorType::Error, PDFTranslationContext::tr("Page %1 not found.").arg(pageIndex)));
+            }
+            return;
+        }
+
+        // Take the compiled page from the page task or from the cache. If page
+        // is being compiled by another task, leave the image to that task.
+        PageTask& pageTask = pageTasks.at(pageIndex);
+        PDFPrecompiledPageCache::PrecompiledPagePointer precompiledPage;
+
+        {
+            QMutexLocker lock(&pageTask.mutex);
+
+            if (!pageTask.precompiledPage && m_precompiledPageCache)
+            {
+                pageTask.precompiledPage = m_precompiledPageCache->getPage(pageIndex);
+            }
+
+            if (pageTask.precompiledPage)
+            {
+                precompiledPage = pageTask.precompiledPage;
+
+                // If this is the last image of the page, task no longer needs to hold the compiled page
+                if (--pageTask.remainingImages == 0)
+                {
+                    pageTask.precompiledPage.reset();
+                }
+            }
+            else if (pageTask.isCompiling)
+            {
+                pageTask.deferredImageSizeIndices.push_back(imageSizeIndex);
+                return;
+            }
+            else
+            {
+                pageTask.isCompiling = true;
+            }
+        }
+
+        if (precompiledPage)
+        {
+            renderImage(pageIndex, page, imageSizeIndex, precompiledPage.data(), 0, 0);
+            return;
+        }
+
+        // Compile the page, page task is not locked, so other tasks
+        // of the page can leave their images to this task.
+        QElapsedTimer pageTimer;
+        pageTimer.start();
+
+        QSharedPointer<PDFPrecompiledPage> compiledPage(new PDFPrecompiledPage());
+        PDFCMSPointer cms = m_cmsManager->getCurrentCMS();
+        PDFRenderer renderer(m_document, m_fontCache, cms.data(), m_optionalContentActivity, m_features, m_meshQualitySettings);
+        renderer.compile(compiledPage.data(), pageIndex);
+        precompiledPage = qMove(compiledPage);
+
+        if (m_precompiledPageCache)
+        {
+            m_precompiledPageCache->insertPage(pageIndex, precompiledPage);
+        }
+
+        const qint64 pageCompileTime = pageTimer.elapsed();
+        std::vector<size_t> imageSizeIndices = { imageSizeIndex };
+
+        {
+            QMutexLocker lock(&pageTask.mutex);
+
+            pageTask.isCompiling = false;
+            imageSizeIndices.insert(imageSizeIndices.end(), pageTask.deferredImageSizeIndices.cbegin(), pageTask.deferredImageSizeIndices.cend());
+            pageTask.deferredImageSizeIndices.clear();
+
+            // Tasks starting from now take the compiled page from the page task
+            pageTask.remainingImages -= imageSizeIndices.size();
+            if (pageTask.remainingImages > 0)
+            {
+                pageTask.precompiledPage = precompiledPage;
+            }
+        }
+
+        // Deferred images have waited for the page compilation
+        for (size_t i = 0; i < imageSizeIndices.size(); ++i)
+        {
+            renderImage(pageIndex, page, imageSizeIndices[i], precompiledPage.data(), (i == 0) ? pageCompileTime : 0, (i == 0) ? 0 : pageCompileTime);
+        }
+    };
+    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, imageTasks.cbegin(), imageTasks.cend(), processImageTask);
 
     if (progress)
     {
@@ -495,6 +785,60 @@ void PDFRasterizerPool::render(const std::vector<PDFInteger>& pageIndices,
     emit renderError(PDFCatalog::INVALID_PAGE_INDEX, PDFRenderError(RenderErrorType::Information, PDFTranslationContext::tr("%1 miliseconds elapsed to render %2 pages...").arg(timer.nsecsElapsed() / 1000000).arg(pageIndices.size())));
 }
 
+PDFPrecompiledPageCache::PDFPrecompiledPageCache(int byteBudget)
+{
+    m_cache.setMaxCost(byteBudget);
+}
+
+PDFPrecompiledPageCache::PrecompiledPagePointer PDFPrecompiledPageCache::getPage(PDFInteger pageIndex) const
+{
+    QMutexLocker lock(&m_mutex);
+
+    if (const PrecompiledPagePointer* page = m_cache.object(pageIndex))
+    {
+        return *page;
+    }
+
+    return PrecompiledPagePointer();
+}
+
+void PDFPrecompiledPageCache::insertPage(PDFInteger pageIndex, PrecompiledPagePointer page)
+{
+    Q_ASSERT(page);
+
+    const qint64 memoryConsumptionEstimate = page->getMemoryConsumptionEstimate();
+
+    QMutexLocker lock(&m_mutex);
+    if (memoryConsumptionEstimate <= m_cache.maxCost())
+    {
+        m_cache.insert(pageIndex, new PrecompiledPagePointer(qMove(page)), int(memoryConsumptionEstimate));
+    }
+}
+
+void PDFPrecompiledPageCache::clear()
+{
+    QMutexLocker lock(&m_mutex);
+    m_cache.clear();
+}
+
+int PDFPrecompiledPageCache::getByteBudget() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_cache.maxCost();
+}
+
+void PDFPrecompiledPageCache::setByteBudget(int byteBudget)
+{
+    QMutexLocker lock(&m_mutex);
+    m_cache.setMaxCost(byteBudget);
+}
+
+void PDFRasterizerPool::setBandWriterGetter(BandWriterGetter bandWriterGetter, int bandHeight)
+{
+    m_bandWriterGetter = qMove(bandWriterGetter);
+    m_bandHeight = bandHeight;
+}
+
 int PDFRasterizerPool::getDefaultRasterizerCount()
 {
     int hint = QThread::idealThreadCount() / 2;
@@ -21,7 +21,9 @@
 #include "pdfpage.h"
 #include "pdfexception.h"
 #include "pdfmeshqualitysettings.h"
+#include "pdfimagebandwriter.h"
 
+#include <QCache>
 #include <QMutex>
 #include <QSemaphore>
 #include <QImageWriter>
@@ -62,6 +64,7 @@ public:
         InvertColors            = 0x0100,   ///< Invert colors
         DenyExtraGraphics       = 0x0200,   ///< Do not display additional graphics, for example from tools
         DisplayAnnotations      = 0x0400,   ///< Display annotations
+        ExactTextOutlines       = 0x0800,   ///< Text layout uses exact glyph outlines instead of boxes from font metrics (slower)
     };
 
     Q_DECLARE_FLAGS(Features, Feature)
@@ -172,7 +175,98 @@ public:
                   const PDFAnnotationManager* annotationManager,
                   PageRotation extraRotation);
 
+    /// Renders region of the page to the image of given size. Region is given
+    /// in page coordinates (the same coordinate system as crop box) and is mapped
+    /// onto the whole image, so aspect ratio of the region (after page rotation)
+    /// should match aspect ratio of the image. Only the region is rasterized,
+    /// so memory consumption is proportional to \p size, not to the size of the
+    /// whole page at the same resolution. If some error occurs, then empty image
+    /// is returned. This function is not thread safe.
+    /// \param pageIndex Page index
+    /// \param page Page
+    /// \param compiledPage Compiled page contents
+    /// \param region Region of the page in page coordinates
+    /// \param size Size of the target image
+    /// \param features Renderer features
+    /// \param annotationManager Annotation manager (can be nullptr)
+    /// \param extraRotation Extra page rotation
+    QImage renderRegion(PDFInteger pageIndex,
+                        const PDFPage* page,
+                        const PDFPrecompiledPage* compiledPage,
+                        const QRectF& region,
+                        QSize size,
+                        PDFRenderer::Features features,
+                        const PDFAnnotationManager* annotationManager,
+                        PageRotation extraRotation);
+
+    /// Renders tile of the page image. Page is rendered as if it was rendered
+    /// to the image of size \p pageImageSize (using \p render function), but
+    /// only pixels in \p tileRect are rasterized. Resulting image has size
+    /// of the tile (tile rectangle is clipped to the page image). This function
+    /// is not thread safe.
+    /// \param pageIndex Page index
+    /// \param page Page
+    /// \param compiledPage Compiled page contents
+    /// \param pageImageSize Size of the whole page image
+    /// \param tileRect Tile rectangle in page image coordinates
+    /// \param features Renderer features
+    /// \param annotationManager Annotation manager (can be nullptr)
+    /// \param extraRotation Extra page rotation
+    QImage renderTile(PDFInteger pageIndex,
+                      const PDFPage* page,
+                      const PDFPrecompiledPage* compiledPage,
+                      QSize pageImageSize,
+                      QRect tileRect,
+                      PDFRenderer::Features features,
+                      const PDFAnnotationManager* annotationManager,
+                      PageRotation extraRotation);
+
+    /// Processes rendered tile. Returns false, if tile rendering
+    /// should be stopped (for example, if tile can't be written).
+    using ProcessTileMethod = std::function<bool(const QRect&, QImage)>;
+
+    /// Renders page image of size \p pageImageSize tile by tile. Tiles have
+    /// fixed size \p tileSize (tiles in the last column and row can be smaller)
+    /// and are processed in row-major order (left to right, top to bottom), so
+    /// huge images can be written sequentially, with memory consumption bounded
+    /// by tile size. Horizontal bands (strips) can be rendered by setting tile
+    /// width to the image width. Returns true, if all tiles were processed.
+    /// This function is not thread safe.
+    /// \param pageIndex Page index
+    /// \param page Page
+    /// \param compiledPage Compiled page contents
+    /// \param pageImageSize Size of the whole page image
+    /// \param tileSize Size of the tile
+    /// \param features Renderer features
+    /// \param annotationManager Annotation manager (can be nullptr)
+    /// \param extraRotation Extra page rotation
+    /// \param processTile Tile processing callback
+    bool renderTiles(PDFInteger pageIndex,
+                     const PDFPage* page,
+                     const PDFPrecompiledPage* compiledPage,
+                     QSize pageImageSize,
+                     QSize tileSize,
+                     PDFRenderer::Features features,
+                     const PDFAnnotationManager* annotationManager,
+                     PageRotation extraRotation,
+                     const ProcessTileMethod& processTile);
+
+    /// Returns tile rectangles of the image of given size in row-major order.
+    /// Tiles in the last column and row are clipped to the image.
+    /// \param imageSize Image size
+    /// \param tileSize Tile size
+    static std::vector<QRect> getTiles(QSize imageSize, QSize tileSize);
+
 private:
+    /// Renders page to the image of given size using given page to device matrix
+    QImage renderImpl(PDFInteger pageIndex,
+                      const PDFPage* page,
+                      const PDFPrecompiledPage* compiledPage,
+                      QSize size,
+                      const QMatrix& matrix,
+                      PDFRenderer::Features features,
+                      const PDFAnnotationManager* annotationManager);
+
     void initializeOpenGL();
     void releaseOpenGL();
 
@@ -190,10 +284,57 @@ struct PDFRenderedPageImage
     qint64 pageWaitTime = 0;
     qint64 pageRenderTime = 0;
     qint64 pageTotalTime = 0;
+    qint64 pageWriteTime = 0;   ///< Time spent in band writer (if band writer was used)
     PDFInteger pageIndex;
+    size_t imageSizeIndex = 0; ///< Index of image size getter, which was used to determine image size
+    QSize pageImageSize;        ///< Size of the page image
+    bool isBandWritten = false; ///< Page image was written by band writer, so page image is empty
     QImage pageImage;
 };
 
+/// Thread safe cache of precompiled pages. Cache can be shared between multiple
+/// render requests of the same document (for example, when document is rendered
+/// to images in several resolutions), so each page is compiled only once. Cache
+/// is bound to one document and one renderer setup (features, color management,
+/// optional content activity), so it must be cleared, when any of them changes.
+/// Memory consumption is limited by byte budget, size of the page is estimated
+/// using \p PDFPrecompiledPage::getMemoryConsumptionEstimate.
+class PDF4QTLIBSHARED_EXPORT PDFPrecompiledPageCache
+{
+public:
+    using PrecompiledPagePointer = QSharedPointer<const PDFPrecompiledPage>;
+
+    /// Creates new cache of precompiled pages
+    /// \param byteBudget Cache limit [bytes]
+    explicit PDFPrecompiledPageCache(int byteBudget);
+
+    /// Returns precompiled page from the cache. If page is not found,
+    /// then null pointer is returned. Returned page remains valid,
+    /// even if it is removed from the cache.
+    /// \param pageIndex Page index
+    PrecompiledPagePointer getPage(PDFInteger pageIndex) const;
+
+    /// Inserts precompiled page into the cache. If page is larger,
+    /// than byte budget of the cache, it is not inserted.
+    /// \param pageIndex Page index
+    /// \param page Precompiled page
+    void insertPage(PDFInteger pageIndex, PrecompiledPagePointer page);
+
+    /// Removes all pages from the cache
+    void clear();
+
+    /// Returns cache limit [bytes]
+    int getByteBudget() const;
+
+    /// Sets cache limit [bytes]
+    /// \param byteBudget Cache limit [bytes]
+    void setByteBudget(int byteBudget);
+
+private:
+    mutable QMutex m_mutex;
+    mutable QCache<PDFInteger, PrecompiledPagePointer> m_cache;
+};
+
 /// Pool of page image renderers. It can use predefined number of renderers to
 /// render page images asynchronously. You can use this object in two ways -
 /// first one is as standard object pool, second one is to directly render
@@ -211,6 +352,10 @@ public:
     using PageImageSizeGetter = std::function<QSize(const PDFPage*)>;
     using ProcessImageMethod = std::function<void(PDFRenderedPageImage&)>;
 
+    /// Returns band writer for the page image (page index, image size index and page
+    /// image size are set), or nullptr, if page image should be rendered as a whole.
+    using BandWriterGetter = std::function<std::unique_ptr<PDFImageBandWriter>(const PDFRenderedPageImage&)>;
+
     /// Creates new rasterizer pool
     /// \param document Document
     /// \param fontCache Font cache
@@ -253,6 +398,39 @@ public:
                 const ProcessImageMethod& processImage,
                 PDFProgress* progress);
 
+    /// Renders pages asynchronously to images of multiple sizes. Each page
+    /// is compiled only once, and images of all sizes are rendered from the same
+    /// compiled page. Threads never wait for the page compilation, images
+    /// of the page being compiled are rendered by the compiling thread after
+    /// the compilation, other images are rendered concurrently. Image size
+    /// getter, which was used for the rendered image, can be determined
+    /// from \p PDFRenderedPageImage::imageSizeIndex.
+    /// \param pageIndices Page indices for rendered pages
+    /// \param imageSizeGetters Getters, which compute image sizes from page index
+    /// \param processImage Method, which processes rendered page images
+    /// \param progress Progress indicator
+    void render(const std::vector<PDFInteger>& pageIndices,
+                const std::vector<PageImageSizeGetter>& imageSizeGetters,
+                const ProcessImageMethod& processImage,
+                PDFProgress* progress);
+
+    /// Sets cache of precompiled pages, which is used by \p render function.
+    /// Pages are taken from the cache, and newly compiled pages are inserted
+    /// into the cache. Cache must outlive the render call, and must belong
+    /// to the same document and settings as the pool. Pass nullptr to disable it.
+    /// \param cache Cache of precompiled pages (can be nullptr)
+    void setPrecompiledPageCache(PDFPrecompiledPageCache* cache) { m_precompiledPageCache = cache; }
+
+    /// Enables band rendering. If band writer getter returns band writer for the page
+    /// image, then page image is rendered in horizontal bands of given height, which
+    /// are passed to the band writer, so only one band of the page image is held
+    /// in the memory. Process image method then receives empty page image with
+    /// \p PDFRenderedPageImage::isBandWritten flag set. Write errors are reported
+    /// using \p renderError signal. Pass empty getter, or zero band height, to disable it.
+    /// \param bandWriterGetter Band writer getter
+    /// \param bandHeight Height of the band (in pixels)
+    void setBandWriterGetter(BandWriterGetter bandWriterGetter, int bandHeight);
+
     /// Returns default rasterizer count
     static int getDefaultRasterizerCount();
 
@@ -273,6 +451,9 @@ private:
     const PDFOptionalContentActivity* m_optionalContentActivity;
     PDFRenderer::Features m_features;
     const PDFMeshQualitySettings& m_meshQualitySettings;
+    PDFPrecompiledPageCache* m_precompiledPageCache = nullptr;
+    BandWriterGetter m_bandWriterGetter;
+    int m_bandHeight = 0;
 
     QSemaphore m_semaphore;
     QMutex m_mutex;
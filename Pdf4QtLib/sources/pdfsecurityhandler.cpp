@@ -28,6 +28,7 @@
 #include <openssl/md5.h>
 #include <openssl/aes.h>
 #include <openssl/sha.h>
+#include <openssl/evp.h>
 
 #include <array>
 
@@ -804,6 +805,77 @@ PDFSecurityHandler::AuthorizationResult PDFStandardSecurityHandler::authenticate
     return AuthorizationResult::Cancelled;
 }
 
+/// Encrypts or decrypts data using AES algorithm in CBC mode. Size of the data must be
+/// multiple of AES block size, no padding is added nor removed. EVP interface is used,
+/// so hardware acceleration (AES-NI) is used, if it is available.
+/// \param key Key (16 bytes for AES-128, 32 bytes for AES-256)
+/// \param keyLength Key length in bytes
+/// \param initializationVector Initialization vector (AES block size)
+/// \param data Data to be processed
+/// \param encrypt Encrypt (true), or decrypt (false) the data
+static QByteArray processAES_CBC(const uint8_t* key, int keyLength, const QByteArray& initializationVector, const QByteArray& data, bool encrypt)
+{
+    Q_ASSERT(initializationVector.size() == AES_BLOCK_SIZE);
+    Q_ASSERT(data.size() % AES_BLOCK_SIZE == 0);
+
+    const EVP_CIPHER* cipher = (keyLength == 32) ? EVP_aes_256_cbc() : EVP_aes_128_cbc();
+    QByteArray result(data.size(), Qt::Uninitialized);
+
+    EVP_CIPHER_CTX* context = EVP_CIPHER_CTX_new();
+    Q_ASSERT(context);
+
+    int outputLength = 0;
+    int finalLength = 0;
+    if (EVP_CipherInit_ex(context, cipher, nullptr, key, convertByteArrayToUcharPtr(initializationVector), encrypt ? 1 : 0) != 1 ||
+        EVP_CIPHER_CTX_set_padding(context, 0) != 1 ||
+        EVP_CipherUpdate(context, convertByteArrayToUcharPtr(result), &outputLength, convertByteArrayToUcharPtr(data), data.size()) != 1 ||
+        EVP_CipherFinal_ex(context, convertByteArrayToUcharPtr(result) + outputLength, &finalLength) != 1)
+    {
+        result.clear();
+    }
+    else
+    {
+        result.resize(outputLength + finalLength);
+    }
+
+    EVP_CIPHER_CTX_free(context);
+    return result;
+}
+
+const std::vector<uint8_t>& PDFStandardSecurityHandler::getObjectEncryptionKey(PDFObjectReference reference, CryptFilter filter) const
+{
+    Q_ASSERT(filter.type == CryptFilterType::V2 || filter.type == CryptFilterType::AESV2);
+
+    // All strings and stream of the object are encrypted with the
+    // same object key, and objects are usually processed one after another, so
+    // we remember the last key (for each thread, because objects are decrypted
+    // in parallel).
+    struct ObjectEncryptionKeyCache
+    {
+        QByteArray fileEncryptionKey;
+        PDFObjectReference reference;
+        CryptFilterType type = CryptFilterType::None;
+        int keyLength = 0;
+        std::vector<uint8_t> objectEncryptionKey;
+    };
+    static thread_local ObjectEncryptionKeyCache cache;
+
+    if (cache.objectEncryptionKey.empty() ||
+        !(cache.reference == reference) ||
+        cache.type != filter.type ||
+        cache.keyLength != filter.keyLength ||
+        cache.fileEncryptionKey != m_authorizationData.fileEncryptionKey)
+    {
+        cache.fileEncryptionKey = m_authorizationData.fileEncryptionKey;
+        cache.reference = reference;
+        cache.type = filter.type;
+        cache.keyLength = filter.keyLength;
+        cache.objectEncryptionKey = (filter.type == CryptFilterType::V2) ? createV2_ObjectEncryptionKey(reference, filter) : createAESV2_ObjectEncryptionKey(reference);
+    }
+
+    return cache.objectEncryptionKey;
+}
+
 std::vector<uint8_t> PDFStandardSecurityHandler::createV2_ObjectEncryptionKey(PDFObjectReference reference, CryptFilter filter) const
 {
     std::vector<uint8_t> inputKeyData = convertByteArrayToVector(m_authorizationData.fileEncryptionKey);
@@ -896,7 +968,7 @@ QByteArray PDFStandardSecurityHandler::decryptUsingFilter(const QByteArray& data
 
         case CryptFilterType::V2:         // Use file encryption key for RC4 algorithm
         {
-            std::vector<uint8_t> objectEncryptionKey = createV2_ObjectEncryptionKey(reference, filter);
+            const std::vector<uint8_t>& objectEncryptionKey = getObjectEncryptionKey(reference, filter);
             decryptedData.resize(data.size());
 
             RC4_KEY key = { };
@@ -908,18 +980,13 @@ QByteArray PDFStandardSecurityHandler::decryptUsingFilter(const QByteArray& data
 
         case CryptFilterType::AESV2:      // Use file encryption key for AES algorithm
         {
-            std::vector<uint8_t> objectEncryptionKey = createAESV2_ObjectEncryptionKey(reference);
+            const std::vector<uint8_t>& objectEncryptionKey = getObjectEncryptionKey(reference, filter);
 
             // For AES algorithm, always use 16 bytes key (128 bit encryption mode)
-
-            AES_KEY key = { };
-            AES_set_decrypt_key(objectEncryptionKey.data(), static_cast<int>(objectEncryptionKey.size()) * 8, &key);
-
             AES_data aes_data = prepareAES_data(data);
             if (!aes_data.paddedData.isEmpty())
             {
-                decryptedData.resize(aes_data.paddedData.size());
-                AES_cbc_encrypt(convertByteArrayToUcharPtr(aes_data.paddedData), convertByteArrayToUcharPtr(decryptedData), aes_data.paddedData.length(), &key, convertByteArrayToUcharPtr(aes_data.initializationVector), AES_DECRYPT);
+                decryptedData = processAES_CBC(objectEncryptionKey.data(), static_cast<int>(objectEncryptionKey.size()), aes_data.initializationVector, aes_data.paddedData, false);
                 decryptedData = removeAES_padding(decryptedData);
             }
 
@@ -929,14 +996,11 @@ QByteArray PDFStandardSecurityHandler::decryptUsingFilter(const QByteArray& data
         case CryptFilterType::AESV3:      // Use file encryption key for AES 256 bit algorithm
         {
             Q_ASSERT(m_authorizationData.fileEncryptionKey.size() == 32);
-            AES_KEY key = { };
-            AES_set_decrypt_key(convertByteArrayToUcharPtr(m_authorizationData.fileEncryptionKey), static_cast<int>(m_authorizationData.fileEncryptionKey.size()) * 8, &key);
 
             AES_data aes_data = prepareAES_data(data);
             if (!aes_data.paddedData.isEmpty())
             {
-                decryptedData.resize(aes_data.paddedData.size());
-                AES_cbc_encrypt(convertByteArrayToUcharPtr(aes_data.paddedData), convertByteArrayToUcharPtr(decryptedData), aes_data.paddedData.length(), &key, convertByteArrayToUcharPtr(aes_data.initializationVector), AES_DECRYPT);
+                decryptedData = processAES_CBC(convertByteArrayToUcharPtr(m_authorizationData.fileEncryptionKey), static_cast<int>(m_authorizationData.fileEncryptionKey.size()), aes_data.initializationVector, aes_data.paddedData, false);
                 decryptedData = removeAES_padding(decryptedData);
             }
 
@@ -1005,7 +1069,7 @@ QByteArray PDFStandardSecurityHandler::encryptUsingFilter(const QByteArray& data
         case CryptFilterType::V2:         // Use file encryption key for RC4 algorithm
         {
             // This algorithm is same as the encrypt algorithm, because RC4 cipher is symmetrical
-            std::vector<uint8_t> objectEncryptionKey = createV2_ObjectEncryptionKey(reference, filter);
+            const std::vector<uint8_t>& objectEncryptionKey = getObjectEncryptionKey(reference, filter);
             encryptedData.resize(data.size());
 
             RC4_KEY key = { };
@@ -1017,20 +1081,14 @@ QByteArray PDFStandardSecurityHandler::encryptUsingFilter(const QByteArray& data
 
         case CryptFilterType::AESV2:      // Use file encryption key for AES algorithm
         {
-            std::vector<uint8_t> objectEncryptionKey = createAESV2_ObjectEncryptionKey(reference);
+            const std::vector<uint8_t>& objectEncryptionKey = getObjectEncryptionKey(reference, filter);
 
             // For AES algorithm, always use 16 bytes key (128 bit encryption mode)
-
-            AES_KEY key = { };
-            AES_set_encrypt_key(objectEncryptionKey.data(), static_cast<int>(objectEncryptionKey.size()) * 8, &key);
-
             AES_data aes_data = prepareAES_data(data);
             if (!aes_data.paddedData.isEmpty())
             {
-                QByteArray initializationVectorCopy = aes_data.initializationVector;
-                encryptedData.resize(aes_data.paddedData.size());
-                AES_cbc_encrypt(convertByteArrayToUcharPtr(aes_data.paddedData), convertByteArrayToUcharPtr(encryptedData), aes_data.paddedData.length(), &key, convertByteArrayToUcharPtr(aes_data.initializationVector), AES_ENCRYPT);
-                encryptedData.prepend(initializationVectorCopy);
+                encryptedData = processAES_CBC(objectEncryptionKey.data(), static_cast<int>(objectEncryptionKey.size()), aes_data.initializationVector, aes_data.paddedData, true);
+                encryptedData.prepend(aes_data.initializationVector);
             }
 
             break;
@@ -1039,16 +1097,12 @@ QByteArray PDFStandardSecurityHandler::encryptUsingFilter(const QByteArray& data
         case CryptFilterType::AESV3:      // Use file encryption key for AES 256 bit algorithm
         {
             Q_ASSERT(m_authorizationData.fileEncryptionKey.size() == 32);
-            AES_KEY key = { };
-            AES_set_encrypt_key(convertByteArrayToUcharPtr(m_authorizationData.fileEncryptionKey), static_cast<int>(m_authorizationData.fileEncryptionKey.size()) * 8, &key);
 
             AES_data aes_data = prepareAES_data(data);
             if (!aes_data.paddedData.isEmpty())
             {
-                QByteArray initializationVectorCopy = aes_data.initializationVector;
-                encryptedData.resize(aes_data.paddedData.size());
-                AES_cbc_encrypt(convertByteArrayToUcharPtr(aes_data.paddedData), convertByteArrayToUcharPtr(encryptedData), aes_data.paddedData.length(), &key, convertByteArrayToUcharPtr(aes_data.initializationVector), AES_ENCRYPT);
-                encryptedData.prepend(initializationVectorCopy);
+                encryptedData = processAES_CBC(convertByteArrayToUcharPtr(m_authorizationData.fileEncryptionKey), static_cast<int>(m_authorizationData.fileEncryptionKey.size()), aes_data.initializationVector, aes_data.paddedData, true);
+                encryptedData.prepend(aes_data.initializationVector);
             }
 
             break;
@@ -326,6 +326,13 @@ private:
     /// \returns Encrypted data
     QByteArray encryptUsingFilter(const QByteArray& data, CryptFilter filter, PDFObjectReference reference) const;
 
+    /// Returns object encryption key for V2 (RC4) or AESV2 filter. Last used key
+    /// is cached, so key is not computed again for each string of the object.
+    /// Returned reference is valid until next call of this function in the same thread.
+    /// \param reference Object reference for key generation
+    /// \param filter Filter (V2 or AESV2)
+    const std::vector<uint8_t>& getObjectEncryptionKey(PDFObjectReference reference, CryptFilter filter) const;
+
     std::vector<uint8_t> createV2_ObjectEncryptionKey(PDFObjectReference reference, CryptFilter filter) const;
     std::vector<uint8_t> createAESV2_ObjectEncryptionKey(PDFObjectReference reference) const;
     CryptFilter getCryptFilter(EncryptionScope encryptionScope) const;
@@ -20,6 +20,7 @@
 #include "pdfencoding.h"
 #include "pdfform.h"
 #include "pdfutils.h"
+#include "pdfexecutionpolicy.h"
 #include "pdfsignaturehandler_impl.h"
 
 #include <openssl/err.h>
@@ -33,8 +34,10 @@
 #include <QMutexLocker>
 #include <QDataStream>
 #include <QFileInfo>
+#include <QCryptographicHash>
 
 #include <array>
+#include <algorithm>
 #ifdef Q_OS_UNIX
 #include <time.h>
 #endif
@@ -55,6 +58,206 @@ private:
     QMutexLocker m_mutexLocker;
 };
 
+/// Store of trusted certificates (user trusted certificates and certificates
+/// from system store) used for certificate verification. Creating the store
+/// is expensive (all certificates must be decoded and system store must be
+/// enumerated), so it is created once and shared by all verifications with
+/// the same trusted certificates. Store is never modified after it is created,
+/// so it can be used by multiple threads.
+class PDFTrustedCertificateStore
+{
+public:
+    /// Returns store of trusted certificates for given parameters. Returned
+    /// store is reference counted, caller must release it using X509_STORE_free.
+    /// \param parameters Verification settings
+    static X509_STORE* getStore(const PDFSignatureHandler::Parameters& parameters);
+
+private:
+    static QByteArray getKey(const PDFSignatureHandler::Parameters& parameters);
+    static X509_STORE* createStore(const PDFSignatureHandler::Parameters& parameters);
+};
+
+X509_STORE* PDFTrustedCertificateStore::getStore(const PDFSignatureHandler::Parameters& parameters)
+{
+    struct Cache
+    {
+        ~Cache() { X509_STORE_free(store); }
+
+        QMutex mutex;
+        QByteArray key;
+        X509_STORE* store = nullptr;
+    };
+    static Cache cache;
+
+    QByteArray key = getKey(parameters);
+
+    QMutexLocker lock(&cache.mutex);
+    if (!cache.store || cache.key != key)
+    {
+        X509_STORE_free(cache.store);
+        cache.store = createStore(parameters);
+        cache.key = qMove(key);
+    }
+
+    X509_STORE_up_ref(cache.store);
+    return cache.store;
+}
+
+QByteArray PDFTrustedCertificateStore::getKey(const PDFSignatureHandler::Parameters& parameters)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+
+    if (parameters.store)
+    {
+        for (const auto& entry : parameters.store->getCertificates())
+        {
+            hash.addData(entry.info.getCertificateData());
+        }
+    }
+
+    QByteArray key = hash.result();
+    key.append(parameters.useSystemCertificateStore ? '1' : '0');
+    return key;
+}
+
+/// Read-only OpenSSL BIO, which reads signed byte ranges directly from
+/// the source data of the document, so signed data are not copied into
+/// the temporary buffer before the digest is calculated.
+class PDFSignedDataByteRangeBio
+{
+public:
+    /// Creates new BIO reading given byte ranges. Byte ranges must be valid
+    /// (inside source data). Source data are implicitly shared, so no copy is made.
+    /// \param sourceData Source data
+    /// \param byteRanges Byte ranges of the source data
+    static BIO* create(const QByteArray& sourceData, PDFSignature::ByteRanges byteRanges);
+
+private:
+    struct Data
+    {
+        QByteArray sourceData;
+        PDFSignature::ByteRanges byteRanges;
+        size_t currentRange = 0;
+        PDFInteger currentOffset = 0;
+    };
+
+    static BIO_METHOD* createMethod();
+    static int read(BIO* bio, char* buffer, int size);
+    static long control(BIO* bio, int command, long number, void* pointer);
+    static int destroy(BIO* bio);
+    static PDFInteger getRemainingBytes(const Data* data);
+};
+
+BIO* PDFSignedDataByteRangeBio::create(const QByteArray& sourceData, PDFSignature::ByteRanges byteRanges)
+{
+    static BIO_METHOD* method = createMethod();
+
+    BIO* bio = BIO_new(method);
+    if (bio)
+    {
+        Data* data = new Data();
+        data->sourceData = sourceData;
+        data->byteRanges = qMove(byteRanges);
+        BIO_set_data(bio, data);
+        BIO_set_init(bio, 1);
+    }
+
+    return bio;
+}
+
+BIO_METHOD* PDFSignedDataByteRangeBio::createMethod()
+{
+    BIO_METHOD* method = BIO_meth_new(BIO_get_new_index() | BIO_TYPE_SOURCE_SINK, "PDF signed byte ranges");
+    BIO_meth_set_read(method, &PDFSignedDataByteRangeBio::read);
+    BIO_meth_set_ctrl(method, &PDFSignedDataByteRangeBio::control);
+    BIO_meth_set_destroy(method, &PDFSignedDataByteRangeBio::destroy);
+    return method;
+}
+
+int PDFSignedDataByteRangeBio::read(BIO* bio, char* buffer, int size)
+{
+    BIO_clear_retry_flags(bio);
+
+    Data* data = static_cast<Data*>(BIO_get_data(bio));
+    if (!data || size <= 0)
+    {
+        return 0;
+    }
+
+    int bytesRead = 0;
+    while (bytesRead < size && data->currentRange < data->byteRanges.size())
+    {
+        const PDFSignature::ByteRange& byteRange = data->byteRanges[data->currentRange];
+        const PDFInteger remainingInRange = byteRange.size - data->currentOffset;
+
+        if (remainingInRange <= 0)
+        {
+            ++data->currentRange;
+            data->currentOffset = 0;
+            continue;
+        }
+
+        const int bytesToCopy = int(qMin<PDFInteger>(remainingInRange, size - bytesRead));
+        std::copy_n(data->sourceData.constData() + byteRange.offset + data->currentOffset, bytesToCopy, buffer + bytesRead);
+        data->currentOffset += bytesToCopy;
+        bytesRead += bytesToCopy;
+    }
+
+    return bytesRead;
+}
+
+long PDFSignedDataByteRangeBio::control(BIO* bio, int command, long number, void* pointer)
+{
+    Q_UNUSED(number);
+    Q_UNUSED(pointer);
+
+    Data* data = static_cast<Data*>(BIO_get_data(bio));
+    if (!data)
+    {
+        return 0;
+    }
+
+    switch (command)
+    {
+        case BIO_CTRL_RESET:
+            data->currentRange = 0;
+            data->currentOffset = 0;
+            return 1;
+
+        case BIO_CTRL_EOF:
+            return getRemainingBytes(data) == 0 ? 1 : 0;
+
+        case BIO_CTRL_PENDING:
+            return long(getRemainingBytes(data));
+
+        case BIO_CTRL_FLUSH:
+            return 1;
+
+        default:
+            break;
+    }
+
+    return 0;
+}
+
+int PDFSignedDataByteRangeBio::destroy(BIO* bio)
+{
+    delete static_cast<Data*>(BIO_get_data(bio));
+    BIO_set_data(bio, nullptr);
+    BIO_set_init(bio, 0);
+    return 1;
+}
+
+PDFInteger PDFSignedDataByteRangeBio::getRemainingBytes(const Data* data)
+{
+    PDFInteger remainingBytes = 0;
+    for (size_t i = data->currentRange; i < data->byteRanges.size(); ++i)
+    {
+        remainingBytes += data->byteRanges[i].size;
+    }
+    return remainingBytes - data->currentOffset;
+}
+
 PDFSignatureReference PDFSignatureReference::parse(const PDFObjectStorage* storage, PDFObject object)
 {
     PDFSignatureReference result;
@@ -195,13 +398,16 @@ std::vector<PDFSignatureVerificationResult> PDFSignatureHandler::verifySignature
             }
         };
         form.apply(getSignatureFields);
-        result.reserve(signatureFields.size());
+        result.resize(signatureFields.size());
 
-        for (const PDFFormFieldSignature* signatureField : signatureFields)
+        // Signatures are independent, so they are verified in parallel,
+        // each signature writes only to its own result.
+        auto verifySignature = [&](size_t index)
         {
+            const PDFFormFieldSignature* signatureField = signatureFields[index];
             if (const PDFSignatureHandler* signatureHandler = createHandler(signatureField, sourceData, parameters))
             {
-                result.emplace_back(signatureHandler->verify());
+                result[index] = signatureHandler->verify();
                 delete signatureHandler;
             }
             else
@@ -210,9 +416,12 @@ std::vector<PDFSignatureVerificationResult> PDFSignatureHandler::verifySignature
                 QString qualifiedName = signatureField->getName(PDFFormField::NameType::FullyQualified);
                 PDFSignatureVerificationResult verificationResult(signatureField->getSignature().getType(), signatureFieldReference, qMove(qualifiedName));
                 verificationResult.addNoHandlerError(signatureField->getSignature().getSubfilter());
-                result.emplace_back(qMove(verificationResult));
+                result[index] = qMove(verificationResult);
             }
-        }
+        };
+
+        auto range = PDFIntegerRange<size_t>(0, signatureFields.size());
+        PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Unknown, range.begin(), range.end(), verifySignature);
     }
 
     return result;
@@ -505,8 +714,6 @@ STACK_OF(X509)* PDFPublicKeySignatureHandler::getCertificates(PKCS7* pkcs7)
 
 void PDFPublicKeySignatureHandler::verifyCertificate(PDFSignatureVerificationResult& result) const
 {
-    PDFOpenSSLGlobalLock lock;
-
     OpenSSL_add_all_algorithms();
 
     const PDFSignature& signature = m_signatureField->getSignature();
@@ -517,16 +724,13 @@ void PDFPublicKeySignatureHandler::verifyCertificate(PDFSignatureVerificationRes
     const unsigned char* data = convertByteArrayToUcharPtr(content);
     if (PKCS7* pkcs7 = d2i_PKCS7(nullptr, &data, content.size()))
     {
-        X509_STORE* store = X509_STORE_new();
+        X509_STORE* store = getTrustedCertificateStore();
         X509_STORE_CTX* context = X509_STORE_CTX_new();
 
-        // Above functions can fail only if not enough memory. But in this
+        // Above function can fail only if not enough memory. But in this
         // case, this library will crash anyway.
-        Q_ASSERT(store);
         Q_ASSERT(context);
 
-        addTrustedCertificates(store);
-
         STACK_OF(PKCS7_SIGNER_INFO)* signerInfo = PKCS7_get_signer_info(pkcs7);
         const int signerInfoCount = sk_PKCS7_SIGNER_INFO_num(signerInfo);
         STACK_OF(X509)* certificates = getCertificates(pkcs7);
@@ -641,6 +845,8 @@ void PDFPublicKeySignatureHandler::verifyCertificate(PDFSignatureVerificationRes
 
 BIO* PDFPublicKeySignatureHandler::getSignedDataBuffer(pdf::PDFSignatureVerificationResult& result, QByteArray& outputBuffer) const
 {
+    Q_UNUSED(outputBuffer);
+
     const PDFSignature& signature = m_signatureField->getSignature();
     const QByteArray& contents = signature.getContents();
     const QByteArray& sourceData = m_sourceData;
@@ -660,8 +866,9 @@ BIO* PDFPublicKeySignatureHandler::getSignedDataBuffer(pdf::PDFSignatureVerifica
     }
 
     PDFClosedIntervalSet bytesCoveredBySignature;
+    PDFSignature::ByteRanges signedByteRanges;
+    signedByteRanges.reserve(byteRanges.size());
 
-    outputBuffer.reserve(size);
     for (const PDFSignature::ByteRange& byteRange : byteRanges)
     {
         PDFInteger startOffset = byteRange.offset; // Offset to the first data byte
@@ -679,8 +886,7 @@ BIO* PDFPublicKeySignatureHandler::getSignedDataBuffer(pdf::PDFSignatureVerifica
             return nullptr;
         }
 
-        const int length = endOffset - startOffset;
-        outputBuffer.append(sourceData.constData() + startOffset, length);
+        signedByteRanges.push_back(byteRange);
         bytesCoveredBySignature.addInterval(startOffset, endOffset - 1);
     }
 
@@ -718,13 +924,13 @@ BIO* PDFPublicKeySignatureHandler::getSignedDataBuffer(pdf::PDFSignatureVerifica
 
     result.setBytesCoveredBySignature(qMove(bytesCoveredBySignature));
 
-    return BIO_new_mem_buf(outputBuffer.data(), outputBuffer.length());
+    // Signed data can be very large (whole document), so they are
+    // not copied, digest is calculated directly from the source data.
+    return PDFSignedDataByteRangeBio::create(sourceData, qMove(signedByteRanges));
 }
 
 void PDFPublicKeySignatureHandler::verifySignature(PDFSignatureVerificationResult& result) const
 {
-    PDFOpenSSLGlobalLock lock;
-
     OpenSSL_add_all_algorithms();
 
     const PDFSignature& signature = m_signatureField->getSignature();
@@ -851,8 +1057,6 @@ PDFSignatureVerificationResult PDFSignatureHandler_ETSI_RFC3161::verify() const
 
 void PDFSignatureHandler_ETSI_RFC3161::verifySignatureTimestamp(PDFSignatureVerificationResult& result) const
 {
-    PDFOpenSSLGlobalLock lock;
-
     OpenSSL_add_all_algorithms();
 
     const PDFSignature& signature = m_signatureField->getSignature();
@@ -866,13 +1070,7 @@ void PDFSignatureHandler_ETSI_RFC3161::verifySignatureTimestamp(PDFSignatureVeri
         QByteArray buffer;
         if (BIO* inputBuffer = getSignedDataBuffer(result, buffer))
         {
-            X509_STORE* store = X509_STORE_new();
-
-            // Above function can fail only if not enough memory. But in this
-            // case, this library will crash anyway.
-            Q_ASSERT(store);
-
-            addTrustedCertificates(store);
+            X509_STORE* store = getTrustedCertificateStore();
 
             // Add certificates from DSS store
             STACK_OF(X509)* certificatesFromPkcs7 = getCertificates(pkcs7);
@@ -958,8 +1156,8 @@ void PDFSignatureHandler_ETSI_RFC3161::verifySignatureTimestamp(PDFSignatureVeri
     }
 }
 
-// This is protected by global mutex, but it is ugly
-static PDFSignatureVerificationResult* s_ETSI_currentResult = nullptr;
+// Verification callback has no user data, so current result is stored per thread
+static thread_local PDFSignatureVerificationResult* s_ETSI_currentResult = nullptr;
 
 int PDFSignatureHandler_ETSI_base::verifyCallback(int ok, X509_STORE_CTX* context)
 {
@@ -1027,8 +1225,6 @@ int PDFSignatureHandler_ETSI_base::verifyCallback(int ok, X509_STORE_CTX* contex
 
 void PDFSignatureHandler_ETSI_base::verifyCertificateCAdES(PDFSignatureVerificationResult& result, int purpose) const
 {
-    PDFOpenSSLGlobalLock lock;
-
     s_ETSI_currentResult = &result;
 
     OpenSSL_add_all_algorithms();
@@ -1041,16 +1237,13 @@ void PDFSignatureHandler_ETSI_base::verifyCertificateCAdES(PDFSignatureVerificat
     const unsigned char* data = convertByteArrayToUcharPtr(content);
     if (PKCS7* pkcs7 = d2i_PKCS7(nullptr, &data, content.size()))
     {
-        X509_STORE* store = X509_STORE_new();
+        X509_STORE* store = getTrustedCertificateStore();
         X509_STORE_CTX* context = X509_STORE_CTX_new();
 
-        // Above functions can fail only if not enough memory. But in this
+        // Above function can fail only if not enough memory. But in this
         // case, this library will crash anyway.
-        Q_ASSERT(store);
         Q_ASSERT(context);
 
-        addTrustedCertificates(store);
-
         STACK_OF(PKCS7_SIGNER_INFO)* signerInfo = PKCS7_get_signer_info(pkcs7);
         const int signerInfoCount = sk_PKCS7_SIGNER_INFO_num(signerInfo);
         STACK_OF(X509)* certificates = getCertificates(pkcs7);
@@ -1080,6 +1273,8 @@ void PDFSignatureHandler_ETSI_base::verifyCertificateCAdES(PDFSignatureVerificat
             STACK_OF(X509)* usedCertificates = allCertificates ? allCertificates : certificates;
 
             // Jakub Melka: add certificate revocation lists
+            // CRLs are set to the verification context, because trusted certificate store is shared.
+            STACK_OF(X509_CRL)* crls = sk_X509_CRL_new_null();
             if (m_parameters.dss && !m_parameters.dss->getMasterItem()->CRL.empty())
             {
                 for (const QByteArray& crlData : m_parameters.dss->getMasterItem()->CRL)
@@ -1087,8 +1282,7 @@ void PDFSignatureHandler_ETSI_base::verifyCertificateCAdES(PDFSignatureVerificat
                     const unsigned char* crlDataBuffer = convertByteArrayToUcharPtr(crlData);
                     if (X509_CRL* crl = d2i_X509_CRL(nullptr, &crlDataBuffer, crlData.size()))
                     {
-                        X509_STORE_add_crl(store, crl);
-                        X509_CRL_free(crl);
+                        sk_X509_CRL_push(crls, crl);
                     }
                 }
             }
@@ -1111,6 +1305,8 @@ void PDFSignatureHandler_ETSI_base::verifyCertificateCAdES(PDFSignatureVerificat
                     break;
                 }
 
+                X509_STORE_CTX_set0_crls(context, crls);
+
                 if (!X509_STORE_CTX_set_purpose(context, purpose))
                 {
                     result.addCertificateGenericError();
@@ -1189,6 +1385,8 @@ void PDFSignatureHandler_ETSI_base::verifyCertificateCAdES(PDFSignatureVerificat
 
                 sk_X509_free(allCertificates);
             }
+
+            sk_X509_CRL_pop_free(crls, X509_CRL_free);
         }
         else
         {
@@ -1237,7 +1435,7 @@ X509* PDFSignatureHandler_adbe_pkcs7_rsa_sha1::createCertificate(size_t index) c
     return nullptr;
 }
 
-bool PDFSignatureHandler_adbe_pkcs7_rsa_sha1::getMessageDigest(const QByteArray& message,
+bool PDFSignatureHandler_adbe_pkcs7_rsa_sha1::getMessageDigest(BIO* message,
                                                                ASN1_OCTET_STRING* encryptedString,
                                                                RSA* rsa,
                                                                int& algorithmNID,
@@ -1257,7 +1455,14 @@ bool PDFSignatureHandler_adbe_pkcs7_rsa_sha1::getMessageDigest(const QByteArray&
         Q_ASSERT(context);
 
         EVP_DigestInit(context, md);
-        EVP_DigestUpdate(context, message.constData(), message.size());
+
+        std::array<char, 16384> buffer = { };
+        int bytesRead = 0;
+        while ((bytesRead = BIO_read(message, buffer.data(), int(buffer.size()))) > 0)
+        {
+            EVP_DigestUpdate(context, buffer.data(), bytesRead);
+        }
+
         EVP_DigestFinal(context, convertByteArrayToUcharPtr(digest), &messageDigestSize);
 
         EVP_MD_CTX_free(context);
@@ -1320,16 +1525,13 @@ void PDFSignatureHandler_adbe_pkcs7_rsa_sha1::verifyRSACertificate(PDFSignatureV
             }
         }
 
-        X509_STORE* store = X509_STORE_new();
+        X509_STORE* store = getTrustedCertificateStore();
         X509_STORE_CTX* context = X509_STORE_CTX_new();
 
-        // Above functions can fail only if not enough memory. But in this
+        // Above function can fail only if not enough memory. But in this
         // case, this library will crash anyway.
-        Q_ASSERT(store);
         Q_ASSERT(context);
 
-        addTrustedCertificates(store);
-
         X509* signer = certificate;
         if (!X509_STORE_CTX_init(context, store, signer, certificates))
         {
@@ -1460,7 +1662,7 @@ void PDFSignatureHandler_adbe_pkcs7_rsa_sha1::verifyRSASignature(PDFSignatureVer
         {
             int algorithmNID = NID_undef;
             QByteArray digestBuffer;
-            if (!getMessageDigest(outputBuffer, encryptedString, rsa, algorithmNID, digestBuffer))
+            if (!getMessageDigest(bio, encryptedString, rsa, algorithmNID, digestBuffer))
             {
                 BIO_free(bio);
                 X509_free(certificate);
@@ -1528,8 +1730,18 @@ BIO* PDFSignatureHandler_adbe_pkcs7_sha1::getSignedDataBuffer(PDFSignatureVerifi
     if (BIO* bio = PDFPublicKeySignatureHandler::getSignedDataBuffer(result, temporaryBuffer))
     {
         // Calculate SHA1
+        SHA_CTX context;
+        SHA1_Init(&context);
+
+        std::array<char, 16384> buffer = { };
+        int bytesRead = 0;
+        while ((bytesRead = BIO_read(bio, buffer.data(), int(buffer.size()))) > 0)
+        {
+            SHA1_Update(&context, buffer.data(), bytesRead);
+        }
+
         outputBuffer.resize(SHA_DIGEST_LENGTH);
-        SHA1(convertByteArrayToUcharPtr(temporaryBuffer), temporaryBuffer.length(), convertByteArrayToUcharPtr(outputBuffer));
+        SHA1_Final(convertByteArrayToUcharPtr(outputBuffer), &context);
         BIO_free(bio);
 
         return BIO_new_mem_buf(outputBuffer.data(), outputBuffer.length());
@@ -2014,11 +2226,22 @@ void PDFCertificateStore::createDirectoryForDefaultUserCertificatesStore()
 #endif
 #endif
 
-void pdf::PDFPublicKeySignatureHandler::addTrustedCertificates(X509_STORE* store) const
+X509_STORE* pdf::PDFPublicKeySignatureHandler::getTrustedCertificateStore() const
+{
+    return PDFTrustedCertificateStore::getStore(m_parameters);
+}
+
+X509_STORE* pdf::PDFTrustedCertificateStore::createStore(const PDFSignatureHandler::Parameters& parameters)
 {
-    if (m_parameters.store)
+    X509_STORE* store = X509_STORE_new();
+
+    // Above function can fail only if not enough memory. But in this
+    // case, this library will crash anyway.
+    Q_ASSERT(store);
+
+    if (parameters.store)
     {
-        const PDFCertificateStore::CertificateEntries& certificates = m_parameters.store->getCertificates();
+        const PDFCertificateStore::CertificateEntries& certificates = parameters.store->getCertificates();
         for (const auto& entry : certificates)
         {
             QByteArray certificateData = entry.info.getCertificateData();
@@ -2033,7 +2256,7 @@ void pdf::PDFPublicKeySignatureHandler::addTrustedCertificates(X509_STORE* store
     }
 
 #ifdef Q_OS_WIN
-    if (m_parameters.useSystemCertificateStore)
+    if (parameters.useSystemCertificateStore)
     {
         HCERTSTORE certStore = CertOpenSystemStore(0, L"ROOT");
         PCCERT_CONTEXT context = nullptr;
@@ -2054,6 +2277,8 @@ void pdf::PDFPublicKeySignatureHandler::addTrustedCertificates(X509_STORE* store
         }
     }
 #endif
+
+    return store;
 }
 
 pdf::PDFCertificateStore::CertificateEntries pdf::PDFCertificateStore::getSystemCertificates()
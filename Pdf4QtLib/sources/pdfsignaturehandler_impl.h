@@ -42,8 +42,17 @@ protected:
     void initializeResult(PDFSignatureVerificationResult& result) const;
     void verifyCertificate(PDFSignatureVerificationResult& result) const;
     void verifySignature(PDFSignatureVerificationResult& result) const;
-    void addTrustedCertificates(X509_STORE* store) const;
 
+    /// Returns shared store of trusted certificates. Store must not be modified,
+    /// caller must release it using X509_STORE_free.
+    X509_STORE* getTrustedCertificateStore() const;
+
+    /// Returns BIO for reading data covered by the signature. Data are read directly
+    /// from the source data (they are not copied). If signature byte ranges are invalid,
+    /// then error is added to the result and nullptr is returned. Caller is responsible
+    /// for freeing the returned BIO.
+    /// \param result Verification result
+    /// \param outputBuffer Buffer, which must outlive the returned BIO (if used by the handler)
     virtual BIO* getSignedDataBuffer(PDFSignatureVerificationResult& result, QByteArray& outputBuffer) const;
 
 public:
@@ -108,7 +117,7 @@ public:
 
 private:
     X509* createCertificate(size_t index) const;
-    bool getMessageDigest(const QByteArray& message, ASN1_OCTET_STRING* encryptedString, RSA* rsa, int& algorithmNID, QByteArray& digest) const;
+    bool getMessageDigest(BIO* message, ASN1_OCTET_STRING* encryptedString, RSA* rsa, int& algorithmNID, QByteArray& digest) const;
     bool getMessageDigestAlgorithm(ASN1_OCTET_STRING* encryptedString, RSA* rsa, int& algorithmNID) const;
 
     void verifyRSACertificate(PDFSignatureVerificationResult& result) const;
@@ -529,6 +529,97 @@ QByteArray PDFFlateDecodeFilter::uncompress(const QByteArray& data)
     return result;
 }
 
+PDFFlateRowDecoder::PDFFlateRowDecoder(const QByteArray* data, PDFStreamPredictor predictor, int stride) :
+    m_data(data),
+    m_predictor(predictor),
+    m_stride(stride),
+    m_isStreamEnd(false),
+    m_stream(std::make_unique<z_stream>())
+{
+    Q_ASSERT(m_predictor.isNoPredictor() || (m_predictor.isPNGPredictor() && m_predictor.getStride() == m_stride));
+
+    m_stream->next_in = const_cast<Bytef*>(convertByteArrayToUcharPtr(*m_data));
+    m_stream->avail_in = m_data->size();
+
+    if (inflateInit(m_stream.get()) != Z_OK)
+    {
+        throw PDFException(PDFTranslationContext::tr("Failed to initialize flate decompression stream."));
+    }
+
+    if (m_predictor.isPNGPredictor())
+    {
+        m_previousRow.resize(m_stride, 0);
+    }
+}
+
+PDFFlateRowDecoder::~PDFFlateRowDecoder()
+{
+    inflateEnd(m_stream.get());
+}
+
+void PDFFlateRowDecoder::readRow(uint8_t* row)
+{
+    uint8_t rowPredictor = 0;
+    if (m_predictor.isPNGPredictor() && inflateData(&rowPredictor, 1) == 0)
+    {
+        // Missing row is treated as a row of zeros (predictor None)
+        rowPredictor = 0;
+    }
+
+    const int bytesWritten = inflateData(row, m_stride);
+    std::fill(row + bytesWritten, row + m_stride, 0);
+
+    if (m_predictor.isPNGPredictor())
+    {
+        m_predictor.applyPNGPredictorRow(rowPredictor, row, m_previousRow.data());
+        std::copy(row, row + m_stride, m_previousRow.begin());
+    }
+}
+
+int PDFFlateRowDecoder::inflateData(uint8_t* buffer, int size)
+{
+    if (m_isStreamEnd)
+    {
+        return 0;
+    }
+
+    m_stream->next_out = buffer;
+    m_stream->avail_out = static_cast<uInt>(size);
+
+    int error = Z_OK;
+    while (error == Z_OK && m_stream->avail_out > 0)
+    {
+        error = inflate(m_stream.get(), Z_NO_FLUSH);
+    }
+
+    switch (error)
+    {
+        case Z_OK:
+            break;
+
+        case Z_STREAM_END:
+            m_isStreamEnd = true;
+            break;
+
+        default:
+        {
+            QString errorMessage;
+            if (m_stream->msg)
+            {
+                errorMessage = QString::fromLatin1(m_stream->msg);
+            }
+            else
+            {
+                errorMessage = PDFTranslationContext::tr("zlib code: %1").arg(error);
+            }
+
+            throw PDFException(PDFTranslationContext::tr("Error decompressing by flate method: %1").arg(errorMessage));
+        }
+    }
+
+    return size - int(m_stream->avail_out);
+}
+
 QByteArray PDFRunLengthDecodeFilter::apply(const QByteArray& data,
                                            const PDFObjectFetcher& objectFetcher,
                                            const PDFObject& parameters,
@@ -799,103 +890,93 @@ QByteArray PDFStreamPredictor::applyPNGPredictor(const QByteArray& data) const
     QByteArray outputData;
     outputData.reserve(data.size());
 
-    auto it = data.cbegin();
-    auto itEnd = data.cend();
+    std::vector<uint8_t> line(m_stride, 0);
+    std::vector<uint8_t> lineOld(m_stride, 0);
 
-    int pixelBytes = (m_components * m_bitsPerComponent + 7) / 8;
+    const uint8_t* it = convertByteArrayToUcharPtr(data);
+    const uint8_t* itEnd = it + data.size();
 
-    auto readByte = [&it, &itEnd]() -> uint8_t
+    while (it != itEnd)
     {
-        if (it != itEnd)
-        {
-            return static_cast<uint8_t>(*it++);
-        }
+        // First, read the predictor data for current line
+        const uint8_t rowPredictor = *it++;
 
         // According to the PDF specification, incomplete line is completed. For this
         // reason, we behave as we have zero data in the buffer.
-        return 0;
-    };
+        const std::ptrdiff_t bytesRead = qMin<std::ptrdiff_t>(itEnd - it, m_stride);
+        std::copy(it, it + bytesRead, line.begin());
+        std::fill(line.begin() + bytesRead, line.end(), 0);
+        it += bytesRead;
 
-    // Idea: to avoid using if for many cases, we use larger buffer filled with zeros
-    const int totalBytes = m_stride + pixelBytes;
-    std::vector<uint8_t> line(totalBytes, 0);
-    std::vector<uint8_t> lineOld(totalBytes, 0);
+        applyPNGPredictorRow(rowPredictor, line.data(), lineOld.data());
+        outputData.append(reinterpret_cast<const char*>(line.data()), m_stride);
 
-    Predictor currentPredictor = m_predictor;
-    while (it != itEnd)
+        // Swap the buffers
+        std::swap(line, lineOld);
+    }
+
+    return outputData;
+}
+
+void PDFStreamPredictor::applyPNGPredictorRow(uint8_t rowPredictor, uint8_t* row, const uint8_t* previousRow) const
+{
+    const int pixelBytes = (m_components * m_bitsPerComponent + 7) / 8;
+    const Predictor currentPredictor = static_cast<Predictor>(rowPredictor + 10);
+
+    for (int i = 0; i < m_stride; ++i)
     {
-        // First, read the predictor data for current line
-        currentPredictor = static_cast<Predictor>(readByte() + 10);
+        // a = left, b = upper, c = upper left (bytes outside the row are zero)
+        const int a = (i >= pixelBytes) ? row[i - pixelBytes] : 0;
+        const int b = previousRow[i];
+        const int c = (i >= pixelBytes) ? previousRow[i - pixelBytes] : 0;
+        const uint8_t currentByte = row[i];
 
-        for (int i = 0; i < m_stride; ++i)
+        switch (currentPredictor)
         {
-            uint8_t currentByte = readByte();
+            case PNG_Sub:
+            {
+                row[i] = a + currentByte;
+                break;
+            }
 
-            int lineIndex = i + pixelBytes;
-            switch (currentPredictor)
+            case PNG_Up:
             {
-                case PNG_Sub:
-                {
-                    line[lineIndex] = line[i] + currentByte;
-                    break;
-                }
+                row[i] = b + currentByte;
+                break;
+            }
 
-                case PNG_Up:
-                {
-                    line[lineIndex] = lineOld[lineIndex] + currentByte;
-                    break;
-                }
+            case PNG_Average:
+            {
+                row[i] = (a + b) / 2 + currentByte;
+                break;
+            }
 
-                case PNG_Average:
+            case PNG_Paeth:
+            {
+                const int p = a + b - c;
+                const int pa = std::abs(p - a);
+                const int pb = std::abs(p - b);
+                const int pc = std::abs(p - c);
+                if (pa <= pb && pa <= pc)
                 {
-                    line[lineIndex] = (lineOld[lineIndex] + line[i]) / 2 + currentByte;
-                    break;
+                    row[i] = a + currentByte;
                 }
-
-                case PNG_Paeth:
+                else if (pb <= pc)
                 {
-                    // a = left,
-                    // b = upper,
-                    // c = upper left
-                    const int a = line[i];
-                    const int b = lineOld[lineIndex];
-                    const int c = lineOld[i];
-                    const int p = a + b - c;
-                    const int pa = std::abs(p - a);
-                    const int pb = std::abs(p - b);
-                    const int pc = std::abs(p - c);
-                    if (pa <= pb && pa <= pc)
-                    {
-                        line[lineIndex] = a + currentByte;
-                    }
-                    else if (pb <= pc)
-                    {
-                        line[lineIndex] = b + currentByte;
-                    }
-                    else
-                    {
-                        line[lineIndex] = c + currentByte;
-                    }
-                    break;
+                    row[i] = b + currentByte;
                 }
-
-                case PNG_None:
-                default:
+                else
                 {
-                    line[lineIndex] = currentByte;
-                    break;
+                    row[i] = c + currentByte;
                 }
+                break;
             }
 
-            // Fill the output buffer
-            outputData.push_back(static_cast<const char>(line[lineIndex]));
+            case PNG_None:
+            default:
+                break;
         }
-
-        // Swap the buffers
-        std::swap(line, lineOld);
     }
-
-    return outputData;
 }
 
 QByteArray PDFStreamPredictor::applyTIFFPredictor(const QByteArray& data) const
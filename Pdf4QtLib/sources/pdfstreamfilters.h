@@ -25,6 +25,8 @@
 #include <memory>
 #include <functional>
 
+struct z_stream_s;
+
 namespace pdf
 {
 class PDFStreamFilter;
@@ -87,7 +89,7 @@ private:
     std::map<QByteArray, QByteArray> m_abbreviations;
 };
 
-class PDFStreamPredictor
+class PDF4QTLIBSHARED_EXPORT PDFStreamPredictor
 {
 public:
     /// Create predictor from stream parameters. If error occurs, exception is thrown.
@@ -99,6 +101,22 @@ public:
     /// \param data Data to be decoded using predictor
     QByteArray apply(const QByteArray& data) const;
 
+    /// Returns true, if no predictor is used
+    bool isNoPredictor() const { return m_predictor == NoPredictor; }
+
+    /// Returns true, if predictor is PNG predictor (each row is then
+    /// prefixed by one byte, which contains row predictor).
+    bool isPNGPredictor() const { return m_predictor >= PNG_None; }
+
+    /// Returns size of the row in bytes (without row predictor byte)
+    int getStride() const { return m_stride; }
+
+    /// Applies PNG predictor to one row. Row is decoded in place.
+    /// \param rowPredictor Predictor byte of the row
+    /// \param row Row data (predicted bytes on input, decoded bytes on output)
+    /// \param previousRow Decoded previous row (zeros for the first row)
+    void applyPNGPredictorRow(uint8_t rowPredictor, uint8_t* row, const uint8_t* previousRow) const;
+
 private:
 
     enum Predictor
@@ -222,6 +240,42 @@ private:
     static QByteArray uncompress(const QByteArray& data);
 };
 
+/// Decodes flate compressed data incrementally, row by row (predictor is
+/// applied to each row), so decoded data don't need to be held in memory
+/// as a whole. It is used for decoding of images band by band.
+class PDF4QTLIBSHARED_EXPORT PDFFlateRowDecoder
+{
+public:
+    /// Creates row decoder. If error occurs, exception is thrown.
+    /// \param data Compressed data (must exist, until decoder is destroyed)
+    /// \param predictor Predictor (no predictor or PNG predictor)
+    /// \param stride Size of the decoded row in bytes
+    explicit PDFFlateRowDecoder(const QByteArray* data, PDFStreamPredictor predictor, int stride);
+    ~PDFFlateRowDecoder();
+
+    PDFFlateRowDecoder(const PDFFlateRowDecoder&) = delete;
+    PDFFlateRowDecoder& operator=(const PDFFlateRowDecoder&) = delete;
+
+    /// Decodes next row. If data ends before the row is complete,
+    /// the rest of the row is filled with zeros. If error occurs,
+    /// exception is thrown.
+    /// \param row Row buffer (must have at least stride bytes)
+    void readRow(uint8_t* row);
+
+private:
+    /// Inflates data to the buffer, returns number of bytes written
+    /// \param buffer Buffer
+    /// \param size Size of the buffer
+    int inflateData(uint8_t* buffer, int size);
+
+    const QByteArray* m_data;
+    PDFStreamPredictor m_predictor;
+    int m_stride;
+    bool m_isStreamEnd;
+    std::unique_ptr<z_stream_s> m_stream;
+    std::vector<uint8_t> m_previousRow;
+};
+
 class PDF4QTLIBSHARED_EXPORT PDFRunLengthDecodeFilter : public PDFStreamFilter
 {
 public:
@@ -0,0 +1,566 @@
+//    Copyright (C) 2021 Jakub Melka
+//
+//    This file is part of PDF4QT.
+//
+//    PDF4QT is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    with the written consent of the copyright owner, any later version.
+//
+//    PDF4QT is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public License
+//    along with PDF4QT.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "pdftextindex.h"
+#include "pdfdocumenttextflow.h"
+#include "pdfexecutionpolicy.h"
+#include "pdfutils.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QLockFile>
+#include <QStandardPaths>
+#include <QDateTime>
+#include <QCryptographicHash>
+
+#include <map>
+#include <iterator>
+#include <algorithm>
+
+namespace pdf
+{
+
+static constexpr qint32 TEXT_INDEX_FORMAT_VERSION = 3;
+static constexpr int TEXT_INDEX_CONTEXT_LENGTH = 40;
+
+template<typename Callback>
+void PDFTextIndex::tokenize(const QString& text, Callback callback)
+{
+    QString term;
+    int termStart = 0;
+    int termEnd = 0;
+
+    for (int i = 0, count = text.size(); i < count; ++i)
+    {
+        const QChar character = text[i];
+
+        if (character == QChar(QChar::SoftHyphen))
+        {
+            // Soft hyphen doesn't break the term
+            continue;
+        }
+
+        if (character.isLetterOrNumber() || character.isMark())
+        {
+            if (term.isEmpty())
+            {
+                termStart = i;
+            }
+            term += character;
+            termEnd = i + 1;
+        }
+        else if (!term.isEmpty())
+        {
+            callback(term.toCaseFolded(), termStart, termEnd);
+            term.clear();
+        }
+    }
+
+    if (!term.isEmpty())
+    {
+        callback(term.toCaseFolded(), termStart, termEnd);
+    }
+}
+
+PDFTextIndex PDFTextIndex::create(const PDFTextLayoutStorage& storage)
+{
+    PDFTextIndex index;
+    index.m_flowTexts.resize(storage.getCount());
+
+    // Each page writes only to its own item, so no locking is needed
+    auto createFlowTexts = [&index, &storage](size_t pageIndex)
+    {
+        PDFTextLayout textLayout = storage.getTextLayout(pageIndex);
+        PDFTextFlows textFlows = PDFTextFlow::createTextFlows(textLayout, PDFTextFlow::FlowFlags(PDFTextFlow::SeparateBlocks) | PDFTextFlow::RemoveSoftHyphen, pageIndex);
+
+        QStringList flowTexts;
+        flowTexts.reserve(int(textFlows.size()));
+        for (const PDFTextFlow& textFlow : textFlows)
+        {
+            flowTexts << textFlow.getText();
+        }
+        index.m_flowTexts[pageIndex] = qMove(flowTexts);
+    };
+
+    auto range = PDFIntegerRange<size_t>(0, storage.getCount());
+    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, range.begin(), range.end(), createFlowTexts);
+
+    index.buildTerms();
+    return index;
+}
+
+PDFTextIndex PDFTextIndex::create(const PDFDocumentTextFlow& textFlow, PDFInteger pageCount)
+{
+    PDFTextIndex index;
+    index.m_flowTexts.resize(pageCount);
+
+    for (const PDFDocumentTextFlow::Item& item : textFlow.getItems())
+    {
+        if (item.isText() && item.pageIndex >= 0 && item.pageIndex < pageCount)
+        {
+            index.m_flowTexts[item.pageIndex] << item.text;
+        }
+    }
+
+    index.buildTerms();
+    return index;
+}
+
+std::optional<PDFTextIndex::FlowReferences> PDFTextIndex::getCandidateFlows(const QString& text) const
+{
+    struct Token
+    {
+        QString term;
+        bool matchStart = true;
+        bool matchEnd = true;
+    };
+
+    // Searched text can start or end in the middle of the word,
+    // so first token can be a suffix of the term and last token can be a prefix
+    // of the term (if token is at the same time first and last, it can be anywhere
+    // in the term). All other tokens are delimited by non-letter characters
+    // both in the searched text and in the text flow, so they must match
+    // the term exactly.
+    std::vector<Token> tokens;
+    tokenize(text, [&tokens, &text](const QString& term, int start, int end) { tokens.push_back(Token{ term, start > 0, end < text.size() }); });
+
+    if (tokens.empty())
+    {
+        return std::nullopt;
+    }
+
+    // Longer tokens are usually more selective, so process them first
+    auto compareTokens = [](const Token& l, const Token& r)
+    {
+        if (l.term.size() != r.term.size())
+        {
+            return l.term.size() > r.term.size();
+        }
+        return std::tie(l.term, l.matchStart, l.matchEnd) < std::tie(r.term, r.matchStart, r.matchEnd);
+    };
+    auto isTokenEqual = [](const Token& l, const Token& r) { return std::tie(l.term, l.matchStart, l.matchEnd) == std::tie(r.term, r.matchStart, r.matchEnd); };
+    std::sort(tokens.begin(), tokens.end(), compareTokens);
+    tokens.erase(std::unique(tokens.begin(), tokens.end(), isTokenEqual), tokens.end());
+
+    FlowReferences result;
+    bool isFirst = true;
+    for (const Token& token : tokens)
+    {
+        FlowReferences tokenFlows;
+        for (size_t termIndex : findTerms(token.term, token.matchStart, token.matchEnd))
+        {
+            for (const Occurence& occurence : m_occurences[termIndex])
+            {
+                tokenFlows.push_back(FlowReference{ occurence.pageIndex, occurence.flowIndex });
+            }
+        }
+
+        std::sort(tokenFlows.begin(), tokenFlows.end());
+        tokenFlows.erase(std::unique(tokenFlows.begin(), tokenFlows.end()), tokenFlows.end());
+
+        if (isFirst)
+        {
+            result = qMove(tokenFlows);
+            isFirst = false;
+        }
+        else
+        {
+            FlowReferences intersection;
+            std::set_intersection(result.cbegin(), result.cend(), tokenFlows.cbegin(), tokenFlows.cend(), std::back_inserter(intersection));
+            result = qMove(intersection);
+        }
+
+        if (result.empty())
+        {
+            break;
+        }
+    }
+
+    return result;
+}
+
+std::vector<size_t> PDFTextIndex::findTerms(const QString& token, bool matchStart, bool matchEnd) const
+{
+    std::vector<size_t> result;
+
+    if (matchStart)
+    {
+        // Terms are sorted, so terms starting with the token form a contiguous range
+        auto it = std::lower_bound(m_terms.cbegin(), m_terms.cend(), token);
+        if (matchEnd)
+        {
+            if (it != m_terms.cend() && *it == token)
+            {
+                result.push_back(std::distance(m_terms.cbegin(), it));
+            }
+        }
+        else
+        {
+            for (; it != m_terms.cend() && it->startsWith(token); ++it)
+            {
+                result.push_back(std::distance(m_terms.cbegin(), it));
+            }
+        }
+    }
+    else
+    {
+        // Suffixes are sorted, so suffixes starting with the token form a contiguous range
+        auto compare = [this](const TermSuffix& suffix, const QString& value) { return getSuffix(suffix).compare(value) < 0; };
+        auto it = std::lower_bound(m_suffixes.cbegin(), m_suffixes.cend(), token, compare);
+        for (; it != m_suffixes.cend(); ++it)
+        {
+            QStringRef suffix = getSuffix(*it);
+            if (!suffix.startsWith(token))
+            {
+                break;
+            }
+
+            if (!matchEnd || suffix.size() == token.size())
+            {
+                result.push_back(it->termIndex);
+            }
+        }
+
+        // Term can contain the token several times
+        std::sort(result.begin(), result.end());
+        result.erase(std::unique(result.begin(), result.end()), result.end());
+    }
+
+    return result;
+}
+
+QStringRef PDFTextIndex::getSuffix(const TermSuffix& suffix) const
+{
+    const QString& term = m_terms[suffix.termIndex];
+    return QStringRef(&term, int(suffix.offset), term.size() - int(suffix.offset));
+}
+
+PDFTextIndex::Matches PDFTextIndex::find(const QString& text, Qt::CaseSensitivity caseSensitivity) const
+{
+    Matches matches;
+
+    if (text.isEmpty())
+    {
+        return matches;
+    }
+
+    auto findInFlow = [&](PDFInteger pageIndex, PDFInteger flowIndex, const QString& flowText)
+    {
+        int index = flowText.indexOf(text, 0, caseSensitivity);
+        while (index != -1)
+        {
+            const int contextStart = qMax(index - TEXT_INDEX_CONTEXT_LENGTH, 0);
+            const int contextEnd = qMin(index + text.length() + TEXT_INDEX_CONTEXT_LENGTH, flowText.length());
+
+            Match match;
+            match.pageIndex = pageIndex;
+            match.flowIndex = flowIndex;
+            match.characterIndex = index;
+            match.context = flowText.mid(contextStart, contextEnd - contextStart).simplified();
+            matches.emplace_back(qMove(match));
+
+            index = flowText.indexOf(text, index + 1, caseSensitivity);
+        }
+    };
+
+    if (std::optional<FlowReferences> candidateFlows = getCandidateFlows(text))
+    {
+        // Candidate flows are sorted, so text of each page is retrieved only once
+        PDFInteger currentPageIndex = -1;
+        QStringList flowTexts;
+
+        for (const FlowReference& reference : *candidateFlows)
+        {
+            if (reference.pageIndex != currentPageIndex)
+            {
+                currentPageIndex = reference.pageIndex;
+                flowTexts = getFlowTexts(currentPageIndex);
+            }
+
+            if (reference.flowIndex >= 0 && reference.flowIndex < flowTexts.size())
+            {
+                findInFlow(reference.pageIndex, reference.flowIndex, flowTexts[int(reference.flowIndex)]);
+            }
+        }
+    }
+    else
+    {
+        for (PDFInteger pageIndex = 0, pageCount = getPageCount(); pageIndex < pageCount; ++pageIndex)
+        {
+            const QStringList flowTexts = getFlowTexts(pageIndex);
+            for (int flowIndex = 0; flowIndex < flowTexts.size(); ++flowIndex)
+            {
+                findInFlow(pageIndex, flowIndex, flowTexts[flowIndex]);
+            }
+        }
+    }
+
+    return matches;
+}
+
+QStringList PDFTextIndex::getFlowTexts(PDFInteger pageIndex) const
+{
+    if (pageIndex >= 0 && pageIndex < PDFInteger(m_flowTexts.size()))
+    {
+        return m_flowTexts[pageIndex];
+    }
+
+    if (pageIndex >= 0 && pageIndex < PDFInteger(m_compressedFlowTexts.size()))
+    {
+        QByteArray data = qUncompress(m_compressedFlowTexts[pageIndex]);
+
+        QStringList flowTexts;
+        QDataStream stream(&data, QIODevice::ReadOnly);
+        stream >> flowTexts;
+
+        if (stream.status() == QDataStream::Ok)
+        {
+            return flowTexts;
+        }
+    }
+
+    return QStringList();
+}
+
+QByteArray PDFTextIndex::compressFlowTexts(const QStringList& flowTexts)
+{
+    QByteArray data;
+    {
+        QDataStream stream(&data, QIODevice::WriteOnly);
+        stream << flowTexts;
+    }
+    return qCompress(data, 9);
+}
+
+bool PDFTextIndex::DocumentIdentification::isFileInfoEqual(const DocumentIdentification& other) const
+{
+    return fileSize >= 0 && lastModified >= 0 && fileSize == other.fileSize && lastModified == other.lastModified;
+}
+
+PDFTextIndex::DocumentIdentification PDFTextIndex::DocumentIdentification::createFromFileInfo(const QFileInfo& fileInfo)
+{
+    DocumentIdentification identification;
+    identification.fileSize = fileInfo.size();
+    identification.lastModified = fileInfo.lastModified().toMSecsSinceEpoch();
+    return identification;
+}
+
+QByteArray PDFTextIndex::computeDocumentHash(const QByteArray& data)
+{
+    return QCryptographicHash::hash(data, QCryptographicHash::Sha256);
+}
+
+QString PDFTextIndex::getCacheFileName(const QString& documentFileName)
+{
+    QByteArray pathHash = QCryptographicHash::hash(QFileInfo(documentFileName).absoluteFilePath().toUtf8(), QCryptographicHash::Sha256);
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QString("/TextIndex/%1.pdfidx").arg(QString::fromLatin1(pathHash.toHex()));
+}
+
+QString PDFTextIndex::getDocumentIndexFileName(const QString& documentFileName)
+{
+    return documentFileName + ".pdfidx";
+}
+
+bool PDFTextIndex::save(const QString& fileName) const
+{
+    QFileInfo fileInfo(fileName);
+    QDir().mkpath(fileInfo.path());
+
+    QByteArray dictionary;
+    {
+        QDataStream stream(&dictionary, QIODevice::WriteOnly);
+        stream << m_terms;
+        stream << m_occurences;
+        stream << m_suffixes;
+    }
+    dictionary = qCompress(dictionary, 9);
+
+    // Page texts are compressed separately, so only searched pages
+    // are decompressed, when index is loaded from the file.
+    std::vector<QByteArray> compressedFlowTexts = m_compressedFlowTexts;
+    if (compressedFlowTexts.empty() && !m_flowTexts.empty())
+    {
+        compressedFlowTexts.resize(m_flowTexts.size());
+        auto compressPage = [this, &compressedFlowTexts](size_t pageIndex)
+        {
+            compressedFlowTexts[pageIndex] = compressFlowTexts(m_flowTexts[pageIndex]);
+        };
+
+        auto range = PDFIntegerRange<size_t>(0, m_flowTexts.size());
+        PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, range.begin(), range.end(), compressPage);
+    }
+
+    bool result = false;
+    QLockFile lockFile(fileName + ".lock");
+    if (lockFile.lock())
+    {
+        QFile file(fileName);
+        if (file.open(QFile::WriteOnly | QFile::Truncate))
+        {
+            QDataStream stream(&file);
+            stream << TEXT_INDEX_FORMAT_VERSION;
+            stream << m_documentIdentification.hash;
+            stream << m_documentIdentification.fileSize;
+            stream << m_documentIdentification.lastModified;
+            stream << dictionary;
+            stream << compressedFlowTexts;
+            result = stream.status() == QDataStream::Ok;
+            file.close();
+        }
+        lockFile.unlock();
+    }
+
+    return result;
+}
+
+std::optional<PDFTextIndex> PDFTextIndex::load(const QString& fileName, const AcceptIndexCallback& acceptIndex)
+{
+    if (!QFile::exists(fileName))
+    {
+        return std::nullopt;
+    }
+
+    PDFTextIndex index;
+    QByteArray dictionary;
+    QLockFile lockFile(fileName + ".lock");
+    if (lockFile.lock())
+    {
+        QFile file(fileName);
+        if (file.open(QFile::ReadOnly))
+        {
+            qint32 version = 0;
+
+            QDataStream stream(&file);
+            stream >> version;
+            stream >> index.m_documentIdentification.hash;
+            stream >> index.m_documentIdentification.fileSize;
+            stream >> index.m_documentIdentification.lastModified;
+
+            // Do not read the data at all, if index is for another document
+            if (stream.status() == QDataStream::Ok && version == TEXT_INDEX_FORMAT_VERSION && acceptIndex(index.m_documentIdentification))
+            {
+                stream >> dictionary;
+                stream >> index.m_compressedFlowTexts;
+                if (stream.status() != QDataStream::Ok)
+                {
+                    dictionary.clear();
+                }
+            }
+            file.close();
+        }
+        lockFile.unlock();
+    }
+
+    if (dictionary.isEmpty())
+    {
+        return std::nullopt;
+    }
+
+    dictionary = qUncompress(dictionary);
+
+    QDataStream stream(&dictionary, QIODevice::ReadOnly);
+    stream >> index.m_terms;
+    stream >> index.m_occurences;
+    stream >> index.m_suffixes;
+
+    if (stream.status() != QDataStream::Ok || index.m_terms.size() != index.m_occurences.size())
+    {
+        return std::nullopt;
+    }
+
+    for (const TermSuffix& suffix : index.m_suffixes)
+    {
+        if (suffix.termIndex >= index.m_terms.size() || int(suffix.offset) >= index.m_terms[suffix.termIndex].size())
+        {
+            return std::nullopt;
+        }
+    }
+
+    return index;
+}
+
+void PDFTextIndex::buildTerms()
+{
+    std::map<QString, Occurences> terms;
+
+    for (size_t pageIndex = 0; pageIndex < m_flowTexts.size(); ++pageIndex)
+    {
+        const QStringList& flowTexts = m_flowTexts[pageIndex];
+        for (int flowIndex = 0; flowIndex < flowTexts.size(); ++flowIndex)
+        {
+            tokenize(flowTexts[flowIndex], [&terms, pageIndex, flowIndex](const QString& term, int characterIndex, int)
+            {
+                terms[term].push_back(Occurence{ PDFInteger(pageIndex), flowIndex, characterIndex });
+            });
+        }
+    }
+
+    m_terms.clear();
+    m_occurences.clear();
+    m_terms.reserve(terms.size());
+    m_occurences.reserve(terms.size());
+
+    for (auto& item : terms)
+    {
+        m_terms.push_back(item.first);
+        m_occurences.emplace_back(qMove(item.second));
+    }
+
+    buildSuffixes();
+}
+
+void PDFTextIndex::buildSuffixes()
+{
+    m_suffixes.clear();
+
+    size_t suffixCount = 0;
+    for (const QString& term : m_terms)
+    {
+        suffixCount += term.size();
+    }
+    m_suffixes.reserve(suffixCount);
+
+    for (size_t termIndex = 0; termIndex < m_terms.size(); ++termIndex)
+    {
+        for (int offset = 0, length = m_terms[termIndex].size(); offset < length; ++offset)
+        {
+            m_suffixes.push_back(TermSuffix{ quint32(termIndex), quint32(offset) });
+        }
+    }
+
+    auto compare = [this](const TermSuffix& l, const TermSuffix& r) { return getSuffix(l).compare(getSuffix(r)) < 0; };
+    std::sort(m_suffixes.begin(), m_suffixes.end(), compare);
+}
+
+QDataStream& operator<<(QDataStream& stream, const PDFTextIndex::Occurence& occurence)
+{
+    stream << occurence.pageIndex;
+    stream << occurence.flowIndex;
+    stream << occurence.characterIndex;
+    return stream;
+}
+
+QDataStream& operator>>(QDataStream& stream, PDFTextIndex::Occurence& occurence)
+{
+    stream >> occurence.pageIndex;
+    stream >> occurence.flowIndex;
+    stream >> occurence.characterIndex;
+    return stream;
+}
+
+}   // namespace pdf
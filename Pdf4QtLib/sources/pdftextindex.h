@@ -0,0 +1,234 @@
+//    Copyright (C) 2021 Jakub Melka
+//
+//    This file is part of PDF4QT.
+//
+//    PDF4QT is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    with the written consent of the copyright owner, any later version.
+//
+//    PDF4QT is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public License
+//    along with PDF4QT.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef PDFTEXTINDEX_H
+#define PDFTEXTINDEX_H
+
+#include "pdfglobal.h"
+#include "pdftextlayout.h"
+
+#include <QStringList>
+
+#include <tuple>
+#include <optional>
+#include <functional>
+
+class QFileInfo;
+
+namespace pdf
+{
+class PDFDocumentTextFlow;
+
+/// Inverted full text index of the document. For each page, text of all
+/// text flows (text blocks) is stored, together with normalized terms
+/// (case folded words) and their occurences. Index is used to quickly
+/// determine, which text flows can contain searched text, so text search
+/// is then performed only on small subset of the document. Text flows are
+/// created using flags \p PDFTextFlow::SeparateBlocks and \p PDFTextFlow::RemoveSoftHyphen,
+/// so candidate flows are valid for any search, which uses separate blocks.
+/// Index can be stored to the file (next to the document, or in per-user
+/// cache, where file name is derived from document path). In the file, term
+/// table is stored separately from the text of each page, so loaded index
+/// decompresses page text only for pages, which are actually searched.
+class PDF4QTLIBSHARED_EXPORT PDFTextIndex
+{
+public:
+    explicit inline PDFTextIndex() = default;
+
+    /// Occurence of the term in the document
+    struct Occurence
+    {
+        PDFInteger pageIndex = 0;
+        PDFInteger flowIndex = 0;
+        PDFInteger characterIndex = 0;
+
+        friend QDataStream& operator<<(QDataStream& stream, const Occurence& occurence);
+        friend QDataStream& operator>>(QDataStream& stream, Occurence& occurence);
+    };
+    using Occurences = std::vector<Occurence>;
+
+    /// Reference to the text flow on the page
+    struct FlowReference
+    {
+        PDFInteger pageIndex = 0;
+        PDFInteger flowIndex = 0;
+
+        bool operator<(const FlowReference& other) const { return std::tie(pageIndex, flowIndex) < std::tie(other.pageIndex, other.flowIndex); }
+        bool operator==(const FlowReference& other) const { return pageIndex == other.pageIndex && flowIndex == other.flowIndex; }
+    };
+    using FlowReferences = std::vector<FlowReference>;
+
+    /// Match of the searched text
+    struct Match
+    {
+        PDFInteger pageIndex = 0;
+        PDFInteger flowIndex = 0;
+        PDFInteger characterIndex = 0;
+        QString context;
+    };
+    using Matches = std::vector<Match>;
+
+    /// Identification of the document, from which index was created. Stored
+    /// index can be matched with the document cheaply, using file size and
+    /// time of last modification, or reliably, using document hash.
+    struct DocumentIdentification
+    {
+        QByteArray hash;
+        qint64 fileSize = -1;
+        qint64 lastModified = -1; ///< Time of last modification (milliseconds since epoch)
+
+        /// Returns true, if both file size and time of last modification are valid and equal
+        /// \param other Other identification
+        bool isFileInfoEqual(const DocumentIdentification& other) const;
+
+        /// Creates identification from file info (hash is left empty)
+        /// \param fileInfo File info of the document
+        static DocumentIdentification createFromFileInfo(const QFileInfo& fileInfo);
+    };
+
+    /// Decides, if stored index belongs to the document. It is called after
+    /// the header of the index file is read, before the index is loaded.
+    using AcceptIndexCallback = std::function<bool(const DocumentIdentification&)>;
+
+    /// Creates text index from text layout storage. Text flows are created
+    /// for each page in parallel.
+    /// \param storage Text layout storage
+    static PDFTextIndex create(const PDFTextLayoutStorage& storage);
+
+    /// Creates text index from document text flow. Document text flow
+    /// must be created using layout algorithm (only then text items correspond
+    /// to the text flows of the page).
+    /// \param textFlow Document text flow
+    /// \param pageCount Page count
+    static PDFTextIndex create(const PDFDocumentTextFlow& textFlow, PDFInteger pageCount);
+
+    /// Returns text flows, which can contain given text. If index can't be
+    /// used to restrict the search (for example, text doesn't contain any
+    /// letter or number), then std::nullopt is returned and all text flows
+    /// must be searched. Returned text flows are sorted. Terms are looked up
+    /// by binary search, only first and last word of the text can match
+    /// the term partially (text can start or end in the middle of the word).
+    /// \param text Searched text
+    std::optional<FlowReferences> getCandidateFlows(const QString& text) const;
+
+    /// Finds all occurences of the text in the stored text flows. Only
+    /// candidate flows are searched.
+    /// \param text Text to be found
+    /// \param caseSensitivity Case sensitivity
+    Matches find(const QString& text, Qt::CaseSensitivity caseSensitivity) const;
+
+    /// Returns page count
+    PDFInteger getPageCount() const { return PDFInteger(qMax(m_flowTexts.size(), m_compressedFlowTexts.size())); }
+
+    /// Returns texts of text flows of the given page. If page index
+    /// is invalid, empty list is returned. If index was loaded from the file,
+    /// text of the page is decompressed.
+    /// \param pageIndex Page index
+    QStringList getFlowTexts(PDFInteger pageIndex) const;
+
+    /// Returns number of distinct terms in the index
+    size_t getTermCount() const { return m_terms.size(); }
+
+    /// Returns identification of the document, from which index was created
+    const DocumentIdentification& getDocumentIdentification() const { return m_documentIdentification; }
+
+    /// Sets identification of the document, from which index was created
+    void setDocumentIdentification(const DocumentIdentification& documentIdentification) { m_documentIdentification = documentIdentification; }
+
+    /// Computes document hash from document data
+    /// \param data Document data
+    static QByteArray computeDocumentHash(const QByteArray& data);
+
+    /// Returns file name of index in per-user cache. File name is derived
+    /// from absolute path of the document.
+    /// \param documentFileName File name of the document
+    static QString getCacheFileName(const QString& documentFileName);
+
+    /// Returns file name of index stored next to the document
+    /// \param documentFileName File name of the document
+    static QString getDocumentIndexFileName(const QString& documentFileName);
+
+    /// Saves index to the file. Returns true, if index was successfully saved.
+    /// \param fileName File name
+    bool save(const QString& fileName) const;
+
+    /// Loads index from the file. If file doesn't exist, is damaged, or index
+    /// is not accepted by the callback (it was created from another document),
+    /// then std::nullopt is returned. Text of the pages is not decompressed.
+    /// \param fileName File name
+    /// \param acceptIndex Callback, which checks stored document identification
+    static std::optional<PDFTextIndex> load(const QString& fileName, const AcceptIndexCallback& acceptIndex);
+
+private:
+    /// Suffix of the term (term index and start of the suffix in the term)
+    struct TermSuffix
+    {
+        quint32 termIndex = 0;
+        quint32 offset = 0;
+
+        friend QDataStream& operator<<(QDataStream& stream, const TermSuffix& suffix) { return stream << suffix.termIndex << suffix.offset; }
+        friend QDataStream& operator>>(QDataStream& stream, TermSuffix& suffix) { return stream >> suffix.termIndex >> suffix.offset; }
+    };
+
+    /// Builds term table (and suffix table) from stored text flows
+    void buildTerms();
+
+    /// Builds sorted table of all suffixes of all terms, so terms containing
+    /// given text can be found by binary search.
+    void buildSuffixes();
+
+    /// Returns suffix of the term
+    /// \param suffix Suffix
+    QStringRef getSuffix(const TermSuffix& suffix) const;
+
+    /// Finds indices of terms, which contain given token. Returned indices are sorted.
+    /// \param token Token (normalized term)
+    /// \param matchStart Term must start with the token
+    /// \param matchEnd Term must end with the token
+    std::vector<size_t> findTerms(const QString& token, bool matchStart, bool matchEnd) const;
+
+    /// Splits text to normalized terms. Terms are maximal sequences of letters
+    /// and numbers, soft hyphens are ignored (they don't break the term).
+    /// Callback is called for each term with term, its start index in the text
+    /// and index after its last character.
+    /// \param text Text
+    /// \param callback Callback
+    template<typename Callback>
+    static void tokenize(const QString& text, Callback callback);
+
+    /// Compresses texts of text flows of the page
+    /// \param flowTexts Texts of text flows
+    static QByteArray compressFlowTexts(const QStringList& flowTexts);
+
+    DocumentIdentification m_documentIdentification;
+
+    /// Texts of text flows of each page (index created from the document)
+    std::vector<QStringList> m_flowTexts;
+
+    /// Compressed texts of text flows of each page (index loaded from the file)
+    std::vector<QByteArray> m_compressedFlowTexts;
+
+    std::vector<QString> m_terms;
+    std::vector<Occurences> m_occurences;
+
+    /// Suffixes of all terms, sorted lexicographically
+    std::vector<TermSuffix> m_suffixes;
+};
+
+}   // namespace pdf
+
+#endif // PDFTEXTINDEX_H
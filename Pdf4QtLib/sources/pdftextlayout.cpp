@@ -16,11 +16,14 @@
 //    along with PDF4QT.  If not, see <https://www.gnu.org/licenses/>.
 
 #include "pdftextlayout.h"
+#include "pdftextindex.h"
 #include "pdfutils.h"
 #include "pdfexecutionpolicy.h"
 
 #include <QPainter>
 
+#include <numeric>
+#include <type_traits>
 #include <execution>
 
 namespace pdf
@@ -935,53 +938,310 @@ QDataStream& operator>>(QDataStream& stream, TextCharacter& character)
     return stream;
 }
 
-PDFTextLayout PDFTextLayoutStorage::getTextLayout(PDFInteger pageIndex) const
+static constexpr quint32 FLAT_TEXT_LAYOUT_MAGIC = 0x46544C31;
+
+PDFFlatTextLayout::PDFFlatTextLayout(QByteArray data)
 {
-    PDFTextLayout result;
+    if (data.size() < int(sizeof(Header)))
+    {
+        return;
+    }
 
-    if (pageIndex >= 0 && pageIndex < static_cast<PDFInteger>(m_offsets.size()))
+    Header header;
+    std::memcpy(&header, data.constData(), sizeof(Header));
+
+    const size_t blocksOffset = sizeof(Header);
+    const size_t linesOffset = blocksOffset + header.blockCount * sizeof(Block);
+    const size_t charactersOffset = linesOffset + header.lineCount * sizeof(Line);
+    const size_t dataSize = charactersOffset + header.characterCount * sizeof(Character);
+
+    if (header.magic != FLAT_TEXT_LAYOUT_MAGIC || size_t(data.size()) != dataSize)
     {
-        QDataStream layoutStream(const_cast<QByteArray*>(&m_textLayouts), QIODevice::ReadOnly);
-        layoutStream.skipRawData(m_offsets[pageIndex]);
+        return;
+    }
 
-        QByteArray buffer;
-        layoutStream >> buffer;
-        buffer = qUncompress(buffer);
+    m_data = qMove(data);
+    m_header = header;
+    m_blocksOffset = blocksOffset;
+    m_linesOffset = linesOffset;
+    m_charactersOffset = charactersOffset;
+}
+
+QByteArray PDFFlatTextLayout::create(const PDFTextLayout& layout)
+{
+    static_assert(std::is_trivially_copyable_v<Block>);
+    static_assert(std::is_trivially_copyable_v<Line>);
+    static_assert(std::is_trivially_copyable_v<Character>);
+
+    Header header;
+    header.magic = FLAT_TEXT_LAYOUT_MAGIC;
 
-        QDataStream stream(&buffer, QIODevice::ReadOnly);
-        stream >> result;
+    for (const PDFTextBlock& block : layout.getTextBlocks())
+    {
+        header.blockCount += 1;
+        for (const PDFTextLine& line : block.getLines())
+        {
+            header.lineCount += 1;
+            header.characterCount += quint32(line.getCharacters().size());
+        }
     }
 
-    return result;
+    const size_t blocksOffset = sizeof(Header);
+    const size_t linesOffset = blocksOffset + header.blockCount * sizeof(Block);
+    const size_t charactersOffset = linesOffset + header.lineCount * sizeof(Line);
+    const size_t dataSize = charactersOffset + header.characterCount * sizeof(Character);
+
+    QByteArray data(int(dataSize), Qt::Uninitialized);
+    char* buffer = data.data();
+    std::memcpy(buffer, &header, sizeof(Header));
+
+    quint32 blockIndex = 0;
+    quint32 lineIndex = 0;
+    quint32 characterIndex = 0;
+    for (const PDFTextBlock& textBlock : layout.getTextBlocks())
+    {
+        const PDFTextLines& lines = textBlock.getLines();
+
+        Block block;
+        block.boundingBox = Quadrilateral::fromPath(textBlock.getBoundingBox());
+        block.topLeft = textBlock.getTopLeft();
+        block.firstLine = lineIndex;
+        block.lineCount = quint32(lines.size());
+        std::memcpy(buffer + blocksOffset + blockIndex++ * sizeof(Block), &block, sizeof(Block));
+
+        for (const PDFTextLine& textLine : lines)
+        {
+            const TextCharacters& characters = textLine.getCharacters();
+
+            Line line;
+            line.boundingBox = Quadrilateral::fromPath(textLine.getBoundingBox());
+            line.topLeft = textLine.getTopLeft();
+            line.firstCharacter = characterIndex;
+            line.characterCount = quint32(characters.size());
+            std::memcpy(buffer + linesOffset + lineIndex++ * sizeof(Line), &line, sizeof(Line));
+
+            for (const TextCharacter& textCharacter : characters)
+            {
+                Character character;
+                character.position = textCharacter.position;
+                character.angle = textCharacter.angle;
+                character.fontSize = textCharacter.fontSize;
+                character.advance = textCharacter.advance;
+                character.boundingBox = Quadrilateral::fromPath(textCharacter.boundingBox);
+                character.character = textCharacter.character.unicode();
+                std::memcpy(buffer + charactersOffset + characterIndex++ * sizeof(Character), &character, sizeof(Character));
+            }
+        }
+    }
+
+    return data;
 }
 
-void PDFTextLayoutStorage::setTextLayout(PDFInteger pageIndex, const PDFTextLayout& layout, QMutex* mutex)
+bool PDFFlatTextLayout::isHoveringOverTextBlock(const QPointF& point) const
 {
-    QByteArray result;
+    for (size_t i = 0; i < getBlockCount(); ++i)
     {
-        QDataStream stream(&result, QIODevice::WriteOnly);
-        stream << layout;
+        if (getBlock(i).boundingBox.contains(point))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+PDFTextLayout PDFFlatTextLayout::createTextLayout() const
+{
+    PDFTextLayout layout;
+    layout.m_blocks.reserve(getBlockCount());
+
+    for (size_t blockIndex = 0; blockIndex < getBlockCount(); ++blockIndex)
+    {
+        const Block block = getBlock(blockIndex);
+
+        PDFTextBlock textBlock;
+        textBlock.m_boundingBox = block.boundingBox.toPath();
+        textBlock.m_topLeft = block.topLeft;
+        textBlock.m_lines.reserve(block.lineCount);
+
+        for (size_t lineIndex = block.firstLine; lineIndex < block.firstLine + block.lineCount; ++lineIndex)
+        {
+            const Line line = getLine(lineIndex);
+
+            PDFTextLine textLine;
+            textLine.m_boundingBox = line.boundingBox.toPath();
+            textLine.m_topLeft = line.topLeft;
+            textLine.m_characters.reserve(line.characterCount);
+
+            for (size_t characterIndex = line.firstCharacter; characterIndex < line.firstCharacter + line.characterCount; ++characterIndex)
+            {
+                const Character character = getCharacter(characterIndex);
+
+                TextCharacter textCharacter;
+                textCharacter.character = QChar(ushort(character.character));
+                textCharacter.position = character.position;
+                textCharacter.angle = character.angle;
+                textCharacter.fontSize = character.fontSize;
+                textCharacter.advance = character.advance;
+                textCharacter.boundingBox = character.boundingBox.toPath();
+                textLine.m_characters.emplace_back(qMove(textCharacter));
+            }
+
+            textBlock.m_lines.emplace_back(qMove(textLine));
+        }
+
+        layout.m_blocks.emplace_back(qMove(textBlock));
     }
-    result = qCompress(result, 9);
 
-    QMutexLocker lock(mutex);
-    m_offsets[pageIndex] = m_textLayouts.size();
+    return layout;
+}
+
+QPainterPath PDFFlatTextLayout::Quadrilateral::toPath() const
+{
+    QPainterPath path;
+    path.addPolygon(QPolygonF({ points[0], points[1], points[2], points[3], points[0] }));
+    return path;
+}
 
-    QDataStream layoutStream(&m_textLayouts, QIODevice::Append | QIODevice::WriteOnly);
-    layoutStream << result;
+bool PDFFlatTextLayout::Quadrilateral::contains(const QPointF& point) const
+{
+    return QPolygonF({ points[0], points[1], points[2], points[3] }).containsPoint(point, Qt::OddEvenFill);
+}
+
+PDFFlatTextLayout::Quadrilateral PDFFlatTextLayout::Quadrilateral::fromPath(const QPainterPath& path)
+{
+    Quadrilateral quadrilateral;
+
+    if (path.elementCount() >= 4)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            quadrilateral.points[i] = path.elementAt(i);
+        }
+    }
+    else
+    {
+        QRectF rect = path.controlPointRect();
+        quadrilateral.points = { rect.topLeft(), rect.topRight(), rect.bottomRight(), rect.bottomLeft() };
+    }
+
+    return quadrilateral;
+}
+
+PDFTextLayout PDFTextLayoutStorage::getTextLayout(PDFInteger pageIndex) const
+{
+    return getFlatTextLayout(pageIndex).createTextLayout();
+}
+
+PDFFlatTextLayout PDFTextLayoutStorage::getFlatTextLayout(PDFInteger pageIndex) const
+{
+    if (pageIndex >= 0 && pageIndex < static_cast<PDFInteger>(m_pages.size()))
+    {
+        const PageData& pageData = m_pages[pageIndex];
+        return PDFFlatTextLayout(pageData.isCompressed ? qUncompress(pageData.data) : pageData.data);
+    }
+
+    return PDFFlatTextLayout();
+}
+
+bool PDFTextLayoutStorage::isHoveringOverTextBlock(PDFInteger pageIndex, const QPointF& point) const
+{
+    return getFlatTextLayout(pageIndex).isHoveringOverTextBlock(point);
+}
+
+void PDFTextLayoutStorage::setTextLayout(PDFInteger pageIndex, const PDFTextLayout& layout)
+{
+    PageData& pageData = m_pages[pageIndex];
+    pageData.data = PDFFlatTextLayout::create(layout);
+    pageData.isCompressed = false;
+}
+
+void PDFTextLayoutStorage::compress(qint64 memoryBudget)
+{
+    qint64 memoryConsumption = getMemoryConsumption();
+    if (memoryConsumption <= memoryBudget)
+    {
+        return;
+    }
+
+    std::vector<size_t> pageIndices(m_pages.size(), 0);
+    std::iota(pageIndices.begin(), pageIndices.end(), 0);
+    std::sort(pageIndices.begin(), pageIndices.end(), [this](size_t l, size_t r) { return m_pages[l].data.size() > m_pages[r].data.size(); });
+
+    for (size_t pageIndex : pageIndices)
+    {
+        if (memoryConsumption <= memoryBudget)
+        {
+            break;
+        }
+
+        PageData& pageData = m_pages[pageIndex];
+        if (pageData.isCompressed || pageData.data.isEmpty())
+        {
+            continue;
+        }
+
+        // Use fast compression, layout can be accessed often (for example,
+        // when user moves the mouse over the page), so decompression must be fast.
+        QByteArray compressedData = qCompress(pageData.data, 1);
+        memoryConsumption -= pageData.data.size() - compressedData.size();
+        pageData.data = qMove(compressedData);
+        pageData.isCompressed = true;
+    }
+}
+
+qint64 PDFTextLayoutStorage::getMemoryConsumption() const
+{
+    qint64 memoryConsumption = sizeof(*this) + m_pages.capacity() * sizeof(PageData);
+    for (const PageData& pageData : m_pages)
+    {
+        memoryConsumption += pageData.data.size();
+    }
+    return memoryConsumption;
 }
 
 PDFFindResults PDFTextLayoutStorage::find(const QString& text, Qt::CaseSensitivity caseSensitivity, PDFTextFlow::FlowFlags flowFlags) const
 {
     PDFFindResults results;
 
+    // Use text index to restrict searched text flows, if it is possible (index
+    // is created from text flows of separate blocks).
+    std::optional<PDFTextIndex::FlowReferences> candidateFlows;
+    if (m_textIndex && flowFlags.testFlag(PDFTextFlow::SeparateBlocks) && m_textIndex->getPageCount() == PDFInteger(m_pages.size()))
+    {
+        candidateFlows = m_textIndex->getCandidateFlows(text);
+    }
+
+    std::vector<size_t> pageIndices;
+    if (candidateFlows)
+    {
+        for (const PDFTextIndex::FlowReference& reference : *candidateFlows)
+        {
+            if (pageIndices.empty() || pageIndices.back() != size_t(reference.pageIndex))
+            {
+                pageIndices.push_back(reference.pageIndex);
+            }
+        }
+    }
+    else
+    {
+        pageIndices.resize(m_pages.size());
+        std::iota(pageIndices.begin(), pageIndices.end(), 0);
+    }
+
     QMutex resultsMutex;
-    auto findImpl = [this, flowFlags, caseSensitivity, &results, &resultsMutex, &text](size_t pageIndex)
+    auto findImpl = [this, flowFlags, caseSensitivity, &results, &resultsMutex, &text, &candidateFlows](size_t pageIndex)
     {
         PDFTextLayout textLayout = getTextLayout(pageIndex);
         PDFTextFlows textFlows = PDFTextFlow::createTextFlows(textLayout, flowFlags, pageIndex);
-        for (const PDFTextFlow& textFlow : textFlows)
+        for (size_t flowIndex = 0; flowIndex < textFlows.size(); ++flowIndex)
         {
+            if (candidateFlows && !std::binary_search(candidateFlows->cbegin(), candidateFlows->cend(), PDFTextIndex::FlowReference{ PDFInteger(pageIndex), PDFInteger(flowIndex) }))
+            {
+                continue;
+            }
+
+            const PDFTextFlow& textFlow = textFlows[flowIndex];
             PDFFindResults flowResults = textFlow.find(text, caseSensitivity);
 
             // Jakub Melka: Do not lock mutex, if we didn't find anything. In that case, just skip to next flow.
@@ -993,8 +1253,7 @@ PDFFindResults PDFTextLayoutStorage::find(const QString& text, Qt::CaseSensitivi
         }
     };
 
-    auto range = PDFIntegerRange<size_t>(0, m_offsets.size());
-    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, range.begin(), range.end(), findImpl);
+    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, pageIndices.cbegin(), pageIndices.cend(), findImpl);
 
     std::sort(results.begin(), results.end());
     return results;
@@ -1022,7 +1281,7 @@ PDFFindResults PDFTextLayoutStorage::find(const QRegularExpression& expression,
         }
     };
 
-    auto range = PDFIntegerRange<size_t>(0, m_offsets.size());
+    auto range = PDFIntegerRange<size_t>(0, m_pages.size());
     PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, range.begin(), range.end(), findImpl);
 
     std::sort(results.begin(), results.end());
@@ -1582,27 +1841,27 @@ QPainterPath PDFTextSelectionPainter::prepareGeometry(PDFInteger pageIndex, PDFT
 
 PDFTextLayoutCache::PDFTextLayoutCache(std::function<PDFTextLayout (PDFInteger)> textLayoutGetter) :
     m_textLayoutGetter(qMove(textLayoutGetter)),
-    m_pageIndex(-1),
-    m_layout()
+    m_layouts(CACHED_TEXT_LAYOUT_COUNT)
 {
 
 }
 
 void PDFTextLayoutCache::clear()
 {
-    m_pageIndex = -1;
-    m_layout = PDFTextLayout();
+    m_layouts.clear();
 }
 
 const PDFTextLayout& PDFTextLayoutCache::getTextLayout(PDFInteger pageIndex)
 {
-    if (m_pageIndex != pageIndex)
+    if (PDFTextLayout* layout = m_layouts.object(pageIndex))
     {
-        m_pageIndex = pageIndex;
-        m_layout = m_textLayoutGetter(pageIndex);
+        return *layout;
     }
 
-    return m_layout;
+    // Each layout has cost 1, so insertion never fails
+    PDFTextLayout* layout = new PDFTextLayout(m_textLayoutGetter(pageIndex));
+    m_layouts.insert(pageIndex, layout);
+    return *layout;
 }
 
 }   // namespace pdf
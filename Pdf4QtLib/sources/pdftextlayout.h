@@ -21,16 +21,22 @@
 #include "pdfglobal.h"
 #include "pdfutils.h"
 
+#include <QCache>
 #include <QColor>
 #include <QDataStream>
 #include <QPainterPath>
 
 #include <set>
+#include <array>
+#include <memory>
+#include <cstring>
 #include <compare>
 
 namespace pdf
 {
+class PDFTextIndex;
 class PDFTextLayout;
+class PDFFlatTextLayout;
 class PDFTextLayoutStorage;
 
 struct PDFTextCharacterInfo
@@ -131,6 +137,8 @@ public:
     friend QDataStream& operator>>(QDataStream& stream, PDFTextLine& line);
 
 private:
+    friend class PDFFlatTextLayout;
+
     TextCharacters m_characters;
     QPainterPath m_boundingBox;
     QPointF m_topLeft;
@@ -158,6 +166,8 @@ public:
     friend QDataStream& operator>>(QDataStream& stream, PDFTextBlock& block);
 
 private:
+    friend class PDFFlatTextLayout;
+
     PDFTextLines m_lines;
     QPainterPath m_boundingBox;
     QPointF m_topLeft;
@@ -385,6 +395,8 @@ public:
     friend QDataStream& operator>>(QDataStream& stream, PDFTextLayout& layout);
 
 private:
+    friend class PDFFlatTextLayout;
+
     /// Makes layout for particular angle
     void performDoLayout(PDFReal angle);
 
@@ -404,7 +416,8 @@ private:
     PDFTextBlocks m_blocks;
 };
 
-/// Cache for storing single text layout
+/// Cache for storing text layouts of recently used pages (for example,
+/// visible pages, when user is selecting the text)
 class PDF4QTLIBSHARED_EXPORT PDFTextLayoutCache
 {
 public:
@@ -414,15 +427,17 @@ public:
     void clear();
 
     /// Returns text layout. This function always succeeds. If compiler is not active,
-    /// then empty layout is returned.
-    /// \param compiler Text layout compiler
+    /// then empty layout is returned. Returned reference is valid until text layout
+    /// of another page is requested.
     /// \param pageIndex Page index
     const PDFTextLayout& getTextLayout(PDFInteger pageIndex);
 
 private:
+    /// Maximal number of cached text layouts
+    static constexpr int CACHED_TEXT_LAYOUT_COUNT = 8;
+
     std::function<PDFTextLayout(PDFInteger)> m_textLayoutGetter;
-    PDFInteger m_pageIndex;
-    PDFTextLayout m_layout;
+    QCache<PDFInteger, PDFTextLayout> m_layouts;
 };
 
 class PDF4QTLIBSHARED_EXPORT PDFTextLayoutGetter
@@ -505,16 +520,135 @@ private:
     const PDFTextSelection* m_selection;
 };
 
-/// Storage for text layouts. For reading and writing, this object is thread safe.
-/// For writing, mutex is used to synchronize asynchronous writes, for reading
-/// no mutex is used at all. For this reason, both reading/writing at the same time
-/// is prohibited, it is not thread safe.
+/// Flat (offset based) binary representation of the text layout. Whole layout
+/// is stored in a single buffer, consisting of a header and arrays of plain
+/// structures (blocks, lines and characters), which reference each other by
+/// indices. Data can be read in place, without deserialization, so simple
+/// queries (for example, hover test) do not need to create the text layout.
+/// Only recognized text blocks are stored, not the input characters of the
+/// layout algorithm.
+class PDF4QTLIBSHARED_EXPORT PDFFlatTextLayout
+{
+public:
+    explicit inline PDFFlatTextLayout() = default;
+
+    /// Creates flat text layout over the data. Data are not copied (byte array
+    /// is implicitly shared). If data are invalid, empty layout is created.
+    /// \param data Data created by function \p create
+    explicit PDFFlatTextLayout(QByteArray data);
+
+    /// Quadrilateral (bounding box of the text item in device space)
+    struct Quadrilateral
+    {
+        std::array<QPointF, 4> points = { };
+
+        /// Creates painter path from quadrilateral
+        QPainterPath toPath() const;
+
+        /// Returns true, if quadrilateral contains given point
+        bool contains(const QPointF& point) const;
+
+        /// Creates quadrilateral from a painter path. Bounding boxes in the text
+        /// layout are (possibly transformed) rectangles, so first four points
+        /// of the path are taken. If path has less points, its bounding rectangle is used.
+        static Quadrilateral fromPath(const QPainterPath& path);
+    };
+
+    struct Block
+    {
+        Quadrilateral boundingBox;
+        QPointF topLeft;
+        quint32 firstLine = 0;
+        quint32 lineCount = 0;
+    };
+
+    struct Line
+    {
+        Quadrilateral boundingBox;
+        QPointF topLeft;
+        quint32 firstCharacter = 0;
+        quint32 characterCount = 0;
+    };
+
+    struct Character
+    {
+        QPointF position;
+        PDFReal angle = 0.0;
+        PDFReal fontSize = 0.0;
+        PDFReal advance = 0.0;
+        Quadrilateral boundingBox;
+        quint32 character = 0;
+        quint32 reserved = 0;
+    };
+
+    /// Creates flat data from the text layout
+    /// \param layout Text layout
+    static QByteArray create(const PDFTextLayout& layout);
+
+    /// Returns true, if layout contains valid data
+    bool isValid() const { return !m_data.isEmpty(); }
+
+    size_t getBlockCount() const { return m_header.blockCount; }
+    size_t getLineCount() const { return m_header.lineCount; }
+    size_t getCharacterCount() const { return m_header.characterCount; }
+
+    /// Returns block with given index. Index must be valid.
+    Block getBlock(size_t index) const { return read<Block>(m_blocksOffset, index); }
+
+    /// Returns line with given index (index is global, not relative to
+    /// the block). Index must be valid.
+    Line getLine(size_t index) const { return read<Line>(m_linesOffset, index); }
+
+    /// Returns character with given index (index is global, not relative
+    /// to the line). Index must be valid.
+    Character getCharacter(size_t index) const { return read<Character>(m_charactersOffset, index); }
+
+    /// Returns true, if given point is pointing to some text block
+    bool isHoveringOverTextBlock(const QPointF& point) const;
+
+    /// Creates text layout from the flat data
+    PDFTextLayout createTextLayout() const;
+
+    /// Returns flat data
+    const QByteArray& getData() const { return m_data; }
+
+private:
+    struct Header
+    {
+        quint32 magic = 0;
+        quint32 blockCount = 0;
+        quint32 lineCount = 0;
+        quint32 characterCount = 0;
+    };
+
+    /// Reads structure from the data. Data may not be aligned,
+    /// so memcpy is used instead of pointer cast.
+    template<typename T>
+    T read(size_t offset, size_t index) const
+    {
+        T result;
+        std::memcpy(&result, m_data.constData() + offset + index * sizeof(T), sizeof(T));
+        return result;
+    }
+
+    QByteArray m_data;
+    Header m_header;
+    size_t m_blocksOffset = 0;
+    size_t m_linesOffset = 0;
+    size_t m_charactersOffset = 0;
+};
+
+/// Storage for text layouts. Each page is stored in its own buffer in flat
+/// format (see \p PDFFlatTextLayout), so text layouts of different pages can be
+/// written from multiple threads at once, without locking. Reading can be performed
+/// from multiple threads, but reading and writing at the same time is prohibited,
+/// it is not thread safe.
 class PDF4QTLIBSHARED_EXPORT PDFTextLayoutStorage
 {
 public:
     explicit inline PDFTextLayoutStorage() = default;
     explicit inline PDFTextLayoutStorage(PDFInteger pageCount) :
-        m_offsets(pageCount, 0)
+        m_pages(pageCount)
     {
 
     }
@@ -531,14 +665,37 @@ public:
     /// \param pageIndex Page index
     PDFTextLayoutStorageGetter getTextLayoutLazy(PDFInteger pageIndex) const { return PDFTextLayoutStorageGetter(this, pageIndex); }
 
+    /// Returns flat text layout for particular page, which can be read in place.
+    /// If page index is invalid, then empty layout is returned. If page is not
+    /// compressed, no data are copied.
+    /// \param pageIndex Page index
+    PDFFlatTextLayout getFlatTextLayout(PDFInteger pageIndex) const;
+
+    /// Returns true, if given point is pointing to some text block on the page.
+    /// Text layout is not created, flat data are used directly.
+    /// \param pageIndex Page index
+    /// \param point Point
+    bool isHoveringOverTextBlock(PDFInteger pageIndex, const QPointF& point) const;
+
     /// Sets text layout to the particular index. Index must be valid and from
-    /// range 0 to \p pageCount - 1. Function is not thread safe.
+    /// range 0 to \p pageCount - 1. Function can be called from multiple threads,
+    /// but each page must be written by one thread only.
     /// \param pageIndex Page index
     /// \param layout Text layout
-    /// \param mutex Mutex for locking (calls of setTextLayout from multiple threads)
-    void setTextLayout(PDFInteger pageIndex, const PDFTextLayout& layout, QMutex* mutex);
+    void setTextLayout(PDFInteger pageIndex, const PDFTextLayout& layout);
 
-    /// Finds simple text in all pages. All text occurences are returned.
+    /// Compresses largest pages, until memory consumption of the storage
+    /// fits into the memory budget. Compressed pages must be uncompressed
+    /// when accessed, so they can't be read in place. Function is not thread safe.
+    /// \param memoryBudget Memory budget (in bytes)
+    void compress(qint64 memoryBudget);
+
+    /// Returns memory consumption of the stored data (in bytes)
+    qint64 getMemoryConsumption() const;
+
+    /// Finds simple text in all pages. All text occurences are returned. If text
+    /// index is set and text flows are created for separate blocks, then only
+    /// text flows, which can contain the text (according to the index), are searched.
     /// \param text Text to be found
     /// \param caseSensitivity Case sensitivity
     /// \param flowFlags Text flow flags
@@ -550,11 +707,25 @@ public:
     PDFFindResults find(const QRegularExpression& expression, PDFTextFlow::FlowFlags flowFlags) const;
 
     /// Returns number of pages
-    size_t getCount() const { return m_offsets.size(); }
+    size_t getCount() const { return m_pages.size(); }
+
+    /// Returns text index (or nullptr, if text index was not set)
+    const PDFTextIndex* getTextIndex() const { return m_textIndex.get(); }
+
+    /// Sets text index, which is used to speed up the text search. Text
+    /// index must be created from this storage.
+    /// \param textIndex Text index
+    void setTextIndex(std::shared_ptr<const PDFTextIndex> textIndex) { m_textIndex = qMove(textIndex); }
 
 private:
-    std::vector<int> m_offsets;
-    QByteArray m_textLayouts;
+    struct PageData
+    {
+        QByteArray data;
+        bool isCompressed = false;
+    };
+
+    std::vector<PageData> m_pages;
+    std::shared_ptr<const PDFTextIndex> m_textIndex;
 };
 
 }   // namespace pdf
@@ -2613,6 +2613,11 @@ void PDFTransparencyRenderer::performTextEnd(ProcessOrder order)
     }
 }
 
+bool PDFTransparencyRenderer::isProcessingOriginalImages() const
+{
+    return true;
+}
+
 bool PDFTransparencyRenderer::performOriginalImagePainting(const PDFImage& image)
 {
     PDFFloatBitmap texture = getImage(image);
@@ -704,6 +704,7 @@ public:
     virtual void performTextBegin(ProcessOrder order) override;
     virtual void performTextEnd(ProcessOrder order) override;
     virtual bool performOriginalImagePainting(const PDFImage& image) override;
+    virtual bool isProcessingOriginalImages() const override;
     virtual void performImagePainting(const QImage& image) override;
     virtual void performMeshPainting(const PDFMesh& mesh) override;
 
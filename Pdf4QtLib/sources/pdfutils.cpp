@@ -83,22 +83,23 @@ PDFBitReader::Value PDFBitReader::read(PDFBitReader::Value bits)
 
 PDFBitReader::Value PDFBitReader::look(Value bits) const
 {
-    PDFBitReader temp(*this);
+    // We do not modify the state of the reader, we just fill local copy of
+    // the buffer. If end of stream is reached, zero bits are used.
+    Value buffer = m_buffer;
+    Value bitsInBuffer = m_bitsInBuffer;
+    int position = m_position;
 
-    Value result = 0;
-    for (Value i = 0; i < bits; ++i)
+    while (bitsInBuffer < bits)
     {
-        if (!temp.isAtEnd())
+        buffer = buffer << 8;
+        if (position < m_stream->size())
         {
-            result = (result << 1) | temp.read(1);
-        }
-        else
-        {
-            result = (result << 1);
+            buffer |= static_cast<uint8_t>((*m_stream)[position++]);
         }
+        bitsInBuffer += 8;
     }
 
-    return result;
+    return (buffer >> (bitsInBuffer - bits)) & ((static_cast<Value>(1) << bits) - static_cast<Value>(1));
 }
 
 void PDFBitReader::seek(qint64 position)
@@ -596,14 +596,14 @@ void PDFSelectTextTool::mouseMoveEvent(QWidget* widget, QMouseEvent* event)
 
     QPointF pagePoint;
     const PDFInteger pageIndex = getProxy()->getPageUnderPoint(event->pos(), &pagePoint);
-    PDFTextLayout textLayout = getProxy()->getTextLayoutCompiler()->getTextLayoutLazy(pageIndex);
-    m_isCursorOverText = textLayout.isHoveringOverTextBlock(pagePoint);
+    m_isCursorOverText = getProxy()->getTextLayoutCompiler()->isHoveringOverTextBlock(pageIndex, pagePoint);
 
     if (m_selectionInfo.pageIndex != -1)
     {
         if (m_selectionInfo.pageIndex == pageIndex)
         {
             // Jakub Melka: handle the selection
+            PDFTextLayout textLayout = getProxy()->getTextLayoutCompiler()->getTextLayoutLazy(pageIndex);
             setSelection(textLayout.createTextSelection(pageIndex, m_selectionInfo.selectionStartPoint, pagePoint));
         }
         else
@@ -676,7 +676,8 @@ void PDFSelectTextTool::onActionCopyText()
             while (it != m_textSelection.end())
             {
                 const PDFInteger pageIndex = it->start.pageIndex;
-                PDFTextLayout textLayout = getProxy()->getTextLayoutCompiler()->getTextLayoutLazy(pageIndex);
+                PDFTextLayoutGetter textLayoutGetter = getProxy()->getTextLayoutCompiler()->getTextLayoutLazy(pageIndex);
+                const PDFTextLayout& textLayout = textLayoutGetter;
                 result << textLayout.getTextFromSelection(it, itEnd, pageIndex);
 
                 it = itEnd;
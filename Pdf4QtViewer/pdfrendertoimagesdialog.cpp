@@ -32,6 +32,10 @@
 namespace pdfviewer
 {
 
+/// Limit of the cache of precompiled pages, which are reused, when document
+/// is rendered several times (for example, in different resolutions) [bytes]
+static constexpr int PRECOMPILED_PAGE_CACHE_LIMIT = 128 * 1024 * 1024;
+
 PDFRenderToImagesDialog::PDFRenderToImagesDialog(const pdf::PDFDocument* document,
                                                  pdf::PDFDrawWidgetProxy* proxy,
                                                  pdf::PDFProgress* progress,
@@ -44,7 +48,8 @@ PDFRenderToImagesDialog::PDFRenderToImagesDialog(const pdf::PDFDocument* documen
     m_imageExportSettings(document),
     m_isLoadingData(false),
     m_optionalContentActivity(nullptr),
-    m_rasterizerPool(nullptr)
+    m_rasterizerPool(nullptr),
+    m_precompiledPageCache(PRECOMPILED_PAGE_CACHE_LIMIT)
 {
     ui->setupUi(this);
 
@@ -299,6 +304,7 @@ void PDFRenderToImagesDialog::on_buttonBox_clicked(QAbstractButton* button)
                                                           m_optionalContentActivity, m_proxy->getFeatures(), m_proxy->getMeshQualitySettings(),
                                                           pdf::PDFRasterizerPool::getDefaultRasterizerCount(), m_proxy->isUsingOpenGL(), m_proxy->getSurfaceFormat(), this);
             connect(m_rasterizerPool, &pdf::PDFRasterizerPool::renderError, this, &PDFRenderToImagesDialog::onRenderError);
+            m_rasterizerPool->setPrecompiledPageCache(&m_precompiledPageCache);
 
             auto process = [this]()
             {
@@ -92,6 +92,7 @@ private:
     pdf::PDFOptionalContentActivity* m_optionalContentActivity;
     pdf::PDFCMSPointer m_cms;
     pdf::PDFRasterizerPool* m_rasterizerPool;
+    pdf::PDFPrecompiledPageCache m_precompiledPageCache;
 };
 
 }   // namespace pdfviewer
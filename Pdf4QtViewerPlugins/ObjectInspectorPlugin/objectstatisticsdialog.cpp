@@ -36,8 +36,8 @@ ObjectStatisticsDialog::ObjectStatisticsDialog(const pdf::PDFDocument* document,
     connect(ui->comboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &ObjectStatisticsDialog::updateStatisticsWidget);
 
     pdf::PDFObjectClassifier classifier;
-    classifier.classify(document);
-    m_statistics = classifier.calculateStatistics(document);
+    classifier.classify(document, true);
+    m_statistics = classifier.calculateStatistics();
 
     updateStatisticsWidget();
     pdf::PDFWidgetUtils::style(this);
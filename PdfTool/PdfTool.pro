@@ -62,6 +62,7 @@ SOURCES += \
         pdftoolinkcoverage.cpp \
         pdftooloptimize.cpp \
         pdftoolrender.cpp \
+        pdftoolsearch.cpp \
         pdftoolseparate.cpp \
         pdftoolstatistics.cpp \
         pdftoolunite.cpp \
@@ -96,6 +97,7 @@ HEADERS += \
     pdftoolinkcoverage.h \
     pdftooloptimize.h \
     pdftoolrender.h \
+    pdftoolsearch.h \
     pdftoolseparate.h \
     pdftoolstatistics.h \
     pdftoolunite.h \
@@ -181,6 +181,15 @@ void PDFToolAbstractApplication::initializeCommandLineParser(QCommandLineParser*
         parser->addPositionalArgument("right", "Right (new) document to be compared.");
     }
 
+    if (optionFlags.testFlag(Search))
+    {
+        parser->addPositionalArgument("text", "Text to be found.");
+        parser->addPositionalArgument("paths", "Documents or directories with documents to be searched.", "path1 [path2, ...]");
+        parser->addOption(QCommandLineOption("search-case-sensitive", "Use case sensitive search."));
+        parser->addOption(QCommandLineOption("search-recursive", "Search documents in subdirectories."));
+        parser->addOption(QCommandLineOption("search-index", "Location of text index (valid values: cache|document|none). Text index is created on first search and reused, until document is changed.", "location", "cache"));
+    }
+
     if (optionFlags.testFlag(SignatureVerification))
     {
         parser->addOption(QCommandLineOption("ver-no-user-cert", "Disable user certificate store."));
@@ -222,6 +231,7 @@ void PDFToolAbstractApplication::initializeCommandLineParser(QCommandLineParser*
     if (optionFlags.testFlag(TextAnalysis))
     {
         parser->addOption(QCommandLineOption("text-analysis-alg", "Text analysis algorithm (auto - select automatically, layout - perform automatic layout algorithm, content - simple content stream reading order, structure - use tagged document structure).", "algorithm", "auto"));
+        parser->addOption(QCommandLineOption("text-exact-outlines", "Use exact glyph outlines in layout algorithm instead of character boxes computed from font metrics (slower)."));
     }
 
     if (optionFlags.testFlag(TextShow))
@@ -280,6 +290,7 @@ void PDFToolAbstractApplication::initializeCommandLineParser(QCommandLineParser*
         parser->addOption(QCommandLineOption("image-res-mode", "Image resolution mode (valid values are dpi|pixel). Dpi is default.", "mode", "dpi"));
         parser->addOption(QCommandLineOption("image-res-dpi", "DPI resolution of target image.", "dpi"));
         parser->addOption(QCommandLineOption("image-res-pixel", "Pixel resolution of target image.", "pixel"));
+        parser->addOption(QCommandLineOption("image-outputs", "Render each page into multiple outputs, each page is compiled only once. Outputs are separated by comma, each output is in the form mode:resolution[:format], where mode is dpi|pixel (for example, 'pixel:256:jpg,dpi:300'). Resolution is appended to the file name.", "outputs"));
     }
 
     if (optionFlags.testFlag(ColorManagementSystem))
@@ -310,6 +321,7 @@ void PDFToolAbstractApplication::initializeCommandLineParser(QCommandLineParser*
         parser->addOption(QCommandLineOption("render-show-page-stat", "Show page rendering statistics."));
         parser->addOption(QCommandLineOption("render-msaa-samples", "MSAA sample count for GPU rendering.", "samples", "4"));
         parser->addOption(QCommandLineOption("render-rasterizers", "Number of rasterizer contexts.", "rasterizers", QString::number(pdf::PDFRasterizerPool::getDefaultRasterizerCount())));
+        parser->addOption(QCommandLineOption("render-band-height", "Render and write page images in horizontal bands of given height (in pixels), so whole page image is not held in memory. Only PNG, PBM, PGM and PPM formats are written by bands. Zero means that whole page is rendered at once.", "pixels", "0"));
     }
 
     if (optionFlags.testFlag(Optimize))
@@ -474,6 +486,8 @@ PDFToolOptions PDFToolAbstractApplication::getOptions(QCommandLineParser* parser
         {
             PDFConsole::writeError(PDFToolTranslationContext::tr("Unknown text layout analysis algorithm '%1'. Defaulting to automatic algorithm selection.").arg(algoritm), options.outputCodec);
         }
+
+        options.textExactOutlines = parser->isSet("text-exact-outlines");
     }
 
     if (optionFlags.testFlag(TextShow))
@@ -702,6 +716,54 @@ PDFToolOptions PDFToolAbstractApplication::getOptions(QCommandLineParser* parser
                 PDFConsole::writeError(PDFToolTranslationContext::tr("Invalid image pixel value '%1'.").arg(parser->value("image-res-pixel")), options.outputCodec);
             }
         }
+
+        if (parser->isSet("image-outputs"))
+        {
+            const QStringList outputs = parser->value("image-outputs").split(',', Qt::SkipEmptyParts);
+            for (const QString& output : outputs)
+            {
+                const QStringList items = output.trimmed().split(':');
+
+                PDFToolOptions::ImageOutput imageOutput;
+                bool ok = items.size() == 2 || items.size() == 3;
+
+                if (ok)
+                {
+                    const QString mode = items[0].toLower();
+                    if (mode == "dpi")
+                    {
+                        imageOutput.resolutionMode = pdf::PDFPageImageExportSettings::ResolutionMode::DPI;
+                        imageOutput.resolution = items[1].toInt(&ok);
+                        ok = ok && imageOutput.resolution >= pdf::PDFPageImageExportSettings::getMinDPIResolution() && imageOutput.resolution <= pdf::PDFPageImageExportSettings::getMaxDPIResolution();
+                    }
+                    else if (mode == "pixel")
+                    {
+                        imageOutput.resolutionMode = pdf::PDFPageImageExportSettings::ResolutionMode::Pixels;
+                        imageOutput.resolution = items[1].toInt(&ok);
+                        ok = ok && imageOutput.resolution >= pdf::PDFPageImageExportSettings::getMinPixelResolution() && imageOutput.resolution <= pdf::PDFPageImageExportSettings::getMaxPixelResolution();
+                    }
+                    else
+                    {
+                        ok = false;
+                    }
+                }
+
+                if (ok && items.size() == 3)
+                {
+                    imageOutput.format = items[2].toLatin1();
+                    ok = options.imageWriterSettings.getFormats().contains(imageOutput.format);
+                }
+
+                if (ok)
+                {
+                    options.imageOutputs.push_back(qMove(imageOutput));
+                }
+                else
+                {
+                    PDFConsole::writeError(PDFToolTranslationContext::tr("Invalid image output '%1'.").arg(output), options.outputCodec);
+                }
+            }
+        }
     }
 
     if (optionFlags.testFlag(ColorManagementSystem))
@@ -880,6 +942,14 @@ PDFToolOptions PDFToolAbstractApplication::getOptions(QCommandLineParser* parser
             options.renderRasterizerCount = correctedRasterizerCount;
         }
 
+        textValue = parser->value("render-band-height");
+        options.renderBandHeight = textValue.toInt(&ok);
+        if (!ok || options.renderBandHeight < 0)
+        {
+            PDFConsole::writeError(PDFToolTranslationContext::tr("Invalid band height '%1'. Whole pages are rendered.").arg(textValue), options.outputCodec);
+            options.renderBandHeight = 0;
+        }
+
         options.renderShowPageStatistics = parser->isSet("render-show-page-stat");
     }
 
@@ -893,6 +963,37 @@ PDFToolOptions PDFToolAbstractApplication::getOptions(QCommandLineParser* parser
         options.diffFiles = positionalArguments;
     }
 
+    if (optionFlags.testFlag(Search))
+    {
+        options.searchText = positionalArguments.isEmpty() ? QString() : positionalArguments.front();
+        options.searchPaths = positionalArguments.mid(1);
+        options.searchCaseSensitive = parser->isSet("search-case-sensitive");
+        options.searchRecursive = parser->isSet("search-recursive");
+
+        QString searchIndex = parser->value("search-index");
+        if (searchIndex == "cache")
+        {
+            options.searchIndexLocation = PDFToolOptions::SearchIndexLocation::Cache;
+        }
+        else if (searchIndex == "document")
+        {
+            options.searchIndexLocation = PDFToolOptions::SearchIndexLocation::Document;
+        }
+        else if (searchIndex == "none")
+        {
+            options.searchIndexLocation = PDFToolOptions::SearchIndexLocation::None;
+        }
+        else
+        {
+            if (!searchIndex.isEmpty())
+            {
+                PDFConsole::writeError(PDFToolTranslationContext::tr("Unknown text index location '%1'. Defaulting to per-user cache.").arg(searchIndex), options.outputCodec);
+            }
+
+            options.searchIndexLocation = PDFToolOptions::SearchIndexLocation::Cache;
+        }
+    }
+
     if (optionFlags.testFlag(Optimize))
     {
         options.optimizeFlags = pdf::PDFOptimizer::None;
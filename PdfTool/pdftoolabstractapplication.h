@@ -86,6 +86,7 @@ struct PDFToolOptions
 
     // For option 'TextAnalysis'
     pdf::PDFDocumentTextFlowFactory::Algorithm textAnalysisAlgorithm = pdf::PDFDocumentTextFlowFactory::Algorithm::Auto;
+    bool textExactOutlines = false;
 
     // For option 'TextShow'
     bool textShowPageNumbers = false;
@@ -120,6 +121,18 @@ struct PDFToolOptions
     // For option 'ImageExportSettings'
     pdf::PDFPageImageExportSettings imageExportSettings;
 
+    /// Additional image output (resolution and format). If some outputs
+    /// are defined, then each page is rendered into all of them.
+    struct ImageOutput
+    {
+        pdf::PDFPageImageExportSettings::ResolutionMode resolutionMode = pdf::PDFPageImageExportSettings::ResolutionMode::DPI;
+        int resolution = 0;
+        QByteArray format; ///< Image format, empty means format from image writer settings
+    };
+
+    // For option 'ImageExportSettingsResolution'
+    std::vector<ImageOutput> imageOutputs;
+
     // For option 'ColorManagementSystem'
     pdf::PDFCMSSettings cmsSettings;
 
@@ -129,6 +142,7 @@ struct PDFToolOptions
     bool renderShowPageStatistics = false;
     int renderMSAAsamples = 4;
     int renderRasterizerCount = pdf::PDFRasterizerPool::getDefaultRasterizerCount();
+    int renderBandHeight = 0; ///< Height of the rendered band (in pixels), zero means whole page is rendered at once
 
     // For option 'Separate'
     QString separatePagePattern;
@@ -139,6 +153,20 @@ struct PDFToolOptions
     // For option 'Diff'
     QStringList diffFiles;
 
+    // For option 'Search'
+    enum class SearchIndexLocation
+    {
+        None,       ///< Do not store text index
+        Cache,      ///< Store text index in per-user cache
+        Document    ///< Store text index next to the document
+    };
+
+    QString searchText;
+    QStringList searchPaths;
+    bool searchCaseSensitive = false;
+    bool searchRecursive = false;
+    SearchIndexLocation searchIndexLocation = SearchIndexLocation::Cache;
+
     // For option 'Optimize'
     pdf::PDFOptimizer::OptimizationFlags optimizeFlags = pdf::PDFOptimizer::None;
 
@@ -242,6 +270,7 @@ public:
         CertStoreInstall                = 0x00400000,       ///< Settings for certificate store install certificate tool
         Encrypt                         = 0x00800000,       ///< Encryption settings
         Diff                            = 0x01000000,       ///< Diff settings (compare documents)
+        Search                          = 0x02000000,       ///< Full text search settings
     };
     Q_DECLARE_FLAGS(Options, Option)
 
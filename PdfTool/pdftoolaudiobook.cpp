@@ -350,6 +350,7 @@ int PDFToolAudioBook::getDocumentTextFlow(const PDFToolOptions& options, pdf::PD
     }
 
     pdf::PDFDocumentTextFlowFactory factory;
+    factory.setExactTextOutlines(options.textExactOutlines);
     flow = factory.create(&document, pages, options.textAnalysisAlgorithm);
 
     return ExitSuccess;
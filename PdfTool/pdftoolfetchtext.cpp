@@ -69,6 +69,7 @@ int PDFToolFetchTextApplication::execute(const PDFToolOptions& options)
     }
 
     pdf::PDFDocumentTextFlowFactory factory;
+    factory.setExactTextOutlines(options.textExactOutlines);
     pdf::PDFDocumentTextFlow documentTextFlow = factory.create(&document, pages, options.textAnalysisAlgorithm);
 
     PDFOutputFormatter formatter(options.outputStyle, options.outputCodec);
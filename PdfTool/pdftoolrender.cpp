@@ -19,6 +19,8 @@
 #include "pdffont.h"
 #include "pdfconstants.h"
 
+#include <QDir>
+#include <QFileInfo>
 #include <QElapsedTimer>
 
 namespace pdftool
@@ -70,28 +72,78 @@ void PDFToolRender::finish(const PDFToolOptions& options)
     PDFConsole::writeText(formatter.getString(), options.outputCodec);
 }
 
+QString PDFToolRender::getOutputFileName(const PDFToolOptions& options, const pdf::PDFRenderedPageImage& renderedPageImage, pdf::PDFImageWriterSettings& imageWriterSettings) const
+{
+    imageWriterSettings = options.imageWriterSettings;
+    QString fileName;
+
+    if (!options.imageOutputs.empty())
+    {
+        // Multiple outputs - each output can have its own format, and resolution
+        // is appended to the file name, so file names of the outputs differ.
+        const PDFToolOptions::ImageOutput& imageOutput = options.imageOutputs.at(renderedPageImage.imageSizeIndex);
+        if (!imageOutput.format.isEmpty())
+        {
+            imageWriterSettings.selectFormat(imageOutput.format);
+        }
+
+        const bool isDPI = imageOutput.resolutionMode == pdf::PDFPageImageExportSettings::ResolutionMode::DPI;
+        const QString resolution = isDPI ? QString("%1dpi").arg(imageOutput.resolution) : QString("%1px").arg(imageOutput.resolution);
+
+        QFileInfo fileInfo(options.imageExportSettings.getOutputFileName(renderedPageImage.pageIndex, imageWriterSettings.getCurrentFormat()));
+        fileName = QDir::toNativeSeparators(QString("%1/%2_%3.%4").arg(fileInfo.path(), fileInfo.completeBaseName(), resolution, fileInfo.suffix()));
+    }
+    else
+    {
+        fileName = options.imageExportSettings.getOutputFileName(renderedPageImage.pageIndex, imageWriterSettings.getCurrentFormat());
+    }
+
+    return fileName;
+}
+
+std::unique_ptr<pdf::PDFImageBandWriter> PDFToolRender::createBandWriter(const PDFToolOptions& options, const pdf::PDFRenderedPageImage& renderedPageImage)
+{
+    pdf::PDFImageWriterSettings imageWriterSettings;
+    QString fileName = getOutputFileName(options, renderedPageImage, imageWriterSettings);
+    return pdf::PDFImageBandWriter::create(fileName, imageWriterSettings.getCurrentFormat(), imageWriterSettings.getCompression(), imageWriterSettings.getQuality());
+}
+
 void PDFToolRender::onPageRendered(const PDFToolOptions& options, pdf::PDFRenderedPageImage& renderedPageImage)
 {
     writePageInfoStatistics(renderedPageImage);
-    QString fileName = options.imageExportSettings.getOutputFileName(renderedPageImage.pageIndex, options.imageWriterSettings.getCurrentFormat());
+
+    if (renderedPageImage.isBandWritten)
+    {
+        // Image was already written by band writer
+        QMutexLocker lock(&m_pageInfoMutex);
+        m_pageInfo[renderedPageImage.pageIndex].pageWriteTime += renderedPageImage.pageWriteTime;
+        return;
+    }
+
+    pdf::PDFImageWriterSettings imageWriterSettings;
+    QString fileName = getOutputFileName(options, renderedPageImage, imageWriterSettings);
 
     QElapsedTimer imageWriterTimer;
     imageWriterTimer.start();
 
-    QImageWriter imageWriter(fileName, options.imageWriterSettings.getCurrentFormat());
-    imageWriter.setSubType(options.imageWriterSettings.getCurrentSubtype());
-    imageWriter.setCompression(options.imageWriterSettings.getCompression());
-    imageWriter.setQuality(options.imageWriterSettings.getQuality());
-    imageWriter.setGamma(options.imageWriterSettings.getGamma());
-    imageWriter.setOptimizedWrite(options.imageWriterSettings.hasOptimizedWrite());
-    imageWriter.setProgressiveScanWrite(options.imageWriterSettings.hasProgressiveScanWrite());
+    QImageWriter imageWriter(fileName, imageWriterSettings.getCurrentFormat());
+    imageWriter.setSubType(imageWriterSettings.getCurrentSubtype());
+    imageWriter.setCompression(imageWriterSettings.getCompression());
+    imageWriter.setQuality(imageWriterSettings.getQuality());
+    imageWriter.setGamma(imageWriterSettings.getGamma());
+    imageWriter.setOptimizedWrite(imageWriterSettings.hasOptimizedWrite());
+    imageWriter.setProgressiveScanWrite(imageWriterSettings.hasProgressiveScanWrite());
+
+    const bool isWritten = imageWriter.write(renderedPageImage.pageImage);
+    const qint64 pageWriteTime = imageWriterTimer.elapsed();
 
-    if (!imageWriter.write(renderedPageImage.pageImage))
+    QMutexLocker lock(&m_pageInfoMutex);
+    if (!isWritten)
     {
         m_pageInfo[renderedPageImage.pageIndex].errors.emplace_back(pdf::PDFRenderError(pdf::RenderErrorType::Error, PDFToolTranslationContext::tr("Cannot write page image to file '%1', because: %2.").arg(fileName).arg(imageWriter.errorString())));
     }
 
-    m_pageInfo[renderedPageImage.pageIndex].pageWriteTime = imageWriterTimer.elapsed();
+    m_pageInfo[renderedPageImage.pageIndex].pageWriteTime += pageWriteTime;
 }
 
 QString PDFToolBenchmark::getStandardString(PDFToolAbstractApplication::StandardString standardString) const
@@ -200,28 +252,28 @@ int PDFToolRenderBase::execute(const PDFToolOptions& options)
     {
         if (pageIndex != pdf::PDFCatalog::INVALID_PAGE_INDEX)
         {
+            QMutexLocker lock(&m_pageInfoMutex);
             m_pageInfo[pageIndex].errors.emplace_back(qMove(error));
         }
     };
     QObject holder;
     QObject::connect(&rasterizerPool, &pdf::PDFRasterizerPool::renderError, &holder, onRenderError, Qt::DirectConnection);
 
-    auto imageSizeGetter = [&options](const pdf::PDFPage* page) -> QSize
+    auto getImageSize = [](const pdf::PDFPage* page, pdf::PDFPageImageExportSettings::ResolutionMode resolutionMode, int resolution) -> QSize
     {
         Q_ASSERT(page);
 
-        switch (options.imageExportSettings.getResolutionMode())
+        switch (resolutionMode)
         {
             case pdf::PDFPageImageExportSettings::ResolutionMode::DPI:
             {
-                QSizeF size = page->getRotatedMediaBox().size() * pdf::PDF_POINT_TO_INCH * options.imageExportSettings.getDpiResolution();
+                QSizeF size = page->getRotatedMediaBox().size() * pdf::PDF_POINT_TO_INCH * resolution;
                 return size.toSize();
             }
 
             case pdf::PDFPageImageExportSettings::ResolutionMode::Pixels:
             {
-                int pixelResolution = options.imageExportSettings.getPixelResolution();
-                QSizeF size = page->getRotatedMediaBox().size().scaled(pixelResolution, pixelResolution, Qt::KeepAspectRatio);
+                QSizeF size = page->getRotatedMediaBox().size().scaled(resolution, resolution, Qt::KeepAspectRatio);
                 return size.toSize();
             }
 
@@ -235,10 +287,31 @@ int PDFToolRenderBase::execute(const PDFToolOptions& options)
         return QSize();
     };
 
+    std::vector<pdf::PDFRasterizerPool::PageImageSizeGetter> imageSizeGetters;
+    if (options.imageOutputs.empty())
+    {
+        const pdf::PDFPageImageExportSettings::ResolutionMode resolutionMode = options.imageExportSettings.getResolutionMode();
+        const bool isDPI = resolutionMode == pdf::PDFPageImageExportSettings::ResolutionMode::DPI;
+        const int resolution = isDPI ? options.imageExportSettings.getDpiResolution() : options.imageExportSettings.getPixelResolution();
+        imageSizeGetters.push_back(std::bind(getImageSize, std::placeholders::_1, resolutionMode, resolution));
+    }
+    else
+    {
+        for (const PDFToolOptions::ImageOutput& imageOutput : options.imageOutputs)
+        {
+            imageSizeGetters.push_back(std::bind(getImageSize, std::placeholders::_1, imageOutput.resolutionMode, imageOutput.resolution));
+        }
+    }
+
     QElapsedTimer timer;
     timer.start();
 
-    rasterizerPool.render(pageIndices, imageSizeGetter, std::bind(&PDFToolRenderBase::onPageRendered, this, options, std::placeholders::_1), nullptr);
+    if (options.renderBandHeight > 0)
+    {
+        rasterizerPool.setBandWriterGetter(std::bind(&PDFToolRenderBase::createBandWriter, this, options, std::placeholders::_1), options.renderBandHeight);
+    }
+
+    rasterizerPool.render(pageIndices, imageSizeGetters, std::bind(&PDFToolRenderBase::onPageRendered, this, options, std::placeholders::_1), nullptr);
 
     m_wallTime = timer.elapsed();
 
@@ -248,14 +321,23 @@ int PDFToolRenderBase::execute(const PDFToolOptions& options)
     return ExitSuccess;
 }
 
+std::unique_ptr<pdf::PDFImageBandWriter> PDFToolRenderBase::createBandWriter(const PDFToolOptions& options, const pdf::PDFRenderedPageImage& renderedPageImage)
+{
+    Q_UNUSED(options);
+    Q_UNUSED(renderedPageImage);
+    return nullptr;
+}
+
 void PDFToolRenderBase::writePageInfoStatistics(const pdf::PDFRenderedPageImage& renderedPageImage)
 {
+    // Page can be rendered into multiple images concurrently, so we sum the times
+    QMutexLocker lock(&m_pageInfoMutex);
     PageInfo& info = m_pageInfo[renderedPageImage.pageIndex];
     info.isRendered = true;
-    info.pageCompileTime = renderedPageImage.pageCompileTime;
-    info.pageWaitTime = renderedPageImage.pageWaitTime;
-    info.pageRenderTime = renderedPageImage.pageRenderTime;
-    info.pageTotalTime = renderedPageImage.pageTotalTime;
+    info.pageCompileTime += renderedPageImage.pageCompileTime;
+    info.pageWaitTime += renderedPageImage.pageWaitTime;
+    info.pageRenderTime += renderedPageImage.pageRenderTime;
+    info.pageTotalTime += renderedPageImage.pageTotalTime;
     info.pageIndex = renderedPageImage.pageIndex;
 }
 
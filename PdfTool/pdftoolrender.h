@@ -33,6 +33,10 @@ protected:
     virtual void finish(const PDFToolOptions& options) = 0;
     virtual void onPageRendered(const PDFToolOptions& options, pdf::PDFRenderedPageImage& renderedPageImage) = 0;
 
+    /// Creates band writer for the page image, if page image can be written
+    /// band by band, otherwise returns nullptr (default implementation).
+    virtual std::unique_ptr<pdf::PDFImageBandWriter> createBandWriter(const PDFToolOptions& options, const pdf::PDFRenderedPageImage& renderedPageImage);
+
     void writePageInfoStatistics(const pdf::PDFRenderedPageImage& renderedPageImage);
 
     void writeStatistics(PDFOutputFormatter& formatter);
@@ -51,6 +55,7 @@ protected:
         std::vector<pdf::PDFRenderError> errors;
     };
 
+    QMutex m_pageInfoMutex;
     std::vector<PageInfo> m_pageInfo;
     qint64 m_wallTime = 0;
 };
@@ -64,6 +69,11 @@ public:
 protected:
     virtual void finish(const PDFToolOptions& options) override;
     virtual void onPageRendered(const PDFToolOptions& options, pdf::PDFRenderedPageImage& renderedPageImage) override;
+    virtual std::unique_ptr<pdf::PDFImageBandWriter> createBandWriter(const PDFToolOptions& options, const pdf::PDFRenderedPageImage& renderedPageImage) override;
+
+private:
+    /// Returns file name of the page image and sets image writer settings used for it
+    QString getOutputFileName(const PDFToolOptions& options, const pdf::PDFRenderedPageImage& renderedPageImage, pdf::PDFImageWriterSettings& imageWriterSettings) const;
 };
 
 class PDFToolBenchmark : public PDFToolRenderBase
@@ -0,0 +1,266 @@
+//    Copyright (C) 2021 Jakub Melka
+//
+//    This file is part of PDF4QT.
+//
+//    PDF4QT is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    with the written consent of the copyright owner, any later version.
+//
+//    PDF4QT is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public License
+//    along with PDF4QT.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "pdftoolsearch.h"
+#include "pdfdocumentreader.h"
+#include "pdfdocumenttextflow.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDirIterator>
+
+namespace pdftool
+{
+
+static PDFToolSearchApplication s_searchApplication;
+
+QString PDFToolSearchApplication::getStandardString(PDFToolAbstractApplication::StandardString standardString) const
+{
+    switch (standardString)
+    {
+        case Command:
+            return "search";
+
+        case Name:
+            return PDFToolTranslationContext::tr("Search text");
+
+        case Description:
+            return PDFToolTranslationContext::tr("Search text in documents (or in all documents in directories) using persistent text index.");
+
+        default:
+            Q_ASSERT(false);
+            break;
+    }
+
+    return QString();
+}
+
+int PDFToolSearchApplication::execute(const PDFToolOptions& options)
+{
+    if (options.searchText.isEmpty())
+    {
+        PDFConsole::writeError(PDFToolTranslationContext::tr("No text to be found specified."), options.outputCodec);
+        return ErrorInvalidArguments;
+    }
+
+    QStringList documents = getDocuments(options);
+    if (documents.isEmpty())
+    {
+        PDFConsole::writeError(PDFToolTranslationContext::tr("No document specified."), options.outputCodec);
+        return ErrorNoDocumentSpecified;
+    }
+
+    QLocale locale;
+    Qt::CaseSensitivity caseSensitivity = options.searchCaseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive;
+
+    PDFOutputFormatter formatter(options.outputStyle, options.outputCodec);
+    formatter.beginDocument("search", PDFToolTranslationContext::tr("Search results for '%1'").arg(options.searchText));
+    formatter.endl();
+
+    formatter.beginTable("matches", PDFToolTranslationContext::tr("Matches"));
+
+    formatter.beginTableHeaderRow("header");
+    formatter.writeTableHeaderColumn("no", PDFToolTranslationContext::tr("No."), Qt::AlignLeft);
+    formatter.writeTableHeaderColumn("document", PDFToolTranslationContext::tr("Document"), Qt::AlignLeft);
+    formatter.writeTableHeaderColumn("page-number", PDFToolTranslationContext::tr("Page"), Qt::AlignLeft);
+    formatter.writeTableHeaderColumn("context", PDFToolTranslationContext::tr("Context"), Qt::AlignLeft);
+    formatter.endTableHeaderRow();
+
+    int matchIndex = 0;
+    for (const QString& document : documents)
+    {
+        std::optional<pdf::PDFTextIndex> textIndex = getTextIndex(document, options);
+        if (!textIndex)
+        {
+            continue;
+        }
+
+        for (const pdf::PDFTextIndex::Match& match : textIndex->find(options.searchText, caseSensitivity))
+        {
+            formatter.beginTableRow("match", matchIndex);
+            formatter.writeTableColumn("no", locale.toString(matchIndex + 1), Qt::AlignRight);
+            formatter.writeTableColumn("document", document, Qt::AlignLeft);
+            formatter.writeTableColumn("page-number", locale.toString(match.pageIndex + 1), Qt::AlignRight);
+            formatter.writeTableColumn("context", match.context, Qt::AlignLeft);
+            formatter.endTableRow();
+            ++matchIndex;
+        }
+    }
+
+    formatter.endTable();
+
+    formatter.endDocument();
+    PDFConsole::writeText(formatter.getString(), options.outputCodec);
+
+    return ExitSuccess;
+}
+
+PDFToolAbstractApplication::Options PDFToolSearchApplication::getOptionsFlags() const
+{
+    return ConsoleFormat | Search;
+}
+
+QStringList PDFToolSearchApplication::getDocuments(const PDFToolOptions& options) const
+{
+    QStringList documents;
+
+    for (const QString& path : options.searchPaths)
+    {
+        QFileInfo fileInfo(path);
+        if (fileInfo.isDir())
+        {
+            QDirIterator::IteratorFlags flags = options.searchRecursive ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags;
+            QDirIterator iterator(path, QStringList() << "*.pdf" << "*.PDF", QDir::Files | QDir::Readable, flags);
+
+            QStringList directoryDocuments;
+            while (iterator.hasNext())
+            {
+                directoryDocuments << iterator.next();
+            }
+
+            directoryDocuments.sort();
+            documents << directoryDocuments;
+        }
+        else
+        {
+            documents << path;
+        }
+    }
+
+    documents.removeDuplicates();
+    return documents;
+}
+
+std::optional<pdf::PDFTextIndex> PDFToolSearchApplication::getTextIndex(const QString& fileName, const PDFToolOptions& options) const
+{
+    QFileInfo fileInfo(fileName);
+    if (!fileInfo.isFile())
+    {
+        PDFConsole::writeError(PDFToolTranslationContext::tr("Cannot open document '%1'.").arg(fileName), options.outputCodec);
+        return std::nullopt;
+    }
+
+    pdf::PDFTextIndex::DocumentIdentification documentIdentification = pdf::PDFTextIndex::DocumentIdentification::createFromFileInfo(fileInfo);
+
+    // Document is read (and hashed) only when it is needed
+    QByteArray data;
+    bool isDataRead = false;
+    auto readData = [&]()
+    {
+        if (!isDataRead)
+        {
+            QFile file(fileName);
+            if (file.open(QFile::ReadOnly))
+            {
+                data = file.readAll();
+                file.close();
+
+                documentIdentification.hash = pdf::PDFTextIndex::computeDocumentHash(data);
+                isDataRead = true;
+            }
+        }
+        return isDataRead;
+    };
+
+    QString indexFileName;
+    switch (options.searchIndexLocation)
+    {
+        case PDFToolOptions::SearchIndexLocation::None:
+            break;
+
+        case PDFToolOptions::SearchIndexLocation::Cache:
+            indexFileName = pdf::PDFTextIndex::getCacheFileName(fileName);
+            break;
+
+        case PDFToolOptions::SearchIndexLocation::Document:
+            indexFileName = pdf::PDFTextIndex::getDocumentIndexFileName(fileName);
+            break;
+
+        default:
+            Q_ASSERT(false);
+            break;
+    }
+
+    // Stored text index can be used without parsing the document.
+    // Usually, the document isn't even read, because file size and time of last
+    // modification match. If they don't match (for example, document was copied),
+    // document hash is compared.
+    if (!indexFileName.isEmpty())
+    {
+        bool isAcceptedByHash = false;
+        auto acceptIndex = [&](const pdf::PDFTextIndex::DocumentIdentification& storedIdentification)
+        {
+            if (storedIdentification.isFileInfoEqual(documentIdentification))
+            {
+                return true;
+            }
+
+            isAcceptedByHash = readData() && storedIdentification.hash == documentIdentification.hash;
+            return isAcceptedByHash;
+        };
+
+        if (std::optional<pdf::PDFTextIndex> textIndex = pdf::PDFTextIndex::load(indexFileName, acceptIndex))
+        {
+            if (isAcceptedByHash)
+            {
+                // Store actual file info, so next search doesn't need to read the document
+                textIndex->setDocumentIdentification(documentIdentification);
+                textIndex->save(indexFileName);
+            }
+
+            return textIndex;
+        }
+    }
+
+    if (!readData())
+    {
+        PDFConsole::writeError(PDFToolTranslationContext::tr("Cannot open document '%1'.").arg(fileName), options.outputCodec);
+        return std::nullopt;
+    }
+
+    pdf::PDFDocumentReader reader(nullptr, [](bool* ok) { *ok = false; return QString(); }, options.permissiveReading, false);
+    pdf::PDFDocument document = reader.readFromBuffer(data);
+    if (reader.getReadingResult() != pdf::PDFDocumentReader::Result::OK)
+    {
+        PDFConsole::writeError(PDFToolTranslationContext::tr("Cannot open document '%1'.").arg(fileName), options.outputCodec);
+        return std::nullopt;
+    }
+
+    if (!document.getStorage().getSecurityHandler()->isAllowed(pdf::PDFSecurityHandler::Permission::CopyContent))
+    {
+        PDFConsole::writeError(PDFToolTranslationContext::tr("Document '%1' doesn't allow to copy content.").arg(fileName), options.outputCodec);
+        return std::nullopt;
+    }
+
+    const pdf::PDFInteger pageCount = document.getCatalog()->getPageCount();
+
+    pdf::PDFDocumentTextFlowFactory factory;
+    pdf::PDFDocumentTextFlow documentTextFlow = factory.create(&document, pdf::PDFDocumentTextFlowFactory::Algorithm::Layout);
+
+    pdf::PDFTextIndex textIndex = pdf::PDFTextIndex::create(documentTextFlow, pageCount);
+    textIndex.setDocumentIdentification(documentIdentification);
+
+    if (!indexFileName.isEmpty() && !textIndex.save(indexFileName))
+    {
+        PDFConsole::writeError(PDFToolTranslationContext::tr("Cannot write text index to the file '%1'.").arg(indexFileName), options.outputCodec);
+    }
+
+    return textIndex;
+}
+
+}   // namespace pdftool
@@ -0,0 +1,51 @@
+//    Copyright (C) 2021 Jakub Melka
+//
+//    This file is part of PDF4QT.
+//
+//    PDF4QT is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    with the written consent of the copyright owner, any later version.
+//
+//    PDF4QT is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public License
+//    along with PDF4QT.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef PDFTOOLSEARCH_H
+#define PDFTOOLSEARCH_H
+
+#include "pdftoolabstractapplication.h"
+#include "pdftextindex.h"
+
+namespace pdftool
+{
+
+class PDFToolSearchApplication : public PDFToolAbstractApplication
+{
+public:
+    virtual QString getStandardString(StandardString standardString) const override;
+    virtual int execute(const PDFToolOptions& options) override;
+    virtual Options getOptionsFlags() const override;
+
+private:
+    /// Returns list of documents to be searched. Directories are
+    /// scanned for pdf files (recursively, if it is required).
+    /// \param options Options
+    QStringList getDocuments(const PDFToolOptions& options) const;
+
+    /// Returns text index for the document. Stored text index is used,
+    /// if it exists and document was not changed, otherwise text index is
+    /// created from the document and stored. If document can't be read,
+    /// then std::nullopt is returned.
+    /// \param fileName Document file name
+    /// \param options Options
+    std::optional<pdf::PDFTextIndex> getTextIndex(const QString& fileName, const PDFToolOptions& options) const;
+};
+
+}   // namespace pdftool
+
+#endif // PDFTOOLSEARCH_H
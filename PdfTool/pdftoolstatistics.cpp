@@ -54,8 +54,8 @@ int PDFToolStatisticsApplication::execute(const PDFToolOptions& options)
     }
 
     pdf::PDFObjectClassifier classifier;
-    classifier.classify(&document);
-    pdf::PDFObjectClassifier::Statistics statistics = classifier.calculateStatistics(&document);
+    classifier.classify(&document, true);
+    pdf::PDFObjectClassifier::Statistics statistics = classifier.calculateStatistics();
 
     QLocale locale;
 
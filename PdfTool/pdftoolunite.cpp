@@ -16,10 +16,10 @@
 //    along with PDF4QT.  If not, see <https://www.gnu.org/licenses/>.
 
 #include "pdftoolunite.h"
-#include "pdfdocumentbuilder.h"
 #include "pdfdocumentreader.h"
-#include "pdfoptimizer.h"
-#include "pdfdocumentwriter.h"
+#include "pdfdocumentmanipulator.h"
+
+#include <QFile>
 
 namespace pdftool
 {
@@ -65,156 +65,72 @@ int PDFToolUnite::execute(const PDFToolOptions& options)
         return ErrorFailedWriteToFile;
     }
 
-    try
+    auto readDocument = [&options](const QString& fileName, bool* isRead)
     {
-        pdf::PDFDocumentBuilder documentBuilder;
-        documentBuilder.createDocument();
-
-        std::vector<size_t> documentPartPageCounts;
-
-        pdf::PDFObjectReference ocPropertiesMerged = documentBuilder.addObject(pdf::PDFObject());
-        pdf::PDFObjectReference formMerged = documentBuilder.addObject(pdf::PDFObject());
-        pdf::PDFObjectReference namesMerged = documentBuilder.addObject(pdf::PDFObject());
+        pdf::PDFDocumentReader reader(nullptr, [](bool* ok) { *ok = false; return QString(); }, options.permissiveReading, false);
+        pdf::PDFDocument document = reader.readFromFile(fileName);
+        *isRead = reader.getReadingResult() == pdf::PDFDocumentReader::Result::OK;
+        return document;
+    };
+
+    // Documents are read twice. First, we check them and collect their pages,
+    // then they are read again one by one during the merging, and their objects are written
+    // immediately to the target file. So only one document is held in memory at once.
+    pdf::PDFDocumentManipulator::AssembledPages pages;
+    for (int i = 0; i < files.size(); ++i)
+    {
+        const QString& fileName = files[i];
 
-        std::vector<pdf::PDFObjectReference> pages;
-        for (const QString& fileName : files)
+        bool ok = false;
+        pdf::PDFDocument document = readDocument(fileName, &ok);
+        if (!ok)
         {
-            pdf::PDFDocumentReader reader(nullptr, [](bool* ok) { *ok = false; return QString(); }, options.permissiveReading, false);
-            pdf::PDFDocument document = reader.readFromFile(fileName);
-            if (reader.getReadingResult() != pdf::PDFDocumentReader::Result::OK)
-            {
-                PDFConsole::writeError(PDFToolTranslationContext::tr("Cannot open document '%1'.").arg(fileName), options.outputCodec);
-                return ErrorDocumentReading;
-            }
-
-            if (!document.getStorage().getSecurityHandler()->isAllowed(pdf::PDFSecurityHandler::Permission::Assemble))
-            {
-                PDFConsole::writeError(PDFToolTranslationContext::tr("Document doesn't allow to assemble pages."), options.outputCodec);
-                return ErrorPermissions;
-            }
-
-            pdf::PDFDocumentBuilder temporaryBuilder(&document);
-            temporaryBuilder.flattenPageTree();
-
-            std::vector<pdf::PDFObjectReference> currentPages = temporaryBuilder.getPages();
-            std::vector<pdf::PDFObjectReference> objectsToMerge = currentPages;
-
-            pdf::PDFObjectReference acroFormReference;
-            pdf::PDFObjectReference namesReference;
-            pdf::PDFObjectReference ocPropertiesReference;
-
-            pdf::PDFObject formObject = document.getCatalog()->getFormObject();
-            if (formObject.isReference())
-            {
-                acroFormReference = formObject.getReference();
-            }
-            else
-            {
-                acroFormReference = temporaryBuilder.addObject(formObject);
-            }
-
-            if (const pdf::PDFDictionary* catalogDictionary = temporaryBuilder.getDictionaryFromObject(temporaryBuilder.getObjectByReference(temporaryBuilder.getCatalogReference())))
-            {
-                pdf::PDFObject namesObject = catalogDictionary->get("Names");
-                if (namesObject.isReference())
-                {
-                    namesReference = namesObject.getReference();
-                }
-
-                pdf::PDFObject ocPropertiesObject = catalogDictionary->get("OCProperties");
-                if (ocPropertiesObject.isReference())
-                {
-                    ocPropertiesReference = ocPropertiesObject.getReference();
-                }
-            }
-
-            if (!namesReference.isValid())
-            {
-                namesReference = temporaryBuilder.addObject(pdf::PDFObject());
-            }
-
-            if (!ocPropertiesReference.isValid())
-            {
-                ocPropertiesReference = temporaryBuilder.addObject(pdf::PDFObject());
-            }
-
-            objectsToMerge.insert(objectsToMerge.end(), { acroFormReference, namesReference, ocPropertiesReference });
-
-            // Now, we are ready to merge objects into target document builder
-            std::vector<pdf::PDFObjectReference> references = pdf::PDFDocumentBuilder::createReferencesFromObjects(documentBuilder.copyFrom(pdf::PDFDocumentBuilder::createObjectsFromReferences(objectsToMerge), *temporaryBuilder.getStorage(), true));
-
-            ocPropertiesReference = references.back();
-            references.pop_back();
-            namesReference = references.back();
-            references.pop_back();
-            acroFormReference = references.back();
-            references.pop_back();
-
-            documentPartPageCounts.push_back(references.size());
-
-            documentBuilder.appendTo(ocPropertiesMerged, documentBuilder.getObjectByReference(ocPropertiesReference));
-            documentBuilder.appendTo(formMerged, documentBuilder.getObjectByReference(acroFormReference));
-            documentBuilder.mergeNames(namesMerged, namesReference);
-            pages.insert(pages.end(), references.cbegin(), references.cend());
+            PDFConsole::writeError(PDFToolTranslationContext::tr("Cannot open document '%1'.").arg(fileName), options.outputCodec);
+            return ErrorDocumentReading;
         }
 
-        documentBuilder.setPages(pages);
-        if (!documentBuilder.getObjectByReference(ocPropertiesMerged).isNull())
+        if (!document.getStorage().getSecurityHandler()->isAllowed(pdf::PDFSecurityHandler::Permission::Assemble))
         {
-            documentBuilder.setCatalogOptionalContentProperties(ocPropertiesMerged);
+            PDFConsole::writeError(PDFToolTranslationContext::tr("Document doesn't allow to assemble pages."), options.outputCodec);
+            return ErrorPermissions;
         }
 
-        if (!documentBuilder.getObjectByReference(namesMerged).isNull())
-        {
-            documentBuilder.setCatalogNames(namesMerged);
-        }
+        pdf::PDFDocumentManipulator::AssembledPages documentPages = pdf::PDFDocumentManipulator::createAllDocumentPages(i, &document);
+        pages.insert(pages.end(), documentPages.cbegin(), documentPages.cend());
+    }
+
+    auto loadDocument = [&files, &readDocument](pdf::PDFInteger documentIndex)
+    {
+        const QString& fileName = files[documentIndex];
 
-        if (!documentBuilder.getObjectByReference(formMerged).isNull())
+        bool ok = false;
+        pdf::PDFDocument document = readDocument(fileName, &ok);
+        if (!ok)
         {
-            documentBuilder.setCatalogAcroForm(formMerged);
+            throw pdf::PDFException(PDFToolTranslationContext::tr("Cannot open document '%1'.").arg(fileName));
         }
 
-        // Correct page tree (invalid parents are present)
-        documentBuilder.flattenPageTree();
-        documentBuilder.createDocumentParts(documentPartPageCounts);
-        pdf::PDFDocument mergedDocument = documentBuilder.build();
+        return document;
+    };
 
-        // Optimize document - remove unused objects and shrink object storage
-        pdf::PDFOptimizer optimizer(pdf::PDFOptimizer::RemoveUnusedObjects | pdf::PDFOptimizer::ShrinkObjectStorage | pdf::PDFOptimizer::DereferenceSimpleObjects | pdf::PDFOptimizer::MergeIdenticalObjects, nullptr);
-        optimizer.setDocument(&mergedDocument);
-        optimizer.optimize();
-        mergedDocument = optimizer.takeOptimizedDocument();
+    QFile file(targetFile);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate))
+    {
+        PDFConsole::writeError(PDFToolTranslationContext::tr("File '%1' can't be opened for writing. %2").arg(targetFile, file.errorString()), options.outputCodec);
+        return ErrorFailedWriteToFile;
+    }
 
-        // We must adjust some objects - they can be merged
-        pdf::PDFDocumentBuilder finalBuilder(&mergedDocument);
-        if (const pdf::PDFDictionary* dictionary = finalBuilder.getDictionaryFromObject(finalBuilder.getObjectByReference(finalBuilder.getCatalogReference())))
-        {
-            pdf::PDFDocumentDataLoaderDecorator loader(finalBuilder.getStorage());
-            pdf::PDFObjectReference ocPropertiesReference = loader.readReferenceFromDictionary(dictionary, "OCProperties");
-            if (ocPropertiesReference.isValid())
-            {
-                finalBuilder.setObject(ocPropertiesReference, pdf::PDFObjectManipulator::removeDuplicitReferencesInArrays(finalBuilder.getObjectByReference(ocPropertiesReference)));
-            }
-            pdf::PDFObjectReference acroFormReference = loader.readReferenceFromDictionary(dictionary, "AcroForm");
-            if (acroFormReference.isValid())
-            {
-                finalBuilder.setObject(acroFormReference, pdf::PDFObjectManipulator::removeDuplicitReferencesInArrays(finalBuilder.getObjectByReference(acroFormReference)));
-            }
-        }
-        mergedDocument = finalBuilder.build();
+    pdf::PDFDocumentManipulator manipulator;
+    manipulator.setOutlineMode(pdf::PDFDocumentManipulator::OutlineMode::NoOutline);
+    pdf::PDFOperationResult result = manipulator.assemble(pages, loadDocument, &file);
+    file.close();
 
-        pdf::PDFDocumentWriter writer(nullptr);
-        pdf::PDFOperationResult result = writer.write(targetFile, &mergedDocument, false);
-        if (!result)
-        {
-            PDFConsole::writeError(result.getErrorMessage(), options.outputCodec);
-            return ErrorFailedWriteToFile;
-        }
-    }
-    catch (pdf::PDFException exception)
+    if (!result)
     {
-        PDFConsole::writeError(exception.getMessage(), options.outputCodec);
-        return ErrorUnknown;
+        // If some error occured, then remove invalid file
+        file.remove();
+        PDFConsole::writeError(result.getErrorMessage(), options.outputCodec);
+        return ErrorFailedWriteToFile;
     }
 
     return ExitSuccess;
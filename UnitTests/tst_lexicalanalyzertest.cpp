@@ -18,6 +18,8 @@
 
 #include <QtTest>
 #include <QMetaType>
+#include <QTemporaryDir>
+#include <QBuffer>
 
 #include "pdfparser.h"
 #include "pdfconstants.h"
@@ -25,10 +27,21 @@
 #include "pdfstreamfilters.h"
 #include "pdffunction.h"
 #include "pdfdocument.h"
+#include "pdfcatalog.h"
+#include "pdfnametreeloader.h"
 #include "pdfexception.h"
 #include "pdfjbig2decoder.h"
+#include "pdfccittfaxdecoder.h"
+#include "pdfimage.h"
+#include "pdfcms.h"
+#include "pdfimagebandwriter.h"
+#include "pdftextindex.h"
+#include "pdfdocumenttextflow.h"
+#include "pdfdocumentmanipulator.h"
+#include "pdfdocumentreader.h"
 
 #include <regex>
+#include <random>
 
 class LexicalAnalyzerTest : public QObject
 {
@@ -50,17 +63,37 @@ private slots:
     void test_header_regexp();
     void test_flat_map();
     void test_lzw_filter();
+    void test_flate_row_decoder();
+    void test_image_band_writer();
     void test_sampled_function();
     void test_exponential_function();
     void test_stitching_function();
     void test_postscript_function();
     void test_jbig2_arithmetic_decoder();
+    void test_jbig2_bitmap();
+    void test_bit_reader();
+    void test_ccitt_decoder();
+    void test_soft_mask_image();
+    void test_lazy_page_tree();
+    void test_name_tree();
+    void test_streamed_assemble();
+    void test_assemble_shared_objects();
+    void test_text_index();
 
 private:
     void scanWholeStream(const char* stream);
     void testTokens(const char* stream, const std::vector<pdf::PDFLexicalAnalyzer::Token>& tokens);
 
     QString getStringFromTokens(const std::vector<pdf::PDFLexicalAnalyzer::Token>& tokens);
+
+    /// Creates document from objects in the text form. Object number
+    /// is index of the object in the list + 1, object 1 is catalog.
+    pdf::PDFDocument createDocument(const std::vector<QByteArray>& objects);
+
+    /// Creates stream object in the text form
+    /// \param dictionaryEntries Entries of the stream dictionary (without length)
+    /// \param data Stream data
+    QByteArray createStream(const QByteArray& dictionaryEntries, const QByteArray& data);
 };
 
 LexicalAnalyzerTest::LexicalAnalyzerTest()
@@ -317,6 +350,145 @@ void LexicalAnalyzerTest::test_lzw_filter()
     QCOMPARE(decoded, valid);
 }
 
+void LexicalAnalyzerTest::test_flate_row_decoder()
+{
+    // qCompress prepends 4 bytes with uncompressed size to the zlib stream
+    auto compress = [](const QByteArray& data) { return qCompress(data, 9).mid(4); };
+    auto fetcher = [](const pdf::PDFObject& object) -> const pdf::PDFObject& { return object; };
+
+    auto decodeRows = [](const QByteArray& compressedData, const pdf::PDFStreamPredictor& predictor, int stride, int rowCount)
+    {
+        pdf::PDFFlateRowDecoder decoder(&compressedData, predictor, stride);
+
+        QByteArray rows(stride * rowCount, 0);
+        for (int i = 0; i < rowCount; ++i)
+        {
+            decoder.readRow(reinterpret_cast<uint8_t*>(rows.data()) + i * stride);
+        }
+        return rows;
+    };
+
+    {
+        // Rows with predictors Sub, Up, Average, Paeth and incomplete last row
+        pdf::PDFObject parameters = pdf::PDFParser("<< /Predictor 12 /Colors 1 /BitsPerComponent 8 /Columns 3 >>", nullptr, pdf::PDFParser::None).getObject();
+        pdf::PDFStreamPredictor predictor = pdf::PDFStreamPredictor::createPredictor(fetcher, parameters);
+
+        const QByteArray predictedData("\x01\x01\x02\x03" "\x02\x01\x01\x01" "\x03\x00\x00\x00" "\x04\x00\x00\x00" "\x00\x09", 18);
+        const QByteArray expectedData("\x01\x03\x06" "\x02\x04\x07" "\x01\x02\x04" "\x01\x02\x04" "\x09\x00\x00", 15);
+        const QByteArray compressedData = compress(predictedData);
+
+        pdf::PDFFlateDecodeFilter filter;
+        QCOMPARE(filter.apply(compressedData, fetcher, parameters, nullptr), expectedData);
+
+        // Rows after the end of data are filled with zeros
+        QCOMPARE(decodeRows(compressedData, predictor, 3, 6), expectedData + QByteArray(3, 0));
+    }
+
+    {
+        // Random rows with random predictors must be decoded in the same way as whole stream
+        const int columns = 37;
+        const int rowCount = 50;
+        const int stride = columns * 3;
+
+        std::mt19937 generator(7);
+        std::uniform_int_distribution<int> byteDistribution(0, 255);
+        std::uniform_int_distribution<int> predictorDistribution(0, 4);
+
+        QByteArray predictedData;
+        for (int i = 0; i < rowCount; ++i)
+        {
+            predictedData.push_back(char(predictorDistribution(generator)));
+            for (int j = 0; j < stride; ++j)
+            {
+                predictedData.push_back(char(byteDistribution(generator)));
+            }
+        }
+
+        pdf::PDFObject parameters = pdf::PDFParser("<< /Predictor 15 /Colors 3 /BitsPerComponent 8 /Columns 37 >>", nullptr, pdf::PDFParser::None).getObject();
+        pdf::PDFStreamPredictor predictor = pdf::PDFStreamPredictor::createPredictor(fetcher, parameters);
+        const QByteArray compressedData = compress(predictedData);
+
+        pdf::PDFFlateDecodeFilter filter;
+        QByteArray expectedData = filter.apply(compressedData, fetcher, parameters, nullptr);
+        QCOMPARE(expectedData.size(), stride * rowCount);
+        QCOMPARE(decodeRows(compressedData, predictor, stride, rowCount), expectedData);
+
+        // Without predictor, rows are just split decompressed data
+        pdf::PDFStreamPredictor noPredictor = pdf::PDFStreamPredictor::createPredictor(fetcher, pdf::PDFObject());
+        QCOMPARE(decodeRows(compressedData, noPredictor, stride + 1, rowCount), predictedData);
+    }
+}
+
+void LexicalAnalyzerTest::test_image_band_writer()
+{
+    QTemporaryDir temporaryDirectory;
+    QVERIFY(temporaryDirectory.isValid());
+
+    // Noise doesn't compress, so PNG data must be split into multiple IDAT chunks
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<int> distribution(0, 255);
+    QImage sourceImage(512, 1037, QImage::Format_ARGB32_Premultiplied);
+    for (int y = 0; y < sourceImage.height(); ++y)
+    {
+        for (int x = 0; x < sourceImage.width(); ++x)
+        {
+            sourceImage.setPixel(x, y, qRgb(distribution(generator), distribution(generator), distribution(generator)));
+        }
+    }
+
+    const int bandHeight = 100;
+    for (const QByteArray& format : { QByteArray("png"), QByteArray("pbm"), QByteArray("pgm"), QByteArray("ppm") })
+    {
+        QVERIFY(pdf::PDFImageBandWriter::isFormatSupported(format));
+
+        const QString fileName = temporaryDirectory.filePath(QString("image.%1").arg(QString::fromLatin1(format)));
+        std::unique_ptr<pdf::PDFImageBandWriter> writer = pdf::PDFImageBandWriter::create(fileName, format, 50, 50);
+        QVERIFY(writer);
+        QVERIFY(writer->begin(sourceImage.size()));
+        for (int y = 0; y < sourceImage.height(); y += bandHeight)
+        {
+            QVERIFY(writer->writeBand(sourceImage.copy(0, y, sourceImage.width(), qMin(bandHeight, sourceImage.height() - y))));
+        }
+        QVERIFY2(writer->finish(), qPrintable(writer->getErrorString()));
+
+        QImage image(fileName, format.constData());
+        QVERIFY(!image.isNull());
+        QCOMPARE(image.size(), sourceImage.size());
+
+        for (int y = 0; y < sourceImage.height(); ++y)
+        {
+            for (int x = 0; x < sourceImage.width(); ++x)
+            {
+                const QRgb source = sourceImage.pixel(x, y);
+                const QRgb pixel = image.pixel(x, y);
+
+                if (format == "pbm")
+                {
+                    QCOMPARE(qGray(pixel) < 128, qGray(source) < 128);
+                }
+                else if (format == "pgm")
+                {
+                    QCOMPARE(qGray(pixel), qGray(source));
+                }
+                else
+                {
+                    QCOMPARE(pixel & RGB_MASK, source & RGB_MASK);
+                }
+            }
+        }
+    }
+
+    // Incomplete image must be reported as error
+    std::unique_ptr<pdf::PDFImageBandWriter> writer = pdf::PDFImageBandWriter::create(temporaryDirectory.filePath("incomplete.png"), "png", -1, -1);
+    QVERIFY(writer->begin(sourceImage.size()));
+    QVERIFY(writer->writeBand(sourceImage.copy(0, 0, sourceImage.width(), bandHeight)));
+    QVERIFY(!writer->finish());
+    QVERIFY(!writer->getErrorString().isEmpty());
+
+    // Unsupported format
+    QVERIFY(!pdf::PDFImageBandWriter::create(temporaryDirectory.filePath("image.tiff"), "tiff", -1, -1));
+}
+
 void LexicalAnalyzerTest::test_sampled_function()
 {
     {
@@ -1097,6 +1269,815 @@ void LexicalAnalyzerTest::test_jbig2_arithmetic_decoder()
     QVERIFY(decompressed == decompressedByAD);
 }
 
+void LexicalAnalyzerTest::test_jbig2_bitmap()
+{
+    auto createBitmap = [](int width, int height, int seed)
+    {
+        pdf::PDFJBIG2Bitmap bitmap(width, height, 0x00);
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                bitmap.setPixel(x, y, ((x * 7 + y * 13 + seed) % 5 < 2) ? 0xFF : 0x00);
+            }
+        }
+        return bitmap;
+    };
+
+    auto combine = [](pdf::PDFJBIG2BitOperation operation, uint8_t target, uint8_t source) -> uint8_t
+    {
+        switch (operation)
+        {
+            case pdf::PDFJBIG2BitOperation::Or:
+                return target | source;
+            case pdf::PDFJBIG2BitOperation::And:
+                return target & source;
+            case pdf::PDFJBIG2BitOperation::Xor:
+                return target ^ source;
+            case pdf::PDFJBIG2BitOperation::NotXor:
+                return ~(target ^ source);
+            case pdf::PDFJBIG2BitOperation::Replace:
+                return source;
+            default:
+                break;
+        }
+
+        return 0;
+    };
+
+    const pdf::PDFJBIG2Bitmap source = createBitmap(19, 7, 3);
+    for (pdf::PDFJBIG2BitOperation operation : { pdf::PDFJBIG2BitOperation::Or, pdf::PDFJBIG2BitOperation::And, pdf::PDFJBIG2BitOperation::Xor, pdf::PDFJBIG2BitOperation::NotXor, pdf::PDFJBIG2BitOperation::Replace })
+    {
+        for (int offsetX : { -11, -3, 0, 5, 8, 29 })
+        {
+            for (int offsetY : { -2, 0, 3 })
+            {
+                const pdf::PDFJBIG2Bitmap original = createBitmap(37, 9, 1);
+                pdf::PDFJBIG2Bitmap painted = original;
+                painted.paint(source, offsetX, offsetY, operation, false, 0x00);
+
+                for (int y = 0; y < original.getHeight(); ++y)
+                {
+                    for (int x = 0; x < original.getWidth(); ++x)
+                    {
+                        const int sourceX = x - offsetX;
+                        const int sourceY = y - offsetY;
+                        const bool isInside = sourceX >= 0 && sourceX < source.getWidth() && sourceY >= 0 && sourceY < source.getHeight();
+                        const uint8_t expected = isInside ? combine(operation, original.getPixel(x, y), source.getPixel(sourceX, sourceY)) : original.getPixel(x, y);
+                        QCOMPARE(painted.getPixel(x, y), expected);
+                    }
+                }
+            }
+        }
+    }
+
+    const pdf::PDFJBIG2Bitmap subbitmap = source.getSubbitmap(3, -1, 12, 4);
+    for (int y = 0; y < subbitmap.getHeight(); ++y)
+    {
+        for (int x = 0; x < subbitmap.getWidth(); ++x)
+        {
+            QCOMPARE(subbitmap.getPixel(x, y), source.getPixelSafe(x + 3, y - 1));
+        }
+    }
+}
+
+void LexicalAnalyzerTest::test_bit_reader()
+{
+    const QByteArray data("\xA5\x0F", 2);
+    pdf::PDFBitReader reader(&data, 1);
+
+    QCOMPARE(reader.read(4), pdf::PDFBitReader::Value(0xA));
+    QCOMPARE(reader.look(8), pdf::PDFBitReader::Value(0x50));
+
+    // Looking behind the end of the stream returns zero bits and doesn't advance the reader
+    QCOMPARE(reader.look(16), pdf::PDFBitReader::Value(0x50F0));
+    QCOMPARE(reader.look(20), pdf::PDFBitReader::Value(0x50F00));
+    QVERIFY(!reader.isAtEnd());
+    QCOMPARE(reader.read(3), pdf::PDFBitReader::Value(0x2));
+    QCOMPARE(reader.look(13), pdf::PDFBitReader::Value(0x10F0));
+    QCOMPARE(reader.read(9), pdf::PDFBitReader::Value(0x10F));
+    QVERIFY(reader.isAtEnd());
+    QCOMPARE(reader.look(12), pdf::PDFBitReader::Value(0));
+    QVERIFY_EXCEPTION_THROWN(reader.read(1), pdf::PDFException);
+}
+
+void LexicalAnalyzerTest::test_ccitt_decoder()
+{
+    // Black runs of each row (intervals [start, end)). Rows contain white and black
+    // make-up codes, runs crossing byte boundaries and short runs at the row edges.
+    const int columns = 150;
+    const std::vector<std::vector<std::pair<int, int>>> blackRuns = {
+        { },
+        { { 3, 77 } },
+        { { 5, 6 }, { 10, 140 } },
+        { { 0, 150 } },
+        { { 0, 1 }, { 8, 16 }, { 149, 150 } },
+        { { 2, 74 }, { 75, 79 }, { 100, 101 } },
+        { { 3, 76 }, { 77, 80 }, { 96, 102 } }
+    };
+
+    // Decoded rows are packed, white pixel is 1, padding bits are 0
+    const int stride = (columns + 7) / 8;
+    QByteArray expectedData(int(blackRuns.size()) * stride, char(0xFF));
+    for (int row = 0; row < int(blackRuns.size()); ++row)
+    {
+        auto clearPixel = [&](int column) { expectedData[row * stride + column / 8] = char(uint8_t(expectedData[row * stride + column / 8]) & ~(0x80 >> (column % 8))); };
+
+        for (const std::pair<int, int>& run : blackRuns[row])
+        {
+            for (int column = run.first; column < run.second; ++column)
+            {
+                clearPixel(column);
+            }
+        }
+
+        for (int column = columns; column < stride * 8; ++column)
+        {
+            clearPixel(column);
+        }
+    }
+
+    auto decode = [columns](const QByteArray& data, pdf::PDFInteger K, pdf::PDFInteger rows, bool hasEndOfLine, bool hasEndOfBlock)
+    {
+        pdf::PDFCCITTFaxDecoderParameters parameters;
+        parameters.K = K;
+        parameters.columns = columns;
+        parameters.rows = rows;
+        parameters.hasEndOfLine = hasEndOfLine;
+        parameters.hasEndOfBlock = hasEndOfBlock;
+        parameters.decode = { 0.0, 1.0 };
+
+        pdf::PDFCCITTFaxDecoder decoder(&data, parameters);
+        return decoder.decode();
+    };
+
+    auto checkImage = [&](const pdf::PDFImageData& imageData)
+    {
+        QCOMPARE(imageData.getWidth(), unsigned(columns));
+        QCOMPARE(imageData.getHeight(), unsigned(blackRuns.size()));
+        QCOMPARE(imageData.getStride(), unsigned(stride));
+        QCOMPARE(imageData.getData(), expectedData);
+    };
+
+    // Group 3, one dimensional, EOL before each row (fill bits align EOLs to bytes, so
+    // EOL must be searched for), terminated by RTC
+    const QByteArray g3OneDimensional = QByteArray::fromHex("0001903001803c26e80001c561919c0001350c806e0001355e2cb10001703c51d974a40001803c41ea882c004004004004004004");
+    checkImage(decode(g3OneDimensional, 0, 0, true, true));
+
+    // Group 3, two dimensional with K = 2 (one dimensional and two dimensional rows alternate),
+    // contains pass, horizontal and vertical modes, terminated by RTC
+    const QByteArray g3TwoDimensional = QByteArray::fromHex("001c818008c01e12003c561919c0044d43201b800cd578b2c400212381e291d92e9800e00f107aa20b001800c006003001800c");
+    checkImage(decode(g3TwoDimensional, 2, 0, true, true));
+
+    // Group 4, terminated by EOFB
+    const QByteArray g4 = QByteArray::fromHex("9803c2432ac8646726a1900de579165912381e291d92e9b104478d45001001");
+    checkImage(decode(g4, -1, 0, false, true));
+
+    // Group 4 without EOFB, number of rows is given
+    const QByteArray g4WithoutEndOfBlock = QByteArray::fromHex("9803c2432ac8646726a1900de579165912381e291d92e9b104478d45");
+    checkImage(decode(g4WithoutEndOfBlock, -1, pdf::PDFInteger(blackRuns.size()), false, false));
+
+    // Invalid code word
+    QVERIFY_EXCEPTION_THROWN(decode(QByteArray::fromHex("f00000"), 0, 0, false, true), pdf::PDFException);
+}
+
+void LexicalAnalyzerTest::test_soft_mask_image()
+{
+    pdf::PDFCMSGeneric cms;
+    pdf::PDFRenderErrorReporterDummy reporter;
+    pdf::PDFColorSpacePointer colorSpace = pdf::PDFAbstractColorSpace::createDeviceColorSpaceByName(nullptr, nullptr, "DeviceRGB");
+
+    auto getPixel = [](const QImage& image, int x, int y) { return reinterpret_cast<const QRgb*>(image.constScanLine(y))[x]; };
+
+    {
+        // Colors are premultiplied with white matte color, c' = 1 + alpha * (c - 1)
+        const QByteArray samples("\xFF\x00\x00" "\xCC\xCC\xFF" "\xFF\xFF\xFF"
+                                 "\x99\xFF\x99" "\xFF\xFF\xFF" "\x00\x00\x00", 18);
+        const QByteArray alpha("\xFF\x33\x00" "\x66\xFF\xFF", 6);
+
+        pdf::PDFImageData imageData(3, 8, 3, 2, 9, pdf::PDFImageData::MaskingType::SoftMask, samples, { }, { }, { });
+        pdf::PDFImageData softMask(1, 8, 3, 2, 3, pdf::PDFImageData::MaskingType::None, alpha, { }, { }, { });
+        pdf::PDFImageData softMaskWithMatte(1, 8, 3, 2, 3, pdf::PDFImageData::MaskingType::None, alpha, { }, { }, { 1.0, 1.0, 1.0 });
+
+        // Without matte, colors are only premultiplied by alpha
+        QImage image = colorSpace->getImage(imageData, softMask, &cms, pdf::RenderingIntent::Perceptual, &reporter);
+        QCOMPARE(image.format(), QImage::Format_ARGB32_Premultiplied);
+        QCOMPARE(image.size(), QSize(3, 2));
+        QCOMPARE(getPixel(image, 0, 0), qPremultiply(qRgba(255, 0, 0, 255)));
+        QCOMPARE(getPixel(image, 1, 0), qPremultiply(qRgba(204, 204, 255, 51)));
+        QCOMPARE(getPixel(image, 2, 0), qRgba(0, 0, 0, 0));
+        QCOMPARE(getPixel(image, 0, 1), qPremultiply(qRgba(153, 255, 153, 102)));
+        QCOMPARE(getPixel(image, 1, 1), qRgba(255, 255, 255, 255));
+        QCOMPARE(getPixel(image, 2, 1), qRgba(0, 0, 0, 255));
+
+        // With matte, original colors are restored before premultiplication
+        QImage matteImage = colorSpace->getImage(imageData, softMaskWithMatte, &cms, pdf::RenderingIntent::Perceptual, &reporter);
+        QCOMPARE(getPixel(matteImage, 0, 0), qPremultiply(qRgba(255, 0, 0, 255)));
+        QCOMPARE(getPixel(matteImage, 1, 0), qPremultiply(qRgba(0, 0, 255, 51)));
+        QCOMPARE(getPixel(matteImage, 2, 0), qRgba(0, 0, 0, 0));
+        QCOMPARE(getPixel(matteImage, 0, 1), qPremultiply(qRgba(0, 255, 0, 102)));
+        QCOMPARE(getPixel(matteImage, 1, 1), qRgba(255, 255, 255, 255));
+        QCOMPARE(getPixel(matteImage, 2, 1), qRgba(0, 0, 0, 255));
+
+        // Soft mask of different size is scaled to the image size
+        pdf::PDFImageData smallSoftMask(1, 8, 1, 1, 1, pdf::PDFImageData::MaskingType::None, QByteArray("\x80", 1), { }, { }, { });
+        QImage scaledMaskImage = colorSpace->getImage(imageData, smallSoftMask, &cms, pdf::RenderingIntent::Perceptual, &reporter);
+        QCOMPARE(getPixel(scaledMaskImage, 0, 0), qPremultiply(qRgba(255, 0, 0, 128)));
+        QCOMPARE(getPixel(scaledMaskImage, 2, 1), qPremultiply(qRgba(0, 0, 0, 128)));
+    }
+
+    {
+        // Image with soft mask decoded band by band must be the same as image decoded as a whole.
+        // Image has more rows, than fit in one band.
+        const int width = 700;
+        const int height = 600;
+
+        std::mt19937 generator(11);
+        std::uniform_int_distribution<int> distribution(0, 255);
+        QByteArray samples(width * height * 3, 0);
+        QByteArray alpha(width * height, 0);
+        std::generate(samples.begin(), samples.end(), [&]() { return char(distribution(generator)); });
+        std::generate(alpha.begin(), alpha.end(), [&]() { return char(distribution(generator)); });
+
+        pdf::PDFDocument document = createDocument({
+            "<< /Type /Catalog /Pages 2 0 R >>",
+            "<< /Type /Pages /Kids [] /Count 0 >>",
+            createStream("/Type /XObject /Subtype /Image /Width 700 /Height 600 /ColorSpace /DeviceRGB /BitsPerComponent 8 /Filter /FlateDecode /SMask 4 0 R", qCompress(samples, 9).mid(4)),
+            createStream("/Type /XObject /Subtype /Image /Width 700 /Height 600 /ColorSpace /DeviceGray /BitsPerComponent 8 /Matte [0.5 0.25 0.75]", alpha),
+            createStream("/Type /XObject /Subtype /Image /Width 7 /Height 6 /ColorSpace /DeviceGray /BitsPerComponent 8", alpha.left(42)),
+            createStream("/Type /XObject /Subtype /Image /Width 700 /Height 600 /ColorSpace /DeviceRGB /BitsPerComponent 8 /Filter /FlateDecode /SMask 5 0 R", qCompress(samples, 9).mid(4))
+        });
+
+        const pdf::PDFStream* stream = document.getObject(pdf::PDFObjectReference(3, 0)).getStream();
+        QImage imageByBands = pdf::PDFImage::createImageByBands(&document, stream, colorSpace, pdf::RenderingIntent::Perceptual, &cms, &reporter);
+        QImage image = pdf::PDFImage::createImage(&document, stream, colorSpace, false, pdf::RenderingIntent::Perceptual, &reporter).getImage(&cms, &reporter);
+        QCOMPARE(imageByBands.format(), QImage::Format_ARGB32_Premultiplied);
+        QCOMPARE(image.format(), QImage::Format_ARGB32_Premultiplied);
+        QVERIFY(imageByBands == image);
+
+        // Soft mask of different size must be scaled, so image is not decoded band by band
+        const pdf::PDFStream* scaledMaskStream = document.getObject(pdf::PDFObjectReference(6, 0)).getStream();
+        QVERIFY(pdf::PDFImage::createImageByBands(&document, scaledMaskStream, colorSpace, pdf::RenderingIntent::Perceptual, &cms, &reporter).isNull());
+    }
+}
+
+void LexicalAnalyzerTest::test_lazy_page_tree()
+{
+    // Page tree with three levels, with inherited media box and rotation
+    std::vector<QByteArray> objects =
+    {
+        "<< /Type /Catalog /Pages 2 0 R >>",
+        "<< /Type /Pages /Kids [3 0 R 4 0 R] /Count 5 /MediaBox [0 0 100 200] >>",
+        "<< /Type /Pages /Parent 2 0 R /Kids [5 0 R 6 0 R] /Count 2 /Rotate 90 >>",
+        "<< /Type /Pages /Parent 2 0 R /Kids [7 0 R 8 0 R 9 0 R] /Count 3 /MediaBox [0 0 300 400] >>",
+        "<< /Type /Page /Parent 3 0 R >>",
+        "<< /Type /Page /Parent 3 0 R /MediaBox [0 0 50 60] >>",
+        "<< /Type /Page /Parent 4 0 R >>",
+        "<< /Type /Page /Parent 4 0 R >>",
+        "<< /Type /Pages /Parent 4 0 R /Kids [10 0 R] /Count 1 >>",
+        "<< /Type /Page /Parent 9 0 R /Rotate 180 >>"
+    };
+
+    const std::vector<pdf::PDFObjectReference> pageReferences = { pdf::PDFObjectReference(5, 0), pdf::PDFObjectReference(6, 0),
+                                                                   pdf::PDFObjectReference(7, 0), pdf::PDFObjectReference(8, 0),
+                                                                   pdf::PDFObjectReference(10, 0) };
+
+    auto checkPages = [&pageReferences](const pdf::PDFCatalog* catalog)
+    {
+        QCOMPARE(catalog->getPageCount(), size_t(5));
+
+        // Access pages in reverse order, so tree is navigated for each page
+        for (size_t i = 5; i > 0; --i)
+        {
+            const pdf::PDFPage* page = catalog->getPage(i - 1);
+            QVERIFY(page);
+            QCOMPARE(page->getPageReference(), pageReferences[i - 1]);
+            QCOMPARE(catalog->getPage(i - 1), page);
+        }
+
+        QCOMPARE(catalog->getPage(0)->getMediaBox(), QRectF(0, 0, 100, 200));
+        QCOMPARE(catalog->getPage(0)->getPageRotation(), pdf::PageRotation::Rotate90);
+        QCOMPARE(catalog->getPage(1)->getMediaBox(), QRectF(0, 0, 50, 60));
+        QCOMPARE(catalog->getPage(1)->getPageRotation(), pdf::PageRotation::Rotate90);
+        QCOMPARE(catalog->getPage(2)->getMediaBox(), QRectF(0, 0, 300, 400));
+        QCOMPARE(catalog->getPage(2)->getPageRotation(), pdf::PageRotation::None);
+        QCOMPARE(catalog->getPage(4)->getMediaBox(), QRectF(0, 0, 300, 400));
+        QCOMPARE(catalog->getPage(4)->getPageRotation(), pdf::PageRotation::Rotate180);
+
+        for (size_t i = 0; i < pageReferences.size(); ++i)
+        {
+            QCOMPARE(catalog->getPageIndexFromPageReference(pageReferences[i]), i);
+        }
+        QCOMPARE(catalog->getPageIndexFromPageReference(pdf::PDFObjectReference(4, 0)), pdf::PDFCatalog::INVALID_PAGE_INDEX);
+    };
+
+    {
+        pdf::PDFDocument document = createDocument(objects);
+        checkPages(document.getCatalog());
+    }
+
+    {
+        // Copy of the document must parse pages from its own storage
+        pdf::PDFDocument copiedDocument;
+        {
+            pdf::PDFDocument document = createDocument(objects);
+            copiedDocument = document;
+        }
+        checkPages(copiedDocument.getCatalog());
+    }
+
+    {
+        // Inconsistent root - whole tree is parsed immediately
+        std::vector<QByteArray> inconsistentObjects = objects;
+        inconsistentObjects[1] = "<< /Type /Pages /Kids [3 0 R 4 0 R] /Count 4 /MediaBox [0 0 100 200] >>";
+        pdf::PDFDocument document = createDocument(inconsistentObjects);
+        checkPages(document.getCatalog());
+    }
+
+    {
+        // Wrong /Count in intermediate node - page tree is parsed as a whole,
+        // when page can't be found, and missing pages are replaced by empty pages.
+        std::vector<QByteArray> damagedObjects = objects;
+        damagedObjects[1] = "<< /Type /Pages /Kids [3 0 R 4 0 R] /Count 6 /MediaBox [0 0 100 200] >>";
+        damagedObjects[3] = "<< /Type /Pages /Parent 2 0 R /Kids [7 0 R 8 0 R 9 0 R] /Count 4 /MediaBox [0 0 300 400] >>";
+        pdf::PDFDocument document = createDocument(damagedObjects);
+        const pdf::PDFCatalog* catalog = document.getCatalog();
+
+        QCOMPARE(catalog->getPageCount(), size_t(6));
+        QCOMPARE(catalog->getPage(4)->getPageReference(), pdf::PDFObjectReference(10, 0));
+        QCOMPARE(catalog->getPage(5)->getPageReference(), pdf::PDFObjectReference());
+        for (size_t i = 0; i < pageReferences.size(); ++i)
+        {
+            QCOMPARE(catalog->getPage(i)->getPageReference(), pageReferences[i]);
+            QCOMPARE(catalog->getPageIndexFromPageReference(pageReferences[i]), i);
+        }
+    }
+}
+
+void LexicalAnalyzerTest::test_name_tree()
+{
+    // Object 4 is sorted leaf, object 5 is unsorted leaf and kids of object 6
+    // don't have limits. Objects 9 and 10 form a cycle.
+    std::vector<QByteArray> objects = {
+        "<< /Type /Catalog /Pages 2 0 R /Names << /Dests 11 0 R >> /Dests << /first [0 /Fit] >> >>",
+        "<< /Type /Pages /Kids [] /Count 0 >>",
+        "<< /Kids [4 0 R 5 0 R 6 0 R] >>",
+        "<< /Limits [(a) (c)] /Names [(a) 1 (b) 2 (c) 3] >>",
+        "<< /Limits [(d) (f)] /Names [(f) 6 (d) 4 (e) 5] >>",
+        "<< /Limits [(g) (x)] /Kids [7 0 R 8 0 R] >>",
+        "<< /Names [(g) 7 (h) 8] >>",
+        "<< /Names [(x) 9] >>",
+        "<< /Kids [10 0 R] >>",
+        "<< /Kids [9 0 R] >>",
+        "<< /Names [(first) [3 /Fit] (second) << /D [1 /Fit] >>] >>"
+    };
+
+    pdf::PDFDocument document = createDocument(objects);
+    const pdf::PDFObjectStorage* storage = &document.getStorage();
+
+    using Loader = pdf::PDFNameTreeLoader<pdf::PDFInteger>;
+    auto loadInteger = [](const pdf::PDFObjectStorage* objectStorage, const pdf::PDFObject& object)
+    {
+        const pdf::PDFObject& dereferencedObject = objectStorage->getObject(object);
+        return dereferencedObject.isInt() ? dereferencedObject.getInteger() : pdf::PDFInteger(-1);
+    };
+
+    const pdf::PDFObject root = pdf::PDFObject::createReference(pdf::PDFObjectReference(3, 0));
+    const Loader::MappedObjects allObjects = Loader::parse(storage, root, loadInteger);
+    QCOMPARE(allObjects.size(), size_t(9));
+
+    for (const auto& item : allObjects)
+    {
+        std::optional<pdf::PDFInteger> value = Loader::find(storage, root, item.first, loadInteger);
+        QVERIFY(value.has_value());
+        QCOMPARE(*value, item.second);
+    }
+
+    // Sorted leaf, unsorted leaf (found by the sequential fallback) and kids without limits
+    QCOMPARE(Loader::find(storage, root, "b", loadInteger), std::optional<pdf::PDFInteger>(2));
+    QCOMPARE(Loader::find(storage, root, "d", loadInteger), std::optional<pdf::PDFInteger>(4));
+    QCOMPARE(Loader::find(storage, root, "h", loadInteger), std::optional<pdf::PDFInteger>(8));
+
+    // Missing keys - before, between and after the limits of kids and inside the leaf limits
+    for (const QByteArray& key : { QByteArray("0"), QByteArray("bb"), QByteArray("c0"), QByteArray("w"), QByteArray("zz") })
+    {
+        QVERIFY(!Loader::find(storage, root, key, loadInteger).has_value());
+    }
+
+    // Cycle in the tree must not result in infinite recursion
+    QVERIFY(!Loader::find(storage, pdf::PDFObject::createReference(pdf::PDFObjectReference(9, 0)), "a", loadInteger).has_value());
+
+    // Named destinations of the catalog - destinations in the /Dests dictionary have precedence
+    const pdf::PDFCatalog* catalog = document.getCatalog();
+    const pdf::PDFDestination* first = catalog->getNamedDestination("first");
+    QVERIFY(first);
+    QCOMPARE(first->getPageIndex(), pdf::PDFInteger(0));
+    const pdf::PDFDestination* second = catalog->getNamedDestination("second");
+    QVERIFY(second);
+    QCOMPARE(second->getPageIndex(), pdf::PDFInteger(1));
+    QVERIFY(!catalog->getNamedDestination("third"));
+    QCOMPARE(catalog->getNamedDestinations().size(), size_t(2));
+    QCOMPARE(catalog->getNamedDestination("second"), second);
+}
+
+void LexicalAnalyzerTest::test_streamed_assemble()
+{
+    // Resources are inherited from the page tree, first document has form field
+    // widget on the first page and outline, both documents have named destinations.
+    const std::vector<QByteArray> firstDocumentObjects = {
+        "<< /Type /Catalog /Pages 2 0 R /AcroForm << /Fields [10 0 R] >> /Names 6 0 R /Outlines 7 0 R >>",
+        "<< /Type /Pages /Kids [3 0 R 4 0 R] /Count 2 /MediaBox [0 0 200 100] /Resources << /Font << /F1 5 0 R >> >> >>",
+        "<< /Type /Page /Parent 2 0 R /Contents 9 0 R /Annots [10 0 R] >>",
+        "<< /Type /Page /Parent 2 0 R /Contents 11 0 R >>",
+        "<< /Type /Font /Subtype /Type1 /BaseFont /Helvetica >>",
+        "<< /Dests << /Names [(a) [4 0 R /Fit]] >> >>",
+        "<< /Type /Outlines /First 8 0 R /Last 8 0 R /Count 1 >>",
+        "<< /Title (Chapter A) /Parent 7 0 R /Dest [4 0 R /Fit] >>",
+        createStream("", "BT /F1 12 Tf (A0) Tj ET"),
+        "<< /Type /Annot /Subtype /Widget /FT /Tx /T (fieldA) /Rect [0 0 10 10] /P 3 0 R >>",
+        createStream("", "BT /F1 12 Tf (A1) Tj ET")
+    };
+
+    const std::vector<QByteArray> secondDocumentObjects = {
+        "<< /Type /Catalog /Pages 2 0 R /AcroForm 5 0 R /Names 6 0 R >>",
+        "<< /Type /Pages /Kids [3 0 R] /Count 1 /MediaBox [0 0 200 100] /Resources << /Font << /F1 4 0 R >> >> >>",
+        "<< /Type /Page /Parent 2 0 R /Contents 7 0 R >>",
+        "<< /Type /Font /Subtype /Type1 /BaseFont /Courier >>",
+        "<< /Fields [8 0 R] >>",
+        "<< /Dests << /Names [(b) [3 0 R /Fit]] >> >>",
+        createStream("", "BT /F1 12 Tf (B0) Tj ET"),
+        "<< /FT /Tx /T (fieldB) >>"
+    };
+
+    const std::vector<std::vector<QByteArray>> documentObjects = { firstDocumentObjects, secondDocumentObjects };
+    auto loadDocument = [this, &documentObjects](pdf::PDFInteger documentIndex) { return createDocument(documentObjects.at(documentIndex)); };
+
+    // Second document is placed before the first one
+    pdf::PDFDocumentManipulator::AssembledPages pages = {
+        pdf::PDFDocumentManipulator::createDocumentPage(1, 0, QSizeF(200, 100), pdf::PageRotation::None),
+        pdf::PDFDocumentManipulator::createDocumentPage(0, 0, QSizeF(200, 100), pdf::PageRotation::None),
+        pdf::PDFDocumentManipulator::createDocumentPage(0, 1, QSizeF(200, 100), pdf::PageRotation::None)
+    };
+
+    auto checkDocument = [](const pdf::PDFDocument& document)
+    {
+        const pdf::PDFObjectStorage& storage = document.getStorage();
+        const pdf::PDFCatalog* catalog = document.getCatalog();
+        QCOMPARE(catalog->getPageCount(), size_t(3));
+
+        auto getDictionary = [&storage](const pdf::PDFObject& object, const char* key) -> const pdf::PDFDictionary*
+        {
+            const pdf::PDFDictionary* dictionary = storage.getDictionaryFromObject(object);
+            return dictionary ? storage.getDictionaryFromObject(dictionary->get(key)) : nullptr;
+        };
+
+        const std::vector<QByteArray> expectedContents = { "(B0)", "(A0)", "(A1)" };
+        const std::vector<QByteArray> expectedFonts = { "Courier", "Helvetica", "Helvetica" };
+        for (size_t i = 0; i < catalog->getPageCount(); ++i)
+        {
+            const pdf::PDFPage* page = catalog->getPage(i);
+            QCOMPARE(page->getMediaBox(), QRectF(0, 0, 200, 100));
+
+            const pdf::PDFObject& contents = storage.getObject(page->getContents());
+            QVERIFY(contents.isStream());
+            QVERIFY(document.getDecodedStream(contents.getStream()).contains(expectedContents[i]));
+
+            const pdf::PDFDictionary* fonts = getDictionary(page->getResources(), "Font");
+            QVERIFY(fonts);
+            const pdf::PDFDictionary* font = storage.getDictionaryFromObject(fonts->get("F1"));
+            QVERIFY(font);
+            QCOMPARE(storage.getObject(font->get("BaseFont")).getString(), expectedFonts[i]);
+        }
+
+        // Form fields of both documents are merged
+        const pdf::PDFDictionary* formDictionary = storage.getDictionaryFromObject(catalog->getFormObject());
+        QVERIFY(formDictionary);
+        const pdf::PDFObject& fields = storage.getObject(formDictionary->get("Fields"));
+        QVERIFY(fields.isArray());
+
+        std::set<QByteArray> fieldNames;
+        for (size_t i = 0; i < fields.getArray()->getCount(); ++i)
+        {
+            const pdf::PDFDictionary* field = storage.getDictionaryFromObject(fields.getArray()->getItem(i));
+            QVERIFY(field);
+            fieldNames.insert(storage.getObject(field->get("T")).getString());
+        }
+        QVERIFY(fieldNames == std::set<QByteArray>({ "fieldA", "fieldB" }));
+
+        const std::vector<pdf::PDFObjectReference>& annotations = catalog->getPage(1)->getAnnotations();
+        QCOMPARE(annotations.size(), size_t(1));
+        const pdf::PDFDictionary* annotation = storage.getDictionaryFromObject(storage.getObject(annotations.front()));
+        QVERIFY(annotation);
+        QCOMPARE(storage.getObject(annotation->get("T")).getString(), QByteArray("fieldA"));
+        QCOMPARE(annotation->get("P").getReference(), catalog->getPage(1)->getPageReference());
+
+        // Named destinations of both documents are merged and point to the assembled pages
+        const pdf::PDFDestination* firstDestination = catalog->getNamedDestination("a");
+        const pdf::PDFDestination* secondDestination = catalog->getNamedDestination("b");
+        QVERIFY(firstDestination);
+        QVERIFY(secondDestination);
+        QCOMPARE(firstDestination->getPageReference(), catalog->getPage(2)->getPageReference());
+        QCOMPARE(secondDestination->getPageReference(), catalog->getPage(0)->getPageReference());
+
+        // Outline has item for each document, outline of the first document is joined
+        QSharedPointer<pdf::PDFOutlineItem> outlineRoot = catalog->getOutlineRootPtr();
+        QVERIFY(outlineRoot);
+        QCOMPARE(outlineRoot->getChildCount(), size_t(2));
+        QCOMPARE(outlineRoot->getChild(0)->getChildCount(), size_t(0));
+        QCOMPARE(outlineRoot->getChild(1)->getChildCount(), size_t(1));
+
+        const pdf::PDFOutlineItem* chapterItem = outlineRoot->getChild(1)->getChild(0);
+        QCOMPARE(chapterItem->getTitle(), QString("Chapter A"));
+        const pdf::PDFActionGoTo* chapterAction = dynamic_cast<const pdf::PDFActionGoTo*>(chapterItem->getAction());
+        QVERIFY(chapterAction);
+        QCOMPARE(chapterAction->getDestination().getPageReference(), catalog->getPage(2)->getPageReference());
+    };
+
+    // Streamed assembling - documents are loaded by the loader
+    QBuffer buffer;
+    QVERIFY(buffer.open(QBuffer::WriteOnly));
+
+    pdf::PDFDocumentManipulator streamedManipulator;
+    streamedManipulator.setOutlineMode(pdf::PDFDocumentManipulator::OutlineMode::Join);
+    pdf::PDFOperationResult result = streamedManipulator.assemble(pages, loadDocument, &buffer);
+    QVERIFY2(result, qPrintable(result.getErrorMessage()));
+    buffer.close();
+
+    pdf::PDFDocumentReader reader(nullptr, [](bool* ok) { *ok = false; return QString(); }, false, false);
+    pdf::PDFDocument streamedDocument = reader.readFromBuffer(buffer.data());
+    QVERIFY2(reader.getReadingResult() == pdf::PDFDocumentReader::Result::OK, qPrintable(reader.getErrorMessage()));
+    checkDocument(streamedDocument);
+
+    // Assembling in memory must give the same document
+    pdf::PDFDocument firstDocument = createDocument(firstDocumentObjects);
+    pdf::PDFDocument secondDocument = createDocument(secondDocumentObjects);
+
+    pdf::PDFDocumentManipulator manipulator;
+    manipulator.setOutlineMode(pdf::PDFDocumentManipulator::OutlineMode::Join);
+    manipulator.addDocument(0, &firstDocument);
+    manipulator.addDocument(1, &secondDocument);
+    result = manipulator.assemble(pages);
+    QVERIFY2(result, qPrintable(result.getErrorMessage()));
+    checkDocument(manipulator.getAssembledDocument());
+
+    // Streamed assembling without loader uses added documents
+    QBuffer secondBuffer;
+    QVERIFY(secondBuffer.open(QBuffer::WriteOnly));
+    QVERIFY(manipulator.assemble(pages, pdf::PDFDocumentManipulator::DocumentLoader(), &secondBuffer));
+    secondBuffer.close();
+    checkDocument(reader.readFromBuffer(secondBuffer.data()));
+    QVERIFY(reader.getReadingResult() == pdf::PDFDocumentReader::Result::OK);
+}
+
+void LexicalAnalyzerTest::test_assemble_shared_objects()
+{
+    // Each document has one page with embedded font, image, annotation with popup
+    // (popup references its parent, so they form a cycle) and a form field.
+    const QByteArray fontData("Embedded font program data");
+    const QByteArray imageData("\x10\x20", 2);
+    auto createDocumentObjects = [this, &fontData](const QByteArray& documentImageData)
+    {
+        return std::vector<QByteArray>{
+            "<< /Type /Catalog /Pages 2 0 R /AcroForm << /Fields [9 0 R] >> >>",
+            "<< /Type /Pages /Kids [3 0 R] /Count 1 >>",
+            "<< /Type /Page /Parent 2 0 R /MediaBox [0 0 200 100] /Resources << /Font << /F1 4 0 R >> /XObject << /Im1 6 0 R >> >> /Contents 7 0 R /Annots [8 0 R 10 0 R] >>",
+            "<< /Type /Font /Subtype /TrueType /BaseFont /Embedded /FontDescriptor 11 0 R >>",
+            createStream("", fontData),
+            createStream("/Type /XObject /Subtype /Image /Width 2 /Height 1 /ColorSpace /DeviceGray /BitsPerComponent 8", documentImageData),
+            createStream("", "q 2 0 0 1 0 0 cm /Im1 Do Q BT /F1 12 Tf (Text) Tj ET"),
+            "<< /Type /Annot /Subtype /Text /Rect [0 0 10 10] /Popup 10 0 R /P 3 0 R >>",
+            "<< /FT /Tx /T (field) >>",
+            "<< /Type /Annot /Subtype /Popup /Rect [0 0 50 50] /Parent 8 0 R /P 3 0 R >>",
+            "<< /Type /FontDescriptor /FontName /Embedded /FontFile2 5 0 R >>"
+        };
+    };
+
+    // Second document is the same as the first one, image of the third
+    // document differs in one byte.
+    const std::vector<std::vector<QByteArray>> documentObjects = {
+        createDocumentObjects(imageData),
+        createDocumentObjects(imageData),
+        createDocumentObjects(QByteArray("\x10\x21", 2))
+    };
+    auto loadDocument = [this, &documentObjects](pdf::PDFInteger documentIndex) { return createDocument(documentObjects.at(documentIndex)); };
+
+    pdf::PDFDocumentManipulator::AssembledPages pages;
+    for (int i = 0; i < int(documentObjects.size()); ++i)
+    {
+        pages.push_back(pdf::PDFDocumentManipulator::createDocumentPage(i, 0, QSizeF(200, 100), pdf::PageRotation::None));
+    }
+
+    QBuffer buffer;
+    QVERIFY(buffer.open(QBuffer::WriteOnly));
+    pdf::PDFDocumentManipulator manipulator;
+    manipulator.setOutlineMode(pdf::PDFDocumentManipulator::OutlineMode::NoOutline);
+    pdf::PDFOperationResult result = manipulator.assemble(pages, loadDocument, &buffer);
+    QVERIFY2(result, qPrintable(result.getErrorMessage()));
+    buffer.close();
+
+    pdf::PDFDocumentReader reader(nullptr, [](bool* ok) { *ok = false; return QString(); }, false, false);
+    pdf::PDFDocument document = reader.readFromBuffer(buffer.data());
+    QVERIFY2(reader.getReadingResult() == pdf::PDFDocumentReader::Result::OK, qPrintable(reader.getErrorMessage()));
+
+    const pdf::PDFObjectStorage& storage = document.getStorage();
+    const pdf::PDFCatalog* catalog = document.getCatalog();
+    QCOMPARE(catalog->getPageCount(), size_t(3));
+
+    // Count written objects
+    size_t fontDataCount = 0;
+    size_t imageDataCount = 0;
+    size_t fontCount = 0;
+    size_t annotationCount = 0;
+    size_t popupCount = 0;
+    for (const pdf::PDFObjectStorage::Entry& entry : storage.getObjects())
+    {
+        if (entry.object.isStream())
+        {
+            const QByteArray& content = *entry.object.getStream()->getContent();
+            fontDataCount += (content == fontData) ? 1 : 0;
+            imageDataCount += (content.size() == 2 && content.startsWith('\x10')) ? 1 : 0;
+        }
+        else if (const pdf::PDFDictionary* dictionary = storage.getDictionaryFromObject(entry.object))
+        {
+            const pdf::PDFObject& subtype = storage.getObject(dictionary->get("Subtype"));
+            if (subtype.isName())
+            {
+                fontCount += (subtype.getString() == "TrueType") ? 1 : 0;
+                annotationCount += (subtype.getString() == "Text") ? 1 : 0;
+                popupCount += (subtype.getString() == "Popup") ? 1 : 0;
+            }
+        }
+    }
+
+    // Font and image are written once, the changed image is not shared
+    QCOMPARE(fontDataCount, size_t(1));
+    QCOMPARE(fontCount, size_t(1));
+    QCOMPARE(imageDataCount, size_t(2));
+
+    // Pages and annotations are never merged
+    QCOMPARE(annotationCount, size_t(3));
+    QCOMPARE(popupCount, size_t(3));
+
+    std::set<pdf::PDFObjectReference> pageReferences;
+    std::vector<pdf::PDFObjectReference> fontReferences;
+    std::vector<pdf::PDFObjectReference> imageReferences;
+    for (size_t i = 0; i < catalog->getPageCount(); ++i)
+    {
+        const pdf::PDFPage* page = catalog->getPage(i);
+        pageReferences.insert(page->getPageReference());
+        QCOMPARE(page->getAnnotations().size(), size_t(2));
+
+        for (const pdf::PDFObjectReference& annotationReference : page->getAnnotations())
+        {
+            const pdf::PDFDictionary* annotation = storage.getDictionaryFromObject(storage.getObject(annotationReference));
+            QVERIFY(annotation);
+            QCOMPARE(annotation->get("P").getReference(), page->getPageReference());
+        }
+
+        const pdf::PDFDictionary* resources = storage.getDictionaryFromObject(page->getResources());
+        QVERIFY(resources);
+        const pdf::PDFDictionary* fonts = storage.getDictionaryFromObject(resources->get("Font"));
+        const pdf::PDFDictionary* xobjects = storage.getDictionaryFromObject(resources->get("XObject"));
+        QVERIFY(fonts && xobjects);
+        QVERIFY(fonts->get("F1").isReference() && xobjects->get("Im1").isReference());
+        fontReferences.push_back(fonts->get("F1").getReference());
+        imageReferences.push_back(xobjects->get("Im1").getReference());
+    }
+
+    QCOMPARE(pageReferences.size(), size_t(3));
+    QCOMPARE(fontReferences[0], fontReferences[1]);
+    QCOMPARE(fontReferences[0], fontReferences[2]);
+    QCOMPARE(imageReferences[0], imageReferences[1]);
+    QVERIFY(imageReferences[0] != imageReferences[2]);
+
+    // Form fields are part of the document skeleton, they are never merged
+    const pdf::PDFDictionary* formDictionary = storage.getDictionaryFromObject(catalog->getFormObject());
+    QVERIFY(formDictionary);
+    const pdf::PDFObject& fields = storage.getObject(formDictionary->get("Fields"));
+    QVERIFY(fields.isArray());
+    QCOMPARE(fields.getArray()->getCount(), size_t(3));
+
+    std::set<pdf::PDFObjectReference> fieldReferences;
+    for (size_t i = 0; i < fields.getArray()->getCount(); ++i)
+    {
+        fieldReferences.insert(fields.getArray()->getItem(i).getReference());
+    }
+    QCOMPARE(fieldReferences.size(), size_t(3));
+}
+
+void LexicalAnalyzerTest::test_text_index()
+{
+    const std::vector<QStringList> pages = {
+        { "The context of the text is important.", "Pretext and subtext." },
+        { "Textbook examples", "Nothing here." },
+        { "CONTEXT MATTERS" }
+    };
+
+    pdf::PDFDocumentTextFlow::Items items;
+    for (size_t pageIndex = 0; pageIndex < pages.size(); ++pageIndex)
+    {
+        for (const QString& text : pages[pageIndex])
+        {
+            pdf::PDFDocumentTextFlow::Item item;
+            item.pageIndex = pageIndex;
+            item.text = text;
+            item.flags = pdf::PDFDocumentTextFlow::Text;
+            items.emplace_back(qMove(item));
+        }
+    }
+
+    pdf::PDFTextIndex index = pdf::PDFTextIndex::create(pdf::PDFDocumentTextFlow(qMove(items)), pdf::PDFInteger(pages.size()));
+    QCOMPARE(index.getPageCount(), pdf::PDFInteger(3));
+
+    using FlowReferences = pdf::PDFTextIndex::FlowReferences;
+    auto checkCandidates = [&index](const QString& text, const FlowReferences& expectedFlows)
+    {
+        std::optional<FlowReferences> flows = index.getCandidateFlows(text);
+        QVERIFY(flows.has_value());
+        QVERIFY(*flows == expectedFlows);
+    };
+
+    checkCandidates("text", { { 0, 0 }, { 0, 1 }, { 1, 0 }, { 2, 0 } });
+    checkCandidates(" text ", { { 0, 0 } });
+    checkCandidates("text is", { { 0, 0 } });
+    checkCandidates("ext and sub", { { 0, 1 } });
+    checkCandidates("ntex", { { 0, 0 }, { 2, 0 } });
+    checkCandidates("book ex", { { 1, 0 } });
+    checkCandidates("xyz", { });
+    QVERIFY(!index.getCandidateFlows("...").has_value());
+
+    // Index must find the same matches as searching of all text flows
+    for (const QString& text : { "text", "TEXT", " text ", "text is", "ext and sub", "ntex", "book ex", "e", "..." })
+    {
+        std::vector<std::tuple<pdf::PDFInteger, pdf::PDFInteger, pdf::PDFInteger>> expectedMatches;
+        for (size_t pageIndex = 0; pageIndex < pages.size(); ++pageIndex)
+        {
+            for (int flowIndex = 0; flowIndex < pages[pageIndex].size(); ++flowIndex)
+            {
+                for (int i = pages[pageIndex][flowIndex].indexOf(text, 0, Qt::CaseInsensitive); i != -1; i = pages[pageIndex][flowIndex].indexOf(text, i + 1, Qt::CaseInsensitive))
+                {
+                    expectedMatches.emplace_back(pageIndex, flowIndex, i);
+                }
+            }
+        }
+
+        std::vector<std::tuple<pdf::PDFInteger, pdf::PDFInteger, pdf::PDFInteger>> matches;
+        for (const pdf::PDFTextIndex::Match& match : index.find(text, Qt::CaseInsensitive))
+        {
+            matches.emplace_back(match.pageIndex, match.flowIndex, match.characterIndex);
+        }
+
+        QVERIFY(matches == expectedMatches);
+    }
+
+    // Stored index must give the same results, only accepted index is loaded
+    QTemporaryDir temporaryDirectory;
+    QVERIFY(temporaryDirectory.isValid());
+    const QString indexFileName = temporaryDirectory.filePath("document.pdfidx");
+
+    pdf::PDFTextIndex::DocumentIdentification identification;
+    identification.hash = pdf::PDFTextIndex::computeDocumentHash("document");
+    identification.fileSize = 8;
+    identification.lastModified = 1000;
+    index.setDocumentIdentification(identification);
+    QVERIFY(index.save(indexFileName));
+
+    QVERIFY(!pdf::PDFTextIndex::load(indexFileName, [](const pdf::PDFTextIndex::DocumentIdentification&) { return false; }).has_value());
+
+    std::optional<pdf::PDFTextIndex> loadedIndex = pdf::PDFTextIndex::load(indexFileName, [&identification](const pdf::PDFTextIndex::DocumentIdentification& storedIdentification) { return storedIdentification.isFileInfoEqual(identification); });
+    QVERIFY(loadedIndex.has_value());
+    QCOMPARE(loadedIndex->getPageCount(), index.getPageCount());
+    QCOMPARE(loadedIndex->getTermCount(), index.getTermCount());
+    QCOMPARE(loadedIndex->getDocumentIdentification().hash, identification.hash);
+    for (pdf::PDFInteger pageIndex = 0; pageIndex < index.getPageCount(); ++pageIndex)
+    {
+        QCOMPARE(loadedIndex->getFlowTexts(pageIndex), pages[pageIndex]);
+    }
+    QVERIFY(*loadedIndex->getCandidateFlows("text is") == *index.getCandidateFlows("text is"));
+    QCOMPARE(loadedIndex->find("ntex", Qt::CaseInsensitive).size(), size_t(2));
+}
+
+pdf::PDFDocument LexicalAnalyzerTest::createDocument(const std::vector<QByteArray>& objects)
+{
+    pdf::PDFObjectStorage::PDFObjects storageObjects;
+    storageObjects.emplace_back(0, pdf::PDFObject());
+    for (const QByteArray& object : objects)
+    {
+        pdf::PDFParser parser(object, nullptr, pdf::PDFParser::AllowStreams);
+        storageObjects.emplace_back(0, parser.getObject());
+    }
+
+    QByteArray trailer("<< /Root 1 0 R >>");
+    pdf::PDFParser trailerParser(trailer, nullptr, pdf::PDFParser::None);
+    pdf::PDFObjectStorage storage(qMove(storageObjects), trailerParser.getObject(), pdf::PDFSecurityHandlerPointer(new pdf::PDFNoneSecurityHandler()));
+    return pdf::PDFDocument(qMove(storage), pdf::PDFVersion(1, 7));
+}
+
+QByteArray LexicalAnalyzerTest::createStream(const QByteArray& dictionaryEntries, const QByteArray& data)
+{
+    return "<< " + dictionaryEntries + " /Length " + QByteArray::number(data.size()) + " >>\nstream\n" + data + "\nendstream";
+}
+
 void LexicalAnalyzerTest::scanWholeStream(const char* stream)
 {
     pdf::PDFLexicalAnalyzer analyzer(stream, stream + strlen(stream));